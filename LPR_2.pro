@@ -7,24 +7,41 @@ CONFIG += c++17
 # 取消下面的注释来启用Tesseract OCR
 # DEFINES += USE_TESSERACT_OCR
 
-# 如果启用Tesseract OCR，添加必要的库
+# 如果启用Tesseract OCR，链接仓库自带的tesseract-main：RecognizeLine和
+# lstm_line_pattern只有这个版本才有，系统或vcpkg里的tesseract编译不过。
+# 先用CMake构建它，构建目录可以用 qmake TESSERACT_BUILD_DIR=... 指定：
+#   cmake -S tesseract-main -B tesseract-main/build
+#   cmake --build tesseract-main/build --config Release
 contains(DEFINES, USE_TESSERACT_OCR) {
-    # Windows下的Tesseract配置
+    isEmpty(TESSERACT_BUILD_DIR): TESSERACT_BUILD_DIR = $$PWD/tesseract-main/build
+    # 放在最前面，优先于系统里的tesseract头文件；version.h由CMake生成在构建目录
+    INCLUDEPATH += $$PWD/tesseract-main/include $$TESSERACT_BUILD_DIR/include
+
+    # Windows下的Tesseract配置，leptonica仍来自vcpkg
     win32 {
         INCLUDEPATH += C:/Users/lenovo/Desktop/OCR/vcpkg/installed/x64-windows/include
-        LIBS += -LC:/Users/lenovo/Desktop/OCR/vcpkg/installed/x64-windows/lib -ltesseract -lleptonica
+        CONFIG(debug, debug|release) {
+            LIBS += -L$$TESSERACT_BUILD_DIR/Debug -ltesseract55d
+        } else {
+            LIBS += -L$$TESSERACT_BUILD_DIR/Release -ltesseract55
+        }
+        LIBS += -LC:/Users/lenovo/Desktop/OCR/vcpkg/installed/x64-windows/lib -lleptonica
     }
     
     # Linux下的Tesseract配置
     unix:!macx {
+        LIBS += -L$$TESSERACT_BUILD_DIR -ltesseract
+        QMAKE_RPATHDIR += $$TESSERACT_BUILD_DIR
         CONFIG += link_pkgconfig
-        PKGCONFIG += tesseract lept
+        PKGCONFIG += lept
     }
     
     # macOS下的Tesseract配置
     macx {
+        LIBS += -L$$TESSERACT_BUILD_DIR -ltesseract
+        QMAKE_RPATHDIR += $$TESSERACT_BUILD_DIR
         INCLUDEPATH += /usr/local/include
-        LIBS += -L/usr/local/lib -ltesseract -llept
+        LIBS += -L/usr/local/lib -llept
     }
 }
 
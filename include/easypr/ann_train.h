@@ -15,20 +15,36 @@ class AnnTrain : public ITrain {
 
   virtual void test();
 
+  //! cross validated search of the hidden size, the iterations and the
+  //! weight scale. prints the table, then trains and saves the most
+  //! accurate configuration that predicts a character within budgetUs,
+  //! 0 for no budget
+  void search(double budgetUs = 0);
+
   std::pair<std::string, std::string> identifyChinese(cv::Mat input);
   std::pair<std::string, std::string> identify(cv::Mat input);
 
+  //! keep the features in this file, a retrain on the same files skips
+  //! the image decoding
+  inline void setFeatureCache(const std::string& path) { feature_cache_ = path; }
+
  private:
   virtual cv::Ptr<cv::ml::TrainData> tdata();
 
   cv::Ptr<cv::ml::TrainData> sdata(size_t number_for_count = 100);
 
+  // the features of the characters with synthetic images up to
+  // number_for_count per class, returns the class count
+  int loadSamples(size_t number_for_count, cv::Mat& samples, std::vector<int>& labels);
+
   cv::Ptr<cv::ml::ANN_MLP> ann_;
   const char* ann_xml_;
   const char* chars_folder_;
 
   std::shared_ptr<Kv> kv_;
   int type;
+
+  std::string feature_cache_;
 };
 }
 
@@ -71,6 +71,15 @@ class CCharsRecognise {
   inline float getWhitePercent() const {
     return m_charsSegment->getWhitePercent();
   }
+  inline void setMinCharCount(int param) {
+    m_charsSegment->setMinCharCount(param);
+  }
+  inline void setMaxSpacingError(float param) {
+    m_charsSegment->setMaxSpacingError(param);
+  }
+
+  //! the segmenter of charsRecognise, its settings are the ones above
+  inline CCharsSegment* getCharsSegment() const { return m_charsSegment; }
 
  private:
   //！字符分割
@@ -44,6 +44,10 @@ class CCharsSegment {
 
   int SortRect(const std::vector<Rect>& vecRect, std::vector<Rect>& out);
 
+  //! cheap structural check of the rebuilt rects, done before any ANN call:
+  //  enough characters, and regular spacing after the city character
+  bool verifyCharsLayout(const std::vector<Rect>& vecRect) const;
+
   inline void setLiuDingSize(int param) { m_LiuDingSize = param; }
   inline void setColorThreshold(int param) { m_ColorThreshold = param; }
 
@@ -52,6 +56,13 @@ class CCharsSegment {
   inline void setWhitePercent(float param) { m_WhitePercent = param; }
   inline float getWhitePercent() const { return m_WhitePercent; }
 
+  //! 0 disables the check
+  inline void setMinCharCount(int param) { m_minCharCount = param; }
+  inline int getMinCharCount() const { return m_minCharCount; }
+  //! max relative deviation of a char gap from the median gap, 0 disables the check
+  inline void setMaxSpacingError(float param) { m_maxSpacingError = param; }
+  inline float getMaxSpacingError() const { return m_maxSpacingError; }
+
   static const int DEFAULT_DEBUG = 1;
 
   static const int CHAR_SIZE = 20;
@@ -76,6 +87,9 @@ class CCharsSegment {
   float m_BluePercent;
   float m_WhitePercent;
 
+  int m_minCharCount;
+  float m_maxSpacingError;
+
   int m_debug;
 };
 
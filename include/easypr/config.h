@@ -7,7 +7,7 @@ namespace easypr {
 
   enum Color { BLUE, YELLOW, WHITE, UNKNOWN };
 
-  enum LocateType { SOBEL, COLOR, CMSER, OTHER };
+  enum LocateType { SOBEL, COLOR, CMSER, ERFILTER, OTHER };
 
   enum CharSearchDirection { LEFT, RIGHT };
 
@@ -24,12 +24,17 @@ namespace easypr {
     PR_DETECT_SOBEL = 0x01,  /**Sobel detect type, using twice Sobel  */
     PR_DETECT_COLOR = 0x02,  /**Color detect type   */
     PR_DETECT_CMSER = 0x04,  /**Character detect type, using mser  */
+    PR_DETECT_ER = 0x08,     /**Character group detect type, using the NM er filter, only when asked for  */
   };
 
 static const char* kDefaultSvmPath = "model/svm_hist.xml";
 static const char* kLBPSvmPath = "model/svm_lbp.xml";
 static const char* kHistSvmPath = "model/svm_hist.xml";
 
+// the plate feature each svm above is trained on, a name of featureName
+static const char* kHistSvmFeature = "getHistomPlusColoFeatures";
+static const char* kLBPSvmFeature = "getLBPFeatures";
+
 static const char* kDefaultAnnPath = "model/ann.xml";
 static const char* kChineseAnnPath = "model/ann_chinese.xml";
 static const char* kGrayAnnPath = "model/annCh.xml";
@@ -37,6 +42,14 @@ static const char* kGrayAnnPath = "model/annCh.xml";
 //This is important to for key transform to chinese
 static const char* kChineseMappingPath = "model/province_mapping";
 
+// the boost classifiers of the two er filter stages, used by PR_DETECT_ER
+static const char* kErFilterNM1Path = "model/trained_classifierNM1.xml";
+static const char* kErFilterNM2Path = "model/trained_classifierNM2.xml";
+
+// all the models above in one mapped binary file, built by ModelCompiler.
+// when it exists the engine uses it instead of the xml files
+static const char* kModelBundlePath = "model/easypr.bundle";
+
 typedef enum {
   kForward = 1, // correspond to "has plate"
   kInverse = 0  // correspond to "no plate"
@@ -41,17 +41,8 @@ private:
   annCallback extractFeature;
   static CharsIdentify* instance_;
 
-  // binary character classifer
-  cv::Ptr<cv::ml::ANN_MLP> ann_;
-
-  // binary character classifer, only for chinese
-  cv::Ptr<cv::ml::ANN_MLP> annChinese_;
-
-  // gray classifer, only for chinese
-  cv::Ptr<cv::ml::ANN_MLP> annGray_;
-
-  // used for chinese mapping
-  std::shared_ptr<Kv> kv_;
+  // the classifiers and the chinese mapping are in ModelRegistry, every
+  // call uses the set pinned by the frame or the current one
 };
 }
 
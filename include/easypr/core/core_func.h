@@ -1,6 +1,7 @@
 #ifndef EASYPR_CORE_COREFUNC_H_
 #define EASYPR_CORE_COREFUNC_H_
 
+#include <functional>
 #include "opencv2/opencv.hpp"
 #include "easypr/core/plate.hpp"
 #include "easypr/core/character.hpp"
@@ -41,6 +42,9 @@ Rect GetCenterRect(Mat& in);
 Mat CutTheRect(Mat& in, Rect& rect);
 int ThresholdOtsu(Mat mat);
 
+// otsu level of a 256 bin 8u histogram, same as threshold(CV_THRESH_OTSU)
+int otsuFromHistogram(const int* hist, int total);
+
 // project histogram
 Mat ProjectedHistogram(Mat img, int t, int threshold = 20);
 
@@ -71,9 +75,10 @@ Mat scaleImage(const Mat& image, const Size& maxSize, double& scale_ratio);
 // Scale back RotatedRect
 RotatedRect scaleBackRRect(const RotatedRect& rr, const float scale_ratio);
 
-//! use verify size to first generate char candidates
+//! use verify size to first generate char candidates, only inside rois when given
 void mserCharMatch(const Mat &src, std::vector<Mat> &match, std::vector<CPlate>& out_plateVec_blue, std::vector<CPlate>& out_plateVec_yellow,
-  bool usePlateMser, std::vector<RotatedRect>& out_plateRRect_blue, std::vector<RotatedRect>& out_plateRRect_yellow, int index = 0, bool showDebug = false);
+  bool usePlateMser, std::vector<RotatedRect>& out_plateRRect_blue, std::vector<RotatedRect>& out_plateRRect_yellow, int index = 0, bool showDebug = false,
+  const std::vector<Rect>& rois = std::vector<Rect>());
 
 // computer the insert over union about two rrect
 bool computeIOU(const RotatedRect& rrect1, const RotatedRect& rrect2, const int width, const int height, const float thresh, float& result);
@@ -121,6 +126,17 @@ Rect rectFit(const Rect &src, const int mat_width, const int mat_height);
 // write images to temp folder
 void writeTempImage(const Mat& outImg, const string path, int index = 0);
 
+// run task(0) .. task(count - 1) on the opencv thread pool, which lives
+// for the whole process and is bounded by cv::setNumThreads, so no thread
+// is started per call. a single task runs in place. an exception of a task
+// is rethrown once all tasks are done
+void parallelFor(int count, const std::function<void(int)> &task);
+
+// difference of the otsu pixel counts of rect and of its normalized
+// char rect, relative to the rect area. also gives the otsu level of rect
+float mserDiffOstuRatio(const Mat &image, const Rect &rect, bool useExtendHeight,
+                        Rect &normalRect, double &ostuLevel);
+
 // remove small hor lines in the plate
 bool judegMDOratio2(const Mat &image, const Rect &rect, std::vector<Point> &contour, Mat &result, const float thresh = 1.f,
                     bool useExtendHeight = false);
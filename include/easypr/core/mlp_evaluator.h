@@ -0,0 +1,69 @@
+//////////////////////////////////////////////////////////////////////////
+// Name:	    mlp_evaluator Header
+// Version:		1.0
+// Desciption:
+// Defines MlpEvaluator, the forward pass of a trained cv::ml::ANN_MLP
+// over weights that may live outside of the evaluator.
+//////////////////////////////////////////////////////////////////////////
+#ifndef EASYPR_CORE_MLPEVALUATOR_H_
+#define EASYPR_CORE_MLPEVALUATOR_H_
+
+#include <string>
+#include <vector>
+#include "opencv2/opencv.hpp"
+
+using namespace cv;
+
+namespace easypr {
+
+/*! \brief Forward pass of an ANN_MLP model.
+
+Computes the same outputs as cv::ml::ANN_MLP::predict: input scaling,
+one gemm plus bias and activation per layer, output scaling. The
+weights are CV_64F like in OpenCV, either owned or wrapped in place,
+for example inside a mapped model bundle.
+*/
+class MlpEvaluator {
+ public:
+  MlpEvaluator();
+
+  //! read the layers of an ANN_MLP xml/yml file, only IDENTITY and
+  //! SIGMOID_SYM activations are supported
+  bool load(const std::string& path);
+
+  //! use external weights in place, they must outlive the evaluator.
+  //  weights[i] is (layerSizes[i] + 1) x layerSizes[i + 1], the last row
+  //  is the bias, scales are (value, offset) pairs
+  void wrap(const std::vector<int>& layerSizes, int activation,
+            double fparam1, double fparam2, const double* inputScale,
+            const double* outputScale, const std::vector<const double*>& weights);
+
+  inline bool empty() const { return m_weights.empty(); }
+
+  //! samples: N x inputs CV_32F, outputs: N x outputs CV_32F
+  void predict(const Mat& samples, Mat& outputs) const;
+
+  inline const std::vector<int>& getLayerSizes() const { return m_layerSizes; }
+  inline int getActivation() const { return m_activation; }
+  inline double getParam1() const { return m_fparam1; }
+  inline double getParam2() const { return m_fparam2; }
+  inline const Mat& getInputScale() const { return m_inputScale; }
+  inline const Mat& getOutputScale() const { return m_outputScale; }
+  inline const Mat& getWeights(int layer) const { return m_weights[layer]; }
+
+ private:
+  void activate(Mat& sums, const Mat& weights) const;
+
+  std::vector<int> m_layerSizes;
+  int m_activation;
+  double m_fparam1;
+  double m_fparam2;
+
+  Mat m_inputScale;            // 1 x 2 * inputs
+  Mat m_outputScale;           // 1 x 2 * outputs
+  std::vector<Mat> m_weights;  // one per layer after the input
+};
+
+} /*! \namespace easypr*/
+
+#endif  // EASYPR_CORE_MLPEVALUATOR_H_
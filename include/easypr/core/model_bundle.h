@@ -0,0 +1,109 @@
+//////////////////////////////////////////////////////////////////////////
+// Name:	    model_bundle Header
+// Version:		1.0
+// Desciption:
+// Defines the binary model bundle: all the models and the province
+// mapping in one file that is mapped and used in place.
+//////////////////////////////////////////////////////////////////////////
+#ifndef EASYPR_CORE_MODELBUNDLE_H_
+#define EASYPR_CORE_MODELBUNDLE_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "easypr/config.h"
+#include "easypr/core/svm_evaluator.h"
+#include "easypr/core/mlp_evaluator.h"
+
+namespace easypr {
+
+/*! \brief On-disk layout, all offsets are from the start of the file.
+
+  BundleHeader                      64 bytes
+  BundleSection[sectionCount]       64 bytes each
+  section payloads                  each starts on a 64 byte boundary
+
+The checksum is FNV-1a 64 of every byte after the header. Arrays inside
+a payload are 64 byte aligned too, so the evaluators can point straight
+into the mapping.
+*/
+struct BundleHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t sectionCount;
+  uint64_t fileSize;
+  uint64_t checksum;
+  uint8_t reserved[32];
+};
+
+enum BundleSectionKind {
+  kSectionSvmRbf = 1,
+  kSectionMlp = 2,
+  kSectionText = 3
+};
+
+struct BundleSection {
+  char name[40];
+  uint32_t kind;
+  uint32_t reserved;
+  uint64_t offset;
+  uint64_t size;
+};
+
+static const char kBundleMagic[8] = { 'E', 'A', 'S', 'Y', 'P', 'R', 'M', 'B' };
+static const uint32_t kBundleVersion = 1;
+static const size_t kBundleAlignment = 64;
+
+class ModelBundle {
+ public:
+  ~ModelBundle();
+
+  //! map a bundle file read only, nullptr when it is missing, has another
+  //! version, or (with verify) a wrong checksum
+  static std::shared_ptr<ModelBundle> open(const std::string& path, bool verify = true);
+
+  //! evaluators point into the mapping, keep the bundle alive with them.
+  //! false when the section is missing or its arrays do not fit in it
+  bool getSvm(const std::string& name, SvmRbfEvaluator& evaluator) const;
+  bool getMlp(const std::string& name, MlpEvaluator& evaluator) const;
+  bool getText(const std::string& name, std::string& text) const;
+
+  inline size_t size() const { return m_size; }
+
+ private:
+  ModelBundle();
+
+  const BundleSection* find(const std::string& name, uint32_t kind) const;
+
+  const uint8_t* m_data;
+  size_t m_size;
+#ifdef _WIN32
+  void* m_file;
+  void* m_mapping;
+#endif
+
+  DISABLE_ASSIGN_AND_COPY(ModelBundle);
+};
+
+/*! \brief Builds a bundle file, used by the model compiler. */
+class ModelBundleWriter {
+ public:
+  void addSvm(const std::string& name, const SvmRbfEvaluator& evaluator);
+  void addMlp(const std::string& name, const MlpEvaluator& evaluator);
+  void addText(const std::string& name, const std::string& text);
+
+  bool write(const std::string& path) const;
+
+ private:
+  void addSection(const std::string& name, uint32_t kind, const std::vector<uint8_t>& payload);
+
+  std::vector<BundleSection> m_sections;
+  std::vector<std::vector<uint8_t>> m_payloads;
+};
+
+uint64_t bundleChecksum(const uint8_t* data, size_t size);
+
+} /*! \namespace easypr*/
+
+#endif  // EASYPR_CORE_MODELBUNDLE_H_
@@ -37,6 +37,34 @@ class CPlateDetect {
   */
   int plateDetect(Mat src, std::vector<CPlate> &resultVec, int img_index = 0);
 
+  /** @brief Plate detect over an image pyramid, for large input images.
+
+  The pyramid is built by halving src until it fits in kShowWindowWidth x kShowWindowHeight.
+  The locators of type (sobel, color and mser for type 0) run on the coarsest level. Each
+  candidate region is then searched again on the finer level where a plate is about
+  m_pyramidPlateWidth wide, only inside the region. All the levels are shared by the
+  locators, and the plate positions of resultVec are in src coordinates.
+  If type has none of the locator bits, this is plateDetect on src.
+
+  Recall is lower than plateDetect on the full image: a plate that no locator finds on the
+  coarse level is never searched at full resolution. This mostly hits small plates, and
+  mser, which plateDetect runs over the whole frame, only sees the coarse level and the
+  candidate regions. A candidate that is already at its best size on the coarse level is
+  kept as found and not searched again.
+
+  The cost is the locators on one kShowWindowWidth x kShowWindowHeight level, the pyramid
+  resizes, and the refine regions, so it grows with the number of candidates rather than
+  with the frame size. How it compares with plateDetect on a 1080p frame is not measured
+  in this tree; RegressionSuite reports it as the pipeline p50 of a 4K corpus run with
+  setPyramidMode(true), against the same corpus at 1080p.
+
+  @param src Source image, not resized.
+  @param resultVec Destination vector of CPlate.
+  @param type Detect type. (eg. PR_DETECT_SOBEL + PR_DETECT_COLOR)
+  @param index
+  */
+  int plateDetectPyramid(const Mat& src, std::vector<CPlate> &resultVec, int type, int img_index = 0);
+
   void LoadSVM(std::string s);
 
   inline void setPDLifemode(bool param) { m_plateLocate->setLifemode(param); }
@@ -49,6 +77,7 @@ class CPlateDetect {
   inline bool getPDDebug() { return m_plateLocate->getDebug(); }
 
   inline void setDetectType(int param) { m_type = param; }
+  inline int getDetectType() const { return m_type; }
 
   inline void setGaussianBlurSize(int param) {
     m_plateLocate->setGaussianBlurSize(param);
@@ -96,6 +125,10 @@ class CPlateDetect {
 
   inline void setJudgeAngle(int param) { m_plateLocate->setJudgeAngle(param); }
 
+  //! classifier calls per frame of PR_DETECT_ER, 0 for no limit
+  inline void setErBudget(int param) { m_plateLocate->setErBudget(param); }
+  inline int getErBudget() const { return m_plateLocate->getErBudget(); }
+
   inline void setMaxPlates(int param) { m_maxPlates = param; }
 
   inline int getMaxPlates() const { return m_maxPlates; }
@@ -103,8 +136,21 @@ class CPlateDetect {
   inline void setDetectShow(bool param) { m_showDetect = param; }
   inline bool getDetectShow() const { return m_showDetect; }
 
+  inline void setPyramidMode(bool param) { m_pyramidMode = param; }
+  inline bool getPyramidMode() const { return m_pyramidMode; }
+
+  inline void setPyramidPlateWidth(int param) { m_pyramidPlateWidth = param; }
+  inline int getPyramidPlateWidth() const { return m_pyramidPlateWidth; }
+
+  //! run the locators of type on src, the locate type of each plate is set.
+  //! this is plateDetect without the judge
+  void locateCandidates(const Mat& src, std::vector<CPlate> &candPlates, int type, int img_index);
+
  private:
 
+  //! build m_pyramid from src, return the number of levels
+  int buildPyramid(const Mat& src);
+
   int m_maxPlates;
 
   //SceneMode m_mode;
@@ -118,6 +164,11 @@ class CPlateDetect {
   // show the detect result image
   bool m_showDetect;
 
+  // pyramid detect mode, used by plate recognize for large images
+  bool m_pyramidMode;
+  int m_pyramidPlateWidth;
+  std::vector<Mat> m_pyramid;
+
 };
 
 }
@@ -14,6 +14,9 @@ class PlateJudge {
   int plateJudgeUsingNMS(const std::vector<CPlate>&, std::vector<CPlate>&, int maxPlates = 5);
   int plateSetScore(CPlate& plate);
 
+  //! score all the plates with one batched svm evaluation
+  void plateSetScores(std::vector<CPlate>& plates);
+
   int plateJudge(const Mat& plateMat);
   int plateJudge(const std::vector<Mat> &inVec,
     std::vector<Mat> &resultVec);
@@ -26,10 +29,7 @@ class PlateJudge {
 
   static PlateJudge* instance_;
 
-  svmCallback extractFeature;
-
-  cv::Ptr<ml::SVM> svm_;
-
+  // the svm and its feature extractor are in ModelRegistry
 };
 }
 
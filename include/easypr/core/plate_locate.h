@@ -15,6 +15,7 @@
 #define EASYPR_CORE_PLATELOCATE_H_
 
 #include "easypr/core/plate.hpp"
+#include "easypr/core/frame_workspace.h"
 
 /*! \namespace easypr
     Namespace where all the C++ EasyPR functionality resides
@@ -40,7 +41,9 @@ class CPlateLocate {
 
   bool isdeflection(const Mat& in, const double angle, double& slope);
 
-  int sobelOper(const Mat& in, Mat& out, int blurSize, int morphW, int morphH);
+  //! ws: keep the temporaries in the frame workspace, for whole frame input
+  int sobelOper(const Mat& in, Mat& out, int blurSize, int morphW, int morphH,
+                FrameWorkspace* ws = NULL);
 
 
   bool rotation(Mat& in, Mat& out, const Size rect_size, const Point2f center,
@@ -54,13 +57,17 @@ class CPlateLocate {
 
   int plateMserLocate(Mat src, std::vector<CPlate>& candPlates, int index = 0);
 
+  //! text line proposals of the NM er filter, both polarities. at most
+  //! m_erBudget classifier calls per frame
+  int plateErLocate(Mat src, std::vector<CPlate>& candPlates, int index = 0);
+
 
   int colorSearch(const Mat& src, const Color r, Mat& out,
                   std::vector<RotatedRect>& outRects);
 
   int mserSearch(const Mat &src, vector<Mat>& out,
     vector<vector<CPlate>>& out_plateVec, bool usePlateMser, vector<vector<RotatedRect>>& out_plateRRect,
-    int img_index = 0, bool showDebug = false);
+    int img_index = 0, bool showDebug = false, const vector<Rect>& rois = vector<Rect>());
 
   int plateLocate(Mat, std::vector<Mat>&, int = 0);
   int plateLocate(Mat, std::vector<CPlate>&, int = 0);
@@ -93,6 +100,15 @@ class CPlateLocate {
 
   inline bool getDebug() { return m_debug; }
 
+  //! restrict the mser search to these rects of the source image, for
+  //! example the plates of the last frame grown by a margin. empty
+  //! searches the whole image
+  inline void setMserRois(const std::vector<Rect>& rois) { m_mserRois = rois; }
+  inline const std::vector<Rect>& getMserRois() const { return m_mserRois; }
+
+  inline void setErBudget(int param) { m_erBudget = param; }
+  inline int getErBudget() const { return m_erBudget; }
+
 
   static const int DEFAULT_GAUSSIANBLUR_SIZE = 5;
   static const int SOBEL_SCALE = 1;
@@ -117,6 +133,8 @@ class CPlateLocate {
 
   static const int DEFAULT_DEBUG = 1;
 
+  static const int DEFAULT_ER_BUDGET = 20000;
+
  protected:
 
   int m_GaussianBlurSize;
@@ -134,6 +152,10 @@ class CPlateLocate {
 
 
   bool m_debug;
+
+  std::vector<Rect> m_mserRois;
+
+  int m_erBudget;
 };
 
 } /*! \namespace easypr*/
@@ -0,0 +1,62 @@
+//////////////////////////////////////////////////////////////////////////
+// Name:	    scratch_arena Header
+// Version:		1.0
+// Desciption:
+// Defines ScratchArena, a per-thread bump allocator that hands out
+// cv::Mat headers over one reusable buffer.
+//////////////////////////////////////////////////////////////////////////
+#ifndef EASYPR_CORE_SCRATCHARENA_H_
+#define EASYPR_CORE_SCRATCHARENA_H_
+
+#include <vector>
+#include "opencv2/opencv.hpp"
+#include "easypr/config.h"
+
+namespace easypr {
+
+class ScratchArena {
+ public:
+  explicit ScratchArena(size_t capacity = kDefaultCapacity);
+
+  //! the arena of the calling thread
+  static ScratchArena& local();
+
+  //! get a rows x cols Mat of the given type inside the arena.
+  //! when the arena is full, a heap Mat is returned and the overflow is
+  //! remembered, so the buffer grows at the next rewind to zero.
+  cv::Mat alloc(int rows, int cols, int type);
+
+  //! stack discipline: remember the current offset, and release every
+  //! Mat allocated after it
+  inline size_t mark() const { return m_offset; }
+  void rewind(size_t mark);
+
+  inline void reset() { rewind(0); }
+
+  //! make sure at least bytes are available, only valid when empty
+  void reserve(size_t bytes);
+
+  inline size_t used() const { return m_offset; }
+  inline size_t capacity() const { return m_buffer.size(); }
+  inline size_t peak() const { return m_peak; }
+
+  //! how many arena allocations fell back to the heap. only covers the
+  //! arena itself, allocations made by opencv or the svm are not counted
+  inline size_t heapAllocations() const { return m_heapAllocations; }
+
+  static const size_t kDefaultCapacity = 256 * 1024;
+  static const size_t kAlignment = 64;
+
+ private:
+  std::vector<uchar> m_buffer;
+  size_t m_offset;
+  size_t m_peak;
+  size_t m_overflow;
+  size_t m_heapAllocations;
+
+  DISABLE_ASSIGN_AND_COPY(ScratchArena);
+};
+
+} /*! \namespace easypr*/
+
+#endif  // EASYPR_CORE_SCRATCHARENA_H_
@@ -40,7 +40,8 @@ void getLBPFeatures(const cv::Mat& image, cv::Mat& features);
 //! color feature
 void getColorFeatures(const cv::Mat& src, cv::Mat& features);
 
-//! color feature and histom
+//! color feature and histom, computed in one fused pass.
+//! features is reused if it already has the right size
 void getHistomPlusColoFeatures(const cv::Mat& image, cv::Mat& features);
 
 //! get character feature
@@ -54,6 +55,13 @@ void getLBPplusHistFeatures(const cv::Mat& image, cv::Mat& features);
 void getGrayCharFeatures(const cv::Mat& grayChar, cv::Mat& features);
 
 void getGrayPlusLBP(const Mat& grayChar, Mat& features);
+
+//! the name of one of the feature callbacks above, used to key the feature
+//! caches of the trainers. empty for any other function
+std::string featureName(svmCallback callback);
+
+//! the callback of a name given by featureName, nullptr for any other name
+svmCallback featureByName(const std::string& name);
 } /*! \namespace easypr*/
 
 #endif  // EASYPR_CORE_FEATURE_H_
\ No newline at end of file
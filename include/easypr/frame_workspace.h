@@ -0,0 +1,85 @@
+//////////////////////////////////////////////////////////////////////////
+// Name:	    frame_workspace Header
+// Version:		1.0
+// Desciption:
+// Defines FrameWorkspace, the per-thread intermediate buffers of the
+// detect and recognize pipeline.
+//////////////////////////////////////////////////////////////////////////
+#ifndef EASYPR_CORE_FRAMEWORKSPACE_H_
+#define EASYPR_CORE_FRAMEWORKSPACE_H_
+
+#include <iostream>
+#include "opencv2/opencv.hpp"
+#include "easypr/config.h"
+
+using namespace cv;
+
+namespace easypr {
+
+  enum FrameStage {
+    kStageSobel,
+    kStageColor,
+    kStageDeskew,
+    kStageMser,
+    kStageSegment,
+    kStageEr,
+    kStageCount
+  };
+
+  /*! \brief Reusable intermediate Mats of one thread.
+
+  Every stage asks for its buffers by slot index and uses them as the
+  output of the OpenCV calls. cv::Mat::create() is a no-op when size and
+  type already match, so after the first frame of a fixed resolution the
+  stage does not allocate any more. Every slot keeps the largest allocation
+  it has seen. When the input size of a stage changes, prepare() points the
+  slots that had the stage size at the start of their allocation, and
+  allocates only when the new size does not fit. Slots of any other size
+  are left as they are.
+  */
+  class FrameWorkspace {
+  public:
+    FrameWorkspace();
+    ~FrameWorkspace();
+
+    //! the workspace of the calling thread
+    static FrameWorkspace& local();
+
+    //! call at the beginning of a stage with the stage input size
+    void prepare(FrameStage stage, const Size& size);
+
+    //! the persistent buffer of a stage, slot < kSlotsPerStage
+    Mat& get(FrameStage stage, int slot);
+
+    //! bytes held by the stage buffers now
+    size_t stageBytes(FrameStage stage) const;
+
+    //! profiling mode, record the peak working-set bytes of every stage
+    static void setProfile(bool param);
+    static bool getProfile();
+
+    //! peak working-set bytes of a stage, the max over all threads
+    static size_t peakBytes(FrameStage stage);
+
+    //! print the peak bytes of every stage, call it between frames
+    static void report(std::ostream& out);
+
+    static const char* stageName(FrameStage stage);
+
+    static const int kSlotsPerStage = 8;
+
+  private:
+    void updatePeak();
+
+    Mat m_buffers[kStageCount][kSlotsPerStage];
+    // the high-water-mark allocation of every slot, one row of its type
+    Mat m_storage[kStageCount][kSlotsPerStage];
+    Size m_sizes[kStageCount];
+    size_t m_peaks[kStageCount];
+
+    DISABLE_ASSIGN_AND_COPY(FrameWorkspace);
+  };
+
+} /*! \namespace easypr*/
+
+#endif  // EASYPR_CORE_FRAMEWORKSPACE_H_
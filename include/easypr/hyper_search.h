@@ -0,0 +1,94 @@
+#ifndef EASYPR_TRAIN_HYPERSEARCH_H_
+#define EASYPR_TRAIN_HYPERSEARCH_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+namespace easypr {
+
+//! one point of the grid, create() returns an untrained model with the
+//! parameters of the point set
+struct SearchCandidate {
+  std::string name;
+  std::function<cv::Ptr<cv::ml::StatModel>()> create;
+  //! the model is trained on one hot responses (ANN_MLP), else on the
+  //! class labels (SVM)
+  bool oneHot;
+};
+
+struct SearchResult {
+  std::string name;
+  //! folds the candidate was trained on, fewer than the folds when pruned
+  int folds = 0;
+  float accuracy = 0.f;
+  float minAccuracy = 0.f;
+  double trainMs = 0;
+  //! predict time of one sample
+  double inferUs = 0;
+  bool pruned = false;
+};
+
+/*! \brief Cross validated grid search of the trainers.
+
+The folds are cut once from the feature matrix and shared by every
+candidate. The first round trains every candidate on the first fold in
+parallel. Candidates more than the prune margin below the best one stop
+there. The survivors then train on the remaining folds, again in
+parallel over both folds and candidates.
+
+The inference cost is timed afterwards, one candidate at a time, with
+row by row predicts like the engine makes, so the table can be read
+against a latency budget.
+*/
+class HyperSearch {
+ public:
+  HyperSearch();
+
+  inline void setFolds(int param) { m_folds = std::max(2, param); }
+  //! 0 uses every core
+  inline void setThreads(int param) { m_threads = param; }
+  inline void setPruneMargin(float param) { m_pruneMargin = param; }
+  inline void setSeed(uint64_t param) { m_seed = param; }
+
+  inline void addCandidate(const SearchCandidate& candidate) {
+    m_candidates.push_back(candidate);
+  }
+
+  //! samples holds one CV_32F row per label, labels are 0..classNumber-1.
+  //! one result per candidate, in the order they were added
+  std::vector<SearchResult> run(const cv::Mat& samples, const std::vector<int>& labels,
+                                int classNumber);
+
+  //! index of the most accurate candidate within the budget in us per
+  //! sample, 0 for no budget. -1 when none fits
+  static int best(const std::vector<SearchResult>& results, double budgetUs = 0);
+
+  static void printTable(const std::vector<SearchResult>& results, FILE* out = stdout);
+
+ private:
+  struct Fold {
+    cv::Mat trainSamples;
+    cv::Mat trainLabels;
+    cv::Mat trainOneHot;
+    cv::Mat valSamples;
+    std::vector<int> valLabels;
+  };
+
+  void makeFolds(const cv::Mat& samples, const std::vector<int>& labels, int classNumber);
+
+  int m_folds;
+  int m_threads;
+  float m_pruneMargin;
+  uint64_t m_seed;
+
+  std::vector<SearchCandidate> m_candidates;
+  std::vector<Fold> m_foldData;
+};
+}
+
+#endif  // EASYPR_TRAIN_HYPERSEARCH_H_
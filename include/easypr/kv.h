@@ -1,6 +1,7 @@
 #ifndef EASYPR_UTIL_KV_H_
 #define EASYPR_UTIL_KV_H_
 
+#include <istream>
 #include <map>
 #include <string>
 
@@ -12,6 +13,8 @@ class Kv {
 
   void load(const std::string &file);
 
+  void load(std::istream &reader);
+
   std::string get(const std::string &key);
 
   void add(const std::string &key, const std::string &value);
@@ -0,0 +1,158 @@
+//////////////////////////////////////////////////////////////////////////
+// Name:	    model_registry Header
+// Version:		1.0
+// Desciption:
+// Defines ModelSet, an immutable version of all the models, and
+// ModelRegistry, which publishes new versions without stopping the
+// recognition.
+//////////////////////////////////////////////////////////////////////////
+#ifndef EASYPR_CORE_MODELREGISTRY_H_
+#define EASYPR_CORE_MODELREGISTRY_H_
+
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include "opencv2/opencv.hpp"
+#include "easypr/config.h"
+#include "easypr/util/kv.h"
+#include "easypr/core/svm_evaluator.h"
+#include "easypr/core/mlp_evaluator.h"
+#include "easypr/core/model_bundle.h"
+#include "easypr/core/feature.h"
+
+namespace easypr {
+
+//! where a model set is loaded from. with a bundle path, the bundle is
+//! used and the xml paths are ignored, the bundle names its svm feature
+//! too. svmFeature is the featureName of the plate feature the svm is
+//! trained on, kLBPSvmPath goes with kLBPSvmFeature
+struct ModelPaths {
+  std::string bundle;
+  std::string svm = kHistSvmPath;
+  std::string svmFeature = kHistSvmFeature;
+  std::string ann = kDefaultAnnPath;
+  std::string annChinese = kChineseAnnPath;
+  std::string annGray = kGrayAnnPath;
+  std::string mapping = kChineseMappingPath;
+};
+
+/*! \brief One version of every model of the engine.
+
+Never changed after it is published, so any number of threads may use
+it at the same time. The predict helpers use the in place evaluators
+when the set comes from a bundle, else the cv::ml models.
+*/
+struct ModelSet {
+  uint64_t version = 0;
+  ModelPaths paths;
+
+  cv::Ptr<cv::ml::SVM> svm;
+  SvmRbfEvaluator svmEvaluator;
+  //! extracts the plate features of the svm, from paths.svmFeature
+  svmCallback svmFeature = nullptr;
+
+  cv::Ptr<cv::ml::ANN_MLP> ann;
+  cv::Ptr<cv::ml::ANN_MLP> annChinese;
+  cv::Ptr<cv::ml::ANN_MLP> annGray;
+  MlpEvaluator annMlp;
+  MlpEvaluator annChineseMlp;
+  MlpEvaluator annGrayMlp;
+
+  std::shared_ptr<Kv> kv;
+
+  // keeps the mapping of the in place evaluators alive
+  std::shared_ptr<ModelBundle> bundle;
+
+  //! raw svm decision value of one feature row, or of every row of a
+  //! batch. the exact evaluator path, so a plate near the 0.5 threshold
+  //! is judged as cv::ml::SVM judges it
+  float svmScore(const cv::Mat& features) const;
+  void svmScores(const cv::Mat& features, cv::Mat& scores) const;
+
+  void predictAnn(const cv::Mat& samples, cv::Mat& outputs) const;
+  void predictChineseAnn(const cv::Mat& samples, cv::Mat& outputs) const;
+  void predictGrayAnn(const cv::Mat& samples, cv::Mat& outputs) const;
+
+  //! chinese name of a province key like "zh_cuan"
+  std::string province(const std::string& key) const;
+
+  int svmVarCount() const;
+};
+
+/*! \brief RCU style holder of the current ModelSet.
+
+Readers take a shared_ptr to the current set and keep using it until
+they drop it, so a frame in flight finishes on the version it started
+with. Writers load and validate a complete new set, then swap it in
+with one atomic store. The old set is freed when its last reader is
+done.
+
+A Pin makes every acquire() of the calling thread return the same set,
+CPlateRecognize pins one per frame. Parallel regions pass the pinned set
+to their worker threads with Pin(set).
+*/
+class ModelRegistry {
+ public:
+  static ModelRegistry* instance();
+
+  //! the pinned set of this thread, else the current one
+  std::shared_ptr<const ModelSet> acquire() const;
+
+  inline uint64_t version() const { return acquire()->version; }
+
+  //! load and validate a full new set, publish it on success. on failure
+  //! the current set stays and error tells why
+  bool reload(const ModelPaths& paths, std::string* error = nullptr);
+
+  //! the same on a background thread, recognition continues meanwhile
+  std::future<bool> reloadAsync(const ModelPaths& paths);
+
+  //! replace one model of the current set. an svm trained on other
+  //! features than the current one names them with feature
+  bool reloadSvm(const std::string& path, const std::string& feature = std::string());
+  bool reloadAnn(const std::string& path);
+  bool reloadChineseAnn(const std::string& path);
+  bool reloadGrayAnn(const std::string& path);
+  bool reloadChineseMapping(const std::string& path);
+
+  class Pin {
+   public:
+    //! pin the current set, or keep the pin the thread already has
+    Pin();
+    //! pin the given set, used inside parallel regions
+    explicit Pin(std::shared_ptr<const ModelSet> models);
+    ~Pin();
+
+   private:
+    std::shared_ptr<const ModelSet> m_previous;
+
+    DISABLE_ASSIGN_AND_COPY(Pin);
+  };
+
+ private:
+  ModelRegistry();
+
+  // load every model of paths, nullptr and error on failure
+  static std::shared_ptr<ModelSet> load(const ModelPaths& paths, std::string& error);
+
+  // the svm must fit the features of its extractor, the anns the
+  // features the engine extracts, which the current set already does
+  bool validate(const ModelSet& models, std::string& error) const;
+
+  bool publish(std::shared_ptr<ModelSet> models, std::string& error);
+
+  // the model set readers see, accessed only with std::atomic_load/store
+  std::shared_ptr<const ModelSet> m_current;
+
+  // one writer at a time
+  std::mutex m_writeMutex;
+  uint64_t m_lastVersion;
+
+  DISABLE_ASSIGN_AND_COPY(ModelRegistry);
+};
+
+} /*! \namespace easypr*/
+
+#endif  // EASYPR_CORE_MODELREGISTRY_H_
@@ -14,12 +14,23 @@
 
 #include "easypr/core/plate_detect.h"
 #include "easypr/core/chars_recognise.h"
+#include "easypr/core/model_registry.h"
 
 /*! \namespace easypr
 Namespace where all the C++ EasyPR functionality resides
 */
 namespace easypr {
 
+  //! how many candidates of plateRecognize died at each stage of the cascade
+  struct CascadeStats {
+    size_t candidates;
+    size_t rejectedByScore;
+    size_t rejectedBySegment;
+    size_t rejectedByLayout;
+    size_t rejectedByIdentify;
+    size_t recognized;
+  };
+
   class CPlateRecognize : public CPlateDetect, public CCharsRecognise {
   public:
     CPlateRecognize();
@@ -35,6 +46,19 @@ namespace easypr {
     inline void setDetectShow(bool param) { CPlateDetect::setDetectShow(param); }
     inline void setDebug(bool param) { setResultShow(param); }
 
+    //! record the peak working-set bytes of every stage,
+    //! printed by FrameWorkspace::report()
+    inline void setWorkspaceProfile(bool param) { FrameWorkspace::setProfile(param); }
+
+    //! candidates whose svm score is not below this are dropped before
+    //! color detection and segmentation. the judge keeps scores below 0.5,
+    //! a smaller value makes the cascade stricter.
+    inline void setCascadeScore(float param) { m_cascadeScore = param; }
+    inline float getCascadeScore() const { return m_cascadeScore; }
+
+    inline const CascadeStats& getCascadeStats() const { return m_cascadeStats; }
+    void resetCascadeStats();
+
     void LoadSVM(std::string path);
     void LoadANN(std::string path);
     void LoadChineseANN(std::string path);
@@ -43,9 +67,17 @@ namespace easypr {
     void LoadGrayChANN(std::string path);
     void LoadChineseMapping(std::string path);
 
+    //! load, validate and publish a new version of all the models in the
+    //! background. frames in flight finish on the old version
+    std::future<bool> LoadModelsAsync(const ModelPaths& paths);
+    uint64_t getModelVersion() const;
+
   private:
     // show the detect and recognition result image
     bool m_showResult;
+
+    float m_cascadeScore;
+    CascadeStats m_cascadeStats;
     DISABLE_ASSIGN_AND_COPY(CPlateRecognize);
   };
 
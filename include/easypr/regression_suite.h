@@ -0,0 +1,117 @@
+#ifndef EASYPR_UTIL_REGRESSIONSUITE_H_
+#define EASYPR_UTIL_REGRESSIONSUITE_H_
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include "easypr/core/plate_recognize.h"
+
+namespace easypr {
+
+enum RegressionStage {
+  kRegressLocate,
+  kRegressJudge,
+  kRegressSegment,
+  kRegressIdentify,
+  kRegressPipeline,
+  kRegressStageCount
+};
+
+//! how far a run may fall behind the baseline before compare() fails
+struct RegressionThresholds {
+  //! absolute drop of the plate and the character accuracy
+  float plateAccuracyDrop = 0.01f;
+  float charAccuracyDrop = 0.01f;
+  //! p50 latency of any stage over the baseline p50, 0 skips the check
+  float latencyRatio = 1.25f;
+};
+
+struct StageTiming {
+  //! images that got through the stage, for the pipeline the images
+  //! whose plate was read right
+  size_t passed = 0;
+  std::vector<double> samplesMs;
+
+  double percentile(double p) const;
+  double mean() const;
+};
+
+struct RegressionReport {
+  size_t images = 0;
+  //! share of the images whose plate was read exactly
+  double plateAccuracy = 0;
+  //! mean share of the characters read right, by edit distance
+  double charAccuracy = 0;
+  //! share of the images with at least one plate
+  double detectRate = 0;
+
+  StageTiming stages[kRegressStageCount];
+
+  struct Miss {
+    std::string file;
+    std::string label;
+    std::string result;
+  };
+  std::vector<Miss> misses;
+};
+
+/*! \brief Accuracy and latency regression run over a labeled corpus.
+
+Every image runs twice. The first time it goes through the stages one
+at a time, each one timed: locate, judge, segment and identify. The
+stages use the locators of the recognizer's detect type and its
+segmenter, but always at the single uniform scale, the pyramid mode is
+not split into stages. The second time it goes through
+CPlateRecognize::plateRecognize, and the plate and character accuracy
+come from this run.
+
+The label of an image is its file name without the extension, like
+"京A88888.jpg", unless a labels file is given. Each line of a labels
+file holds a file name relative to the corpus, a space, and the plate.
+
+The report is JSON, written with cv::FileStorage. compare() reads the
+report of an earlier run and fails when this run falls behind it by
+more than the thresholds.
+*/
+class RegressionSuite {
+ public:
+  explicit RegressionSuite(const std::string& corpus);
+
+  inline void setLabelsFile(const std::string& param) { m_labelsFile = param; }
+  //! 0 runs the whole corpus
+  inline void setMaxImages(size_t param) { m_maxImages = param; }
+
+  //! the recognizer of the pipeline run, configure it before run()
+  inline CPlateRecognize& recognizer() { return m_recognizer; }
+
+  //! false when the corpus has no labeled image
+  bool run();
+
+  inline const RegressionReport& report() const { return m_report; }
+
+  bool writeReport(const std::string& path) const;
+
+  //! lists every check that fails to out, true when none does
+  bool compare(const std::string& baselinePath, const RegressionThresholds& thresholds,
+               std::ostream& out = std::cout) const;
+
+  static const char* stageName(RegressionStage stage);
+
+ private:
+  bool collect(std::vector<std::pair<std::string, std::string>>& items) const;
+
+  // the stage by stage run of one image, true when its plate is read
+  bool runStages(const Mat& src, const std::string& label);
+
+  std::string m_corpus;
+  std::string m_labelsFile;
+  size_t m_maxImages;
+
+  CPlateRecognize m_recognizer;
+
+  RegressionReport m_report;
+};
+
+}
+
+#endif  // EASYPR_UTIL_REGRESSIONSUITE_H_
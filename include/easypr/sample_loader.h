@@ -0,0 +1,82 @@
+#ifndef EASYPR_TRAIN_SAMPLELOADER_H_
+#define EASYPR_TRAIN_SAMPLELOADER_H_
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+namespace easypr {
+
+//! one training sample, an image file or a synthetic variant of it
+struct TrainSample {
+  std::string file;
+  int label;
+  //! 0 for the image itself, n > 0 for the n-th synthetic variant
+  int variant;
+};
+
+/*! \brief Parallel decode, augment and featurize pipeline of the trainers.
+
+A pool of threads takes the samples in turn and decodes, augments and
+featurizes them. The finished rows go through a bounded queue to the
+calling thread, which copies them straight into their rows of the
+output matrix, so only the queue is held besides the samples. The rows
+keep the order of the items whatever the number of threads. A synthetic
+variant uses a random generator seeded from the seed and its index, so
+the same items give the same samples.
+
+With a cache path, load() first looks for a cache made from the same
+items and feature name and reads it instead of decoding anything. If
+there is none, it writes one after the load. The cache only knows the
+file names, so delete it when images change in place.
+*/
+class SampleLoader {
+ public:
+  typedef std::function<void(const cv::Mat& image, cv::Mat& feature)> Featurizer;
+  typedef std::function<cv::Mat(const cv::Mat& image, cv::RNG& rng)> Augmenter;
+  typedef std::function<cv::Mat(const cv::Mat& image)> Preprocess;
+
+  //! featureName identifies the featurizer in the cache, change it when
+  //! the features change. an empty name turns the cache off
+  SampleLoader(int imreadFlags, Featurizer featurize, const std::string& featureName);
+
+  //! applied to every decoded image before the augmenter
+  inline void setPreprocess(Preprocess param) { m_preprocess = param; }
+  //! makes the variants, needed when an item has variant > 0
+  inline void setAugmenter(Augmenter param) { m_augment = param; }
+
+  //! 0 uses every core
+  inline void setThreads(int param) { m_threads = param; }
+  inline void setQueueSize(size_t param) { m_queueSize = param; }
+  inline void setSeed(uint64_t param) { m_seed = param; }
+  inline void setCachePath(const std::string& param) { m_cachePath = param; }
+
+  //! one CV_32F row per item in samples. unreadable images are left out,
+  //! and indices, when given, holds the item index of every row
+  bool load(const std::vector<TrainSample>& items, cv::Mat& samples, std::vector<int>& labels,
+            std::vector<int>* indices = nullptr);
+
+ private:
+  uint64_t fingerprint(const std::vector<TrainSample>& items) const;
+
+  bool readCache(uint64_t key, cv::Mat& samples, std::vector<int>& labels,
+                 std::vector<int>& indices) const;
+  bool writeCache(uint64_t key, const cv::Mat& samples, const std::vector<int>& labels,
+                  const std::vector<int>& indices) const;
+
+  int m_imreadFlags;
+  Featurizer m_featurize;
+  std::string m_featureName;
+  Preprocess m_preprocess;
+  Augmenter m_augment;
+
+  int m_threads;
+  size_t m_queueSize;
+  uint64_t m_seed;
+  std::string m_cachePath;
+};
+}
+
+#endif  // EASYPR_TRAIN_SAMPLELOADER_H_
@@ -0,0 +1,83 @@
+//////////////////////////////////////////////////////////////////////////
+// Name:	    svm_evaluator Header
+// Version:		1.0
+// Desciption:
+// Defines SvmRbfEvaluator, a batched evaluator of a two class RBF C_SVC.
+//////////////////////////////////////////////////////////////////////////
+#ifndef EASYPR_CORE_SVMEVALUATOR_H_
+#define EASYPR_CORE_SVMEVALUATOR_H_
+
+#include <iostream>
+#include <vector>
+#include "opencv2/opencv.hpp"
+
+using namespace cv;
+
+namespace easypr {
+
+/*! \brief Score many samples with one RBF svm at once.
+
+The raw decision value of cv::ml::SVM is
+  -rho + sum_k alpha_k * exp(-gamma * |x - sv_k|^2).
+With |x - sv|^2 = |x|^2 + |sv|^2 - 2 x.sv, all the distances of a batch
+are one gemm against the support vector matrix, the sv norms are computed
+once at load time, and the kernel values are one cv::exp over the batch.
+The expansion rounds differently from the direct sum of cv::ml::SVM, so
+predict() differs from predict(RAW_OUTPUT) by float rounding, about 1e-6
+on svm_hist; ModelCompiler reports the maximum. predictExact() follows
+the order and precision of cv::ml::SVM and returns identical values, at
+the per sample cost of the original.
+*/
+class SvmRbfEvaluator {
+ public:
+  SvmRbfEvaluator();
+
+  //! take the support vectors of a trained model, return false if it is
+  //! not a two class RBF C_SVC, then the evaluator stays empty
+  bool load(const cv::Ptr<cv::ml::SVM>& svm);
+
+  //! use external arrays in place, they must outlive the evaluator
+  void wrap(int svCount, int varCount, const float* sv, const float* svNorm,
+            const double* alpha, double rho, double gamma);
+
+  inline bool empty() const { return m_sv.empty(); }
+  inline int getSVCount() const { return m_sv.rows; }
+  inline int getVarCount() const { return m_sv.cols; }
+  inline const Mat& getSupportVectors() const { return m_sv; }
+  inline const Mat& getSVNorms() const { return m_svNorm; }
+  inline const Mat& getAlpha() const { return m_alpha; }
+  inline double getRho() const { return m_rho; }
+  inline double getGamma() const { return m_gamma; }
+
+  //! samples: N x var_count CV_32F, scores: N x 1 CV_32F raw decision values
+  void predict(const Mat& samples, Mat& scores) const;
+  float predict(const Mat& sample) const;
+
+  //! as predict, bit identical to cv::ml::SVM::predict(RAW_OUTPUT)
+  void predictExact(const Mat& samples, Mat& scores) const;
+
+  //! reduced set approximation: keep the keepCount support vectors with
+  //! the largest |alpha|, and refit their alpha so the decision values on
+  //! all the original support vectors stay as close as possible
+  SvmRbfEvaluator reduced(int keepCount, bool refit = true) const;
+
+  //! accuracy/speed trade-off of several reduced sizes against this model
+  //  on the given samples: time per sample, max decision error, and how
+  //  often the decision at threshold stays the same
+  void reportReduced(const Mat& samples, const std::vector<int>& keepCounts,
+                     std::ostream& out, float threshold = 0.5f) const;
+
+ private:
+  // |x - sv|^2 for every sample and sv, N x sv_count
+  void distances(const Mat& samples, Mat& dist) const;
+
+  Mat m_sv;      // sv_count x var_count, CV_32F
+  Mat m_svNorm;  // 1 x sv_count, |sv|^2
+  Mat m_alpha;   // sv_count x 1, CV_64F
+  double m_rho;
+  double m_gamma;
+};
+
+} /*! \namespace easypr*/
+
+#endif  // EASYPR_CORE_SVMEVALUATOR_H_
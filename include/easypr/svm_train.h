@@ -23,6 +23,15 @@ class SvmTrain : public ITrain {
 
   virtual void test();
 
+  //! cross validated search of C and gamma, in parallel, in place of
+  //! trainAuto. prints the table, then trains and saves the most accurate
+  //! configuration that scores a plate within budgetUs, 0 for no budget
+  void search(double budgetUs = 0);
+
+  //! keep the features in this file, a retrain on the same files skips
+  //! the image decoding
+  inline void setFeatureCache(const std::string& path) { feature_cache_ = path; }
+
  private:
   void prepare();
 
@@ -35,6 +44,7 @@ class SvmTrain : public ITrain {
   std::vector<TrainItem> test_file_list_;
 
   svmCallback extractFeature;
+  std::string feature_cache_;
   bool isPrepared = true;
 };
 }
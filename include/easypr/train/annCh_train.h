@@ -22,11 +22,24 @@ class AnnChTrain : public ITrain {
     m_number_for_count = n;
   }
 
+  //! keep the features in files named after path, a retrain on the same
+  //! files skips the image decoding. trainVal and tdata extract different
+  //! features, they use path.trainval and path.tdata
+  inline void setFeatureCache(const std::string& path) {
+    m_feature_cache = path;
+  }
+
  private:
   virtual cv::Ptr<cv::ml::TrainData> tdata();
 
   void trainVal(size_t number_for_count = 100);
 
+  // the cache file of one use of the features, empty without a cache
+  std::string featureCache(const char* use) const;
+
+  // share of the rows whose prediction is the label
+  float accuracy(const cv::Mat& samples, const std::vector<int>& labels);
+
   cv::Ptr<cv::ml::ANN_MLP> ann_;
   const char* ann_xml_;
   const char* chars_folder_;
@@ -35,6 +48,7 @@ class AnnChTrain : public ITrain {
   int type;
 
   int m_number_for_count;
+  std::string m_feature_cache;
 
   annCallback extractFeature;
 };
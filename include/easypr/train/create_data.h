@@ -21,6 +21,8 @@ namespace easypr {
   Mat cropImg(Mat src, int x, int y, int shift, int bk = 0);
 
   Mat generateSyntheticImage(const Mat& image, int use_swap = 1);
+  //! the same with the caller's random generator, for parallel loaders
+  Mat generateSyntheticImage(const Mat& image, RNG& rng);
 
 } /*! \namespace easypr*/
 
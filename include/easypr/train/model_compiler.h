@@ -0,0 +1,41 @@
+#ifndef EASYPR_TRAIN_MODELCOMPILER_H_
+#define EASYPR_TRAIN_MODELCOMPILER_H_
+
+#include <string>
+#include "easypr/config.h"
+#include "easypr/core/model_bundle.h"
+
+namespace easypr {
+
+/*! \brief Packs the xml models and the province mapping into one bundle.
+
+The engine maps the bundle and uses the weights in place, so a cold
+start no longer parses megabytes of xml. compile() reopens the written
+bundle and checks every model against its xml version before it
+reports success. svm_feature is the featureName of the plate feature
+the svm is trained on, the bundle records it for the judge.
+*/
+class ModelCompiler {
+ public:
+  ModelCompiler(const char* svm_xml = kHistSvmPath,
+                const char* ann_xml = kDefaultAnnPath,
+                const char* ann_chinese_xml = kChineseAnnPath,
+                const char* annCh_xml = kGrayAnnPath,
+                const char* mapping = kChineseMappingPath,
+                const char* svm_feature = kHistSvmFeature);
+
+  bool compile(const char* bundle_path = kModelBundlePath);
+
+ private:
+  bool verify(const char* bundle_path);
+
+  const char* svm_xml_;
+  const char* ann_xml_;
+  const char* ann_chinese_xml_;
+  const char* annCh_xml_;
+  const char* mapping_;
+  const char* svm_feature_;
+};
+}
+
+#endif  // EASYPR_TRAIN_MODELCOMPILER_H_
@@ -0,0 +1,47 @@
+#ifndef EASYPR_UTIL_ALLOCATIONCHECK_H_
+#define EASYPR_UTIL_ALLOCATIONCHECK_H_
+
+#include <iostream>
+#include "opencv2/opencv.hpp"
+#include "easypr/core/feature.h"
+
+namespace easypr {
+
+struct AllocationCount {
+  size_t calls = 0;
+  //! cv::Mat buffers allocated on the calling thread, by any code
+  size_t matAllocations = 0;
+  //! arena allocations that fell back to the heap
+  size_t arenaFallbacks = 0;
+  //! bytes the thread arena grew by
+  size_t arenaGrowth = 0;
+};
+
+/*! \brief Counts the heap growth of a feature extractor in steady state.
+
+The extractor runs the way PlateJudge runs it: the feature row is carved
+from the thread ScratchArena and the arena is rewound after every call.
+The first calls warm the arena up and are not counted. During the counted
+calls, a cv::MatAllocator installed as the default counts every Mat
+buffer allocated on the calling thread, and the arena reports its own
+fallbacks and growth. A feature path that is allocation free in steady
+state gives zero for all three.
+
+The default allocator is process wide, so run it while no other thread
+creates Mats through it.
+*/
+class AllocationCheck {
+ public:
+  //! calls of extract on plate after warmup calls, 0 calls when extract
+  //! gives no features
+  static AllocationCount count(svmCallback extract, const cv::Mat& plate, int calls = 100,
+                               int warmup = 2);
+
+  //! getHistomPlusColoFeatures over a random plate of the svm input size,
+  //! prints the counts to out, true when nothing was allocated
+  static bool checkPlateFeatures(std::ostream& out = std::cout);
+};
+
+}
+
+#endif  // EASYPR_UTIL_ALLOCATIONCHECK_H_
@@ -62,6 +62,13 @@ namespace libfacerec {
   //
   Mat spatial_histogram(InputArray src, int numPatterns, int grid_x = 8, int grid_y = 8, bool normed = true);
 
+  // Calculates spatial_histogram(olbp(src), numPatterns, grid_x, grid_y)
+  // in one pass, without the LBP image. The grid_x * grid_y * numPatterns
+  // bins are written to dst, for example a row of a preallocated feature
+  // matrix. src is CV_8UC1, CV_32FC1 or CV_64FC1.
+  //
+  void olbp_spatial_histogram(InputArray src, int numPatterns, int grid_x, int grid_y, float* dst);
+
   // see cv::olbp(InputArray, OutputArray)
   Mat olbp(InputArray src);
 
@@ -35,6 +35,12 @@ namespace cv
       vector<vector<Point>>& msers_yellow, vector<Rect>& bboxes_yellow) = 0;
     CV_WRAP virtual void detectRegions(InputArray _src, vector<vector<Point>>& msers, vector<Rect>& bboxes, int type) = 0;
 
+    //! only look inside the rois, regions come back in src coordinates.
+    //! overlapping rois give their common regions once per roi
+    CV_WRAP virtual void detectRegions(InputArray _src, const vector<Rect>& rois,
+      vector<vector<Point>>& msers_blue, vector<Rect>& bboxes_blue,
+      vector<vector<Point>>& msers_yellow, vector<Rect>& bboxes_yellow) = 0;
+
     CV_WRAP virtual void setDelta(int delta) = 0;
     CV_WRAP virtual int getDelta() const = 0;
 
@@ -46,5 +52,9 @@ namespace cv
 
     CV_WRAP virtual void setPass2Only(bool f) = 0;
     CV_WRAP virtual bool getPass2Only() const = 0;
+
+    //! run the two polarity passes at once on the opencv pool, on by default
+    CV_WRAP virtual void setParallelPasses(bool f) = 0;
+    CV_WRAP virtual bool getParallelPasses() const = 0;
   };
 }
\ No newline at end of file
@@ -160,6 +160,12 @@ public:
     virtual void setMinProbabilityDiff(float minProbabilityDiff) = 0;
     virtual void setNonMaxSuppression(bool nonMaxSuppression) = 0;
     virtual int  getNumRejected() = 0;
+
+    //! limit the classifier calls of one run, 0 for no limit. regions left
+    //! when the limit is reached are rejected without a classifier call
+    virtual void setMaxEvaluations(int maxEvaluations) = 0;
+    //! classifier calls of the last run
+    virtual int  getNumEvaluations() = 0;
 };
 
 
@@ -48,6 +48,11 @@ PlateRecognitionWindow::PlateRecognitionWindow(QWidget *parent) :
         m_tesseract->SetPageSegMode(tesseract::PSM_SINGLE_LINE);
         // 设置字符白名单，限制为车牌可能出现的字符
         m_tesseract->SetVariable("tessedit_char_whitelist", "京津沪渝冀豫云辽黑湘皖鲁新苏浙赣鄂桂甘晋蒙陕吉闽贵粤青藏川宁琼使领ABCDEFGHJKLMNPQRSTUVWXYZ0123456789");
+        // 单行识别时按车牌格式约束束搜索：省份简称、字母，再接5到6位字母数字（新能源为6位）
+        if (!m_tesseract->SetVariable("lstm_line_pattern", "[京津沪渝冀豫云辽黑湘皖鲁新苏浙赣鄂桂甘晋蒙陕吉闽贵粤青藏川宁琼][A-Z][A-HJ-NP-Z0-9]{5,6}")) {
+            // 链接的不是tesseract-main时没有这个参数，格式约束不生效
+            qDebug() << "Tesseract不支持lstm_line_pattern，车牌格式约束未生效";
+        }
     }
 #endif
 }
@@ -326,17 +331,18 @@ QString PlateRecognitionWindow::tesseractOCR(const cv::Mat& plateImage)
     // 显示处理后的图像
     cv::imshow("Tesseract Input", binary);
     
-    // 设置图像数据
-    m_tesseract->SetImage(binary.data, binary.cols, binary.rows, 1, binary.step);
-    
-    // 执行OCR
-    char* outText = m_tesseract->GetUTF8Text();
-    
-    // 转换结果为QString并清理空格
-    QString result = QString::fromUtf8(outText).simplified();
-    
-    // 释放Tesseract分配的内存
-    delete[] outText;
+    // 车牌裁剪图本身就是单行文字，直接交给LSTM识别，跳过版面分析
+    QString result;
+    std::string lineText;
+    if (m_tesseract->RecognizeLine(binary.data, binary.cols, binary.rows, (int)binary.step, &lineText)) {
+        result = QString::fromStdString(lineText).simplified();
+    } else {
+        // 没有LSTM模型时走完整流程
+        m_tesseract->SetImage(binary.data, binary.cols, binary.rows, 1, binary.step);
+        char* outText = m_tesseract->GetUTF8Text();
+        result = QString::fromUtf8(outText).simplified();
+        delete[] outText;
+    }
     
     // 后处理：移除可能的非法字符
     result.remove(QRegExp("[^京津沪渝冀豫云辽黑湘皖鲁新苏浙赣鄂桂甘晋蒙陕吉闽贵粤青藏川宁琼使领A-Z0-9]"));
@@ -1,4 +1,5 @@
 #include "easypr/core/chars_identify.h"
+#include "easypr/core/model_registry.h"
 #include "easypr/core/character.hpp"
 #include "easypr/core/core_func.h"
 #include "easypr/core/feature.h"
@@ -19,51 +20,38 @@ CharsIdentify* CharsIdentify::instance() {
 }
 
 CharsIdentify::CharsIdentify() {
-  LOAD_ANN_MODEL(ann_, kDefaultAnnPath);
-  LOAD_ANN_MODEL(annChinese_, kChineseAnnPath);
-  LOAD_ANN_MODEL(annGray_, kGrayAnnPath);
-
-  kv_ = std::shared_ptr<Kv>(new Kv);
-  kv_->load(kChineseMappingPath);
+  // the classifiers live in the model registry, make sure it is loaded
+  ModelRegistry::instance();
 
   extractFeature = getGrayPlusProject;
 }
 
 void CharsIdentify::LoadModel(std::string path) {
-  if (path != std::string(kDefaultAnnPath)) {
-    if (!ann_->empty())
-      ann_->clear();
-    LOAD_ANN_MODEL(ann_, path);
-  }
+  if (path != std::string(kDefaultAnnPath))
+    ModelRegistry::instance()->reloadAnn(path);
 }
 
 void CharsIdentify::LoadChineseModel(std::string path) {
-  if (path != std::string(kChineseAnnPath)) {
-    if (!annChinese_->empty())
-      annChinese_->clear();
-    LOAD_ANN_MODEL(annChinese_, path);
-  }
+  if (path != std::string(kChineseAnnPath))
+    ModelRegistry::instance()->reloadChineseAnn(path);
 }
 
 void CharsIdentify::LoadGrayChANN(std::string path) {
-  if (path != std::string(kGrayAnnPath)) {
-    if (!annGray_->empty())
-      annGray_->clear();
-    LOAD_ANN_MODEL(annGray_, path);
-  }
+  if (path != std::string(kGrayAnnPath))
+    ModelRegistry::instance()->reloadGrayAnn(path);
 }
 
 void CharsIdentify::LoadChineseMapping(std::string path) {
-  kv_->clear();
-  kv_->load(path);
+  ModelRegistry::instance()->reloadChineseMapping(path);
 }
 
 void CharsIdentify::classify(cv::Mat featureRows, std::vector<int>& out_maxIndexs,
                              std::vector<float>& out_maxVals, std::vector<bool> isChineseVec){
+  auto models = ModelRegistry::instance()->acquire();
   int rowNum = featureRows.rows;
 
   cv::Mat output(rowNum, kCharsTotalNumber, CV_32FC1);
-  ann_->predict(featureRows, output);
+  models->predictAnn(featureRows, output);
 
   for (int output_index = 0; output_index < rowNum; output_index++) {
     Mat output_row = output.row(output_index);
@@ -99,20 +87,28 @@ void CharsIdentify::classify(cv::Mat featureRows, std::vector<int>& out_maxIndex
 
 
 void CharsIdentify::classify(std::vector<CCharacter>& charVec){
+  auto models = ModelRegistry::instance()->acquire();
   size_t charVecSize = charVec.size();
 
   if (charVecSize == 0)
     return;
 
+  // the features of a batch are independent, extract them in parallel
+  // with parallelFor, over blocks of 16 characters
+  std::vector<Mat> features(charVecSize);
+  const int kFeatureBlock = 16;
+  parallelFor(((int) charVecSize + kFeatureBlock - 1) / kFeatureBlock, [&](int block) {
+    int end = std::min((int) charVecSize, (block + 1) * kFeatureBlock);
+    for (int index = block * kFeatureBlock; index < end; index++) {
+      Mat charInput = charVec[index].getCharacterMat();
+      features[index] = charFeatures(charInput, kPredictSize);
+    }
+  });
   Mat featureRows;
-  for (size_t index = 0; index < charVecSize; index++) {
-    Mat charInput = charVec[index].getCharacterMat();
-    Mat feature = charFeatures(charInput, kPredictSize);
-    featureRows.push_back(feature);
-  }
+  vconcat(features, featureRows);
 
   cv::Mat output(charVecSize, kCharsTotalNumber, CV_32FC1);
-  ann_->predict(featureRows, output);
+  models->predictAnn(featureRows, output);
 
   for (size_t output_index = 0; output_index < charVecSize; output_index++) {
     CCharacter& character = charVec[output_index];
@@ -147,7 +143,7 @@ void CharsIdentify::classify(std::vector<CCharacter>& charVec){
       }
       const char* key = kChars[result];
       std::string s = key;
-      std::string province = kv_->get(s);
+      std::string province = models->province(s);
       label = std::make_pair(s, province).second;
     }
     /*std::cout << "result:" << result << std::endl;
@@ -159,6 +155,7 @@ void CharsIdentify::classify(std::vector<CCharacter>& charVec){
 
 
 void CharsIdentify::classifyChineseGray(std::vector<CCharacter>& charVec){
+  auto models = ModelRegistry::instance()->acquire();
   size_t charVecSize = charVec.size();
   if (charVecSize == 0)
     return;
@@ -172,7 +169,7 @@ void CharsIdentify::classifyChineseGray(std::vector<CCharacter>& charVec){
   }
 
   cv::Mat output(charVecSize, kChineseNumber, CV_32FC1);
-  annGray_->predict(featureRows, output);
+  models->predictGrayAnn(featureRows, output);
 
   for (size_t output_index = 0; output_index < charVecSize; output_index++) {
     CCharacter& character = charVec[output_index];
@@ -201,7 +198,7 @@ void CharsIdentify::classifyChineseGray(std::vector<CCharacter>& charVec){
     auto index = result + kCharsTotalNumber - kChineseNumber;
     const char* key = kChars[index];
     std::string s = key;
-    std::string province = kv_->get(s);
+    std::string province = models->province(s);
 
     /*std::cout << "result:" << result << std::endl;
     std::cout << "maxVal:" << maxVal << std::endl;*/
@@ -213,6 +210,7 @@ void CharsIdentify::classifyChineseGray(std::vector<CCharacter>& charVec){
 }
 
 void CharsIdentify::classifyChinese(std::vector<CCharacter>& charVec){
+  auto models = ModelRegistry::instance()->acquire();
   size_t charVecSize = charVec.size();
 
   if (charVecSize == 0)
@@ -226,7 +224,7 @@ void CharsIdentify::classifyChinese(std::vector<CCharacter>& charVec){
   }
 
   cv::Mat output(charVecSize, kChineseNumber, CV_32FC1);
-  annChinese_->predict(featureRows, output);
+  models->predictChineseAnn(featureRows, output);
 
   for (size_t output_index = 0; output_index < charVecSize; output_index++) {
     CCharacter& character = charVec[output_index];
@@ -255,7 +253,7 @@ void CharsIdentify::classifyChinese(std::vector<CCharacter>& charVec){
     auto index = result + kCharsTotalNumber - kChineseNumber;
     const char* key = kChars[index];
     std::string s = key;
-    std::string province = kv_->get(s);
+    std::string province = models->province(s);
 
     /*std::cout << "result:" << result << std::endl;
     std::cout << "maxVal:" << maxVal << std::endl;*/
@@ -267,10 +265,11 @@ void CharsIdentify::classifyChinese(std::vector<CCharacter>& charVec){
 }
 
 int CharsIdentify::classify(cv::Mat f, float& maxVal, bool isChinses, bool isAlphabet){
+  auto models = ModelRegistry::instance()->acquire();
   int result = 0;
 
   cv::Mat output(1, kCharsTotalNumber, CV_32FC1);
-  ann_->predict(f, output);
+  models->predictAnn(f, output);
 
   maxVal = -2.f;
   if (!isChinses) {
@@ -314,6 +313,9 @@ int CharsIdentify::classify(cv::Mat f, float& maxVal, bool isChinses, bool isAlp
 }
 
 bool CharsIdentify::isCharacter(cv::Mat input, std::string& label, float& maxVal, bool isChinese) {
+  // classify() below must see the same set
+  ModelRegistry::Pin pin;
+  auto models = ModelRegistry::instance()->acquire();
   cv::Mat feature = charFeatures(input, kPredictSize);
   auto index = static_cast<int>(classify(feature, maxVal, isChinese));
 
@@ -330,7 +332,7 @@ bool CharsIdentify::isCharacter(cv::Mat input, std::string& label, float& maxVal
     else {
       const char* key = kChars[index];
       std::string s = key;
-      std::string province = kv_->get(s);
+      std::string province = models->province(s);
       label = std::make_pair(s, province).second;
     }
     return true;
@@ -340,12 +342,13 @@ bool CharsIdentify::isCharacter(cv::Mat input, std::string& label, float& maxVal
 }
 
 std::pair<std::string, std::string> CharsIdentify::identifyChinese(cv::Mat input, float& out, bool& isChinese) {
+  auto models = ModelRegistry::instance()->acquire();
   cv::Mat feature = charFeatures(input, kChineseSize);
   float maxVal = -2;
   int result = 0;
 
   cv::Mat output(1, kChineseNumber, CV_32FC1);
-  annChinese_->predict(feature, output);
+  models->predictChineseAnn(feature, output);
 
   for (int j = 0; j < kChineseNumber; j++) {
     float val = output.at<float>(j);
@@ -369,19 +372,20 @@ std::pair<std::string, std::string> CharsIdentify::identifyChinese(cv::Mat input
   auto index = result + kCharsTotalNumber - kChineseNumber;
   const char* key = kChars[index];
   std::string s = key;
-  std::string province = kv_->get(s);
+  std::string province = models->province(s);
   out = maxVal;
 
   return std::make_pair(s, province);
 }
 
 std::pair<std::string, std::string> CharsIdentify::identifyChineseGray(cv::Mat input, float& out, bool& isChinese) {
+  auto models = ModelRegistry::instance()->acquire();
   cv::Mat feature;
   extractFeature(input, feature);
   float maxVal = -2;
   int result = 0;
   cv::Mat output(1, kChineseNumber, CV_32FC1);
-  annGray_->predict(feature, output);
+  models->predictGrayAnn(feature, output);
 
   for (int j = 0; j < kChineseNumber; j++) {
     float val = output.at<float>(j);
@@ -402,13 +406,16 @@ std::pair<std::string, std::string> CharsIdentify::identifyChineseGray(cv::Mat i
   auto index = result + kCharsTotalNumber - kChineseNumber;
   const char* key = kChars[index];
   std::string s = key;
-  std::string province = kv_->get(s);
+  std::string province = models->province(s);
   out = maxVal;
   return std::make_pair(s, province);
 }
 
 
 std::pair<std::string, std::string> CharsIdentify::identify(cv::Mat input, bool isChinese, bool isAlphabet) {
+  // classify() below must see the same set
+  ModelRegistry::Pin pin;
+  auto models = ModelRegistry::instance()->acquire();
   cv::Mat feature = charFeatures(input, kPredictSize);
   float maxVal = -2;
   auto index = static_cast<int>(classify(feature, maxVal, isChinese, isAlphabet));
@@ -418,13 +425,14 @@ std::pair<std::string, std::string> CharsIdentify::identify(cv::Mat input, bool
   else {
     const char* key = kChars[index];
     std::string s = key;
-    std::string province = kv_->get(s);
+    std::string province = models->province(s);
     return std::make_pair(s, province);
   }
 }
 
 int CharsIdentify::identify(std::vector<cv::Mat> inputs, std::vector<std::pair<std::string, std::string>>& outputs,
                             std::vector<bool> isChineseVec) {
+  auto models = ModelRegistry::instance()->acquire();
   Mat featureRows;
   size_t input_size = inputs.size();
   for (size_t i = 0; i < input_size; i++) {
@@ -445,7 +453,7 @@ int CharsIdentify::identify(std::vector<cv::Mat> inputs, std::vector<std::pair<s
     else {
       const char* key = kChars[index];
       std::string s = key;
-      std::string province = kv_->get(s);
+      std::string province = models->province(s);
       outputs[row_index] = std::make_pair(s, province);
     }
   }
@@ -2,6 +2,7 @@
 #include "easypr/core/chars_identify.h"
 #include "easypr/core/core_func.h"
 #include "easypr/core/params.h"
+#include "easypr/core/frame_workspace.h"
 #include "easypr/config.h"
 #include "thirdparty/mser/mser2.hpp"
 
@@ -18,6 +19,9 @@ CCharsSegment::CCharsSegment() {
   m_BluePercent = DEFAULT_BLUEPERCEMT;
   m_WhitePercent = DEFAULT_WHITEPERCEMT;
 
+  m_minCharCount = 0;
+  m_maxSpacingError = 0.f;
+
   m_debug = DEFAULT_DEBUG;
 }
 
@@ -891,17 +895,20 @@ int CCharsSegment::charsSegmentUsingOSTU(Mat input, vector<Mat>& resultVec, vect
   if (!input.data) return 0x01;
 
   Color plateType = color;
-  Mat input_grey;
+  FrameWorkspace& ws = FrameWorkspace::local();
+  ws.prepare(kStageSegment, input.size());
+
+  Mat& input_grey = ws.get(kStageSegment, 0);
   cvtColor(input, input_grey, CV_BGR2GRAY);
 
-  Mat img_threshold;
-  img_threshold = input_grey.clone();
+  Mat& img_threshold = ws.get(kStageSegment, 1);
+  input_grey.copyTo(img_threshold);
   spatial_ostu(img_threshold, 8, 2, plateType);
 
   // remove liuding and hor lines, also judge weather is plate use jump count
   if (!clearLiuDing(img_threshold)) return 0x02;
 
-  Mat img_contours;
+  Mat& img_contours = ws.get(kStageSegment, 2);
   img_threshold.copyTo(img_contours);
 
   vector<vector<Point> > contours;
@@ -948,6 +955,9 @@ int CCharsSegment::charsSegmentUsingOSTU(Mat input, vector<Mat>& resultVec, vect
 
   if (newSortedRect.size() == 0) return 0x05;
 
+  // hopeless layout, stop before the chars are identified
+  if (!verifyCharsLayout(newSortedRect)) return 0x06;
+
   bool useSlideWindow = true;
   bool useAdapThreshold = true;
   //bool useAdapThreshold = CParams::instance()->getParam1b();
@@ -985,10 +995,11 @@ int CCharsSegment::charsSegmentUsingOSTU(Mat input, vector<Mat>& resultVec, vect
       }
       newRoi = preprocessChar(newRoi);
 
-      // genenrate gray chinese char
+      // genenrate gray chinese char, input_grey is reused by the
+      // next plate, so the char is copied out of it
       Rect fit_mr = rectFit(mr, input_grey.cols, input_grey.rows);
       Mat grayChar(input_grey, fit_mr);
-      grayChars.push_back(grayChar);
+      grayChars.push_back(grayChar.clone());
     }
     resultVec.push_back(newRoi);
   }
@@ -1043,6 +1054,33 @@ int CCharsSegment::GetSpecificRect(const vector<Rect>& vecRect) {
   return specIndex;
 }
 
+bool CCharsSegment::verifyCharsLayout(const vector<Rect>& vecRect) const {
+  if (m_minCharCount > 0 && (int)vecRect.size() < m_minCharCount)
+    return false;
+
+  // rect 0 is the chinese, rect 1 is the city char, a dot follows it,
+  // so only the gaps from rect 2 on are expected to be equal
+  if (m_maxSpacingError > 0 && vecRect.size() > 4) {
+    vector<int> gaps;
+    for (size_t i = 3; i < vecRect.size(); i++) {
+      int prev = vecRect[i - 1].x + vecRect[i - 1].width / 2;
+      int curr = vecRect[i].x + vecRect[i].width / 2;
+      gaps.push_back(curr - prev);
+    }
+
+    vector<int> sorted(gaps);
+    std::nth_element(sorted.begin(), sorted.begin() + sorted.size() / 2, sorted.end());
+    float median = (float)sorted[sorted.size() / 2];
+    if (median <= 0) return false;
+
+    for (auto gap : gaps) {
+      if (std::abs(gap - median) / median > m_maxSpacingError)
+        return false;
+    }
+  }
+  return true;
+}
+
 int CCharsSegment::RebuildRect(const vector<Rect>& vecRect,
                                vector<Rect>& outRect, int specIndex) {
   int count = 6;
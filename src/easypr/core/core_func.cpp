@@ -3,8 +3,13 @@
 #include "easypr/core/chars_identify.h"
 #include "easypr/config.h"
 #include "easypr/core/params.h"
+#include "easypr/core/frame_workspace.h"
+#include "easypr/core/model_registry.h"
+#include "easypr/core/scratch_arena.h"
 #include "thirdparty/mser/mser2.hpp"
 #include <ctime>
+#include <exception>
+#include <mutex>
 
 namespace easypr {
   Mat colorMatch(const Mat &src, Mat &match, const Color r,
@@ -545,6 +550,35 @@ void clearBorder(const Mat &img, Rect& cropRect) {
   }
 
 
+  int otsuFromHistogram(const int* hist, int total) {
+    const int N = 256;
+    double mu = 0, scale = 1. / total;
+    for (int i = 0; i < N; i++) mu += i * (double) hist[i];
+    mu *= scale;
+
+    double mu1 = 0, q1 = 0;
+    double max_sigma = 0, max_val = 0;
+    for (int i = 0; i < N; i++) {
+      double p_i = hist[i] * scale;
+      mu1 *= q1;
+      q1 += p_i;
+      double q2 = 1. - q1;
+
+      if (std::min(q1, q2) < FLT_EPSILON || std::max(q1, q2) > 1. - FLT_EPSILON)
+        continue;
+
+      mu1 = (mu1 + i * p_i) / q1;
+      double mu2 = (mu - q1 * mu1) / q2;
+      double sigma = q1 * q2 * (mu1 - mu2) * (mu1 - mu2);
+      if (sigma > max_sigma) {
+        max_sigma = sigma;
+        max_val = i;
+      }
+    }
+    return int(max_val);
+  }
+
+
   Mat histeq(Mat in) {
     Mat out(in.size(), in.type());
     if (in.channels() == 3) {
@@ -1262,30 +1296,49 @@ void clearBorder(const Mat &img, Rect& cropRect) {
   }
 
 
-  bool judegMDOratio2(const Mat &image, const Rect &rect, std::vector<Point> &contour, Mat &result, const float thresh,
-    bool useExtendHeight) {
+  // gray level histogram of a rect of an 8 bit image
+  static void rectHistogram(const Mat &image, const Rect &rect, int *hist) {
+    memset(hist, 0, 256 * sizeof(hist[0]));
+    for (int i = rect.y; i < rect.y + rect.height; i++) {
+      const uchar *row = image.ptr<uchar>(i) + rect.x;
+      for (int j = 0; j < rect.width; j++) hist[row[j]]++;
+    }
+  }
 
-    Mat mser = image(rect);
-    Mat mser_mat;
-    cv::threshold(mser, mser_mat, 0, 255, CV_THRESH_BINARY | CV_THRESH_OTSU);
+  // the pixels a binary threshold at level keeps
+  static int countAbove(const int *hist, int level) {
+    int count = 0;
+    for (int i = level + 1; i < 256; i++) count += hist[i];
+    return count;
+  }
+
+  float mserDiffOstuRatio(const Mat &image, const Rect &rect, bool useExtendHeight,
+                          Rect &normalRect, double &ostuLevel) {
+    // otsu from the histograms gives the same counts as thresholding
+    // the two rects, without writing any binary image
+    int hist[256];
+    rectHistogram(image, rect, hist);
+    int level = otsuFromHistogram(hist, rect.area());
+    int mserCount = countAbove(hist, level);
+    ostuLevel = level;
 
-    Rect normalRect = adaptive_charrect_from_rect(rect, image.cols, image.rows, useExtendHeight);
-    Mat region = image(normalRect);
-    Mat thresh_mat;
-    cv::threshold(region, thresh_mat, 0, 255, CV_THRESH_BINARY | CV_THRESH_OTSU);
+    normalRect = adaptive_charrect_from_rect(rect, image.cols, image.rows, useExtendHeight);
+    rectHistogram(image, normalRect, hist);
+    int regionCount = countAbove(hist, otsuFromHistogram(hist, normalRect.area()));
 
     // count mser diff ratio
-    int countdiff = abs(countNonZero(thresh_mat) - countNonZero(mser_mat));
+    int countdiff = abs(regionCount - mserCount);
+    return float(countdiff) / float(rect.area());
+  }
 
-    float MserDiffOstuRatio = float(countdiff) / float(rect.area());
+  bool judegMDOratio2(const Mat &image, const Rect &rect, std::vector<Point> &contour, Mat &result, const float thresh,
+    bool useExtendHeight) {
+    Rect normalRect;
+    double ostuLevel;
+    float MserDiffOstuRatio = mserDiffOstuRatio(image, rect, useExtendHeight, normalRect, ostuLevel);
 
     if (MserDiffOstuRatio > thresh) {
       //std::cout << "MserDiffOstuRatio:" << MserDiffOstuRatio << std::endl;
-      /*imshow("tmpMat", mser_mat);
-      waitKey(0);
-      imshow("tmpMat", thresh_mat);
-      waitKey(0);*/
-
       cv::rectangle(result, normalRect, Scalar(0, 0, 0), 2);
       return false;
     }
@@ -1604,12 +1657,37 @@ void clearBorder(const Mat &img, Rect& cropRect) {
     }
   }
 
+  void parallelFor(int count, const std::function<void(int)> &task) {
+    // a single task, or opencv limited to one thread, runs in place
+    if (count <= 1 || cv::getNumThreads() <= 1) {
+      for (int index = 0; index < count; index++) task(index);
+      return;
+    }
+
+    std::mutex errorMutex;
+    std::exception_ptr error;
+    cv::parallel_for_(cv::Range(0, count), [&](const cv::Range &range) {
+      for (int index = range.start; index < range.end; index++) {
+        try {
+          task(index);
+        }
+        catch (...) {
+          std::lock_guard<std::mutex> lock(errorMutex);
+          if (!error) error = std::current_exception();
+          return;
+        }
+      }
+    }, count);
+    if (error)
+      std::rethrow_exception(error);
+  }
+
 //! use verify size to first generate char candidates
   void mserCharMatch(const Mat &src, std::vector<Mat> &match, std::vector<CPlate> &out_plateVec_blue,
                      std::vector<CPlate> &out_plateVec_yellow,
                      bool usePlateMser, std::vector<RotatedRect> &out_plateRRect_blue,
                      std::vector<RotatedRect> &out_plateRRect_yellow, int img_index,
-                     bool showDebug) {
+                     bool showDebug, const std::vector<Rect> &rois) {
     Mat image = src;
 
     std::vector<std::vector<std::vector<Point>>> all_contours;
@@ -1633,83 +1711,137 @@ void clearBorder(const Mat &img, Rect& cropRect) {
     const int minArea = 30;
     const double maxAreaRatio = 0.05;
 
+    // the area limit stays relative to the whole image, so a roi does not
+    // change which regions are kept
     Ptr<MSER2> mser;
     mser = MSER2::create(delta, minArea, int(maxAreaRatio * imageArea));
-    mser->detectRegions(image, all_contours.at(0), all_boxes.at(0), all_contours.at(1), all_boxes.at(1));
+    if (rois.empty())
+      mser->detectRegions(image, all_contours.at(0), all_boxes.at(0), all_contours.at(1), all_boxes.at(1));
+    else
+      mser->detectRegions(image, rois, all_contours.at(0), all_boxes.at(0), all_contours.at(1), all_boxes.at(1));
 
     // mser detect
     // color_index = 0 : mser-, detect white characters, which is in blue plate.
     // color_index = 1 : mser+, detect dark characters, which is in yellow plate.
 
-#pragma omp parallel for
+    // region filtering. the regions of both colors are cut into chunks
+    // and the threads take chunks as they finish, so the work spreads
+    // over every core instead of one thread per color. each chunk writes
+    // its own output, and concatenating them in chunk order keeps the
+    // order of the serial loop. the chunks run on the opencv pool, see
+    // parallelFor
+    const int char_size = 20;
+    const int kRegionChunk = 64;
+
+    struct RegionChunk {
+      int color_index;
+      size_t begin, end;
+      std::vector<CCharacter> chars;
+      std::vector<RotatedRect> plates;
+      std::vector<Rect> rejected;
+    };
+    std::vector<RegionChunk> chunks;
     for (int color_index = 0; color_index < 2; color_index++) {
-      Color the_color = flags.at(color_index);
-
-      std::vector<CCharacter> charVec;
-      charVec.reserve(128);
-
-      match.at(color_index) = Mat::zeros(image.rows, image.cols, image.type());
-
-      Mat result = image.clone();
-      cvtColor(result, result, COLOR_GRAY2BGR);
-
       size_t size = all_contours.at(color_index).size();
+      for (size_t begin = 0; begin < size; begin += kRegionChunk) {
+        RegionChunk chunk;
+        chunk.color_index = color_index;
+        chunk.begin = begin;
+        chunk.end = std::min(size, begin + kRegionChunk);
+        chunks.push_back(chunk);
+      }
+    }
 
-      int char_index = 0;
-      int char_size = 20;
-
-      // Chinese plate has max 7 characters.
-      const int char_max_count = 7;
+    parallelFor((int) chunks.size(), [&](int chunk_index) {
+      RegionChunk &chunk = chunks[chunk_index];
+      const std::vector<Rect> &boxes = all_boxes.at(chunk.color_index);
+      const std::vector<std::vector<Point>> &contours = all_contours.at(chunk.color_index);
 
       // verify char size and output to rects;
-      for (size_t index = 0; index < size; index++) {
-        Rect rect = all_boxes.at(color_index)[index];
-        std::vector<Point> &contour = all_contours.at(color_index)[index];
+      for (size_t index = chunk.begin; index < chunk.end; index++) {
+        const Rect &rect = boxes[index];
+        const std::vector<Point> &contour = contours[index];
 
         // sometimes a plate could be a mser rect, so we could
         // also use mser algorithm to find plate
         if (usePlateMser) {
           RotatedRect rrect = minAreaRect(Mat(contour));
-          if (verifyRotatedPlateSizes(rrect)) {
-            //rotatedRectangle(result, rrect, Scalar(255, 0, 0), 2);
-            if (the_color == BLUE) out_plateRRect_blue.push_back(rrect);
-            if (the_color == YELLOW) out_plateRRect_yellow.push_back(rrect);
-          }
+          if (verifyRotatedPlateSizes(rrect)) chunk.plates.push_back(rrect);
         }
 
         // find character
-        if (verifyCharSizes(rect)) {
-          Mat mserMat = adaptive_image_from_points(contour, rect, Size(char_size, char_size));
-          Mat charInput = preprocessChar(mserMat, char_size);
-          Rect charRect = rect;
-
-          Point center(charRect.tl().x + charRect.width / 2, charRect.tl().y + charRect.height / 2);
-          Mat tmpMat;
-          double ostu_level = cv::threshold(image(charRect), tmpMat, 0, 255, CV_THRESH_BINARY | CV_THRESH_OTSU);
-
-          //cv::circle(result, center, 3, Scalar(0, 0, 255), 2);
-
-          // use judegMDOratio2 function to
-          // remove the small lines in character like "zh-cuan"
-          if (judegMDOratio2(image, rect, contour, result)) {
-            CCharacter charCandidate;
-            charCandidate.setCharacterPos(charRect);
-            charCandidate.setCharacterMat(charInput);
-            charCandidate.setOstuLevel(ostu_level);
-            charCandidate.setCenterPoint(center);
-            charCandidate.setIsChinese(false);
-            charVec.push_back(charCandidate);
-          }
+        if (!verifyCharSizes(rect)) continue;
+
+        // use the MD ratio to remove the small lines in character
+        // like "zh-cuan", the rejected rects are drawn later
+        Rect normalRect;
+        double ostu_level;
+        if (mserDiffOstuRatio(image, rect, false, normalRect, ostu_level) > 1.f) {
+          chunk.rejected.push_back(normalRect);
+          continue;
         }
-      }
 
-      // improtant, use matrix multiplication to acclerate the
-      // classification of many samples. use the character
-      // score, we can use non-maximum superssion (nms) to
-      // reduce the characters which are not likely to be true
-      // charaters, and use the score to select the strong seed
-      // of which the score is larger than 0.9
-      CharsIdentify::instance()->classify(charVec);
+        Mat mserMat = adaptive_image_from_points(contour, rect, Size(char_size, char_size));
+        Mat charInput = preprocessChar(mserMat, char_size);
+        Point center(rect.tl().x + rect.width / 2, rect.tl().y + rect.height / 2);
+
+        CCharacter charCandidate;
+        charCandidate.setCharacterPos(rect);
+        charCandidate.setCharacterMat(charInput);
+        charCandidate.setOstuLevel(ostu_level);
+        charCandidate.setCenterPoint(center);
+        charCandidate.setIsChinese(false);
+        chunk.chars.push_back(charCandidate);
+      }
+    });
+
+    std::vector<CCharacter> allChars;
+    size_t colorCharCount[2] = { 0, 0 };
+    for (auto &chunk : chunks) {
+      colorCharCount[chunk.color_index] += chunk.chars.size();
+      allChars.insert(allChars.end(), chunk.chars.begin(), chunk.chars.end());
+      std::vector<RotatedRect> &plateRRects =
+          chunk.color_index == 0 ? out_plateRRect_blue : out_plateRRect_yellow;
+      plateRRects.insert(plateRRects.end(), chunk.plates.begin(), chunk.plates.end());
+    }
+
+    // improtant, use matrix multiplication to acclerate the
+    // classification of many samples. both colors go through the ann
+    // in one batch. use the character score, we can use non-maximum
+    // superssion (nms) to reduce the characters which are not likely
+    // to be true charaters, and use the score to select the strong
+    // seed of which the score is larger than 0.9
+    CharsIdentify::instance()->classify(allChars);
+
+    std::vector<CCharacter> colorChars[2];
+    colorChars[0].assign(allChars.begin(), allChars.begin() + colorCharCount[0]);
+    colorChars[1].assign(allChars.begin() + colorCharCount[0], allChars.end());
+
+    auto models = ModelRegistry::instance()->acquire();
+#pragma omp parallel for
+    for (int color_index = 0; color_index < 2; color_index++) {
+      ModelRegistry::Pin pin(models);
+      Color the_color = flags.at(color_index);
+
+      std::vector<CCharacter> &charVec = colorChars[color_index];
+
+      // frame sized buffers of this color, slots 1 and 2 are used by plateMserLocate
+      FrameWorkspace& ws = FrameWorkspace::local();
+      Mat& matchBuf = ws.get(kStageMser, 3 + color_index * 2);
+      matchBuf.create(image.rows, image.cols, image.type());
+      matchBuf.setTo(Scalar(0));
+      match.at(color_index) = matchBuf;
+
+      Mat& result = ws.get(kStageMser, 4 + color_index * 2);
+      cvtColor(image, result, COLOR_GRAY2BGR);
+      for (auto &chunk : chunks)
+        if (chunk.color_index == color_index)
+          for (auto &rect : chunk.rejected) cv::rectangle(result, rect, Scalar(0, 0, 0), 2);
+
+      int char_index = 0;
+
+      // Chinese plate has max 7 characters.
+      const int char_max_count = 7;
 
       // use nms to remove the character are not likely to be true.
       double overlapThresh = 0.6;
@@ -2140,27 +2272,54 @@ void clearBorder(const Mat &img, Rect& cropRect) {
 // this spatial_ostu algorithm are robust to 
 // the plate which has the same light shine, which is that
 // the light in the left of the plate is strong than the right.
+// all the cell histograms are gathered in one pass over the plate, and
+// the cell levels come from them, the result is the same as running
+// threshold(CV_THRESH_OTSU) on every cell.
   void spatial_ostu(InputArray _src, int grid_x, int grid_y, Color type) {
     Mat src = _src.getMat();
+    CV_Assert(src.type() == CV_8UC1);
 
     int width = src.cols / grid_x;
     int height = src.rows / grid_y;
+    if (width <= 0 || height <= 0) return;
+
+    const int cells = grid_x * grid_y;
+    CV_Assert(cells <= 256);
+    ScratchArena& arena = ScratchArena::local();
+    size_t mark = arena.mark();
+    Mat hist = arena.alloc(cells, 256, CV_32SC1);
+    hist.setTo(Scalar(0));
+
+    for (int i = 0; i < grid_y * height; i++) {
+      const uchar* p = src.ptr<uchar>(i);
+      int* cellRow = hist.ptr<int>(i / height * grid_x);
+      for (int j = 0; j < grid_x; j++) {
+        int* h = cellRow + j * 256;
+        const uchar* q = p + j * width;
+        for (int k = 0; k < width; k++) h[q[k]]++;
+      }
+    }
+
+    int levels[256];
+    for (int c = 0; c < cells; c++)
+      levels[c] = otsuFromHistogram(hist.ptr<int>(c), width * height);
 
-    // iterate through grid
-    for (int i = 0; i < grid_y; i++) {
+    // yellow and white plates have dark characters
+    bool inverse = (type == YELLOW || type == WHITE);
+    const uchar above = inverse ? 0 : 255;
+    const uchar below = inverse ? 255 : 0;
+
+    for (int i = 0; i < grid_y * height; i++) {
+      uchar* p = src.ptr<uchar>(i);
+      const int* cellLevel = levels + i / height * grid_x;
       for (int j = 0; j < grid_x; j++) {
-        Mat src_cell = Mat(src, Range(i * height, (i + 1) * height), Range(j * width, (j + 1) * width));
-        if (type == BLUE) {
-          cv::threshold(src_cell, src_cell, 0, 255, CV_THRESH_OTSU + CV_THRESH_BINARY);
-        } else if (type == YELLOW) {
-          cv::threshold(src_cell, src_cell, 0, 255, CV_THRESH_OTSU + CV_THRESH_BINARY_INV);
-        } else if (type == WHITE) {
-          cv::threshold(src_cell, src_cell, 0, 255, CV_THRESH_OTSU + CV_THRESH_BINARY_INV);
-        } else {
-          cv::threshold(src_cell, src_cell, 0, 255, CV_THRESH_OTSU + CV_THRESH_BINARY);
-        }
+        int level = cellLevel[j];
+        uchar* q = p + j * width;
+        for (int k = 0; k < width; k++) q[k] = q[k] > level ? above : below;
       }
     }
+
+    arena.rewind(mark);
   }
 
 
@@ -1,5 +1,6 @@
 #include "easypr/core/feature.h"
 #include "easypr/core/core_func.h"
+#include "easypr/core/scratch_arena.h"
 #include "thirdparty/LBP/lbp.hpp"
 
 namespace easypr {
@@ -91,12 +92,76 @@ void getColorFeatures(const Mat& src, Mat& features) {
 }
 
 
+// normalize the histogram by its max value, the same as convertTo in ProjectedHistogram
+static void normalizeRow(float* p, int n) {
+  float max = 0.f;
+  for (int i = 0; i < n; i++)
+    if (p[i] > max) max = p[i];
+
+  if (max > 0) {
+    float scale = float(1.0 / max);
+    for (int i = 0; i < n; i++) p[i] = p[i] * scale;
+  }
+}
+
+// fused version of getHistogramFeatures + getColorFeatures + hconcat.
+// the gray and hsv images live in the thread scratch arena, the gray and hue
+// histograms are built in one pass, and the binary image is never made:
+// the projections count the pixels above the otsu level directly.
+// the output is identical to the old path, features is only reallocated
+// when it does not have the right size, so the caller can pass an arena row.
 void getHistomPlusColoFeatures(const Mat& image, Mat& features) {
-  // TODO
-  Mat feature1, feature2;
-  getHistogramFeatures(image, feature1);
-  getColorFeatures(image, feature2);
-  hconcat(feature1.reshape(1, 1), feature2.reshape(1, 1), features);
+  const int sz = 180;
+  int nRows = image.rows;
+  int nCols = image.cols;
+
+  ScratchArena& arena = ScratchArena::local();
+  size_t mark = arena.mark();
+
+  Mat grayImage = arena.alloc(nRows, nCols, CV_8UC1);
+  Mat src_hsv = arena.alloc(nRows, nCols, CV_8UC3);
+  cvtColor(image, grayImage, CV_RGB2GRAY);
+  cvtColor(image, src_hsv, CV_BGR2HSV);
+
+  int grayHist[256] = { 0 };
+  int h[sz] = { 0 };
+  for (int i = 0; i < nRows; ++i) {
+    const uchar* g = grayImage.ptr<uchar>(i);
+    const uchar* p = src_hsv.ptr<uchar>(i);
+    for (int j = 0; j < nCols; ++j) {
+      grayHist[g[j]]++;
+      int H = int(p[j * 3]);
+      if (H > sz - 1) H = sz - 1;
+      h[H]++;
+    }
+  }
+  int level = otsuFromHistogram(grayHist, nRows * nCols);
+
+  // vertical projection, then horizontal projection, then color histogram
+  features.create(1, nCols + nRows + sz, CV_32F);
+  float* vhist = features.ptr<float>(0);
+  float* hhist = vhist + nCols;
+  float* chist = hhist + nRows;
+
+  for (int j = 0; j < nCols; ++j) vhist[j] = 0.f;
+  for (int i = 0; i < nRows; ++i) {
+    const uchar* g = grayImage.ptr<uchar>(i);
+    int count = 0;
+    for (int j = 0; j < nCols; ++j) {
+      if (g[j] > level) {
+        vhist[j] += 1.f;
+        count++;
+      }
+    }
+    hhist[i] = (float)count;
+  }
+  for (int j = 0; j < sz; j++) chist[j] = (float)h[j];
+
+  normalizeRow(vhist, nCols);
+  normalizeRow(hhist, nRows);
+  normalizeRow(chist, sz);
+
+  arena.rewind(mark);
 }
 
 
@@ -135,11 +200,9 @@ void getLBPFeatures(const Mat& image, Mat& features) {
   Mat grayImage;
   cvtColor(image, grayImage, CV_RGB2GRAY);
 
-  Mat lbpimage;
-  lbpimage = libfacerec::olbp(grayImage);
-  Mat lbp_hist = libfacerec::spatial_histogram(lbpimage, 32, 4, 4);
-
-  features = lbp_hist;
+  // lbp and its histogram in one pass, straight into the feature row
+  features.create(1, 32 * 4 * 4, CV_32FC1);
+  libfacerec::olbp_spatial_histogram(grayImage, 32, 4, 4, features.ptr<float>());
 }
 
 Mat charFeatures(Mat in, int sizeData) {
@@ -308,9 +371,9 @@ void getGrayCharFeatures(const Mat& grayChar, Mat& features) {
   // use lbp to get features, it can be changed to other
   Mat feautreImg;
   if (useLBP) {
-    Mat lbpimage = libfacerec::olbp(char_mat);
-    SHOW_IMAGE(lbpimage, 0);
-    feautreImg = libfacerec::spatial_histogram(lbpimage, kCharLBPPatterns, kCharLBPGridX, kCharLBPGridY);
+    feautreImg.create(1, kCharLBPPatterns * kCharLBPGridX * kCharLBPGridY, CV_32FC1);
+    libfacerec::olbp_spatial_histogram(char_mat, kCharLBPPatterns, kCharLBPGridX, kCharLBPGridY,
+                                       feautreImg.ptr<float>());
   } else {
     feautreImg = mean_img.reshape(1, 1);
   }
@@ -368,9 +431,9 @@ void getGrayPlusProject(const Mat& grayChar, Mat& features)
   // use lbp to get features, it can be changed to other
   Mat feautreImg;
   if (useLBP) {
-    Mat lbpimage = libfacerec::olbp(char_mat);
-    SHOW_IMAGE(lbpimage, 0);
-    feautreImg = libfacerec::spatial_histogram(lbpimage, kCharLBPPatterns, kCharLBPGridX, kCharLBPGridY);
+    feautreImg.create(1, kCharLBPPatterns * kCharLBPGridX * kCharLBPGridY, CV_32FC1);
+    libfacerec::olbp_spatial_histogram(char_mat, kCharLBPPatterns, kCharLBPGridX, kCharLBPGridY,
+                                       feautreImg.ptr<float>());
   }
   else {
     feautreImg = mean_img.reshape(1, 1);
@@ -430,37 +493,63 @@ void getGrayPlusLBP(const Mat& grayChar, Mat& features)
   }
   SHOW_IMAGE(mean_img, 0);
 
-  // use lbp to get features, it can be changed to other
-  Mat originImage = mean_img.clone();
-  Mat lbpimage = libfacerec::olbp(mean_img);
-  SHOW_IMAGE(lbpimage, 0);
-  lbpimage = libfacerec::spatial_histogram(lbpimage, kCharLBPPatterns, kCharLBPGridX, kCharLBPGridY);
-
-  // 32x20 + 16x16
-  hconcat(mean_img.reshape(1, 1), lbpimage.reshape(1, 1), features);
+  // use lbp to get features, it can be changed to other.
+  // 32x20 + 16x16, both parts are written into one row
+  int grayCols = int(mean_img.total());
+  features.create(1, grayCols + kCharLBPPatterns * kCharLBPGridX * kCharLBPGridY, CV_32FC1);
+  mean_img.reshape(1, 1).copyTo(features.colRange(0, grayCols));
+  libfacerec::olbp_spatial_histogram(mean_img, kCharLBPPatterns, kCharLBPGridX, kCharLBPGridY,
+                                     features.ptr<float>() + grayCols);
 }
 
 void getLBPplusHistFeatures(const Mat& image, Mat& features) {
   Mat grayImage;
   cvtColor(image, grayImage, CV_RGB2GRAY);
 
-  Mat lbpimage;
-  lbpimage = libfacerec::olbp(grayImage);
-  Mat lbp_hist = libfacerec::spatial_histogram(lbpimage, 64, 8, 4);
-  //features = lbp_hist.reshape(1, 1);
-
-  Mat greyImage;
-  cvtColor(image, greyImage, CV_RGB2GRAY);
-
   //grayImage = histeq(grayImage);
   Mat img_threshold;
-  threshold(greyImage, img_threshold, 0, 255,
+  threshold(grayImage, img_threshold, 0, 255,
     CV_THRESH_OTSU + CV_THRESH_BINARY);
   Mat histomFeatures = getHistogram(img_threshold);
 
-  hconcat(lbp_hist.reshape(1, 1), histomFeatures.reshape(1, 1), features);
+  // the lbp histogram and the projections go into one row
+  const int lbpCols = 64 * 8 * 4;
+  features.create(1, lbpCols + histomFeatures.cols, CV_32FC1);
+  libfacerec::olbp_spatial_histogram(grayImage, 64, 8, 4, features.ptr<float>());
+  histomFeatures.reshape(1, 1).copyTo(features.colRange(lbpCols, features.cols));
   //std::cout << features << std::endl;
   //features = histomFeatures;
 }
 
+namespace {
+  // the plate feature functions by name, for featureName and featureByName
+  const std::pair<svmCallback, const char*> kFeatureNames[] = {
+    { getGrayPlusProject, "getGrayPlusProject" },
+    { getHistogramFeatures, "getHistogramFeatures" },
+    { getSIFTFeatures, "getSIFTFeatures" },
+    { getHOGFeatures, "getHOGFeatures" },
+    { getHSVHistFeatures, "getHSVHistFeatures" },
+    { getLBPFeatures, "getLBPFeatures" },
+    { getColorFeatures, "getColorFeatures" },
+    { getHistomPlusColoFeatures, "getHistomPlusColoFeatures" },
+    { getLBPplusHistFeatures, "getLBPplusHistFeatures" },
+    { getGrayCharFeatures, "getGrayCharFeatures" },
+    { getGrayPlusLBP, "getGrayPlusLBP" },
+  };
+}
+
+std::string featureName(svmCallback callback) {
+  for (auto& name : kFeatureNames) {
+    if (name.first == callback) return name.second;
+  }
+  return std::string();
+}
+
+svmCallback featureByName(const std::string& name) {
+  for (auto& feature : kFeatureNames) {
+    if (name == feature.second) return feature.first;
+  }
+  return nullptr;
+}
+
 }
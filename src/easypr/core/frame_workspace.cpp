@@ -0,0 +1,123 @@
+#include "easypr/core/frame_workspace.h"
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <algorithm>
+
+namespace easypr {
+
+  namespace {
+    std::atomic<bool> g_profile(false);
+
+    // all the live workspaces, used by the profiling report
+    std::mutex g_registryMutex;
+    std::vector<FrameWorkspace*> g_registry;
+
+    // peaks of the workspaces whose thread already exited
+    size_t g_retiredPeaks[kStageCount] = { 0 };
+  }
+
+  FrameWorkspace::FrameWorkspace() {
+    for (int i = 0; i < kStageCount; i++) m_peaks[i] = 0;
+
+    std::lock_guard<std::mutex> lock(g_registryMutex);
+    g_registry.push_back(this);
+  }
+
+  FrameWorkspace::~FrameWorkspace() {
+    std::lock_guard<std::mutex> lock(g_registryMutex);
+    for (int i = 0; i < kStageCount; i++)
+      g_retiredPeaks[i] = std::max(g_retiredPeaks[i], m_peaks[i]);
+    g_registry.erase(std::remove(g_registry.begin(), g_registry.end(), this), g_registry.end());
+  }
+
+  FrameWorkspace& FrameWorkspace::local() {
+    static thread_local FrameWorkspace workspace;
+    return workspace;
+  }
+
+  void FrameWorkspace::prepare(FrameStage stage, const Size& size) {
+    // what the stage used last time is its working set
+    if (g_profile) updatePeak();
+
+    if (m_sizes[stage] == size) return;
+
+    for (int i = 0; i < kSlotsPerStage; i++) {
+      Mat& buffer = m_buffers[stage][i];
+      Mat& storage = m_storage[stage][i];
+      if (buffer.empty() || buffer.size() != m_sizes[stage]) continue;
+
+      // the stage allocated the buffer itself, keep it if it is the larger
+      int type = buffer.type();
+      if (buffer.u != storage.u && buffer.isContinuous() &&
+          (storage.type() != type || buffer.total() > storage.total()))
+        storage = buffer.reshape(0, 1);
+
+      // a continuous view of the front of the allocation, which create()
+      // leaves alone as long as the stage asks for the same size and type
+      int count = size.area();
+      if (storage.type() != type || int(storage.total()) < count)
+        storage.create(1, count, type);
+      buffer = count > 0 ? storage.colRange(0, count).reshape(0, size.height) : Mat();
+    }
+    m_sizes[stage] = size;
+  }
+
+  Mat& FrameWorkspace::get(FrameStage stage, int slot) {
+    CV_Assert(slot >= 0 && slot < kSlotsPerStage);
+    return m_buffers[stage][slot];
+  }
+
+  size_t FrameWorkspace::stageBytes(FrameStage stage) const {
+    size_t bytes = 0;
+    for (int i = 0; i < kSlotsPerStage; i++) {
+      const Mat& m = m_buffers[stage][i];
+      const Mat& s = m_storage[stage][i];
+      if (s.datastart) bytes += size_t(s.dataend - s.datastart);
+      if (m.datastart && m.u != s.u) bytes += size_t(m.dataend - m.datastart);
+    }
+    return bytes;
+  }
+
+  void FrameWorkspace::updatePeak() {
+    for (int i = 0; i < kStageCount; i++)
+      m_peaks[i] = std::max(m_peaks[i], stageBytes(FrameStage(i)));
+  }
+
+  void FrameWorkspace::setProfile(bool param) { g_profile = param; }
+
+  bool FrameWorkspace::getProfile() { return g_profile; }
+
+  size_t FrameWorkspace::peakBytes(FrameStage stage) {
+    std::lock_guard<std::mutex> lock(g_registryMutex);
+    size_t peak = g_retiredPeaks[stage];
+    for (auto workspace : g_registry) {
+      workspace->updatePeak();
+      peak = std::max(peak, workspace->m_peaks[stage]);
+    }
+    return peak;
+  }
+
+  void FrameWorkspace::report(std::ostream& out) {
+    size_t total = 0;
+    for (int i = 0; i < kStageCount; i++) {
+      size_t bytes = peakBytes(FrameStage(i));
+      total += bytes;
+      out << stageName(FrameStage(i)) << ": " << bytes << " bytes" << std::endl;
+    }
+    out << "total: " << total << " bytes" << std::endl;
+  }
+
+  const char* FrameWorkspace::stageName(FrameStage stage) {
+    switch (stage) {
+      case kStageSobel:   return "sobel";
+      case kStageColor:   return "color";
+      case kStageDeskew:  return "deskew";
+      case kStageMser:    return "mser";
+      case kStageSegment: return "segment";
+      case kStageEr:      return "er";
+      default:            return "unknown";
+    }
+  }
+
+}
@@ -0,0 +1,136 @@
+#include "easypr/core/mlp_evaluator.h"
+
+namespace easypr {
+
+MlpEvaluator::MlpEvaluator() {
+  m_activation = ml::ANN_MLP::IDENTITY;
+  m_fparam1 = 0;
+  m_fparam2 = 0;
+}
+
+bool MlpEvaluator::load(const std::string& path) {
+  *this = MlpEvaluator();
+
+  FileStorage fs(path, FileStorage::READ);
+  if (!fs.isOpened()) return false;
+  FileNode fn = fs["opencv_ml_ann_mlp"];
+  if (fn.empty()) return false;
+
+  std::vector<int> layerSizes;
+  fn["layer_sizes"] >> layerSizes;
+  if (layerSizes.size() < 2) return false;
+
+  std::string activation = (std::string)fn["activation_function"];
+  int activ;
+  if (activation == "IDENTITY")
+    activ = ml::ANN_MLP::IDENTITY;
+  else if (activation == "SIGMOID_SYM")
+    activ = ml::ANN_MLP::SIGMOID_SYM;
+  else
+    return false;
+
+  std::vector<double> inputScale, outputScale;
+  fn["input_scale"] >> inputScale;
+  fn["output_scale"] >> outputScale;
+  if (inputScale.size() != size_t(layerSizes.front() * 2) ||
+      outputScale.size() != size_t(layerSizes.back() * 2))
+    return false;
+
+  FileNode weightsNode = fn["weights"];
+  if ((int)weightsNode.size() != (int)layerSizes.size() - 1) return false;
+
+  std::vector<Mat> weights;
+  FileNodeIterator it = weightsNode.begin();
+  for (size_t i = 1; i < layerSizes.size(); i++, ++it) {
+    std::vector<double> w;
+    (*it) >> w;
+    int rows = layerSizes[i - 1] + 1, cols = layerSizes[i];
+    if (w.size() != size_t(rows * cols)) return false;
+    weights.push_back(Mat(rows, cols, CV_64F, w.data()).clone());
+  }
+
+  m_layerSizes = layerSizes;
+  m_activation = activ;
+  m_fparam1 = (double)fn["f_param1"];
+  m_fparam2 = (double)fn["f_param2"];
+  m_inputScale = Mat(1, (int)inputScale.size(), CV_64F, inputScale.data()).clone();
+  m_outputScale = Mat(1, (int)outputScale.size(), CV_64F, outputScale.data()).clone();
+  m_weights = weights;
+  return true;
+}
+
+void MlpEvaluator::wrap(const std::vector<int>& layerSizes, int activation,
+                        double fparam1, double fparam2, const double* inputScale,
+                        const double* outputScale,
+                        const std::vector<const double*>& weights) {
+  CV_Assert(layerSizes.size() >= 2 && weights.size() == layerSizes.size() - 1);
+
+  m_layerSizes = layerSizes;
+  m_activation = activation;
+  m_fparam1 = fparam1;
+  m_fparam2 = fparam2;
+  m_inputScale = Mat(1, layerSizes.front() * 2, CV_64F, const_cast<double*>(inputScale));
+  m_outputScale = Mat(1, layerSizes.back() * 2, CV_64F, const_cast<double*>(outputScale));
+  m_weights.clear();
+  for (size_t i = 1; i < layerSizes.size(); i++) {
+    m_weights.push_back(Mat(layerSizes[i - 1] + 1, layerSizes[i], CV_64F,
+                            const_cast<double*>(weights[i - 1])));
+  }
+}
+
+void MlpEvaluator::activate(Mat& sums, const Mat& weights) const {
+  const double* bias = weights.ptr<double>(weights.rows - 1);
+  double scale = m_activation == ml::ANN_MLP::SIGMOID_SYM ? -m_fparam1 : 1.;
+
+  for (int i = 0; i < sums.rows; i++) {
+    double* data = sums.ptr<double>(i);
+    for (int j = 0; j < sums.cols; j++) data[j] = (data[j] + bias[j]) * scale;
+  }
+  if (m_activation != ml::ANN_MLP::SIGMOID_SYM) return;
+
+  // beta * (1 - e^(-alpha x)) / (1 + e^(-alpha x))
+  exp(sums, sums);
+  for (int i = 0; i < sums.rows; i++) {
+    double* data = sums.ptr<double>(i);
+    for (int j = 0; j < sums.cols; j++) {
+      if (!cvIsInf(data[j]))
+        data[j] = m_fparam2 * (1. - data[j]) / (1. + data[j]);
+      else
+        data[j] = -m_fparam2;
+    }
+  }
+}
+
+void MlpEvaluator::predict(const Mat& samples, Mat& outputs) const {
+  CV_Assert(!empty());
+  CV_Assert(samples.type() == CV_32FC1 && samples.cols == m_layerSizes.front());
+
+  int n = samples.rows;
+  const double* inScale = m_inputScale.ptr<double>(0);
+  Mat layerIn(n, samples.cols, CV_64F);
+  for (int i = 0; i < n; i++) {
+    const float* src = samples.ptr<float>(i);
+    double* dst = layerIn.ptr<double>(i);
+    for (int j = 0; j < samples.cols; j++)
+      dst[j] = src[j] * inScale[j * 2] + inScale[j * 2 + 1];
+  }
+
+  for (size_t l = 0; l < m_weights.size(); l++) {
+    const Mat& w = m_weights[l];
+    Mat layerOut;
+    gemm(layerIn, w.rowRange(0, layerIn.cols), 1, noArray(), 0, layerOut);
+    activate(layerOut, w);
+    layerIn = layerOut;
+  }
+
+  const double* outScale = m_outputScale.ptr<double>(0);
+  outputs.create(n, layerIn.cols, CV_32FC1);
+  for (int i = 0; i < n; i++) {
+    const double* src = layerIn.ptr<double>(i);
+    float* dst = outputs.ptr<float>(i);
+    for (int j = 0; j < layerIn.cols; j++)
+      dst[j] = (float)(src[j] * outScale[j * 2] + outScale[j * 2 + 1]);
+  }
+}
+
+}
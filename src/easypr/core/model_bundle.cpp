@@ -0,0 +1,346 @@
+#include "easypr/core/model_bundle.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace easypr {
+
+namespace {
+
+  const int kMaxLayers = 8;
+
+  // payload heads, the offsets are from the start of the payload
+  struct SvmPayload {
+    int32_t svCount;
+    int32_t varCount;
+    double rho;
+    double gamma;
+    uint64_t svOffset;
+    uint64_t normOffset;
+    uint64_t alphaOffset;
+  };
+
+  struct MlpPayload {
+    int32_t layerCount;
+    int32_t activation;
+    double fparam1;
+    double fparam2;
+    uint64_t inputScaleOffset;
+    uint64_t outputScaleOffset;
+    int32_t layerSizes[kMaxLayers];
+    uint64_t weightOffsets[kMaxLayers];
+  };
+
+  size_t alignUp(size_t value) {
+    return (value + kBundleAlignment - 1) / kBundleAlignment * kBundleAlignment;
+  }
+
+  // append bytes on the next aligned offset and return that offset
+  uint64_t appendAligned(std::vector<uint8_t>& payload, const void* data, size_t bytes) {
+    size_t offset = alignUp(payload.size());
+    payload.resize(offset + bytes);
+    if (bytes) memcpy(payload.data() + offset, data, bytes);
+    return offset;
+  }
+
+  // copy a Mat row by row, it may not be continuous
+  uint64_t appendMat(std::vector<uint8_t>& payload, const Mat& m) {
+    size_t rowBytes = m.cols * m.elemSize();
+    size_t offset = appendAligned(payload, nullptr, rowBytes * m.rows);
+    for (int i = 0; i < m.rows; i++)
+      memcpy(payload.data() + offset + rowBytes * i, m.ptr(i), rowBytes);
+    return offset;
+  }
+
+  // true if count items of itemSize bytes at offset lie inside a payload of
+  // size bytes, on an aligned offset. the file comes from outside, so the
+  // sizes are checked before any Mat header points into the mapping
+  bool arrayFits(uint64_t size, uint64_t offset, uint64_t count, size_t itemSize) {
+    if (offset % kBundleAlignment != 0 || offset > size) return false;
+    return count <= (size - offset) / itemSize;
+  }
+
+  template <class T>
+  void writeHead(std::vector<uint8_t>& payload, const T& head) {
+    memcpy(payload.data(), &head, sizeof(T));
+  }
+
+}
+
+uint64_t bundleChecksum(const uint8_t* data, size_t size) {
+  uint64_t hash = 14695981039346656037ULL;
+  for (size_t i = 0; i < size; i++) {
+    hash ^= data[i];
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+ModelBundle::ModelBundle() {
+  m_data = nullptr;
+  m_size = 0;
+#ifdef _WIN32
+  m_file = nullptr;
+  m_mapping = nullptr;
+#endif
+}
+
+ModelBundle::~ModelBundle() {
+#ifdef _WIN32
+  if (m_data) UnmapViewOfFile(m_data);
+  if (m_mapping) CloseHandle(m_mapping);
+  if (m_file && m_file != INVALID_HANDLE_VALUE) CloseHandle(m_file);
+#else
+  if (m_data) munmap(const_cast<uint8_t*>(m_data), m_size);
+#endif
+}
+
+std::shared_ptr<ModelBundle> ModelBundle::open(const std::string& path, bool verify) {
+  std::shared_ptr<ModelBundle> bundle(new ModelBundle);
+
+  // a shared read only mapping, every process using the bundle shares
+  // the same page cache copy
+#ifdef _WIN32
+  HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+                            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  bundle->m_file = file;
+  if (file == INVALID_HANDLE_VALUE) return nullptr;
+  LARGE_INTEGER fileSize;
+  if (!GetFileSizeEx(file, &fileSize)) return nullptr;
+  bundle->m_size = size_t(fileSize.QuadPart);
+  if (bundle->m_size < sizeof(BundleHeader)) return nullptr;
+  bundle->m_mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+  if (!bundle->m_mapping) return nullptr;
+  bundle->m_data = (const uint8_t*)MapViewOfFile(bundle->m_mapping, FILE_MAP_READ, 0, 0, 0);
+  if (!bundle->m_data) return nullptr;
+#else
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) return nullptr;
+  struct stat st;
+  if (fstat(fd, &st) != 0 || size_t(st.st_size) < sizeof(BundleHeader)) {
+    ::close(fd);
+    return nullptr;
+  }
+  void* data = mmap(NULL, size_t(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (data == MAP_FAILED) return nullptr;
+  bundle->m_data = (const uint8_t*)data;
+  bundle->m_size = size_t(st.st_size);
+#endif
+
+  const BundleHeader* header = (const BundleHeader*)bundle->m_data;
+  if (memcmp(header->magic, kBundleMagic, sizeof(kBundleMagic)) != 0) {
+    std::cerr << "[ModelBundle] " << path << " is not a model bundle" << std::endl;
+    return nullptr;
+  }
+  if (header->version != kBundleVersion) {
+    std::cerr << "[ModelBundle] " << path << " has version " << header->version
+              << ", expected " << kBundleVersion << std::endl;
+    return nullptr;
+  }
+  size_t tableEnd = sizeof(BundleHeader) + header->sectionCount * sizeof(BundleSection);
+  if (header->fileSize != bundle->m_size || tableEnd > bundle->m_size) {
+    std::cerr << "[ModelBundle] " << path << " is truncated" << std::endl;
+    return nullptr;
+  }
+  if (verify) {
+    uint64_t checksum = bundleChecksum(bundle->m_data + sizeof(BundleHeader),
+                                       bundle->m_size - sizeof(BundleHeader));
+    if (checksum != header->checksum) {
+      std::cerr << "[ModelBundle] " << path << " checksum mismatch" << std::endl;
+      return nullptr;
+    }
+  }
+
+  const BundleSection* sections = (const BundleSection*)(bundle->m_data + sizeof(BundleHeader));
+  for (uint32_t i = 0; i < header->sectionCount; i++) {
+    const BundleSection& s = sections[i];
+    if (s.offset % kBundleAlignment != 0 || s.offset > bundle->m_size ||
+        s.size > bundle->m_size - s.offset) {
+      std::cerr << "[ModelBundle] " << path << " has a bad section " << i << std::endl;
+      return nullptr;
+    }
+  }
+  return bundle;
+}
+
+const BundleSection* ModelBundle::find(const std::string& name, uint32_t kind) const {
+  const BundleHeader* header = (const BundleHeader*)m_data;
+  const BundleSection* sections = (const BundleSection*)(m_data + sizeof(BundleHeader));
+  for (uint32_t i = 0; i < header->sectionCount; i++) {
+    if (sections[i].kind == kind &&
+        strncmp(sections[i].name, name.c_str(), sizeof(sections[i].name)) == 0)
+      return &sections[i];
+  }
+  return nullptr;
+}
+
+bool ModelBundle::getSvm(const std::string& name, SvmRbfEvaluator& evaluator) const {
+  const BundleSection* section = find(name, kSectionSvmRbf);
+  if (!section || section->size < sizeof(SvmPayload)) return false;
+
+  const uint8_t* base = m_data + section->offset;
+  const SvmPayload* head = (const SvmPayload*)base;
+  if (head->svCount <= 0 || head->varCount <= 0) return false;
+  uint64_t svCount = uint64_t(head->svCount);
+  if (!arrayFits(section->size, head->svOffset, svCount * uint64_t(head->varCount), sizeof(float)) ||
+      !arrayFits(section->size, head->normOffset, svCount, sizeof(float)) ||
+      !arrayFits(section->size, head->alphaOffset, svCount, sizeof(double))) {
+    std::cerr << "[ModelBundle] " << name << " has a bad svm payload" << std::endl;
+    return false;
+  }
+  evaluator.wrap(head->svCount, head->varCount,
+                 (const float*)(base + head->svOffset),
+                 (const float*)(base + head->normOffset),
+                 (const double*)(base + head->alphaOffset), head->rho, head->gamma);
+  return true;
+}
+
+bool ModelBundle::getMlp(const std::string& name, MlpEvaluator& evaluator) const {
+  const BundleSection* section = find(name, kSectionMlp);
+  if (!section || section->size < sizeof(MlpPayload)) return false;
+
+  const uint8_t* base = m_data + section->offset;
+  const MlpPayload* head = (const MlpPayload*)base;
+  if (head->layerCount < 2 || head->layerCount > kMaxLayers) return false;
+
+  std::vector<int> layerSizes(head->layerSizes, head->layerSizes + head->layerCount);
+  bool fits = true;
+  for (int size : layerSizes) fits = fits && size > 0;
+  fits = fits && arrayFits(section->size, head->inputScaleOffset,
+                           uint64_t(layerSizes.front()) * 2, sizeof(double));
+  fits = fits && arrayFits(section->size, head->outputScaleOffset,
+                           uint64_t(layerSizes.back()) * 2, sizeof(double));
+  // layer i has (inputs + bias) x outputs weights
+  for (int i = 0; fits && i < head->layerCount - 1; i++)
+    fits = arrayFits(section->size, head->weightOffsets[i],
+                     (uint64_t(layerSizes[i]) + 1) * uint64_t(layerSizes[i + 1]), sizeof(double));
+  if (!fits) {
+    std::cerr << "[ModelBundle] " << name << " has a bad mlp payload" << std::endl;
+    return false;
+  }
+
+  std::vector<const double*> weights;
+  for (int i = 0; i < head->layerCount - 1; i++)
+    weights.push_back((const double*)(base + head->weightOffsets[i]));
+
+  evaluator.wrap(layerSizes, head->activation, head->fparam1, head->fparam2,
+                 (const double*)(base + head->inputScaleOffset),
+                 (const double*)(base + head->outputScaleOffset), weights);
+  return true;
+}
+
+bool ModelBundle::getText(const std::string& name, std::string& text) const {
+  const BundleSection* section = find(name, kSectionText);
+  if (!section) return false;
+  text.assign((const char*)(m_data + section->offset), size_t(section->size));
+  return true;
+}
+
+void ModelBundleWriter::addSection(const std::string& name, uint32_t kind,
+                                   const std::vector<uint8_t>& payload) {
+  BundleSection section;
+  memset(&section, 0, sizeof(section));
+  CV_Assert(name.size() < sizeof(section.name));
+  strncpy(section.name, name.c_str(), sizeof(section.name) - 1);
+  section.kind = kind;
+  section.size = payload.size();
+  m_sections.push_back(section);
+  m_payloads.push_back(payload);
+}
+
+void ModelBundleWriter::addSvm(const std::string& name, const SvmRbfEvaluator& evaluator) {
+  CV_Assert(!evaluator.empty());
+  SvmPayload head;
+  memset(&head, 0, sizeof(head));
+  head.svCount = evaluator.getSVCount();
+  head.varCount = evaluator.getVarCount();
+  head.rho = evaluator.getRho();
+  head.gamma = evaluator.getGamma();
+
+  std::vector<uint8_t> payload(sizeof(head));
+  head.svOffset = appendMat(payload, evaluator.getSupportVectors());
+  head.normOffset = appendMat(payload, evaluator.getSVNorms());
+  head.alphaOffset = appendMat(payload, evaluator.getAlpha());
+  writeHead(payload, head);
+  addSection(name, kSectionSvmRbf, payload);
+}
+
+void ModelBundleWriter::addMlp(const std::string& name, const MlpEvaluator& evaluator) {
+  CV_Assert(!evaluator.empty());
+  const std::vector<int>& layerSizes = evaluator.getLayerSizes();
+  CV_Assert(layerSizes.size() <= size_t(kMaxLayers));
+
+  MlpPayload head;
+  memset(&head, 0, sizeof(head));
+  head.layerCount = int32_t(layerSizes.size());
+  head.activation = evaluator.getActivation();
+  head.fparam1 = evaluator.getParam1();
+  head.fparam2 = evaluator.getParam2();
+  for (size_t i = 0; i < layerSizes.size(); i++) head.layerSizes[i] = layerSizes[i];
+
+  std::vector<uint8_t> payload(sizeof(head));
+  head.inputScaleOffset = appendMat(payload, evaluator.getInputScale());
+  head.outputScaleOffset = appendMat(payload, evaluator.getOutputScale());
+  for (size_t i = 0; i + 1 < layerSizes.size(); i++)
+    head.weightOffsets[i] = appendMat(payload, evaluator.getWeights(int(i)));
+  writeHead(payload, head);
+  addSection(name, kSectionMlp, payload);
+}
+
+void ModelBundleWriter::addText(const std::string& name, const std::string& text) {
+  addSection(name, kSectionText, std::vector<uint8_t>(text.begin(), text.end()));
+}
+
+bool ModelBundleWriter::write(const std::string& path) const {
+  std::vector<BundleSection> sections = m_sections;
+  size_t offset = alignUp(sizeof(BundleHeader) + sections.size() * sizeof(BundleSection));
+  for (size_t i = 0; i < sections.size(); i++) {
+    sections[i].offset = offset;
+    offset = alignUp(offset + sections[i].size);
+  }
+
+  std::vector<uint8_t> file(offset, 0);
+  memcpy(file.data() + sizeof(BundleHeader), sections.data(),
+         sections.size() * sizeof(BundleSection));
+  for (size_t i = 0; i < sections.size(); i++) {
+    if (!m_payloads[i].empty())
+      memcpy(file.data() + sections[i].offset, m_payloads[i].data(), m_payloads[i].size());
+  }
+
+  BundleHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, kBundleMagic, sizeof(kBundleMagic));
+  header.version = kBundleVersion;
+  header.sectionCount = uint32_t(sections.size());
+  header.fileSize = file.size();
+  header.checksum = bundleChecksum(file.data() + sizeof(BundleHeader),
+                                   file.size() - sizeof(BundleHeader));
+  memcpy(file.data(), &header, sizeof(header));
+
+  // write aside and rename over the old file. a process that still maps
+  // the old bundle keeps its pages, rewriting in place would change them
+  // under a published model set
+  std::string temp = path + ".tmp";
+  {
+    std::ofstream out(temp, std::ios::binary);
+    if (!out) return false;
+    out.write((const char*)file.data(), file.size());
+    if (!out) return false;
+  }
+#ifdef _WIN32
+  std::remove(path.c_str());
+#endif
+  return std::rename(temp.c_str(), path.c_str()) == 0;
+}
+
+}
@@ -0,0 +1,354 @@
+#include "easypr/core/model_registry.h"
+#include <cmath>
+#include <sstream>
+
+using namespace cv;
+
+namespace easypr {
+
+namespace {
+  // the set pinned by the calling thread, see ModelRegistry::Pin
+  thread_local std::shared_ptr<const ModelSet> g_pinned;
+
+  std::vector<int> layerSizes(const Ptr<ml::ANN_MLP>& ann, const MlpEvaluator& mlp) {
+    if (!mlp.empty()) return mlp.getLayerSizes();
+    std::vector<int> sizes;
+    if (!ann.empty() && ann->isTrained()) ann->getLayerSizes().copyTo(sizes);
+    return sizes;
+  }
+
+  // a zero sample must give finite outputs of the expected width
+  bool smokeTest(const ModelSet& models, void (ModelSet::*predict)(const Mat&, Mat&) const,
+                 int inputs, int outputs) {
+    Mat sample = Mat::zeros(1, inputs, CV_32FC1);
+    Mat result;
+    (models.*predict)(sample, result);
+    return result.cols == outputs && checkRange(result);
+  }
+}
+
+float ModelSet::svmScore(const Mat& features) const {
+  if (!svmEvaluator.empty()) {
+    float score;
+    Mat scores(1, 1, CV_32FC1, &score);
+    svmEvaluator.predictExact(features, scores);
+    return score;
+  }
+  return svm->predict(features, noArray(), ml::StatModel::Flags::RAW_OUTPUT);
+}
+
+void ModelSet::svmScores(const Mat& features, Mat& scores) const {
+  if (!svmEvaluator.empty()) {
+    svmEvaluator.predictExact(features, scores);
+    return;
+  }
+  scores.create(features.rows, 1, CV_32FC1);
+  for (int i = 0; i < features.rows; i++)
+    scores.at<float>(i) = svm->predict(features.row(i), noArray(), ml::StatModel::Flags::RAW_OUTPUT);
+}
+
+void ModelSet::predictAnn(const Mat& samples, Mat& outputs) const {
+  if (!annMlp.empty()) annMlp.predict(samples, outputs);
+  else ann->predict(samples, outputs);
+}
+
+void ModelSet::predictChineseAnn(const Mat& samples, Mat& outputs) const {
+  if (!annChineseMlp.empty()) annChineseMlp.predict(samples, outputs);
+  else annChinese->predict(samples, outputs);
+}
+
+void ModelSet::predictGrayAnn(const Mat& samples, Mat& outputs) const {
+  if (!annGrayMlp.empty()) annGrayMlp.predict(samples, outputs);
+  else annGray->predict(samples, outputs);
+}
+
+std::string ModelSet::province(const std::string& key) const {
+  return kv->get(key);
+}
+
+int ModelSet::svmVarCount() const {
+  if (!svmEvaluator.empty()) return svmEvaluator.getVarCount();
+  if (!svm.empty() && svm->isTrained()) return svm->getVarCount();
+  return 0;
+}
+
+ModelRegistry* ModelRegistry::instance() {
+  // the registry is shared by every recognition thread, so it is created
+  // thread safe
+  static ModelRegistry* registry = new ModelRegistry;
+  return registry;
+}
+
+ModelRegistry::ModelRegistry() {
+  m_lastVersion = 0;
+
+  // the bundle when there is one, the xml files otherwise
+  std::string error;
+  ModelPaths paths;
+  paths.bundle = kModelBundlePath;
+  std::shared_ptr<ModelSet> models = load(paths, error);
+  if (!models) {
+    paths.bundle.clear();
+    models = load(paths, error);
+  }
+  if (!models || !publish(models, error))
+    CV_Error(Error::StsError, "[ModelRegistry] " + error);
+}
+
+std::shared_ptr<const ModelSet> ModelRegistry::acquire() const {
+  if (g_pinned) return g_pinned;
+  return std::atomic_load(&m_current);
+}
+
+std::shared_ptr<ModelSet> ModelRegistry::load(const ModelPaths& paths, std::string& error) {
+  std::shared_ptr<ModelSet> models = std::make_shared<ModelSet>();
+  models->paths = paths;
+  models->kv = std::make_shared<Kv>();
+
+  if (!paths.bundle.empty()) {
+    models->bundle = ModelBundle::open(paths.bundle);
+    std::string mapping, feature;
+    if (!models->bundle ||
+        !models->bundle->getSvm("svm_hist", models->svmEvaluator) ||
+        !models->bundle->getMlp("ann", models->annMlp) ||
+        !models->bundle->getMlp("ann_chinese", models->annChineseMlp) ||
+        !models->bundle->getMlp("annCh", models->annGrayMlp) ||
+        !models->bundle->getText("province_mapping", mapping)) {
+      error = "cannot use the model bundle " + paths.bundle;
+      return nullptr;
+    }
+    // bundles written before the section have the histogram svm
+    if (models->bundle->getText("svm_feature", feature))
+      models->paths.svmFeature = feature;
+    else
+      models->paths.svmFeature = kHistSvmFeature;
+    models->svmFeature = featureByName(models->paths.svmFeature);
+    models->svm = ml::SVM::create();
+    models->ann = ml::ANN_MLP::create();
+    models->annChinese = ml::ANN_MLP::create();
+    models->annGray = ml::ANN_MLP::create();
+    std::istringstream reader(mapping);
+    models->kv->load(reader);
+    return models;
+  }
+
+  try {
+    LOAD_SVM_MODEL(models->svm, paths.svm);
+    LOAD_ANN_MODEL(models->ann, paths.ann);
+    LOAD_ANN_MODEL(models->annChinese, paths.annChinese);
+    LOAD_ANN_MODEL(models->annGray, paths.annGray);
+  }
+  catch (const cv::Exception& e) {
+    error = e.what();
+    return nullptr;
+  }
+  if (models->svm.empty() || models->ann.empty() || models->annChinese.empty() ||
+      models->annGray.empty()) {
+    error = "cannot load the xml models";
+    return nullptr;
+  }
+  models->svmEvaluator.load(models->svm);
+  models->svmFeature = featureByName(paths.svmFeature);
+  models->kv->load(paths.mapping);
+  return models;
+}
+
+bool ModelRegistry::validate(const ModelSet& models, std::string& error) const {
+  std::shared_ptr<const ModelSet> current = std::atomic_load(&m_current);
+
+  int svmVars = models.svmVarCount();
+  if (svmVars <= 0) {
+    error = "the svm is not trained";
+    return false;
+  }
+  if (!models.svmFeature) {
+    error = "unknown svm feature " + models.paths.svmFeature;
+    return false;
+  }
+  // the judge carves the feature row from the svm size, so the extractor
+  // must give exactly that many
+  Mat plate(kPlateResizeHeight, kPlateResizeWidth, CV_8UC3, Scalar::all(0));
+  Mat plateFeatures;
+  models.svmFeature(plate, plateFeatures);
+  if (int(plateFeatures.total()) != svmVars) {
+    error = "the svm expects " + std::to_string(svmVars) + " features, " +
+            models.paths.svmFeature + " extracts " + std::to_string(plateFeatures.total());
+    return false;
+  }
+  Mat sample = Mat::zeros(1, svmVars, CV_32FC1);
+  if (!std::isfinite(models.svmScore(sample))) {
+    error = "the svm gives a non finite score";
+    return false;
+  }
+
+  struct {
+    const char* name;
+    std::vector<int> sizes;
+    std::vector<int> currentSizes;
+    int outputs;
+    void (ModelSet::*predict)(const Mat&, Mat&) const;
+  } anns[] = {
+    { "ann", layerSizes(models.ann, models.annMlp),
+      current ? layerSizes(current->ann, current->annMlp) : std::vector<int>(),
+      kCharsTotalNumber, &ModelSet::predictAnn },
+    { "ann_chinese", layerSizes(models.annChinese, models.annChineseMlp),
+      current ? layerSizes(current->annChinese, current->annChineseMlp) : std::vector<int>(),
+      kChineseNumber, &ModelSet::predictChineseAnn },
+    { "annCh", layerSizes(models.annGray, models.annGrayMlp),
+      current ? layerSizes(current->annGray, current->annGrayMlp) : std::vector<int>(),
+      kChineseNumber, &ModelSet::predictGrayAnn },
+  };
+  for (auto& ann : anns) {
+    if (ann.sizes.size() < 2 || ann.sizes.back() != ann.outputs) {
+      error = std::string(ann.name) + " does not have " + std::to_string(ann.outputs) + " outputs";
+      return false;
+    }
+    if (!ann.currentSizes.empty() && ann.sizes.front() != ann.currentSizes.front()) {
+      error = std::string(ann.name) + " expects " + std::to_string(ann.sizes.front()) +
+              " features, the engine extracts " + std::to_string(ann.currentSizes.front());
+      return false;
+    }
+    if (!smokeTest(models, ann.predict, ann.sizes.front(), ann.outputs)) {
+      error = std::string(ann.name) + " gives non finite outputs";
+      return false;
+    }
+  }
+
+  if (!models.kv) {
+    error = "no province mapping";
+    return false;
+  }
+  return true;
+}
+
+bool ModelRegistry::publish(std::shared_ptr<ModelSet> models, std::string& error) {
+  if (!validate(*models, error)) return false;
+
+  models->version = ++m_lastVersion;
+  std::shared_ptr<const ModelSet> published = models;
+  std::atomic_store(&m_current, published);
+  return true;
+}
+
+bool ModelRegistry::reload(const ModelPaths& paths, std::string* error) {
+  std::string message;
+
+  // the slow part, parsing the files, runs without the lock. only the
+  // checks against the current set and the store are serialized
+  std::shared_ptr<ModelSet> models = load(paths, message);
+  bool ok = false;
+  if (models) {
+    std::lock_guard<std::mutex> lock(m_writeMutex);
+    ok = publish(models, message);
+  }
+
+  if (!ok) std::cerr << "[ModelRegistry] keep version " << version() << ": " << message << std::endl;
+  if (error) *error = message;
+  return ok;
+}
+
+std::future<bool> ModelRegistry::reloadAsync(const ModelPaths& paths) {
+  return std::async(std::launch::async, [this, paths]() { return reload(paths); });
+}
+
+bool ModelRegistry::reloadSvm(const std::string& path, const std::string& feature) {
+  std::lock_guard<std::mutex> lock(m_writeMutex);
+  auto models = std::make_shared<ModelSet>(*std::atomic_load(&m_current));
+  std::string error;
+  try {
+    LOAD_SVM_MODEL(models->svm, path);
+  }
+  catch (const cv::Exception& e) {
+    error = e.what();
+  }
+  if (error.empty() && !models->svm.empty()) {
+    models->svmEvaluator.load(models->svm);
+    models->paths.svm = path;
+    if (!feature.empty()) {
+      models->paths.svmFeature = feature;
+      models->svmFeature = featureByName(feature);
+    }
+    if (publish(models, error)) return true;
+  }
+  std::cerr << "[ModelRegistry] cannot use " << path << ": " << error << std::endl;
+  return false;
+}
+
+namespace {
+  bool loadAnn(const std::string& path, Ptr<ml::ANN_MLP>& ann, MlpEvaluator& mlp,
+               std::string& error) {
+    try {
+      LOAD_ANN_MODEL(ann, path);
+    }
+    catch (const cv::Exception& e) {
+      error = e.what();
+      return false;
+    }
+    mlp = MlpEvaluator();
+    return !ann.empty();
+  }
+}
+
+bool ModelRegistry::reloadAnn(const std::string& path) {
+  std::lock_guard<std::mutex> lock(m_writeMutex);
+  auto models = std::make_shared<ModelSet>(*std::atomic_load(&m_current));
+  std::string error;
+  if (loadAnn(path, models->ann, models->annMlp, error)) {
+    models->paths.ann = path;
+    if (publish(models, error)) return true;
+  }
+  std::cerr << "[ModelRegistry] cannot use " << path << ": " << error << std::endl;
+  return false;
+}
+
+bool ModelRegistry::reloadChineseAnn(const std::string& path) {
+  std::lock_guard<std::mutex> lock(m_writeMutex);
+  auto models = std::make_shared<ModelSet>(*std::atomic_load(&m_current));
+  std::string error;
+  if (loadAnn(path, models->annChinese, models->annChineseMlp, error)) {
+    models->paths.annChinese = path;
+    if (publish(models, error)) return true;
+  }
+  std::cerr << "[ModelRegistry] cannot use " << path << ": " << error << std::endl;
+  return false;
+}
+
+bool ModelRegistry::reloadGrayAnn(const std::string& path) {
+  std::lock_guard<std::mutex> lock(m_writeMutex);
+  auto models = std::make_shared<ModelSet>(*std::atomic_load(&m_current));
+  std::string error;
+  if (loadAnn(path, models->annGray, models->annGrayMlp, error)) {
+    models->paths.annGray = path;
+    if (publish(models, error)) return true;
+  }
+  std::cerr << "[ModelRegistry] cannot use " << path << ": " << error << std::endl;
+  return false;
+}
+
+bool ModelRegistry::reloadChineseMapping(const std::string& path) {
+  std::lock_guard<std::mutex> lock(m_writeMutex);
+  auto models = std::make_shared<ModelSet>(*std::atomic_load(&m_current));
+  models->kv = std::make_shared<Kv>();
+  models->kv->load(path);
+  models->paths.mapping = path;
+  std::string error;
+  if (publish(models, error)) return true;
+  std::cerr << "[ModelRegistry] cannot use " << path << ": " << error << std::endl;
+  return false;
+}
+
+ModelRegistry::Pin::Pin() {
+  m_previous = g_pinned;
+  if (!g_pinned) g_pinned = ModelRegistry::instance()->acquire();
+}
+
+ModelRegistry::Pin::Pin(std::shared_ptr<const ModelSet> models) {
+  m_previous = g_pinned;
+  g_pinned = models;
+}
+
+ModelRegistry::Pin::~Pin() {
+  g_pinned = m_previous;
+}
+
+}
@@ -2,6 +2,7 @@
 #include "easypr/util/util.h"
 #include "easypr/core/core_func.h"
 #include "easypr/config.h"
+#include "easypr/core/model_registry.h"
 
 namespace easypr {
 
@@ -10,53 +11,79 @@ namespace easypr {
     m_maxPlates = 3;
     m_type = 0;
     m_showDetect = false;
+    m_pyramidMode = false;
+    m_pyramidPlateWidth = 2 * kPlateResizeWidth;
   }
 
   CPlateDetect::~CPlateDetect() { SAFE_RELEASE(m_plateLocate); }
 
-  int CPlateDetect::plateDetect(Mat src, std::vector<CPlate> &resultVec, int type,
-    bool showDetectArea, int img_index) {
+  void CPlateDetect::locateCandidates(const Mat& src, std::vector<CPlate> &candPlates, int type, int img_index) {
     std::vector<CPlate> sobel_Plates;
     sobel_Plates.reserve(16);
     std::vector<CPlate> color_Plates;
     color_Plates.reserve(16);
     std::vector<CPlate> mser_Plates;
     mser_Plates.reserve(16);
-    std::vector<CPlate> all_result_Plates;
-    all_result_Plates.reserve(64);
+    std::vector<CPlate> er_Plates;
+    er_Plates.reserve(16);
+
+    // the worker threads use the model set of the calling thread
+    auto models = ModelRegistry::instance()->acquire();
 #pragma omp parallel sections
     {
 #pragma omp section
       {
+        ModelRegistry::Pin pin(models);
         if (!type || type & PR_DETECT_SOBEL) {
           m_plateLocate->plateSobelLocate(src, sobel_Plates, img_index);
         }
       }
 #pragma omp section
       {
+        ModelRegistry::Pin pin(models);
         if (!type || type & PR_DETECT_COLOR) {
           m_plateLocate->plateColorLocate(src, color_Plates, img_index);
         }
       }
 #pragma omp section
       {
+        ModelRegistry::Pin pin(models);
         if (!type || type & PR_DETECT_CMSER) {
           m_plateLocate->plateMserLocate(src, mser_Plates, img_index);
         }
       }
+#pragma omp section
+      {
+        // optional, only when the type asks for it
+        if (type & PR_DETECT_ER) {
+          m_plateLocate->plateErLocate(src, er_Plates, img_index);
+        }
+      }
     }
     for (auto plate : sobel_Plates) {
       plate.setPlateLocateType(SOBEL);
-      all_result_Plates.push_back(plate);
+      candPlates.push_back(plate);
     }
     for (auto plate : color_Plates) {
       plate.setPlateLocateType(COLOR);
-      all_result_Plates.push_back(plate);
+      candPlates.push_back(plate);
     }
     for (auto plate : mser_Plates) {
       plate.setPlateLocateType(CMSER);
-      all_result_Plates.push_back(plate);
+      candPlates.push_back(plate);
     }
+    for (auto plate : er_Plates) {
+      plate.setPlateLocateType(ERFILTER);
+      candPlates.push_back(plate);
+    }
+  }
+
+  int CPlateDetect::plateDetect(Mat src, std::vector<CPlate> &resultVec, int type,
+    bool showDetectArea, int img_index) {
+    std::vector<CPlate> all_result_Plates;
+    all_result_Plates.reserve(64);
+    locateCandidates(src, all_result_Plates, type, img_index);
+
     // use nms to judge plate
     PlateJudge::instance()->plateJudgeUsingNMS(all_result_Plates, resultVec, m_maxPlates);
 
@@ -65,6 +92,104 @@ namespace easypr {
     return 0;
   }
 
+  int CPlateDetect::buildPyramid(const Mat& src) {
+    if (m_pyramid.size() < 1) m_pyramid.resize(1);
+    m_pyramid[0] = src;
+
+    // the levels keep their memory, a fixed resolution stream reuses it
+    size_t levels = 1;
+    while (m_pyramid[levels - 1].cols > kShowWindowWidth ||
+           m_pyramid[levels - 1].rows > kShowWindowHeight) {
+      if (m_pyramid.size() <= levels) m_pyramid.resize(levels + 1);
+      const Mat& finer = m_pyramid[levels - 1];
+      resize(finer, m_pyramid[levels], Size(finer.cols / 2, finer.rows / 2), 0, 0, INTER_AREA);
+      levels++;
+    }
+    return (int)levels;
+  }
+
+  int CPlateDetect::plateDetectPyramid(const Mat& src, std::vector<CPlate> &resultVec, int type,
+    int img_index) {
+    // the coarse pass needs at least one locator, else search src directly
+    int coarseMask = PR_DETECT_SOBEL | PR_DETECT_COLOR | PR_DETECT_CMSER | PR_DETECT_ER;
+    int coarseType = (!type ? PR_DETECT_SOBEL | PR_DETECT_COLOR | PR_DETECT_CMSER : type) & coarseMask;
+    if (!coarseType)
+      return plateDetect(src, resultVec, type, false, img_index);
+
+    int levels = buildPyramid(src);
+    int coarse = levels - 1;
+
+    std::vector<float> factors(levels);
+    for (int l = 0; l < levels; l++)
+      factors[l] = float(src.cols) / float(m_pyramid[l].cols);
+
+    // 1. the locators on the coarse level, where they are cheap. mser runs
+    // here too when it is asked for, so a CMSER only type has seeds
+    std::vector<CPlate> coarse_Plates;
+    coarse_Plates.reserve(64);
+    locateCandidates(m_pyramid[coarse], coarse_Plates, coarseType, img_index);
+
+    // 2. choose the refine level of every candidate, the finest one where
+    // the plate is not wider than m_pyramidPlateWidth, and merge the regions
+    std::vector<std::vector<Rect>> regions(levels);
+    std::vector<CPlate> all_result_Plates;
+    all_result_Plates.reserve(64);
+
+    for (auto plate : coarse_Plates) {
+      Rect bound = plate.getPlatePos().boundingRect();
+      float srcWidth = bound.width * factors[coarse];
+
+      int level = coarse;
+      while (level > 0 && srcWidth / factors[level - 1] <= m_pyramidPlateWidth)
+        level--;
+
+      if (level == coarse) {
+        // already at its best level, whichever locator found it. a region
+        // here would only run the same locators on the same pixels again
+        plate.setPlatePos(scaleBackRRect(plate.getPlatePos(), factors[coarse]));
+        all_result_Plates.push_back(plate);
+        continue;
+      }
+
+      // enlarge by one plate height up and down, half a width left and right
+      float ratio = factors[coarse] / factors[level];
+      const Mat& levelMat = m_pyramid[level];
+      Rect region(int((bound.x - bound.width * 0.5f) * ratio), int((bound.y - bound.height) * ratio),
+                  int(bound.width * 2.f * ratio), int(bound.height * 3.f * ratio));
+      region &= Rect(0, 0, levelMat.cols, levelMat.rows);
+      if (region.area() <= 0) continue;
+
+      bool merged = false;
+      for (auto& other : regions[level]) {
+        if ((other & region).area() > 0) {
+          other |= region;
+          merged = true;
+          break;
+        }
+      }
+      if (!merged) regions[level].push_back(region);
+    }
+
+    // 3. refine only inside the regions, on the finer levels
+    for (int l = 0; l < levels; l++) {
+      for (auto region : regions[l]) {
+        std::vector<CPlate> region_Plates;
+        region_Plates.reserve(16);
+        locateCandidates(m_pyramid[l](region), region_Plates, type, img_index);
+
+        for (auto plate : region_Plates) {
+          RotatedRect rrect = plate.getPlatePos();
+          rrect.center += Point2f(region.tl());
+          plate.setPlatePos(scaleBackRRect(rrect, factors[l]));
+          all_result_Plates.push_back(plate);
+        }
+      }
+    }
+
+    PlateJudge::instance()->plateJudgeUsingNMS(all_result_Plates, resultVec, m_maxPlates);
+    return 0;
+  }
+
   int CPlateDetect::plateDetect(Mat src, std::vector<CPlate> &resultVec, int img_index) {
     int result = plateDetect(src, resultVec, m_type, false, img_index);
     return result;
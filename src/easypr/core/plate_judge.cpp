@@ -2,6 +2,8 @@
 #include "easypr/config.h"
 #include "easypr/core/core_func.h"
 #include "easypr/core/params.h"
+#include "easypr/core/scratch_arena.h"
+#include "easypr/core/model_registry.h"
 
 namespace easypr {
 
@@ -15,31 +17,36 @@ namespace easypr {
   }
 
   PlateJudge::PlateJudge() { 
-    bool useLBP = false;
-    if (useLBP) {
-      LOAD_SVM_MODEL(svm_, kLBPSvmPath);
-      extractFeature = getLBPFeatures;
-    }
-    else {
-      LOAD_SVM_MODEL(svm_, kHistSvmPath);
-      extractFeature = getHistomPlusColoFeatures;
-    }
+    // the svm lives in the model registry, make sure it is loaded
+    ModelRegistry::instance();
   }
 
   void PlateJudge::LoadModel(std::string path) {
-    if (path != std::string(kDefaultSvmPath)) {
-      if (!svm_->empty())
-        svm_->clear();
-      LOAD_SVM_MODEL(svm_, path);
-    }
+    if (path == std::string(kDefaultSvmPath)) return;
+    // the lbp svm needs the lbp features, any other svm the histogram ones
+    if (path == std::string(kLBPSvmPath))
+      ModelRegistry::instance()->reloadSvm(path, kLBPSvmFeature);
+    else
+      ModelRegistry::instance()->reloadSvm(path, kHistSvmFeature);
   }
 
   // set the score of plate
   // 0 is plate, -1 is not.
   int PlateJudge::plateSetScore(CPlate& plate) {
-    Mat features;
-    extractFeature(plate.getPlateMat(), features);
-    float score = svm_->predict(features, noArray(), cv::ml::StatModel::Flags::RAW_OUTPUT);
+    // the feature row and the feature scratch all come from the
+    // thread arena, so feature extraction does not touch the heap.
+    // the svm scoring may still allocate on its own
+    // the extractor and the svm come from the same model set, so a reload
+    // in between cannot pair features with the wrong svm
+    auto models = ModelRegistry::instance()->acquire();
+    ScratchArena& arena = ScratchArena::local();
+    size_t mark = arena.mark();
+
+    Mat features = arena.alloc(1, models->svmVarCount(), CV_32FC1);
+    models->svmFeature(plate.getPlateMat(), features);
+
+    float score = models->svmScore(features);
+    arena.rewind(mark);
     //std::cout << "score:" << score << std::endl;
     if (0) {
       imshow("plate", plate.getPlateMat());
@@ -53,6 +60,32 @@ namespace easypr {
     else return -1;      
   }
 
+  void PlateJudge::plateSetScores(std::vector<CPlate>& plates) {
+    if (plates.empty()) return;
+
+    auto models = ModelRegistry::instance()->acquire();
+    ScratchArena& arena = ScratchArena::local();
+    size_t mark = arena.mark();
+
+    // one row per candidate, then a single evaluation of the batch. an
+    // extractor that gives its own buffer is copied into the row
+    Mat features = arena.alloc(int(plates.size()), models->svmVarCount(), CV_32FC1);
+    for (size_t i = 0; i < plates.size(); i++) {
+      Mat row = features.row(int(i));
+      models->svmFeature(plates[i].getPlateMat(), row);
+      if (row.data != features.ptr(int(i))) {
+        CV_Assert(int(row.total()) == features.cols);
+        row.reshape(1, 1).convertTo(features.row(int(i)), CV_32FC1);
+      }
+    }
+    Mat scores = arena.alloc(int(plates.size()), 1, CV_32FC1);
+    models->svmScores(features, scores);
+
+    for (size_t i = 0; i < plates.size(); i++)
+      plates[i].setPlateScore(scores.at<float>(int(i)));
+    arena.rewind(mark);
+  }
+
   int PlateJudge::plateJudge(const Mat& plateMat) {
     CPlate plate;
     plate.setPlateMat(plateMat);
@@ -125,46 +158,40 @@ namespace easypr {
   // judge plate using nms
   int PlateJudge::plateJudgeUsingNMS(const std::vector<CPlate> &inVec, std::vector<CPlate> &resultVec, int maxPlates) {
     std::vector<CPlate> plateVec;
-    int num = inVec.size();
     bool useCascadeJudge = true;
 
-    for (int j = 0; j < num; j++) {
-      CPlate plate = inVec[j];
-      Mat inMat = plate.getPlateMat();
-      int result = plateSetScore(plate);
-      if (0 == result) {
-        if (0) {
-          imshow("inMat", inMat);
-          waitKey(0);
-          destroyWindow("inMat");
-        }
+    // both judge passes use the same svm version
+    ModelRegistry::Pin pin;
 
-        if (plate.getPlateLocateType() == CMSER) {
-          int w = inMat.cols;
-          int h = inMat.rows;
-          Mat tmpmat = inMat(Rect_<double>(w * 0.05, h * 0.1, w * 0.9, h * 0.8));
-          Mat tmpDes = inMat.clone();
-          resize(tmpmat, tmpDes, Size(inMat.size()));
-          plate.setPlateMat(tmpDes);
-          if (useCascadeJudge) {
-            int resultCascade = plateSetScore(plate);
-            if (plate.getPlateLocateType() != CMSER)
-              plate.setPlateMat(inMat);
-            if (resultCascade == 0) {
-              if (0) {
-                imshow("tmpDes", tmpDes);
-                waitKey(0);
-                destroyWindow("tmpDes");
-              }
-              plateVec.push_back(plate);
-            }
-          }
-          else 
-            plateVec.push_back(plate);
-        }
-        else 
-          plateVec.push_back(plate);                  
+    std::vector<CPlate> candidates(inVec);
+    plateSetScores(candidates);
+
+    // mser plates pass a second judge on the center crop
+    std::vector<CPlate> cascadeVec;
+    for (auto& plate : candidates) {
+      if (plate.getPlateScore() >= 0.5) continue;
+
+      if (plate.getPlateLocateType() == CMSER) {
+        Mat inMat = plate.getPlateMat();
+        int w = inMat.cols;
+        int h = inMat.rows;
+        Mat tmpmat = inMat(Rect_<double>(w * 0.05, h * 0.1, w * 0.9, h * 0.8));
+        Mat tmpDes = inMat.clone();
+        resize(tmpmat, tmpDes, Size(inMat.size()));
+        plate.setPlateMat(tmpDes);
+        if (useCascadeJudge)
+          cascadeVec.push_back(plate);
+        else
+          plateVec.push_back(plate);
       }
+      else
+        plateVec.push_back(plate);
+    }
+
+    plateSetScores(cascadeVec);
+    for (auto& plate : cascadeVec) {
+      if (plate.getPlateScore() < 0.5)
+        plateVec.push_back(plate);
     }
 
     std::vector<CPlate> reDupPlateVec;
@@ -2,6 +2,8 @@
 #include "easypr/core/core_func.h"
 #include "easypr/util/util.h"
 #include "easypr/core/params.h"
+#include "easypr/core/frame_workspace.h"
+#include "thirdparty/textDetect/erfilter.hpp"
 
 using namespace std;
 
@@ -23,6 +25,8 @@ CPlateLocate::CPlateLocate() {
   m_angle = DEFAULT_ANGLE;
 
   m_debug = DEFAULT_DEBUG;
+
+  m_erBudget = DEFAULT_ER_BUDGET;
 }
 
 void CPlateLocate::setLifemode(bool param) {
@@ -79,7 +83,7 @@ bool CPlateLocate::verifySizes(RotatedRect mr) {
 //! mser search method
 int CPlateLocate::mserSearch(const Mat &src,  vector<Mat> &out,
   vector<vector<CPlate>>& out_plateVec, bool usePlateMser, vector<vector<RotatedRect>>& out_plateRRect,
-  int img_index, bool showDebug) {
+  int img_index, bool showDebug, const vector<Rect>& rois) {
   vector<Mat> match_grey;
 
   vector<CPlate> plateVec_blue;
@@ -93,7 +97,7 @@ int CPlateLocate::mserSearch(const Mat &src,  vector<Mat> &out,
   vector<RotatedRect> plateRRect_yellow;
   plateRRect_yellow.reserve(16);
 
-  mserCharMatch(src, match_grey, plateVec_blue, plateVec_yellow, usePlateMser, plateRRect_blue, plateRRect_yellow, img_index, showDebug);
+  mserCharMatch(src, match_grey, plateVec_blue, plateVec_yellow, usePlateMser, plateRRect_blue, plateRRect_yellow, img_index, showDebug, rois);
 
   out_plateVec.push_back(plateVec_blue);
   out_plateVec.push_back(plateVec_yellow);
@@ -111,6 +115,10 @@ int CPlateLocate::colorSearch(const Mat &src, const Color r, Mat &out,
                               vector<RotatedRect> &outRects) {
   Mat match_grey;
 
+  // blue and yellow may run on the same thread, keep their buffers apart
+  FrameWorkspace& ws = FrameWorkspace::local();
+  Mat& src_threshold = ws.get(kStageColor, YELLOW == r ? 4 : 3);
+
   // width is important to the final results;
   const int color_morph_width = 10;
   const int color_morph_height = 2;
@@ -118,7 +126,6 @@ int CPlateLocate::colorSearch(const Mat &src, const Color r, Mat &out,
   colorMatch(src, match_grey, r, false);
   SHOW_IMAGE(match_grey, 0);
 
-  Mat src_threshold;
   threshold(match_grey, src_threshold, 0, 255,
             CV_THRESH_OTSU + CV_THRESH_BINARY);
 
@@ -158,10 +165,11 @@ int CPlateLocate::colorSearch(const Mat &src, const Color r, Mat &out,
 
 int CPlateLocate::sobelFrtSearch(const Mat &src,
                                  vector<Rect_<float>> &outRects) {
-  Mat src_threshold;
+  FrameWorkspace& ws = FrameWorkspace::local();
+  Mat& src_threshold = ws.get(kStageSobel, 4);
 
   sobelOper(src, src_threshold, m_GaussianBlurSize, m_MorphSizeWidth,
-            m_MorphSizeHeight);
+            m_MorphSizeHeight, &ws);
 
   vector<vector<Point>> contours;
   findContours(src_threshold,
@@ -306,40 +314,34 @@ int CPlateLocate::sobelSecSearch(Mat &bound, Point2f refpoint,
 
 
 int CPlateLocate::sobelOper(const Mat &in, Mat &out, int blurSize, int morphW,
-                            int morphH) {
-  Mat mat_blur;
-  mat_blur = in.clone();
+                            int morphH, FrameWorkspace* ws) {
+  // the temporaries live in the workspace when the input is a whole frame
+  Mat scratch[4];
+  Mat& mat_blur = ws ? ws->get(kStageSobel, 0) : scratch[0];
+  Mat& gray_buf = ws ? ws->get(kStageSobel, 1) : scratch[1];
+  Mat& abs_grad_x = ws ? ws->get(kStageSobel, 2) : scratch[2];
+  Mat& grad_x = ws ? ws->get(kStageSobel, 3) : scratch[3];
+
   GaussianBlur(in, mat_blur, Size(blurSize, blurSize), 0, 0, BORDER_DEFAULT);
 
-  Mat mat_gray;
-  if (mat_blur.channels() == 3)
-    cvtColor(mat_blur, mat_gray, CV_RGB2GRAY);
-  else
-    mat_gray = mat_blur;
+  const Mat* mat_gray = &mat_blur;
+  if (mat_blur.channels() == 3) {
+    cvtColor(mat_blur, gray_buf, CV_RGB2GRAY);
+    mat_gray = &gray_buf;
+  }
 
   int scale = SOBEL_SCALE;
   int delta = SOBEL_DELTA;
   int ddepth = SOBEL_DDEPTH;
 
-  Mat grad_x, grad_y;
-  Mat abs_grad_x, abs_grad_y;
-
-
-  Sobel(mat_gray, grad_x, ddepth, 1, 0, 3, scale, delta, BORDER_DEFAULT);
+  Sobel(*mat_gray, grad_x, ddepth, 1, 0, 3, scale, delta, BORDER_DEFAULT);
   convertScaleAbs(grad_x, abs_grad_x);
 
-  Mat grad;
-  addWeighted(abs_grad_x, SOBEL_X_WEIGHT, 0, 0, 0, grad);
-
-  Mat mat_threshold;
-  double otsu_thresh_val =
-      threshold(grad, mat_threshold, 0, 255, CV_THRESH_OTSU + CV_THRESH_BINARY);
-
+  // grad = SOBEL_X_WEIGHT * abs_grad_x, which is abs_grad_x itself
+  threshold(abs_grad_x, out, 0, 255, CV_THRESH_OTSU + CV_THRESH_BINARY);
 
   Mat element = getStructuringElement(MORPH_RECT, Size(morphW, morphH));
-  morphologyEx(mat_threshold, mat_threshold, MORPH_CLOSE, element);
-
-  out = mat_threshold;
+  morphologyEx(out, out, MORPH_CLOSE, element);
 
   return 0;
 }
@@ -420,8 +422,12 @@ void deleteNotArea(Mat &inmat, Color color = UNKNOWN) {
 int CPlateLocate::deskew(const Mat &src, const Mat &src_b,
                          vector<RotatedRect> &inRects,
                          vector<CPlate> &outPlates, bool useDeteleArea, Color color) {
-  Mat mat_debug;
-  src.copyTo(mat_debug);
+  FrameWorkspace& ws = FrameWorkspace::local();
+  ws.prepare(kStageDeskew, src.size());
+
+  // only drawn on in debug mode
+  Mat& mat_debug = ws.get(kStageDeskew, 0);
+  if (m_debug) src.copyTo(mat_debug);
 
   for (size_t i = 0; i < inRects.size(); i++) {
     RotatedRect roi_rect = inRects[i];
@@ -705,10 +711,14 @@ int CPlateLocate::plateColorLocate(Mat src, vector<CPlate> &candPlates,
   vector<CPlate> plates_yellow;
   plates_yellow.reserve(64);
 
-  Mat src_clone = src.clone();
+  FrameWorkspace& ws = FrameWorkspace::local();
+  ws.prepare(kStageColor, src.size());
+
+  Mat& src_clone = ws.get(kStageColor, 0);
+  src.copyTo(src_clone);
 
-  Mat src_b_blue;
-  Mat src_b_yellow;
+  Mat& src_b_blue = ws.get(kStageColor, 1);
+  Mat& src_b_yellow = ws.get(kStageColor, 2);
 #pragma omp parallel sections
   {
 #pragma omp section
@@ -742,9 +752,12 @@ int CPlateLocate::plateMserLocate(Mat src, vector<CPlate> &candPlates, int img_i
   //int scale_size = CParams::instance()->getParam1i();
   double scale_ratio = 1;
 
+  FrameWorkspace& ws = FrameWorkspace::local();
+  ws.prepare(kStageMser, src.size());
+
   // only conside blue plate
   if (1) {
-    Mat grayImage;
+    Mat& grayImage = ws.get(kStageMser, 0);
     cvtColor(src, grayImage, COLOR_BGR2GRAY);
     channelImages.push_back(grayImage);
   }
@@ -757,8 +770,20 @@ int CPlateLocate::plateMserLocate(Mat src, vector<CPlate> &candPlates, int img_i
     Mat channelImage = channelImages.at(i);   
     Mat image = scaleImage(channelImage, Size(scale_size, scale_size), scale_ratio);
 
+    // the rois are given in source coordinates
+    vector<Rect> rois;
+    Rect imageRect(0, 0, image.cols, image.rows);
+    for (auto roi : m_mserRois) {
+      Rect scaled(cvFloor(roi.x / scale_ratio), cvFloor(roi.y / scale_ratio),
+                  cvCeil(roi.width / scale_ratio), cvCeil(roi.height / scale_ratio));
+      scaled &= imageRect;
+      if (scaled.area() > 0) rois.push_back(scaled);
+    }
+    // every roi fell outside the image, search all of it
+    if (!m_mserRois.empty() && rois.empty()) rois.push_back(imageRect);
+
     // vector<RotatedRect> rects;
-    mserSearch(image, src_b_vec, platesVec, usePlateMser, plateRRectsVec, img_index, false);
+    mserSearch(image, src_b_vec, platesVec, usePlateMser, plateRRectsVec, img_index, false, rois);
 
     for (size_t j = 0; j < flags.size(); j++) {
       vector<CPlate>& plates = platesVec.at(j);
@@ -783,7 +808,7 @@ int CPlateLocate::plateMserLocate(Mat src, vector<CPlate> &candPlates, int img_i
         mserPlate.push_back(plate);
       }
 
-      Mat resize_src_b;
+      Mat& resize_src_b = ws.get(kStageMser, 1 + int(j));
       resize(src_b, resize_src_b, Size(channelImage.cols, channelImage.rows));
 
       deskew(src, resize_src_b, rects_mser, deskewPlate, false, color);
@@ -815,6 +840,123 @@ int CPlateLocate::plateMserLocate(Mat src, vector<CPlate> &candPlates, int img_i
   return 0;
 }
 
+namespace {
+  // the er filters keep state during a run, so every thread has its own.
+  // empty when the classifiers are missing
+  struct ErFilters {
+    bool loaded = false;
+    Ptr<text::ERFilter> nm1;
+    Ptr<text::ERFilter> nm2;
+  };
+
+  ErFilters& localErFilters() {
+    static thread_local ErFilters filters;
+    if (!filters.loaded) {
+      filters.loaded = true;
+      try {
+        filters.nm1 = text::createERFilterNM1(text::loadClassifierNM1(kErFilterNM1Path),
+                                              16, 0.00015f, 0.13f, 0.2f, true, 0.1f);
+        filters.nm2 = text::createERFilterNM2(text::loadClassifierNM2(kErFilterNM2Path), 0.5f);
+      }
+      catch (const cv::Exception& e) {
+        std::cerr << "[CPlateLocate] er locate disabled: " << e.what() << std::endl;
+        filters.nm1.release();
+        filters.nm2.release();
+      }
+    }
+    return filters;
+  }
+}
+
+int CPlateLocate::plateErLocate(Mat src, vector<CPlate> &candPlates, int img_index) {
+  ErFilters& filters = localErFilters();
+  if (filters.nm1.empty() || filters.nm2.empty()) return 0;
+
+  int scale_size = 1000;
+  double scale_ratio = 1;
+
+  FrameWorkspace& ws = FrameWorkspace::local();
+  ws.prepare(kStageEr, src.size());
+
+  Mat& grayImage = ws.get(kStageEr, 0);
+  cvtColor(src, grayImage, COLOR_BGR2GRAY);
+  Mat image = scaleImage(grayImage, Size(scale_size, scale_size), scale_ratio);
+  Mat colorImage = scaleImage(src, Size(scale_size, scale_size), scale_ratio);
+
+  // dark characters on a light plate (yellow, white, new energy) and light
+  // characters on a dark one (blue)
+  vector<Mat> channels(2);
+  channels[0] = image;
+  Mat& inverted = ws.get(kStageEr, 1);
+  bitwise_not(image, inverted);
+  channels[1] = inverted;
+
+  // the stage 1 descriptors are computed incrementally while the
+  // component tree grows, stage 2 only adds its three descriptors to the
+  // regions stage 1 kept. the budget is shared by both polarities and
+  // both stages, a stage with nothing left does not run, and the regions
+  // stage 2 could not check are dropped, so the total stays in the budget
+  bool limited = m_erBudget > 0;
+  int budget = m_erBudget;
+  vector<vector<text::ERStat>> regions(channels.size());
+  for (size_t c = 0; c < channels.size(); c++) {
+    int share = limited ? budget / int(channels.size() - c) : 0;
+    if (limited && share <= 0) continue;
+
+    filters.nm1->setMaxEvaluations(share);
+    filters.nm1->run(channels[c], regions[c]);
+    int used = filters.nm1->getNumEvaluations();
+
+    if (limited && share - used <= 0) {
+      regions[c].clear();
+    } else {
+      filters.nm2->setMaxEvaluations(limited ? share - used : 0);
+      filters.nm2->run(channels[c], regions[c]);
+      used += filters.nm2->getNumEvaluations();
+    }
+
+    budget -= used;
+  }
+
+  vector<vector<Vec2i>> groups;
+  vector<Rect> groupRects;
+  text::erGrouping(colorImage, channels, regions, groups, groupRects, text::ERGROUPING_ORIENTATION_HORIZ);
+
+  Rect srcRect(0, 0, src.cols, src.rows);
+  for (size_t i = 0; i < groupRects.size(); i++) {
+    // the group covers the characters, the plate has a border around them
+    Rect2f group(groupRects[i].x * float(scale_ratio), groupRects[i].y * float(scale_ratio),
+                 groupRects[i].width * float(scale_ratio), groupRects[i].height * float(scale_ratio));
+    Point2f center(group.x + group.width / 2.f, group.y + group.height / 2.f);
+    RotatedRect rrect(center, Size2f(group.width * 1.1f, group.height * 1.4f), 0.f);
+    if (!verifySizes(rrect)) continue;
+
+    Rect bound = rrect.boundingRect() & srcRect;
+    if (bound.area() == 0) continue;
+
+    Mat plateMat;
+    resize(src(bound), plateMat, Size(WIDTH, HEIGHT), 0, 0, INTER_AREA);
+
+    CPlate plate;
+    plate.setPlatePos(rrect);
+    plate.setPlateMat(plateMat);
+    // light characters come from the inverted channel
+    Vec2i first = groups[i].front();
+    plate.setPlateColor(first[0] == 1 ? BLUE : UNKNOWN);
+    candPlates.push_back(plate);
+  }
+
+  if (m_debug) {
+    Mat debug = src.clone();
+    for (auto& plate : candPlates) rectangle(debug, plate.getPlatePos().boundingRect(), Scalar(0, 255, 255));
+    std::stringstream ss(std::stringstream::in | std::stringstream::out);
+    ss << "resources/image/tmp/plateDetect/er_" << img_index << ".jpg";
+    utils::imwrite(ss.str(), debug);
+  }
+
+  return 0;
+}
+
 int CPlateLocate::sobelOperT(const Mat &in, Mat &out, int blurSize, int morphW,
                              int morphH) {
   Mat mat_blur;
@@ -873,6 +1015,9 @@ int CPlateLocate::plateSobelLocate(Mat src, vector<CPlate> &candPlates,
   vector<Rect_<float>> bound_rects;
   bound_rects.reserve(256);
 
+  FrameWorkspace& ws = FrameWorkspace::local();
+  ws.prepare(kStageSobel, src.size());
+
   sobelFrtSearch(src, bound_rects);
 
   vector<Rect_<float>> bound_rects_part;
@@ -953,8 +1098,8 @@ int CPlateLocate::plateSobelLocate(Mat src, vector<CPlate> &candPlates,
     }
   }
 
-  Mat src_b;
-  sobelOper(src, src_b, 3, 10, 3);
+  Mat& src_b = ws.get(kStageSobel, 5);
+  sobelOper(src, src_b, 3, 10, 3, &ws);
 
   deskew(src, src_b, rects_sobel_all, plates);
 
@@ -6,6 +6,12 @@ namespace easypr {
 
 CPlateRecognize::CPlateRecognize() { 
   m_showResult = false;
+  m_cascadeScore = 0.5f;
+  resetCascadeStats();
+}
+
+void CPlateRecognize::resetCascadeStats() {
+  m_cascadeStats = CascadeStats();
 }
 
 
@@ -13,13 +19,26 @@ CPlateRecognize::CPlateRecognize() {
 // 1. plate detect
 // 2. chars recognize
 int CPlateRecognize::plateRecognize(const Mat& src, std::vector<CPlate> &plateVecOut, int img_index) {
-  // resize to uniform sizes
+  // the whole frame runs on one model version, a reload meanwhile is
+  // picked up by the next frame
+  ModelRegistry::Pin pin;
+
+  // resize to uniform sizes, the pyramid mode works on the source
+  // image and returns the plate positions in its coordinates
   float scale = 1.f;
-  Mat img = uniformResize(src, scale);
+  Mat img;
+  std::vector<CPlate> plateVec;
+  int resultPD = 0;
 
   // 1. plate detect
-  std::vector<CPlate> plateVec;
-  int resultPD = plateDetect(img, plateVec, img_index);
+  if (getPyramidMode()) {
+    img = src;
+    resultPD = plateDetectPyramid(src, plateVec, getDetectType(), img_index);
+  }
+  else {
+    img = uniformResize(src, scale);
+    resultPD = plateDetect(img, plateVec, img_index);
+  }
   if (resultPD == 0) {
     size_t num = plateVec.size();
     for (size_t j = 0; j < num; j++) {
@@ -27,6 +46,13 @@ int CPlateRecognize::plateRecognize(const Mat& src, std::vector<CPlate> &plateVe
       Mat plateMat = item.getPlateMat();
       SHOW_IMAGE(plateMat, 0);
 
+      // cascade stage 1: a marginal svm score is not worth the recognition
+      m_cascadeStats.candidates++;
+      if (item.getPlateScore() >= m_cascadeScore) {
+        m_cascadeStats.rejectedByScore++;
+        continue;
+      }
+
       // scale the rect to src;
       item.setPlateScale(scale);
       RotatedRect rect = item.getPlatePos();
@@ -46,6 +72,14 @@ int CPlateRecognize::plateRecognize(const Mat& src, std::vector<CPlate> &plateVe
       // 2. chars recognize
       std::string plateIdentify = "";
       int resultCR = charsRecognise(item, plateIdentify);
+
+      // cascade stage 2 and 3: segmentation and layout fail before any
+      // ann call, identify fails after it
+      if (resultCR == 0) m_cascadeStats.recognized++;
+      else if (resultCR == 0x06) m_cascadeStats.rejectedByLayout++;
+      else if (resultCR == -1) m_cascadeStats.rejectedByIdentify++;
+      else m_cascadeStats.rejectedBySegment++;
+
       if (resultCR == 0) {
         std::string license = plateColor + ":" + plateIdentify;
         item.setPlateStr(license);
@@ -91,6 +125,14 @@ void CPlateRecognize::LoadChineseMapping(std::string path) {
   CharsIdentify::instance()->LoadChineseMapping(path);
 }
 
+std::future<bool> CPlateRecognize::LoadModelsAsync(const ModelPaths& paths) {
+  return ModelRegistry::instance()->reloadAsync(paths);
+}
+
+uint64_t CPlateRecognize::getModelVersion() const {
+  return ModelRegistry::instance()->version();
+}
+
 // deprected
 int CPlateRecognize::plateRecognize(const Mat& src, std::vector<std::string> &licenseVec) {
   vector<CPlate> plates;
@@ -0,0 +1,57 @@
+#include "easypr/core/scratch_arena.h"
+
+namespace easypr {
+
+ScratchArena::ScratchArena(size_t capacity) {
+  m_offset = 0;
+  m_peak = 0;
+  m_overflow = 0;
+  m_heapAllocations = 0;
+  reserve(capacity);
+}
+
+ScratchArena& ScratchArena::local() {
+  static thread_local ScratchArena arena;
+  return arena;
+}
+
+cv::Mat ScratchArena::alloc(int rows, int cols, int type) {
+  size_t bytes = size_t(rows) * size_t(cols) * CV_ELEM_SIZE(type);
+
+  // align the real address, the vector storage itself is not aligned
+  uchar* base = m_buffer.data();
+  size_t address = reinterpret_cast<size_t>(base) + m_offset;
+  size_t padding = (kAlignment - address % kAlignment) % kAlignment;
+
+  if (m_offset + padding + bytes > m_buffer.size()) {
+    m_overflow += bytes + kAlignment;
+    m_heapAllocations++;
+    return cv::Mat(rows, cols, type);
+  }
+
+  uchar* data = base + m_offset + padding;
+  m_offset += padding + bytes;
+  if (m_offset > m_peak) m_peak = m_offset;
+
+  return cv::Mat(rows, cols, type, data);
+}
+
+void ScratchArena::rewind(size_t mark) {
+  CV_Assert(mark <= m_offset);
+  m_offset = mark;
+
+  // no Mat points into the buffer any more, it is safe to grow now
+  if (0 == m_offset && m_overflow > 0) {
+    reserve(m_buffer.size() + m_overflow);
+    m_overflow = 0;
+  }
+}
+
+void ScratchArena::reserve(size_t bytes) {
+  CV_Assert(0 == m_offset);
+  if (bytes > m_buffer.size()) {
+    m_buffer.resize(bytes + kAlignment);
+  }
+}
+
+}
@@ -0,0 +1,231 @@
+#include "easypr/core/svm_evaluator.h"
+#include <algorithm>
+#include <numeric>
+#include <iomanip>
+
+namespace easypr {
+
+SvmRbfEvaluator::SvmRbfEvaluator() {
+  m_rho = 0;
+  m_gamma = 0;
+}
+
+bool SvmRbfEvaluator::load(const cv::Ptr<cv::ml::SVM>& svm) {
+  m_sv.release();
+  m_svNorm.release();
+  m_alpha.release();
+
+  if (svm.empty() || !svm->isTrained()) return false;
+  if (svm->getType() != cv::ml::SVM::C_SVC) return false;
+  if (svm->getKernelType() != cv::ml::SVM::RBF) return false;
+
+  // one decision function is the two class case
+  Mat alpha, svidx;
+  double rho = 0;
+  try {
+    rho = svm->getDecisionFunction(0, alpha, svidx);
+  }
+  catch (const cv::Exception&) {
+    return false;
+  }
+  Mat sv = svm->getSupportVectors();
+  if (sv.empty() || alpha.empty()) return false;
+
+  // keep only the vectors the function uses, in the order of its alpha.
+  // cv::Mat storage is 64 bytes aligned, so every gemm reads aligned rows.
+  int count = int(alpha.total());
+  m_sv.create(count, sv.cols, CV_32FC1);
+  m_alpha.create(count, 1, CV_64FC1);
+  for (int k = 0; k < count; k++) {
+    int index = svidx.at<int>(k);
+    sv.row(index).convertTo(m_sv.row(k), CV_32F);
+    m_alpha.at<double>(k) = alpha.type() == CV_64F ? alpha.at<double>(k)
+                                                   : double(alpha.at<float>(k));
+  }
+
+  reduce(m_sv.mul(m_sv), m_svNorm, 1, REDUCE_SUM, CV_32F);
+  m_svNorm = m_svNorm.t();
+  m_rho = rho;
+  m_gamma = svm->getGamma();
+  return true;
+}
+
+void SvmRbfEvaluator::wrap(int svCount, int varCount, const float* sv,
+                           const float* svNorm, const double* alpha,
+                           double rho, double gamma) {
+  m_sv = Mat(svCount, varCount, CV_32FC1, const_cast<float*>(sv));
+  m_svNorm = Mat(1, svCount, CV_32FC1, const_cast<float*>(svNorm));
+  m_alpha = Mat(svCount, 1, CV_64FC1, const_cast<double*>(alpha));
+  m_rho = rho;
+  m_gamma = gamma;
+}
+
+void SvmRbfEvaluator::distances(const Mat& samples, Mat& dist) const {
+  CV_Assert(samples.type() == CV_32FC1 && samples.cols == m_sv.cols);
+
+  // -2 x.sv for the whole batch in one gemm
+  gemm(samples, m_sv, -2.0, noArray(), 0, dist, GEMM_2_T);
+
+  const float* svNorm = m_svNorm.ptr<float>(0);
+  for (int i = 0; i < samples.rows; i++) {
+    const float* x = samples.ptr<float>(i);
+    float xNorm = 0.f;
+    for (int j = 0; j < samples.cols; j++) xNorm += x[j] * x[j];
+
+    float* d = dist.ptr<float>(i);
+    for (int k = 0; k < dist.cols; k++) {
+      // the expansion can go slightly below zero for x close to an sv
+      d[k] = std::max(d[k] + xNorm + svNorm[k], 0.f);
+    }
+  }
+}
+
+void SvmRbfEvaluator::predict(const Mat& samples, Mat& scores) const {
+  CV_Assert(!empty());
+  scores.create(samples.rows, 1, CV_32FC1);
+  if (samples.rows == 0) return;
+
+  Mat kernel;
+  distances(samples, kernel);
+  kernel.convertTo(kernel, CV_32F, -m_gamma);
+  exp(kernel, kernel);
+
+  // the weighted sum is accumulated in double, as cv::ml::SVM does
+  const double* alpha = m_alpha.ptr<double>(0);
+  for (int i = 0; i < samples.rows; i++) {
+    const float* k = kernel.ptr<float>(i);
+    double sum = -m_rho;
+    for (int j = 0; j < kernel.cols; j++) sum += alpha[j] * k[j];
+    scores.at<float>(i) = float(sum);
+  }
+}
+
+float SvmRbfEvaluator::predict(const Mat& sample) const {
+  Mat score;
+  predict(sample.reshape(1, 1), score);
+  return score.at<float>(0);
+}
+
+void SvmRbfEvaluator::predictExact(const Mat& samples, Mat& scores) const {
+  CV_Assert(!empty() && samples.type() == CV_32FC1 && samples.cols == m_sv.cols);
+  scores.create(samples.rows, 1, CV_32FC1);
+
+  // the steps of calc_rbf and the decision sum in cv::ml::SVM: the
+  // distance in double, unrolled by four, the kernel row in float and one
+  // exp over it, then the alpha sum in double in sv order
+  int count = m_sv.rows;
+  int varCount = m_sv.cols;
+  double gamma = -m_gamma;
+  const double* alpha = m_alpha.ptr<double>(0);
+  Mat kernel(1, count, CV_32FC1);
+  float* k = kernel.ptr<float>(0);
+  for (int i = 0; i < samples.rows; i++) {
+    const float* x = samples.ptr<float>(i);
+    for (int j = 0; j < count; j++) {
+      const float* sv = m_sv.ptr<float>(j);
+      double s = 0;
+      int v = 0;
+      for (; v <= varCount - 4; v += 4) {
+        double t0 = sv[v] - x[v];
+        double t1 = sv[v + 1] - x[v + 1];
+        s += t0 * t0 + t1 * t1;
+        t0 = sv[v + 2] - x[v + 2];
+        t1 = sv[v + 3] - x[v + 3];
+        s += t0 * t0 + t1 * t1;
+      }
+      for (; v < varCount; v++) {
+        double t0 = sv[v] - x[v];
+        s += t0 * t0;
+      }
+      k[j] = float(s * gamma);
+    }
+    exp(kernel, kernel);
+
+    double sum = -m_rho;
+    for (int j = 0; j < count; j++) sum += alpha[j] * k[j];
+    scores.at<float>(i) = float(sum);
+  }
+}
+
+SvmRbfEvaluator SvmRbfEvaluator::reduced(int keepCount, bool refit) const {
+  SvmRbfEvaluator result;
+  if (empty()) return result;
+  keepCount = std::max(1, std::min(keepCount, getSVCount()));
+
+  std::vector<int> order(getSVCount());
+  std::iota(order.begin(), order.end(), 0);
+  const double* alpha = m_alpha.ptr<double>(0);
+  std::stable_sort(order.begin(), order.end(), [alpha](int a, int b) {
+    return std::abs(alpha[a]) > std::abs(alpha[b]);
+  });
+  order.resize(keepCount);
+  std::sort(order.begin(), order.end());
+
+  result.m_sv.create(keepCount, m_sv.cols, CV_32FC1);
+  result.m_svNorm.create(1, keepCount, CV_32FC1);
+  result.m_alpha.create(keepCount, 1, CV_64FC1);
+  for (int k = 0; k < keepCount; k++) {
+    m_sv.row(order[k]).copyTo(result.m_sv.row(k));
+    result.m_svNorm.at<float>(k) = m_svNorm.at<float>(order[k]);
+    result.m_alpha.at<double>(k) = alpha[order[k]];
+  }
+  result.m_rho = m_rho;
+  result.m_gamma = m_gamma;
+
+  if (refit && keepCount < getSVCount()) {
+    // least squares on the original support vectors:
+    // K(sv, kept) * alpha' ~= K(sv, sv) * alpha
+    Mat full, part;
+    distances(m_sv, full);
+    full.convertTo(full, CV_64F, -m_gamma);
+    exp(full, full);
+
+    part.create(full.rows, keepCount, CV_64FC1);
+    for (int k = 0; k < keepCount; k++) full.col(order[k]).copyTo(part.col(k));
+
+    Mat target = full * m_alpha;
+    Mat refitted;
+    if (solve(part, target, refitted, DECOMP_SVD))
+      result.m_alpha = refitted;
+  }
+  return result;
+}
+
+void SvmRbfEvaluator::reportReduced(const Mat& samples,
+                                    const std::vector<int>& keepCounts,
+                                    std::ostream& out, float threshold) const {
+  if (empty() || samples.empty()) return;
+
+  auto timedPredict = [&samples](const SvmRbfEvaluator& evaluator, Mat& scores) {
+    int64 start = getTickCount();
+    evaluator.predict(samples, scores);
+    return (getTickCount() - start) * 1000000.0 / getTickFrequency() / samples.rows;
+  };
+
+  Mat reference;
+  double referenceUs = timedPredict(*this, reference);
+
+  out << std::setw(8) << "svs" << std::setw(14) << "us/sample"
+      << std::setw(14) << "max error" << std::setw(12) << "agreement" << std::endl;
+  out << std::setw(8) << getSVCount() << std::setw(14) << referenceUs
+      << std::setw(14) << 0 << std::setw(12) << 1 << std::endl;
+
+  for (int keepCount : keepCounts) {
+    SvmRbfEvaluator evaluator = reduced(keepCount);
+    Mat scores;
+    double us = timedPredict(evaluator, scores);
+
+    double maxError = norm(scores, reference, NORM_INF);
+    int same = 0;
+    for (int i = 0; i < samples.rows; i++) {
+      bool a = reference.at<float>(i) < threshold;
+      bool b = scores.at<float>(i) < threshold;
+      if (a == b) same++;
+    }
+    out << std::setw(8) << evaluator.getSVCount() << std::setw(14) << us
+        << std::setw(14) << maxError << std::setw(12)
+        << double(same) / samples.rows << std::endl;
+  }
+}
+
+}
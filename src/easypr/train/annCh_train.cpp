@@ -1,5 +1,6 @@
 #include <numeric>
 #include <ctime>
+#include <random>
 
 #include "easypr/train/annCh_train.h"
 #include "easypr/config.h"
@@ -8,6 +9,7 @@
 #include "easypr/core/core_func.h"
 #include "easypr/util/util.h"
 #include "easypr/train/create_data.h"
+#include "easypr/train/sample_loader.h"
 
 namespace easypr {
 
@@ -117,73 +119,105 @@ std::pair<std::string, std::string> AnnChTrain::identifyGrayChinese(cv::Mat inpu
     //TODO
 }
 
+namespace {
+  // one folder per class, the last classNumber characters of kChars,
+  // filled up to number_for_count with synthetic variants of random
+  // originals
+  void collectChars(const char* chars_folder, int classNumber, size_t number_for_count,
+                    std::vector<TrainSample>& items) {
+    // a fixed seed picks the same originals every run, so the feature
+    // cache of the items stays valid
+    cv::RNG rng;
+    for (int i = 0; i < classNumber; ++i) {
+      auto char_key = kChars[i + kCharsTotalNumber - classNumber];
+      char sub_folder[512] = { 0 };
+      sprintf(sub_folder, "%s/%s", chars_folder, char_key);
+
+      fprintf(stdout, ">> Collecting characters %s in %s \n", char_key, sub_folder);
+      auto chars_files = utils::getFiles(sub_folder);
+      size_t char_size = chars_files.size();
+      for (auto file : chars_files)
+        items.push_back({ file, i, 0 });
+
+      for (int t = 0; char_size > 0 && t < (int)number_for_count - (int)char_size; t++) {
+        int ran_num = rng.uniform(0, (int)char_size);
+        items.push_back({ chars_files[ran_num], i, t + 1 });
+      }
+      fprintf(stdout, ">> Characters count: %d \n", int(std::max(char_size, number_for_count)));
+    }
+  }
+
+  cv::Mat resizeGrayChar(const cv::Mat& img) {
+    Mat img_resize;
+    img_resize.create(kGrayCharHeight, kGrayCharWidth, CV_8UC1);
+    resize(img, img_resize, img_resize.size(), 0, 0, INTER_LINEAR);
+    return img_resize;
+  }
+}
+
+std::string AnnChTrain::featureCache(const char* use) const {
+  return m_feature_cache.empty() ? std::string() : m_feature_cache + "." + use;
+}
+
+float AnnChTrain::accuracy(const cv::Mat& samples, const std::vector<int>& labels) {
+  if (samples.empty()) return 0.f;
+  cv::Mat output;
+  ann_->predict(samples, output);
+
+  int corrects_all = 0;
+  for (int i = 0; i < output.rows; ++i) {
+    cv::Point maxLoc;
+    cv::minMaxLoc(output.row(i), nullptr, nullptr, nullptr, &maxLoc);
+    if (maxLoc.x == labels[i]) corrects_all++;
+  }
+  return (float)corrects_all / (float)output.rows;
+}
+
 void AnnChTrain::trainVal(size_t number_for_count) {
   assert(chars_folder_);
-  cv::Mat train_samples;
-  std::vector<cv::Mat>  train_images, val_images;
-  std::vector<int> train_label, val_labels;
   float percentage = 0.7f;
   int classNumber = kChineseNumber;
 
-  for (int i = 0; i < classNumber; ++i) { 
-    auto char_key = kChars[i + kCharsTotalNumber - classNumber];
-    char sub_folder[512] = { 0 };
-    sprintf(sub_folder, "%s/%s", chars_folder_, char_key);
-    std::string test_char(char_key);
-    // if (test_char != "zh_yun") continue;
-
-    fprintf(stdout, ">> Testing characters %s in %s \n", char_key, sub_folder);
-    auto chars_files = utils::getFiles(sub_folder);
-    size_t char_size = chars_files.size();
-    fprintf(stdout, ">> Characters count: %d \n", (int)char_size);
-
-    std::vector<cv::Mat> matVec;
-    matVec.reserve(number_for_count);
-    for (auto file : chars_files) {
-      std::cout << file << std::endl;
-      auto img = cv::imread(file, IMREAD_GRAYSCALE);  // a grayscale image 
-      Mat img_resize;
-      img_resize.create(kGrayCharHeight, kGrayCharWidth, CV_8UC1);
-      resize(img, img_resize, img_resize.size(), 0, 0, INTER_LINEAR);
-      matVec.push_back(img_resize);
-    }
-    // genrate the synthetic images
-    for (int t = 0; t < (int)number_for_count - (int)char_size; t++) {
-      int rand_range = char_size + t;
-      int ran_num = rand() % rand_range;
-      auto img = matVec.at(ran_num);
-      SHOW_IMAGE(img, 0);
-      auto simg = generateSyntheticImage(img);
-      SHOW_IMAGE(simg, 0);
-      matVec.push_back(simg);
-    }
-    fprintf(stdout, ">> Characters count: %d \n", (int)matVec.size());
-
-    // random sort the mat;
-    srand(unsigned(time(NULL)));
-    random_shuffle(matVec.begin(), matVec.end());
-
-    int mat_size = (int)matVec.size();
-    int split_index = int((float)mat_size * percentage);
-    for (int j = mat_size - 1; j >= 0; j--) {
-      Mat img = matVec.at(j);
-      if (1) {
-        Mat feature;
-        extractFeature(img, feature);
-        if (j <= split_index) {
-          train_samples.push_back(feature);
-          train_images.push_back(img);
-          train_label.push_back(i);
-        }
-        else {
-          val_images.push_back(img);
-          val_labels.push_back(i);
-        }
-      }
+  std::vector<TrainSample> items;
+  collectChars(chars_folder_, classNumber, number_for_count, items);
+
+  SampleLoader loader(IMREAD_GRAYSCALE, extractFeature, featureName(extractFeature));
+  loader.setPreprocess(resizeGrayChar);
+  loader.setAugmenter([](const cv::Mat& img, cv::RNG& rng) { return generateSyntheticImage(img, rng); });
+  loader.setCachePath(featureCache("trainval"));
+
+  cv::Mat samples;
+  std::vector<int> labels;
+  loader.load(items, samples, labels);
+
+  // random split of every class, the rows of a class are contiguous
+  std::vector<int> train_rows, val_rows;
+  std::mt19937 engine(unsigned(time(NULL)));
+  for (int begin = 0, end = 0; begin < samples.rows; begin = end) {
+    while (end < samples.rows && labels[end] == labels[begin]) end++;
+    std::vector<int> rows(end - begin);
+    std::iota(rows.begin(), rows.end(), begin);
+    std::shuffle(rows.begin(), rows.end(), engine);
+
+    int split_index = int((float)rows.size() * percentage);
+    train_rows.insert(train_rows.end(), rows.begin(), rows.begin() + split_index);
+    val_rows.insert(val_rows.end(), rows.begin() + split_index, rows.end());
+  }
+
+  auto gather = [&](const std::vector<int>& rows, cv::Mat& subset, std::vector<int>& subset_labels) {
+    subset.create((int)rows.size(), samples.cols, CV_32F);
+    subset_labels.resize(rows.size());
+    for (size_t i = 0; i < rows.size(); ++i) {
+      samples.row(rows[i]).copyTo(subset.row((int)i));
+      subset_labels[i] = labels[rows[i]];
     }
-  } 
+  };
+  cv::Mat train_samples, val_samples;
+  std::vector<int> train_label, val_labels;
+  gather(train_rows, train_samples, train_label);
+  gather(val_rows, val_samples, val_labels);
+
   // generate train data
-  train_samples.convertTo(train_samples, CV_32F);
   cv::Mat train_classes = cv::Mat::zeros((int)train_label.size(), classNumber, CV_32F);
   for (int i = 0; i < train_classes.rows; ++i)
     train_classes.at<float>(i, train_label[i]) = 1.f;
@@ -198,72 +232,37 @@ void AnnChTrain::trainVal(size_t number_for_count) {
   std::cout << "Your ANN Model was saved to " << ann_xml_ << std::endl;
   std::cout << "Training done. Time elapse: " << (end - start) / (1000 * 60) << "minute" << std::endl;
 
-  // test the accuracy_rate in train
-  if (1) {
-    int corrects_all = 0, sum_all = train_images.size();
-    std::cout << "train_images size: " << sum_all << std::endl;
-    for (size_t i = 0; i < train_images.size(); ++i) {
-      cv::Mat img = train_images.at(i);
-      int label = train_label.at(i);
-      auto char_key = kChars[label + kCharsTotalNumber - classNumber];
-      std::pair<std::string, std::string> ch = identifyGrayChinese(img);
-      if (ch.first == char_key)
-        corrects_all++;
-    }
-    float accuracy_rate = (float)corrects_all / (float)sum_all;
-    std::cout << "Train error_rate: " << (1.f - accuracy_rate) * 100.f << "% "<< std::endl;
-  }
-
-  // test the accuracy_rate in val
-  if (1) {
-    int corrects_all = 0, sum_all = val_images.size();
-    std::cout << "val_images: " << sum_all << std::endl;
-    for (size_t i = 0; i < val_images.size(); ++i) {
-      cv::Mat img = val_images.at(i);
-      int label = val_labels.at(i);
-      auto char_key = kChars[label + kCharsTotalNumber - classNumber];
-      std::pair<std::string, std::string> ch = identifyGrayChinese(img);
-      if (ch.first == char_key)
-        corrects_all++;
-    }
-    float accuracy_rate = (float)corrects_all / (float)sum_all;
-    std::cout << "Test error_rate: " << (1.f - accuracy_rate) * 100.f << "% "<< std::endl;
-  }
+  // the accuracy_rate in train and in val, on the features already extracted
+  std::cout << "train_images size: " << train_samples.rows << std::endl;
+  float accuracy_rate = accuracy(train_samples, train_label);
+  std::cout << "Train error_rate: " << (1.f - accuracy_rate) * 100.f << "% "<< std::endl;
 
+  std::cout << "val_images: " << val_samples.rows << std::endl;
+  accuracy_rate = accuracy(val_samples, val_labels);
+  std::cout << "Test error_rate: " << (1.f - accuracy_rate) * 100.f << "% "<< std::endl;
 }
 
 cv::Ptr<cv::ml::TrainData> AnnChTrain::tdata() {
   assert(chars_folder_);
 
-  cv::Mat samples;
-  std::vector<int> labels;
-
   std::cout << "Collecting chars in " << chars_folder_ << std::endl;
 
   int classNumber = 0;
   if (type == 0) classNumber = kCharsTotalNumber;
   if (type == 1) classNumber = kChineseNumber;
 
-  for (int i = 0; i < classNumber; ++i) {
-    auto char_key = kChars[i + kCharsTotalNumber - classNumber];
-    char sub_folder[512] = {0};
-
-    sprintf(sub_folder, "%s/%s", chars_folder_, char_key);
-    std::cout << "  >> Featuring characters " << char_key << " in "
-              << sub_folder << std::endl;
+  std::vector<TrainSample> items;
+  collectChars(chars_folder_, classNumber, 0, items);
 
-    auto chars_files = utils::getFiles(sub_folder);
-    for (auto file : chars_files) {
-      auto img = cv::imread(file, 0);  // a grayscale image
-      auto fps = charFeatures2(img, kPredictSize);
+  SampleLoader loader(IMREAD_GRAYSCALE,
+    [](const cv::Mat& img, cv::Mat& feature) { feature = charFeatures2(img, kPredictSize); },
+    "charFeatures2");
+  loader.setCachePath(featureCache("tdata"));
 
-      samples.push_back(fps);
-      labels.push_back(i);
-    }
-  }
+  cv::Mat samples;
+  std::vector<int> labels;
+  loader.load(items, samples, labels);
 
-  cv::Mat samples_;
-  samples.convertTo(samples_, CV_32F);
   cv::Mat train_classes =
     cv::Mat::zeros((int)labels.size(), classNumber, CV_32F);
 
@@ -271,7 +270,7 @@ cv::Ptr<cv::ml::TrainData> AnnChTrain::tdata() {
     train_classes.at<float>(i, labels[i]) = 1.f;
   }
 
-  return cv::ml::TrainData::create(samples_, cv::ml::SampleTypes::ROW_SAMPLE,
+  return cv::ml::TrainData::create(samples, cv::ml::SampleTypes::ROW_SAMPLE,
                                    train_classes);
 }
 }
@@ -7,10 +7,30 @@
 #include "easypr/core/feature.h"
 #include "easypr/core/core_func.h"
 #include "easypr/train/create_data.h"
+#include "easypr/train/hyper_search.h"
+#include "easypr/train/sample_loader.h"
 #include "easypr/util/util.h"
 
 namespace easypr {
 
+namespace {
+  // characters per class with the synthetic images
+  const size_t kSyntheticCount = 350;
+
+  cv::Ptr<cv::ml::TrainData> charTrainData(const cv::Mat& samples, const std::vector<int>& labels,
+                                           int classNumber);
+
+  void configureAnn(cv::Ptr<cv::ml::ANN_MLP>& ann, const cv::Mat& layers, int iterations,
+                    double weightScale) {
+    ann->setLayerSizes(layers);
+    ann->setActivationFunction(cv::ml::ANN_MLP::SIGMOID_SYM, 1, 1);
+    ann->setTrainMethod(cv::ml::ANN_MLP::TrainingMethods::BACKPROP);
+    ann->setTermCriteria(cvTermCriteria(CV_TERMCRIT_ITER, iterations, 0.0001));
+    ann->setBackpropWeightScale(weightScale);
+    ann->setBackpropMomentumScale(0.1);
+  }
+}
+
 AnnTrain::AnnTrain(const char* chars_folder, const char* xml)
     : chars_folder_(chars_folder), ann_xml_(xml) {
   ann_ = cv::ml::ANN_MLP::create();
@@ -71,12 +91,7 @@ void AnnTrain::train() {
     layers.at<int>(3) = output_number;
   }
 
-  ann_->setLayerSizes(layers);
-  ann_->setActivationFunction(cv::ml::ANN_MLP::SIGMOID_SYM, 1, 1);
-  ann_->setTrainMethod(cv::ml::ANN_MLP::TrainingMethods::BACKPROP);
-  ann_->setTermCriteria(cvTermCriteria(CV_TERMCRIT_ITER, 30000, 0.0001));
-  ann_->setBackpropWeightScale(0.1);
-  ann_->setBackpropMomentumScale(0.1);
+  configureAnn(ann_, layers, 30000, 0.1);
 
   auto files = Utils::getFiles(chars_folder_);
   if (files.size() == 0) {
@@ -87,7 +102,7 @@ void AnnTrain::train() {
   }
 
   //using raw data or raw + synthic data.
-  auto traindata = sdata(350);
+  auto traindata = sdata(kSyntheticCount);
 
   std::cout << "Training ANN model, please wait..." << std::endl;
   long start = utils::getTimestamp();
@@ -100,6 +115,61 @@ void AnnTrain::train() {
   std::cout << "Training done. Time elapse: " << (end - start) / (1000 * 60) << "minute" << std::endl;
 }
 
+void AnnTrain::search(double budgetUs) {
+  int hiddens[] = { kNeurons / 2, kNeurons, kNeurons * 2 };
+  int iterations[] = { 5000, 30000 };
+  double weightScales[] = { 0.1, 0.05 };
+
+  cv::Mat samples;
+  std::vector<int> labels;
+  int classNumber = loadSamples(kSyntheticCount, samples, labels);
+  if (samples.empty()) {
+    fprintf(stdout, "No file found in the train folder!\n");
+    return;
+  }
+
+  struct Point { int hidden; int iterations; double weightScale; };
+  std::vector<Point> points;
+  HyperSearch search;
+  for (int hidden : hiddens) {
+    for (int iteration : iterations) {
+      for (double weightScale : weightScales) {
+        Point point = { hidden, iteration, weightScale };
+        points.push_back(point);
+
+        char name[64] = { 0 };
+        sprintf(name, "hidden=%d iter=%d w=%.2f", hidden, iteration, weightScale);
+        search.addCandidate({ name, [=]() {
+          cv::Mat layers = (cv::Mat_<int>(1, 3) << samples.cols, point.hidden, classNumber);
+          cv::Ptr<cv::ml::ANN_MLP> ann = cv::ml::ANN_MLP::create();
+          configureAnn(ann, layers, point.iterations, point.weightScale);
+          return cv::Ptr<cv::ml::StatModel>(ann);
+        }, true });
+      }
+    }
+  }
+
+  std::cout << "Searching " << points.size() << " ANN configurations, please wait..." << std::endl;
+  auto results = search.run(samples, labels, classNumber);
+  HyperSearch::printTable(results);
+
+  int best = HyperSearch::best(results, budgetUs);
+  if (best < 0) {
+    fprintf(stdout, ">> No configuration within %.2f us per character\n", budgetUs);
+    return;
+  }
+  fprintf(stdout, ">> Training %s on all the samples\n", results[best].name.c_str());
+
+  const Point& point = points[best];
+  cv::Mat layers = (cv::Mat_<int>(1, 3) << samples.cols, point.hidden, classNumber);
+  configureAnn(ann_, layers, point.iterations, point.weightScale);
+  ann_->train(charTrainData(samples, labels, classNumber));
+  ann_->save(ann_xml_);
+  std::cout << "Your ANN Model was saved to " << ann_xml_ << std::endl;
+
+  test();
+}
+
 std::pair<std::string, std::string> AnnTrain::identifyChinese(cv::Mat input) {
   cv::Mat feature = charFeatures2(input, kPredictSize);
   float maxVal = -2;
@@ -226,18 +296,18 @@ void AnnTrain::test() {
   fprintf(stdout, ">>   [classNumber: %d, avg_rate: %.4f]\n", classNumber, rate_mean);
 }
 
-cv::Mat getSyntheticImage(const Mat& image) {
-  int rand_type = rand();
+cv::Mat getSyntheticImage(const Mat& image, cv::RNG& rng) {
+  int rand_type = int(rng.next() & 0x7fffffff);
   Mat result = image.clone();
 
   if (rand_type % 2 == 0) {
-    int ran_x = rand() % 5 - 2;
-    int ran_y = rand() % 5 - 2;
+    int ran_x = rng.uniform(0, 5) - 2;
+    int ran_y = rng.uniform(0, 5) - 2;
 
     result = translateImg(result, ran_x, ran_y);
   }
   else if (rand_type % 2 != 0) {
-    float angle = float(rand() % 15 - 7);
+    float angle = float(rng.uniform(0, 15) - 7);
 
     result = rotateImg(result, angle);
   }
@@ -245,112 +315,81 @@ cv::Mat getSyntheticImage(const Mat& image) {
   return result;
 }
 
-cv::Ptr<cv::ml::TrainData> AnnTrain::sdata(size_t number_for_count) {
-  assert(chars_folder_);
-
-  cv::Mat samples;
-  std::vector<int> labels;
-
-  int classNumber = 0;
-  if (type == 0) classNumber = kCharsTotalNumber;
-  if (type == 1) classNumber = kChineseNumber;
-  
-  srand((unsigned)time(0));
-  for (int i = 0; i < classNumber; ++i) {
-   
-    auto char_key = kChars[i + kCharsTotalNumber - classNumber];
-    char sub_folder[512] = { 0 };
-
-    sprintf(sub_folder, "%s/%s", chars_folder_, char_key);
-    fprintf(stdout, ">> Testing characters %s in %s \n", char_key, sub_folder);
-
-    auto chars_files = utils::getFiles(sub_folder);
-    size_t char_size = chars_files.size();
-    fprintf(stdout, ">> Characters count: %d \n", int(char_size));
-
-    std::vector<cv::Mat> matVec;
-    matVec.reserve(number_for_count);
-    for (auto file : chars_files) {
-      auto img = cv::imread(file, 0);  // a grayscale image
-      matVec.push_back(img);
-    }
-
-    for (int t = 0; t < (int)number_for_count - (int)char_size; t++) {
-      int rand_range = char_size + t;
-      int ran_num = rand() % rand_range;
-      auto img = matVec.at(ran_num);
-      auto simg = getSyntheticImage(img);
-      matVec.push_back(simg);
-      if (1) {
-        std::stringstream ss(std::stringstream::in | std::stringstream::out);
-        ss << sub_folder << "/" << i << "_" << t << "_" << ran_num << ".jpg";
-        imwrite(ss.str(), simg);
+namespace {
+  // the character folders of the classes, the label is the class index
+  void collectChars(const char* chars_folder, int classNumber, size_t number_for_count,
+                    std::vector<TrainSample>& items) {
+    // a fixed seed picks the same originals every run, so the feature
+    // cache of the items stays valid
+    cv::RNG rng;
+    for (int i = 0; i < classNumber; ++i) {
+      auto char_key = kChars[i + kCharsTotalNumber - classNumber];
+      char sub_folder[512] = { 0 };
+
+      sprintf(sub_folder, "%s/%s", chars_folder, char_key);
+      fprintf(stdout, ">> Collecting characters %s in %s \n", char_key, sub_folder);
+
+      auto chars_files = utils::getFiles(sub_folder);
+      size_t char_size = chars_files.size();
+      for (auto file : chars_files)
+        items.push_back({ file, i, 0 });
+
+      // fill the class up to number_for_count with synthetic variants of
+      // random originals
+      for (int t = 0; char_size > 0 && t < (int)number_for_count - (int)char_size; t++) {
+        int ran_num = rng.uniform(0, (int)char_size);
+        items.push_back({ chars_files[ran_num], i, t + 1 });
       }
+      fprintf(stdout, ">> Characters count: %d \n", int(std::max(char_size, number_for_count)));
     }
+  }
 
-    fprintf(stdout, ">> Characters count: %d \n", (int)matVec.size());
-
-    for (auto img : matVec) {
-      auto fps = charFeatures2(img, kPredictSize);
+  cv::Ptr<cv::ml::TrainData> charTrainData(const cv::Mat& samples, const std::vector<int>& labels,
+                                           int classNumber) {
+    cv::Mat train_classes =
+      cv::Mat::zeros((int)labels.size(), classNumber, CV_32F);
 
-      samples.push_back(fps);
-      labels.push_back(i);
+    for (int i = 0; i < train_classes.rows; ++i) {
+      train_classes.at<float>(i, labels[i]) = 1.f;
     }
-  } 
-
-  cv::Mat samples_;
-  samples.convertTo(samples_, CV_32F);
-  cv::Mat train_classes =
-    cv::Mat::zeros((int)labels.size(), classNumber, CV_32F);
 
-  for (int i = 0; i < train_classes.rows; ++i) {
-    train_classes.at<float>(i, labels[i]) = 1.f;
+    return cv::ml::TrainData::create(samples, cv::ml::SampleTypes::ROW_SAMPLE,
+      train_classes);
   }
 
-  return cv::ml::TrainData::create(samples_, cv::ml::SampleTypes::ROW_SAMPLE,
-    train_classes);
+  void charFeatures2Row(const cv::Mat& image, cv::Mat& feature) {
+    feature = charFeatures2(image, kPredictSize);
+  }
 }
 
-cv::Ptr<cv::ml::TrainData> AnnTrain::tdata() {
+int AnnTrain::loadSamples(size_t number_for_count, cv::Mat& samples, std::vector<int>& labels) {
   assert(chars_folder_);
 
-  cv::Mat samples;
-  std::vector<int> labels;
-
-  std::cout << "Collecting chars in " << chars_folder_ << std::endl;
-
   int classNumber = 0;
   if (type == 0) classNumber = kCharsTotalNumber;
   if (type == 1) classNumber = kChineseNumber;
 
-  for (int i = 0; i < classNumber; ++i) {
-    auto char_key = kChars[i + kCharsTotalNumber - classNumber];
-    char sub_folder[512] = {0};
+  std::vector<TrainSample> items;
+  collectChars(chars_folder_, classNumber, number_for_count, items);
 
-    sprintf(sub_folder, "%s/%s", chars_folder_, char_key);
-    std::cout << "  >> Featuring characters " << char_key << " in "
-              << sub_folder << std::endl;
-
-    auto chars_files = utils::getFiles(sub_folder);
-    for (auto file : chars_files) {
-      auto img = cv::imread(file, 0);  // a grayscale image
-      auto fps = charFeatures2(img, kPredictSize);
-
-      samples.push_back(fps);
-      labels.push_back(i);
-    }
-  }
+  SampleLoader loader(cv::IMREAD_GRAYSCALE, charFeatures2Row, "charFeatures2");
+  loader.setAugmenter(getSyntheticImage);
+  loader.setCachePath(feature_cache_);
+  loader.load(items, samples, labels);
+  return classNumber;
+}
 
-  cv::Mat samples_;
-  samples.convertTo(samples_, CV_32F);
-  cv::Mat train_classes =
-    cv::Mat::zeros((int)labels.size(), classNumber, CV_32F);
+cv::Ptr<cv::ml::TrainData> AnnTrain::sdata(size_t number_for_count) {
+  cv::Mat samples;
+  std::vector<int> labels;
+  int classNumber = loadSamples(number_for_count, samples, labels);
+  return charTrainData(samples, labels, classNumber);
+}
 
-  for (int i = 0; i < train_classes.rows; ++i) {
-    train_classes.at<float>(i, labels[i]) = 1.f;
-  }
+cv::Ptr<cv::ml::TrainData> AnnTrain::tdata() {
+  std::cout << "Collecting chars in " << chars_folder_ << std::endl;
 
-  return cv::ml::TrainData::create(samples_, cv::ml::SampleTypes::ROW_SAMPLE,
-                                   train_classes);
+  // without a count to fill up to there is no synthetic image
+  return sdata(0);
 }
 }
@@ -63,22 +63,27 @@ namespace easypr {
   }
 
   Mat generateSyntheticImage(const Mat& image, int use_swap) {
-    int rd = rand();
+    RNG rng((uint64)rand());
+    return generateSyntheticImage(image, rng);
+  }
+
+  Mat generateSyntheticImage(const Mat& image, RNG& rng) {
+    int rd = int(rng.next() & 0x7fffffff);
     int bkColor = getBoderColor(image);
     Mat result = image.clone();
     if (0 && (rd >> 6 & 1)) {
       int shift = 2;
-      int ran_x = rand() % shift;
-      int ran_y = rand() % shift;
+      int ran_x = rng.uniform(0, shift);
+      int ran_y = rng.uniform(0, shift);
       result = cropImg(result, ran_x, ran_y, shift, bkColor);
     }
     if (0 && (rd >> 4 & 1)) {
-      int ran_x = rand() % 2 - 1;
-      int ran_y = rand() % 2 - 1;
+      int ran_x = rng.uniform(0, 2) - 1;
+      int ran_y = rng.uniform(0, 2) - 1;
       result = translateImg(result, ran_x, ran_y, bkColor);
     }
     if (1 && (rd >> 2 & 1)) {
-      float angle = float(rand() % 100) * 0.1f - 5.f;
+      float angle = float(rng.uniform(0, 100)) * 0.1f - 5.f;
       result = rotateImg(result, angle, bkColor);
     }
 
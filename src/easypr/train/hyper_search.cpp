@@ -0,0 +1,192 @@
+#include "easypr/train/hyper_search.h"
+#include <algorithm>
+#include <atomic>
+#include <numeric>
+#include <random>
+#include <thread>
+
+using namespace cv;
+using namespace cv::ml;
+
+namespace easypr {
+
+namespace {
+  const int kTimedSamples = 256;
+
+  double elapsedMs(int64 start) {
+    return (getTickCount() - start) * 1000.0 / getTickFrequency();
+  }
+
+  // share of the validation rows the model labels right
+  float foldAccuracy(const Ptr<StatModel>& model, bool oneHot, const Mat& samples,
+                     const std::vector<int>& labels) {
+    if (samples.empty()) return 0.f;
+    Mat output;
+    model->predict(samples, output);
+
+    int corrects = 0;
+    for (int i = 0; i < samples.rows; i++) {
+      int predict = 0;
+      if (oneHot) {
+        Point maxLoc;
+        minMaxLoc(output.row(i), nullptr, nullptr, nullptr, &maxLoc);
+        predict = maxLoc.x;
+      } else {
+        predict = cvRound(output.at<float>(i));
+      }
+      if (predict == labels[i]) corrects++;
+    }
+    return (float)corrects / (float)samples.rows;
+  }
+
+  // runs task(0..count-1) on a pool of threads
+  void parallelTasks(int count, int threads, const std::function<void(int)>& task) {
+    std::atomic<int> next(0);
+    auto worker = [&]() {
+      for (int i = next++; i < count; i = next++) task(i);
+    };
+    std::vector<std::thread> pool;
+    for (int t = 0; t < std::min(threads, count); t++) pool.emplace_back(worker);
+    for (auto& thread : pool) thread.join();
+  }
+}
+
+HyperSearch::HyperSearch() {
+  m_folds = 5;
+  m_threads = 0;
+  m_pruneMargin = 0.05f;
+  m_seed = 0x45617379505251ULL;
+}
+
+void HyperSearch::makeFolds(const Mat& samples, const std::vector<int>& labels,
+                            int classNumber) {
+  // stratified: the rows of every class are dealt round robin over the
+  // folds after a seeded shuffle
+  std::vector<int> order(samples.rows);
+  std::iota(order.begin(), order.end(), 0);
+  std::mt19937_64 engine(m_seed);
+  std::shuffle(order.begin(), order.end(), engine);
+  std::stable_sort(order.begin(), order.end(),
+                   [&](int a, int b) { return labels[a] < labels[b]; });
+
+  std::vector<int> foldOf(samples.rows);
+  for (int i = 0; i < (int)order.size(); i++) foldOf[order[i]] = i % m_folds;
+
+  m_foldData.assign(m_folds, Fold());
+  for (int f = 0; f < m_folds; f++) {
+    Fold& fold = m_foldData[f];
+    int valCount = (int)std::count(foldOf.begin(), foldOf.end(), f);
+    int trainCount = samples.rows - valCount;
+
+    fold.trainSamples.create(trainCount, samples.cols, CV_32FC1);
+    fold.trainLabels.create(trainCount, 1, CV_32SC1);
+    fold.trainOneHot = Mat::zeros(trainCount, classNumber, CV_32FC1);
+    fold.valSamples.create(valCount, samples.cols, CV_32FC1);
+    fold.valLabels.clear();
+
+    for (int i = 0, t = 0, v = 0; i < samples.rows; i++) {
+      if (foldOf[i] == f) {
+        samples.row(i).copyTo(fold.valSamples.row(v++));
+        fold.valLabels.push_back(labels[i]);
+      } else {
+        samples.row(i).copyTo(fold.trainSamples.row(t));
+        fold.trainLabels.at<int>(t) = labels[i];
+        fold.trainOneHot.at<float>(t, labels[i]) = 1.f;
+        t++;
+      }
+    }
+  }
+}
+
+std::vector<SearchResult> HyperSearch::run(const Mat& samples, const std::vector<int>& labels,
+                                           int classNumber) {
+  CV_Assert(samples.type() == CV_32FC1 && samples.rows == (int)labels.size());
+  makeFolds(samples, labels, classNumber);
+
+  int threads = m_threads > 0 ? m_threads : std::max(1, (int)std::thread::hardware_concurrency());
+  int candidates = (int)m_candidates.size();
+
+  std::vector<SearchResult> results(candidates);
+  std::vector<std::vector<float>> accuracies(candidates, std::vector<float>(m_folds, -1.f));
+  std::vector<std::vector<double>> trainMs(candidates, std::vector<double>(m_folds, 0));
+  // the first fold model of every candidate, kept for the timing
+  std::vector<Ptr<StatModel>> timed(candidates);
+
+  auto trainFold = [&](int c, int f) {
+    const SearchCandidate& candidate = m_candidates[c];
+    const Fold& fold = m_foldData[f];
+    Ptr<StatModel> model = candidate.create();
+
+    int64 start = getTickCount();
+    model->train(TrainData::create(fold.trainSamples, ROW_SAMPLE,
+                                   candidate.oneHot ? fold.trainOneHot : fold.trainLabels));
+    trainMs[c][f] = elapsedMs(start);
+    accuracies[c][f] = foldAccuracy(model, candidate.oneHot, fold.valSamples, fold.valLabels);
+    if (f == 0) timed[c] = model;
+  };
+
+  // round one, the first fold of every candidate
+  parallelTasks(candidates, threads, [&](int c) { trainFold(c, 0); });
+
+  float bestFirst = 0.f;
+  for (int c = 0; c < candidates; c++) bestFirst = std::max(bestFirst, accuracies[c][0]);
+  std::vector<int> alive;
+  for (int c = 0; c < candidates; c++) {
+    results[c].pruned = accuracies[c][0] < bestFirst - m_pruneMargin;
+    if (!results[c].pruned) alive.push_back(c);
+  }
+
+  // round two, the other folds of the survivors
+  int rest = m_folds - 1;
+  parallelTasks((int)alive.size() * rest, threads,
+                [&](int task) { trainFold(alive[task / rest], 1 + task % rest); });
+
+  for (int c = 0; c < candidates; c++) {
+    SearchResult& result = results[c];
+    result.name = m_candidates[c].name;
+    result.minAccuracy = 1.f;
+    for (int f = 0; f < m_folds; f++) {
+      if (accuracies[c][f] < 0) continue;
+      result.folds++;
+      result.accuracy += accuracies[c][f];
+      result.minAccuracy = std::min(result.minAccuracy, accuracies[c][f]);
+      result.trainMs += trainMs[c][f];
+    }
+    result.accuracy /= result.folds;
+    result.trainMs /= result.folds;
+
+    // alone on the machine, one row at a time
+    const Mat& val = m_foldData[0].valSamples;
+    int count = std::min(kTimedSamples, val.rows);
+    if (count == 0) continue;
+    Mat output;
+    int64 start = getTickCount();
+    for (int i = 0; i < count; i++) timed[c]->predict(val.row(i), output);
+    result.inferUs = elapsedMs(start) * 1000.0 / count;
+  }
+  return results;
+}
+
+int HyperSearch::best(const std::vector<SearchResult>& results, double budgetUs) {
+  int best = -1;
+  for (int i = 0; i < (int)results.size(); i++) {
+    const SearchResult& result = results[i];
+    if (result.pruned || (budgetUs > 0 && result.inferUs > budgetUs)) continue;
+    if (best < 0 || result.accuracy > results[best].accuracy ||
+        (result.accuracy == results[best].accuracy && result.inferUs < results[best].inferUs))
+      best = i;
+  }
+  return best;
+}
+
+void HyperSearch::printTable(const std::vector<SearchResult>& results, FILE* out) {
+  fprintf(out, "%-32s %5s %9s %9s %11s %11s\n", "candidate", "folds", "accuracy", "min",
+          "train ms", "infer us");
+  for (auto& result : results) {
+    fprintf(out, "%-32s %5d %9.4f %9.4f %11.1f %11.2f%s\n", result.name.c_str(), result.folds,
+            result.accuracy, result.minAccuracy, result.trainMs, result.inferUs,
+            result.pruned ? "  pruned" : "");
+  }
+}
+
+}
@@ -0,0 +1,155 @@
+#include "easypr/train/model_compiler.h"
+#include <fstream>
+#include <sstream>
+#include "easypr/core/feature.h"
+#include "easypr/util/util.h"
+
+using namespace cv;
+using namespace cv::ml;
+
+namespace easypr {
+
+namespace {
+  const int kVerifySamples = 256;
+
+  double elapsedMs(int64 start) {
+    return (getTickCount() - start) * 1000.0 / getTickFrequency();
+  }
+
+  bool readText(const char* path, std::string& text) {
+    std::ifstream reader(path, std::ios::binary);
+    if (!reader) return false;
+    std::stringstream buffer;
+    buffer << reader.rdbuf();
+    text = buffer.str();
+    return true;
+  }
+
+  bool verifyMlp(const ModelBundle& bundle, const char* name, const char* xml) {
+    Ptr<ANN_MLP> ann;
+    int64 start = getTickCount();
+    LOAD_ANN_MODEL(ann, xml);
+    double xmlMs = elapsedMs(start);
+
+    MlpEvaluator mlp;
+    if (ann.empty() || !bundle.getMlp(name, mlp)) {
+      fprintf(stderr, "[ModelCompiler] %s is missing\n", name);
+      return false;
+    }
+
+    Mat samples(kVerifySamples, mlp.getLayerSizes().front(), CV_32FC1);
+    randu(samples, 0.f, 1.f);
+    Mat expected, actual;
+    ann->predict(samples, expected);
+    mlp.predict(samples, actual);
+
+    double error = norm(expected, actual, NORM_INF);
+    fprintf(stdout, "%-18s xml load %8.2f ms, max output error %g\n", name, xmlMs, error);
+    return error < 1e-4;
+  }
+}
+
+ModelCompiler::ModelCompiler(const char* svm_xml, const char* ann_xml,
+                             const char* ann_chinese_xml, const char* annCh_xml,
+                             const char* mapping, const char* svm_feature)
+    : svm_xml_(svm_xml), ann_xml_(ann_xml), ann_chinese_xml_(ann_chinese_xml),
+      annCh_xml_(annCh_xml), mapping_(mapping), svm_feature_(svm_feature) {
+  assert(svm_xml && ann_xml && ann_chinese_xml && annCh_xml && mapping && svm_feature);
+}
+
+bool ModelCompiler::compile(const char* bundle_path) {
+  ModelBundleWriter writer;
+
+  Ptr<SVM> svm;
+  LOAD_SVM_MODEL(svm, svm_xml_);
+  SvmRbfEvaluator evaluator;
+  if (svm.empty() || !evaluator.load(svm)) {
+    fprintf(stderr, "[ModelCompiler] %s is not a two class RBF svm\n", svm_xml_);
+    return false;
+  }
+  if (!featureByName(svm_feature_)) {
+    fprintf(stderr, "[ModelCompiler] %s is not a plate feature\n", svm_feature_);
+    return false;
+  }
+  writer.addSvm("svm_hist", evaluator);
+  writer.addText("svm_feature", svm_feature_);
+
+  const char* names[] = { "ann", "ann_chinese", "annCh" };
+  const char* xmls[] = { ann_xml_, ann_chinese_xml_, annCh_xml_ };
+  for (int i = 0; i < 3; i++) {
+    MlpEvaluator mlp;
+    if (!mlp.load(xmls[i])) {
+      fprintf(stderr, "[ModelCompiler] cannot read the ann in %s\n", xmls[i]);
+      return false;
+    }
+    writer.addMlp(names[i], mlp);
+  }
+
+  std::string mapping;
+  if (!readText(mapping_, mapping)) {
+    fprintf(stderr, "[ModelCompiler] cannot read %s\n", mapping_);
+    return false;
+  }
+  writer.addText("province_mapping", mapping);
+
+  if (!writer.write(bundle_path)) {
+    fprintf(stderr, "[ModelCompiler] cannot write %s\n", bundle_path);
+    return false;
+  }
+  return verify(bundle_path);
+}
+
+bool ModelCompiler::verify(const char* bundle_path) {
+  int64 start = getTickCount();
+  auto bundle = ModelBundle::open(bundle_path);
+  double openMs = elapsedMs(start);
+  if (!bundle) return false;
+  fprintf(stdout, "%s: %zu bytes, open and checksum %.2f ms\n", bundle_path,
+          bundle->size(), openMs);
+
+  bool ok = true;
+
+  Ptr<SVM> svm;
+  start = getTickCount();
+  LOAD_SVM_MODEL(svm, svm_xml_);
+  double xmlMs = elapsedMs(start);
+  SvmRbfEvaluator evaluator;
+  if (svm.empty() || !bundle->getSvm("svm_hist", evaluator)) {
+    fprintf(stderr, "[ModelCompiler] svm_hist is missing\n");
+    return false;
+  }
+  Mat samples(kVerifySamples, evaluator.getVarCount(), CV_32FC1);
+  randu(samples, 0.f, 1.f);
+  Mat expected, actual, exact;
+  svm->predict(samples, expected, StatModel::Flags::RAW_OUTPUT);
+  evaluator.predict(samples, actual);
+  evaluator.predictExact(samples, exact);
+  double error = norm(expected, actual, NORM_INF);
+  double exactError = norm(expected, exact, NORM_INF);
+  fprintf(stdout, "%-18s xml load %8.2f ms, max decision error %g, exact path %g\n", "svm_hist",
+          xmlMs, error, exactError);
+  // the gemm path only rounds differently, the exact path must match
+  ok = ok && error < 1e-4 && exactError == 0;
+
+  std::string feature;
+  if (!bundle->getText("svm_feature", feature) || feature != svm_feature_) {
+    fprintf(stderr, "[ModelCompiler] svm_feature differs\n");
+    ok = false;
+  }
+
+  ok = verifyMlp(*bundle, "ann", ann_xml_) && ok;
+  ok = verifyMlp(*bundle, "ann_chinese", ann_chinese_xml_) && ok;
+  ok = verifyMlp(*bundle, "annCh", annCh_xml_) && ok;
+
+  std::string mapping, expectedMapping;
+  if (!bundle->getText("province_mapping", mapping) || !readText(mapping_, expectedMapping) ||
+      mapping != expectedMapping) {
+    fprintf(stderr, "[ModelCompiler] province_mapping differs\n");
+    ok = false;
+  }
+
+  if (!ok) fprintf(stderr, "[ModelCompiler] %s does not match the xml models\n", bundle_path);
+  return ok;
+}
+
+}
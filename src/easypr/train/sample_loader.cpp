@@ -0,0 +1,227 @@
+#include "easypr/train/sample_loader.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <thread>
+
+namespace easypr {
+
+namespace {
+  struct FeatureCacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t cols;
+    uint64_t rows;
+    uint64_t key;
+  };
+
+  const char kCacheMagic[8] = { 'E', 'A', 'S', 'Y', 'P', 'R', 'F', 'C' };
+  const uint32_t kCacheVersion = 1;
+
+  // FNV-1a 64, continued from hash
+  uint64_t fnv1a(uint64_t hash, const void* data, size_t size) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; i++) {
+      hash ^= bytes[i];
+      hash *= 1099511628211ULL;
+    }
+    return hash;
+  }
+
+  struct Result {
+    int index;
+    cv::Mat feature;
+  };
+
+  // blocks the workers while the consumer is behind, so at most
+  // capacity rows are waiting at any time
+  class BoundedQueue {
+   public:
+    explicit BoundedQueue(size_t capacity) : m_capacity(std::max<size_t>(1, capacity)) {}
+
+    void push(Result&& result) {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_notFull.wait(lock, [this]() { return m_items.size() < m_capacity; });
+      m_items.push_back(std::move(result));
+      m_notEmpty.notify_one();
+    }
+
+    //! false once the queue is closed and empty
+    bool pop(Result& result) {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_notEmpty.wait(lock, [this]() { return !m_items.empty() || m_closed; });
+      if (m_items.empty()) return false;
+      result = std::move(m_items.front());
+      m_items.pop_front();
+      m_notFull.notify_one();
+      return true;
+    }
+
+    void close() {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_closed = true;
+      m_notEmpty.notify_all();
+    }
+
+   private:
+    size_t m_capacity;
+    bool m_closed = false;
+    std::deque<Result> m_items;
+    std::mutex m_mutex;
+    std::condition_variable m_notFull;
+    std::condition_variable m_notEmpty;
+  };
+}
+
+SampleLoader::SampleLoader(int imreadFlags, Featurizer featurize, const std::string& featureName)
+    : m_imreadFlags(imreadFlags), m_featurize(featurize), m_featureName(featureName) {
+  m_threads = 0;
+  m_queueSize = 1024;
+  m_seed = 0x45617379505251ULL;
+}
+
+uint64_t SampleLoader::fingerprint(const std::vector<TrainSample>& items) const {
+  uint64_t hash = 14695981039346656037ULL;
+  hash = fnv1a(hash, m_featureName.data(), m_featureName.size());
+  hash = fnv1a(hash, &m_imreadFlags, sizeof(m_imreadFlags));
+  hash = fnv1a(hash, &m_seed, sizeof(m_seed));
+  for (auto& item : items) {
+    hash = fnv1a(hash, item.file.data(), item.file.size() + 1);
+    hash = fnv1a(hash, &item.label, sizeof(item.label));
+    hash = fnv1a(hash, &item.variant, sizeof(item.variant));
+  }
+  return hash;
+}
+
+bool SampleLoader::load(const std::vector<TrainSample>& items, cv::Mat& samples,
+                        std::vector<int>& labels, std::vector<int>* indices) {
+  std::vector<int> rowIndices;
+  // the cache is only as good as the name of the features in its key
+  bool useCache = !m_cachePath.empty() && !m_featureName.empty();
+  if (!m_cachePath.empty() && m_featureName.empty())
+    fprintf(stdout, ">> The features have no name, the feature cache is not used\n");
+  uint64_t key = useCache ? fingerprint(items) : 0;
+  if (useCache && readCache(key, samples, labels, rowIndices)) {
+    fprintf(stdout, ">> Read %d samples from the feature cache %s\n", samples.rows,
+            m_cachePath.c_str());
+    if (indices) indices->swap(rowIndices);
+    return true;
+  }
+
+  int threads = m_threads > 0 ? m_threads : std::max(1, (int)std::thread::hardware_concurrency());
+  std::atomic<int> next(0);
+  BoundedQueue queue(m_queueSize);
+
+  auto worker = [&]() {
+    for (int i = next++; i < (int)items.size(); i = next++) {
+      const TrainSample& item = items[i];
+      Result result;
+      result.index = i;
+
+      cv::Mat image = cv::imread(item.file, m_imreadFlags);
+      if (image.data) {
+        if (m_preprocess) image = m_preprocess(image);
+        if (item.variant > 0 && m_augment) {
+          cv::RNG rng(m_seed + 0x9E3779B97F4A7C15ULL * uint64_t(i + 1));
+          image = m_augment(image, rng);
+        }
+        cv::Mat feature;
+        m_featurize(image, feature);
+        feature.reshape(1, 1).convertTo(result.feature, CV_32FC1);
+      }
+      // an empty feature tells the consumer the image was unreadable
+      queue.push(std::move(result));
+    }
+  };
+
+  std::vector<std::thread> pool;
+  for (int t = 0; t < threads; t++) pool.emplace_back(worker);
+
+  // the calling thread writes the rows straight into samples as they
+  // come, so the corpus is held once
+  std::vector<char> valid(items.size(), 0);
+  samples.release();
+  size_t received = 0;
+  Result result;
+  while (received < items.size() && queue.pop(result)) {
+    received++;
+    if (result.feature.empty()) {
+      fprintf(stdout, ">> Invalid image: %s  ignore.\n", items[result.index].file.c_str());
+      continue;
+    }
+    if (samples.empty()) samples.create((int)items.size(), result.feature.cols, CV_32FC1);
+    CV_Assert(result.feature.cols == samples.cols);
+    result.feature.copyTo(samples.row(result.index));
+    valid[result.index] = 1;
+  }
+  queue.close();
+  for (auto& thread : pool) thread.join();
+
+  // squeeze out the rows of unreadable images in place, keeping the order
+  int count = 0;
+  labels.clear();
+  for (int i = 0; i < (int)items.size(); i++) {
+    if (!valid[i]) continue;
+    if (count != i) samples.row(i).copyTo(samples.row(count));
+    count++;
+    labels.push_back(items[i].label);
+    rowIndices.push_back(i);
+  }
+  samples = count > 0 ? samples.rowRange(0, count) : cv::Mat();
+
+  if (useCache && !writeCache(key, samples, labels, rowIndices))
+    fprintf(stderr, "[SampleLoader] cannot write the feature cache %s\n", m_cachePath.c_str());
+  if (indices) indices->swap(rowIndices);
+  return count > 0;
+}
+
+bool SampleLoader::readCache(uint64_t key, cv::Mat& samples, std::vector<int>& labels,
+                             std::vector<int>& indices) const {
+  std::ifstream reader(m_cachePath, std::ios::binary);
+  if (!reader) return false;
+
+  FeatureCacheHeader header;
+  if (!reader.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+      memcmp(header.magic, kCacheMagic, sizeof(kCacheMagic)) != 0 ||
+      header.version != kCacheVersion || header.key != key)
+    return false;
+
+  labels.resize(header.rows);
+  indices.resize(header.rows);
+  samples.create((int)header.rows, (int)header.cols, CV_32FC1);
+  reader.read(reinterpret_cast<char*>(labels.data()), header.rows * sizeof(int));
+  reader.read(reinterpret_cast<char*>(indices.data()), header.rows * sizeof(int));
+  reader.read(reinterpret_cast<char*>(samples.data), samples.total() * sizeof(float));
+  return bool(reader);
+}
+
+bool SampleLoader::writeCache(uint64_t key, const cv::Mat& samples, const std::vector<int>& labels,
+                              const std::vector<int>& indices) const {
+  FeatureCacheHeader header;
+  memcpy(header.magic, kCacheMagic, sizeof(kCacheMagic));
+  header.version = kCacheVersion;
+  header.cols = samples.cols;
+  header.rows = samples.rows;
+  header.key = key;
+
+  // a half written cache must never be read, write aside and rename
+  std::string temp = m_cachePath + ".tmp";
+  {
+    std::ofstream writer(temp, std::ios::binary | std::ios::trunc);
+    if (!writer) return false;
+    writer.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    writer.write(reinterpret_cast<const char*>(labels.data()), labels.size() * sizeof(int));
+    writer.write(reinterpret_cast<const char*>(indices.data()), indices.size() * sizeof(int));
+    writer.write(reinterpret_cast<const char*>(samples.data), samples.total() * sizeof(float));
+    if (!writer) return false;
+  }
+  std::remove(m_cachePath.c_str());
+  return std::rename(temp.c_str(), m_cachePath.c_str()) == 0;
+}
+
+}
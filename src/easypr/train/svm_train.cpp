@@ -1,4 +1,6 @@
 #include "easypr/train/svm_train.h"
+#include "easypr/train/hyper_search.h"
+#include "easypr/train/sample_loader.h"
 #include "easypr/util/util.h"
 #include "easypr/config.h"
 
@@ -19,18 +21,25 @@ SvmTrain::SvmTrain(const char* plates_folder, const char* xml)
   extractFeature = getHistomPlusColoFeatures;
 }
 
+namespace {
+  cv::Ptr<cv::ml::SVM> createSvm(double C, double gamma) {
+    cv::Ptr<cv::ml::SVM> svm = cv::ml::SVM::create();
+    svm->setType(cv::ml::SVM::C_SVC);
+    svm->setKernel(cv::ml::SVM::RBF);
+    svm->setDegree(0.1);
+    // 1.4 bug fix: old 1.4 ver gamma is 1
+    svm->setGamma(gamma);
+    svm->setCoef0(0.1);
+    svm->setC(C);
+    svm->setNu(0.1);
+    svm->setP(0.1);
+    svm->setTermCriteria(cvTermCriteria(CV_TERMCRIT_ITER, 20000, 0.0001));
+    return svm;
+  }
+}
+
 void SvmTrain::train() {
-  svm_ = cv::ml::SVM::create();
-  svm_->setType(cv::ml::SVM::C_SVC);
-  svm_->setKernel(cv::ml::SVM::RBF);
-  svm_->setDegree(0.1);
-  // 1.4 bug fix: old 1.4 ver gamma is 1
-  svm_->setGamma(0.1); 
-  svm_->setCoef0(0.1);
-  svm_->setC(1);
-  svm_->setNu(0.1);
-  svm_->setP(0.1);
-  svm_->setTermCriteria(cvTermCriteria(CV_TERMCRIT_ITER, 20000, 0.0001));
+  svm_ = createSvm(1, 0.1);
 
   this->prepare();
 
@@ -62,6 +71,54 @@ void SvmTrain::train() {
   
 }
 
+void SvmTrain::search(double budgetUs) {
+  // the C and gamma grids of trainAuto, C_SVC with RBF ignores the others
+  double Cs[] = { 0.1, 0.5, 2.5, 12.5, 62.5, 312.5 };
+  double gammas[] = { 1e-5, 1.5e-4, 2.25e-3, 0.03375, 0.50625 };
+
+  this->prepare();
+  if (train_file_list_.size() == 0) {
+    fprintf(stdout, "No file found in the train folder!\n");
+    return;
+  }
+  auto train_data = tdata();
+  cv::Mat samples = train_data->getSamples();
+  std::vector<int> labels;
+  train_data->getResponses().reshape(1, 1).copyTo(labels);
+
+  std::vector<std::pair<double, double>> points;
+  HyperSearch search;
+  search.setFolds(10);
+  for (double C : Cs) {
+    for (double gamma : gammas) {
+      points.push_back(std::make_pair(C, gamma));
+
+      char name[64] = { 0 };
+      sprintf(name, "C=%g gamma=%g", C, gamma);
+      search.addCandidate({ name, [=]() { return cv::Ptr<cv::ml::StatModel>(createSvm(C, gamma)); },
+                            false });
+    }
+  }
+
+  fprintf(stdout, ">> Searching %d SVM configurations, please wait...\n", (int)points.size());
+  auto results = search.run(samples, labels, 2);
+  HyperSearch::printTable(results);
+
+  int best = HyperSearch::best(results, budgetUs);
+  if (best < 0) {
+    fprintf(stdout, ">> No configuration within %.2f us per plate\n", budgetUs);
+    return;
+  }
+  fprintf(stdout, ">> Training %s on all the samples\n", results[best].name.c_str());
+
+  svm_ = createSvm(points[best].first, points[best].second);
+  svm_->train(train_data);
+  svm_->save(svm_xml_);
+  fprintf(stdout, ">> Your SVM Model was saved to %s\n", svm_xml_);
+
+  this->test();
+}
+
 void SvmTrain::test() {
   // 1.4 bug fix: old 1.4 ver there is no null judge
   // if (NULL == svm_)
@@ -169,28 +226,25 @@ void SvmTrain::prepare() {
 }
 
 cv::Ptr<cv::ml::TrainData> SvmTrain::tdata() {
-  cv::Mat samples;
-  std::vector<int> responses;
+  // prepare() shuffles the lists, the loader gets them sorted so the
+  // feature cache matches from one run to the next
+  std::vector<TrainSample> items;
+  for (auto f : train_file_list_)
+    items.push_back({ f.file, int(f.label), 0 });
+  std::sort(items.begin(), items.end(),
+            [](const TrainSample& a, const TrainSample& b) { return a.file < b.file; });
 
-  for (auto f : train_file_list_) {
-    auto image = cv::imread(f.file);
-    if (!image.data) {
-      fprintf(stdout, ">> Invalid image: %s  ignore.\n", f.file.c_str());
-      continue;
-    }
-    cv::Mat feature;
-    extractFeature(image, feature);
-    feature = feature.reshape(1, 1);
+  SampleLoader loader(cv::IMREAD_COLOR, extractFeature, featureName(extractFeature));
+  loader.setCachePath(feature_cache_);
 
-    samples.push_back(feature);
-    responses.push_back(int(f.label));
-  }
+  cv::Mat samples;
+  std::vector<int> responses;
+  loader.load(items, samples, responses);
 
-  cv::Mat samples_, responses_;
-  samples.convertTo(samples_, CV_32FC1);
+  cv::Mat responses_;
   cv::Mat(responses).copyTo(responses_);
 
-  return cv::ml::TrainData::create(samples_, cv::ml::SampleTypes::ROW_SAMPLE, responses_);
+  return cv::ml::TrainData::create(samples, cv::ml::SampleTypes::ROW_SAMPLE, responses_);
 }
 
 }  // namespace easypr
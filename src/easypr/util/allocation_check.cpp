@@ -0,0 +1,88 @@
+#include "easypr/util/allocation_check.h"
+#include <atomic>
+#include <thread>
+#include "easypr/config.h"
+#include "easypr/core/scratch_arena.h"
+
+using namespace cv;
+
+namespace easypr {
+
+namespace {
+  // forwards to the allocator it replaces, counting the new buffers of one
+  // thread. buffers over external data are not allocations
+  class CountingAllocator : public MatAllocator {
+   public:
+    CountingAllocator(MatAllocator* base, std::thread::id thread)
+        : m_base(base), m_thread(thread), m_count(0) {}
+
+    UMatData* allocate(int dims, const int* sizes, int type, void* data, size_t* step,
+                       AccessFlag flags, UMatUsageFlags usageFlags) const override {
+      if (!data && std::this_thread::get_id() == m_thread) m_count++;
+      return m_base->allocate(dims, sizes, type, data, step, flags, usageFlags);
+    }
+
+    bool allocate(UMatData* data, AccessFlag accessflags, UMatUsageFlags usageFlags) const override {
+      return m_base->allocate(data, accessflags, usageFlags);
+    }
+
+    void deallocate(UMatData* data) const override { m_base->deallocate(data); }
+
+    inline size_t count() const { return m_count; }
+
+   private:
+    MatAllocator* m_base;
+    std::thread::id m_thread;
+    mutable std::atomic<size_t> m_count;
+  };
+
+  void extractInArena(svmCallback extract, const Mat& plate, int cols) {
+    ScratchArena& arena = ScratchArena::local();
+    size_t mark = arena.mark();
+    Mat features = arena.alloc(1, cols, CV_32FC1);
+    extract(plate, features);
+    arena.rewind(mark);
+  }
+}
+
+AllocationCount AllocationCheck::count(svmCallback extract, const Mat& plate, int calls,
+                                       int warmup) {
+  AllocationCount result;
+
+  // the row length, then the warm up, which may grow the arena
+  Mat features;
+  extract(plate, features);
+  int cols = int(features.total());
+  if (cols <= 0) return result;
+  for (int i = 0; i < warmup; i++) extractInArena(extract, plate, cols);
+
+  ScratchArena& arena = ScratchArena::local();
+  size_t fallbacks = arena.heapAllocations();
+  size_t capacity = arena.capacity();
+
+  MatAllocator* previous = Mat::getDefaultAllocator();
+  CountingAllocator counter(previous, std::this_thread::get_id());
+  Mat::setDefaultAllocator(&counter);
+  for (int i = 0; i < calls; i++) extractInArena(extract, plate, cols);
+  Mat::setDefaultAllocator(previous);
+
+  result.calls = size_t(calls);
+  result.matAllocations = counter.count();
+  result.arenaFallbacks = arena.heapAllocations() - fallbacks;
+  result.arenaGrowth = arena.capacity() - capacity;
+  return result;
+}
+
+bool AllocationCheck::checkPlateFeatures(std::ostream& out) {
+  Mat plate(kPlateResizeHeight, kPlateResizeWidth, CV_8UC3);
+  randu(plate, Scalar::all(0), Scalar::all(256));
+
+  AllocationCount counts = count(getHistomPlusColoFeatures, plate);
+  out << featureName(getHistomPlusColoFeatures) << ", " << counts.calls << " calls: "
+      << counts.matAllocations << " mat allocations, " << counts.arenaFallbacks
+      << " arena fallbacks, " << counts.arenaGrowth << " bytes of arena growth" << std::endl;
+  return counts.calls > 0 && counts.matAllocations == 0 && counts.arenaFallbacks == 0 &&
+         counts.arenaGrowth == 0;
+}
+
+}
@@ -0,0 +1,290 @@
+#include "easypr/util/regression_suite.h"
+#include <algorithm>
+#include <fstream>
+#include <numeric>
+#include "easypr/util/util.h"
+
+namespace easypr {
+
+namespace {
+  // upper edges of the latency histogram buckets, the last one is open
+  const double kHistogramEdgesMs[] = { 1, 2, 5, 10, 20, 50, 100, 200, 500, 1000, 2000 };
+  const int kHistogramBuckets = sizeof(kHistogramEdgesMs) / sizeof(kHistogramEdgesMs[0]) + 1;
+
+  double elapsedMs(int64 start) {
+    return (getTickCount() - start) * 1000.0 / getTickFrequency();
+  }
+
+  // the characters of a utf-8 string, a chinese character is one item
+  std::vector<std::string> utf8Chars(const std::string& text) {
+    std::vector<std::string> chars;
+    for (size_t i = 0; i < text.size();) {
+      unsigned char lead = (unsigned char)text[i];
+      size_t length = lead < 0x80 ? 1 : (lead >> 5) == 0x6 ? 2 : (lead >> 4) == 0xe ? 3 : 4;
+      chars.push_back(text.substr(i, length));
+      i += length;
+    }
+    return chars;
+  }
+
+  double charAccuracy(const std::string& label, const std::string& result) {
+    auto expected = utf8Chars(label);
+    if (expected.empty()) return 0;
+    unsigned int distance = Utils::levenshtein_distance(expected, utf8Chars(result));
+    return std::max(0.0, 1.0 - double(distance) / expected.size());
+  }
+
+  // "蓝牌:京A88888" gives "京A88888"
+  std::string licenseOf(const std::string& plateStr) {
+    size_t colon = plateStr.rfind(':');
+    return colon == std::string::npos ? std::string() : plateStr.substr(colon + 1);
+  }
+
+  void writeTiming(cv::FileStorage& fs, const StageTiming& timing) {
+    fs << "passed" << (int)timing.passed;
+    fs << "mean_ms" << timing.mean();
+    fs << "p50_ms" << timing.percentile(0.5);
+    fs << "p90_ms" << timing.percentile(0.9);
+    fs << "p99_ms" << timing.percentile(0.99);
+    fs << "max_ms" << timing.percentile(1.0);
+
+    std::vector<int> histogram(kHistogramBuckets, 0);
+    for (double ms : timing.samplesMs) {
+      int bucket = int(std::upper_bound(kHistogramEdgesMs, kHistogramEdgesMs + kHistogramBuckets - 1, ms) -
+                       kHistogramEdgesMs);
+      histogram[bucket]++;
+    }
+    fs << "histogram" << histogram;
+  }
+}
+
+double StageTiming::percentile(double p) const {
+  if (samplesMs.empty()) return 0;
+  std::vector<double> sorted(samplesMs);
+  std::sort(sorted.begin(), sorted.end());
+  size_t index = std::min(sorted.size() - 1, size_t(p * (sorted.size() - 1) + 0.5));
+  return sorted[index];
+}
+
+double StageTiming::mean() const {
+  if (samplesMs.empty()) return 0;
+  return std::accumulate(samplesMs.begin(), samplesMs.end(), 0.0) / samplesMs.size();
+}
+
+RegressionSuite::RegressionSuite(const std::string& corpus) : m_corpus(corpus) {
+  m_maxImages = 0;
+}
+
+const char* RegressionSuite::stageName(RegressionStage stage) {
+  static const char* names[kRegressStageCount] = { "locate", "judge", "segment", "identify",
+                                                   "pipeline" };
+  return names[stage];
+}
+
+bool RegressionSuite::collect(std::vector<std::pair<std::string, std::string>>& items) const {
+  if (m_labelsFile.empty()) {
+    for (auto& file : Utils::getFiles(m_corpus))
+      items.push_back(std::make_pair(file, Utils::getFileName(file)));
+  } else {
+    std::ifstream reader(m_labelsFile);
+    if (!reader) {
+      std::cerr << "[RegressionSuite] cannot read the labels " << m_labelsFile << std::endl;
+      return false;
+    }
+    std::string line;
+    while (std::getline(reader, line)) {
+      size_t space = line.find(' ');
+      if (space == std::string::npos) continue;
+      items.push_back(std::make_pair(m_corpus + "/" + line.substr(0, space), line.substr(space + 1)));
+    }
+  }
+  if (m_maxImages > 0 && items.size() > m_maxImages) items.resize(m_maxImages);
+  return !items.empty();
+}
+
+bool RegressionSuite::runStages(const Mat& src, const std::string& label) {
+  ModelRegistry::Pin pin;
+  StageTiming* stages = m_report.stages;
+
+  float scale = 1.f;
+  Mat img = uniformResize(src, scale);
+
+  int64 start = getTickCount();
+  std::vector<CPlate> candidates;
+  m_recognizer.locateCandidates(img, candidates, m_recognizer.getDetectType(), 0);
+  stages[kRegressLocate].samplesMs.push_back(elapsedMs(start));
+  if (candidates.empty()) return false;
+  stages[kRegressLocate].passed++;
+
+  start = getTickCount();
+  std::vector<CPlate> plates;
+  PlateJudge::instance()->plateJudgeUsingNMS(candidates, plates, m_recognizer.getMaxPlates());
+  stages[kRegressJudge].samplesMs.push_back(elapsedMs(start));
+  if (plates.empty()) return false;
+  stages[kRegressJudge].passed++;
+
+  // the segment and identify steps of CCharsRecognise::charsRecognise
+  double segmentMs = 0, identifyMs = 0;
+  bool segmented = false, read = false;
+  for (auto& plate : plates) {
+    Mat plateMat = plate.getPlateMat();
+    Color color = plate.getPlateColor();
+    if (plate.getPlateLocateType() != CMSER) {
+      Mat tmpMat = plateMat(Rect_<double>(plateMat.cols * 0.1, plateMat.rows * 0.1,
+                                          plateMat.cols * 0.8, plateMat.rows * 0.8));
+      color = getPlateType(tmpMat, true);
+    }
+
+    start = getTickCount();
+    std::vector<Mat> matChars, grayChars;
+    int result = m_recognizer.getCharsSegment()->charsSegmentUsingOSTU(plateMat, matChars, grayChars, color);
+    segmentMs += elapsedMs(start);
+    if (result != 0) continue;
+    segmented = true;
+
+    start = getTickCount();
+    std::string license;
+    for (size_t j = 0; j < matChars.size(); j++) {
+      if (j == 0) {
+        Mat grayChar = color != BLUE ? 255 - grayChars[j] : grayChars[j];
+        float maxVal;
+        bool judge = true;
+        license += CharsIdentify::instance()->identifyChineseGray(grayChar, maxVal, judge).second;
+      } else {
+        license += CharsIdentify::instance()->identify(matChars[j], false, j == 1).second;
+      }
+    }
+    identifyMs += elapsedMs(start);
+    read = read || license == label;
+  }
+
+  stages[kRegressSegment].samplesMs.push_back(segmentMs);
+  if (!segmented) return false;
+  stages[kRegressSegment].passed++;
+  stages[kRegressIdentify].samplesMs.push_back(identifyMs);
+  if (read) stages[kRegressIdentify].passed++;
+  return read;
+}
+
+bool RegressionSuite::run() {
+  std::vector<std::pair<std::string, std::string>> items;
+  m_report = RegressionReport();
+  if (!collect(items)) {
+    std::cerr << "[RegressionSuite] no labeled image in " << m_corpus << std::endl;
+    return false;
+  }
+
+  // one untimed frame, the first one would carry the model loading
+  Mat warmup = imread(items.front().first);
+  if (warmup.data) {
+    std::vector<CPlate> plates;
+    m_recognizer.plateRecognize(warmup, plates);
+  }
+
+  double charSum = 0;
+  size_t detected = 0;
+  for (auto& item : items) {
+    Mat src = imread(item.first);
+    if (!src.data) {
+      std::cerr << "[RegressionSuite] cannot read " << item.first << std::endl;
+      continue;
+    }
+    m_report.images++;
+    runStages(src, item.second);
+
+    int64 start = getTickCount();
+    std::vector<CPlate> plates;
+    m_recognizer.plateRecognize(src, plates);
+    m_report.stages[kRegressPipeline].samplesMs.push_back(elapsedMs(start));
+
+    // the closest plate of the image counts
+    std::string best;
+    double bestAccuracy = -1;
+    for (auto& plate : plates) {
+      std::string license = licenseOf(plate.getPlateStr());
+      double accuracy = charAccuracy(item.second, license);
+      if (accuracy > bestAccuracy) {
+        bestAccuracy = accuracy;
+        best = license;
+      }
+    }
+    if (!plates.empty()) detected++;
+    charSum += std::max(0.0, bestAccuracy);
+    if (best == item.second) m_report.stages[kRegressPipeline].passed++;
+    else m_report.misses.push_back({ item.first, item.second, best });
+  }
+
+  if (m_report.images == 0) return false;
+  m_report.plateAccuracy = double(m_report.stages[kRegressPipeline].passed) / m_report.images;
+  m_report.charAccuracy = charSum / m_report.images;
+  m_report.detectRate = double(detected) / m_report.images;
+  return true;
+}
+
+bool RegressionSuite::writeReport(const std::string& path) const {
+  cv::FileStorage fs(path, cv::FileStorage::WRITE | cv::FileStorage::FORMAT_JSON);
+  if (!fs.isOpened()) {
+    std::cerr << "[RegressionSuite] cannot write " << path << std::endl;
+    return false;
+  }
+  fs << "images" << (int)m_report.images;
+  fs << "plate_accuracy" << m_report.plateAccuracy;
+  fs << "char_accuracy" << m_report.charAccuracy;
+  fs << "detect_rate" << m_report.detectRate;
+  fs << "histogram_edges_ms" << std::vector<double>(kHistogramEdgesMs, kHistogramEdgesMs + kHistogramBuckets - 1);
+
+  fs << "stages" << "{";
+  for (int i = 0; i < kRegressStageCount; i++) {
+    fs << stageName(RegressionStage(i)) << "{";
+    writeTiming(fs, m_report.stages[i]);
+    fs << "}";
+  }
+  fs << "}";
+
+  fs << "misses" << "[";
+  for (auto& miss : m_report.misses) {
+    fs << "{" << "file" << miss.file << "label" << miss.label << "result" << miss.result << "}";
+  }
+  fs << "]";
+  return true;
+}
+
+bool RegressionSuite::compare(const std::string& baselinePath, const RegressionThresholds& thresholds,
+                              std::ostream& out) const {
+  cv::FileStorage fs(baselinePath, cv::FileStorage::READ);
+  if (!fs.isOpened()) {
+    out << "cannot read the baseline " << baselinePath << std::endl;
+    return false;
+  }
+
+  bool ok = true;
+  auto checkDrop = [&](const char* name, double baseline, double current, float drop) {
+    bool pass = current >= baseline - drop;
+    out << (pass ? "ok   " : "FAIL ") << name << ": " << current << " (baseline " << baseline
+        << ", allowed drop " << drop << ")" << std::endl;
+    ok = ok && pass;
+  };
+  checkDrop("plate_accuracy", (double)fs["plate_accuracy"], m_report.plateAccuracy,
+            thresholds.plateAccuracyDrop);
+  checkDrop("char_accuracy", (double)fs["char_accuracy"], m_report.charAccuracy,
+            thresholds.charAccuracyDrop);
+
+  if (thresholds.latencyRatio > 0) {
+    cv::FileNode stages = fs["stages"];
+    for (int i = 0; i < kRegressStageCount; i++) {
+      const char* name = stageName(RegressionStage(i));
+      cv::FileNode stage = stages[name];
+      if (stage.empty()) continue;
+      double baseline = (double)stage["p50_ms"];
+      double current = m_report.stages[i].percentile(0.5);
+      // under a millisecond the timer noise is larger than the ratio
+      bool pass = baseline < 1.0 || current <= baseline * thresholds.latencyRatio;
+      out << (pass ? "ok   " : "FAIL ") << name << " p50: " << current << " ms (baseline "
+          << baseline << " ms, allowed ratio " << thresholds.latencyRatio << ")" << std::endl;
+      ok = ok && pass;
+    }
+  }
+  return ok;
+}
+
+}
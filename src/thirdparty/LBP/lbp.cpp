@@ -1,5 +1,6 @@
 #include "lbp.hpp"
 #include "helper.hpp"
+#include "opencv2/core/hal/intrin.hpp"
 
 using namespace cv;
 
@@ -8,6 +9,65 @@ using namespace cv;
 //------------------------------------------------------------------------------
 namespace libfacerec {
 
+  // the codes of one row, up, mid and down point to the first pixel of
+  // three neighboring rows and n codes are written
+  template <typename _Tp> static
+    void olbp_row_(const _Tp* up, const _Tp* mid, const _Tp* down, unsigned char* out, int n) {
+      for (int j = 0; j < n; j++) {
+        _Tp center = mid[j + 1];
+        unsigned char code = 0;
+        code |= (up[j] >= center) << 7;
+        code |= (up[j + 1] >= center) << 6;
+        code |= (up[j + 2] >= center) << 5;
+        code |= (mid[j + 2] >= center) << 4;
+        code |= (down[j + 2] >= center) << 3;
+        code |= (down[j + 1] >= center) << 2;
+        code |= (down[j] >= center) << 1;
+        code |= (mid[j] >= center) << 0;
+        out[j] = code;
+      }
+    }
+
+  // 8 bit images compare a whole vector of centers against each neighbor
+  template <> 
+    void olbp_row_<unsigned char>(const unsigned char* up, const unsigned char* mid,
+      const unsigned char* down, unsigned char* out, int n) {
+      int j = 0;
+#if CV_SIMD
+      const int lanes = v_uint8::nlanes;
+      const v_uint8 bit7 = vx_setall_u8(1 << 7), bit6 = vx_setall_u8(1 << 6);
+      const v_uint8 bit5 = vx_setall_u8(1 << 5), bit4 = vx_setall_u8(1 << 4);
+      const v_uint8 bit3 = vx_setall_u8(1 << 3), bit2 = vx_setall_u8(1 << 2);
+      const v_uint8 bit1 = vx_setall_u8(1 << 1), bit0 = vx_setall_u8(1);
+      for (; j <= n - lanes; j += lanes) {
+        v_uint8 center = vx_load(mid + j + 1);
+        v_uint8 code = (vx_load(up + j) >= center) & bit7;
+        code |= (vx_load(up + j + 1) >= center) & bit6;
+        code |= (vx_load(up + j + 2) >= center) & bit5;
+        code |= (vx_load(mid + j + 2) >= center) & bit4;
+        code |= (vx_load(down + j + 2) >= center) & bit3;
+        code |= (vx_load(down + j + 1) >= center) & bit2;
+        code |= (vx_load(down + j) >= center) & bit1;
+        code |= (vx_load(mid + j) >= center) & bit0;
+        v_store(out + j, code);
+      }
+      vx_cleanup();
+#endif
+      for (; j < n; j++) {
+        unsigned char center = mid[j + 1];
+        unsigned char code = 0;
+        code |= (up[j] >= center) << 7;
+        code |= (up[j + 1] >= center) << 6;
+        code |= (up[j + 2] >= center) << 5;
+        code |= (mid[j + 2] >= center) << 4;
+        code |= (down[j + 2] >= center) << 3;
+        code |= (down[j + 1] >= center) << 2;
+        code |= (down[j] >= center) << 1;
+        code |= (mid[j] >= center) << 0;
+        out[j] = code;
+      }
+    }
+
   template <typename _Tp> static
     void olbp_(InputArray _src, OutputArray _dst) {
       // get matrices
@@ -15,23 +75,42 @@ namespace libfacerec {
       // allocate memory for result
       _dst.create(src.rows - 2, src.cols - 2, CV_8UC1);
       Mat dst = _dst.getMat();
-      // zero the result matrix
-      dst.setTo(0);
-      // calculate patterns
+      // calculate patterns, every pixel of dst is written
       for (int i = 1; i<src.rows - 1; i++) {
-        for (int j = 1; j<src.cols - 1; j++) {
-          _Tp center = src.at<_Tp>(i, j);
-          unsigned char code = 0;
-          code |= (src.at<_Tp>(i - 1, j - 1) >= center) << 7;
-          code |= (src.at<_Tp>(i - 1, j) >= center) << 6;
-          code |= (src.at<_Tp>(i - 1, j + 1) >= center) << 5;
-          code |= (src.at<_Tp>(i, j + 1) >= center) << 4;
-          code |= (src.at<_Tp>(i + 1, j + 1) >= center) << 3;
-          code |= (src.at<_Tp>(i + 1, j) >= center) << 2;
-          code |= (src.at<_Tp>(i + 1, j - 1) >= center) << 1;
-          code |= (src.at<_Tp>(i, j - 1) >= center) << 0;
-          dst.at<unsigned char>(i - 1, j - 1) = code;
+        olbp_row_<_Tp>(src.ptr<_Tp>(i - 1), src.ptr<_Tp>(i), src.ptr<_Tp>(i + 1),
+          dst.ptr<unsigned char>(i - 1), dst.cols);
+      }
+    }
+
+  template <typename _Tp> static
+    void olbp_spatial_histogram_(const Mat& src, int numPatterns, int grid_x, int grid_y, float* dst) {
+      // the cells of spatial_histogram(olbp(src)), on the lbp image
+      int width = (src.cols - 2) / grid_x;
+      int height = (src.rows - 2) / grid_y;
+      int bins = grid_x * numPatterns;
+      std::fill(dst, dst + grid_y * bins, 0.f);
+      if (width <= 0 || height <= 0)
+        return;
+
+      std::vector<unsigned char> codes(grid_x * width);
+      std::vector<int> counts(bins);
+      float scale = 1.f / (width * height);
+
+      for (int gy = 0; gy < grid_y; gy++) {
+        std::fill(counts.begin(), counts.end(), 0);
+        for (int i = gy * height + 1; i < (gy + 1) * height + 1; i++) {
+          olbp_row_<_Tp>(src.ptr<_Tp>(i - 1), src.ptr<_Tp>(i), src.ptr<_Tp>(i + 1),
+            &codes[0], (int)codes.size());
+          // codes out of [0, numPatterns) fall outside the histogram range
+          for (int gx = 0, j = 0; gx < grid_x; gx++) {
+            int* cell = &counts[gx * numPatterns];
+            for (int end = j + width; j < end; j++)
+              if (codes[j] < numPatterns) cell[codes[j]]++;
+          }
         }
+        float* row = dst + gy * bins;
+        for (int b = 0; b < bins; b++)
+          row[b] = counts[b] * scale;
       }
     }
 
@@ -50,6 +129,17 @@ void libfacerec::olbp(InputArray src, OutputArray dst) {
   }
 }
 
+void libfacerec::olbp_spatial_histogram(InputArray _src, int numPatterns, int grid_x, int grid_y, float* dst) {
+  Mat src = _src.getMat();
+  switch (src.type()) {
+  case CV_8UC1:   olbp_spatial_histogram_<unsigned char>(src, numPatterns, grid_x, grid_y, dst); break;
+  case CV_32FC1:  olbp_spatial_histogram_<float>(src, numPatterns, grid_x, grid_y, dst); break;
+  case CV_64FC1:  olbp_spatial_histogram_<double>(src, numPatterns, grid_x, grid_y, dst); break;
+  default:
+    CV_Error(CV_StsUnmatchedFormats, "This type is not implemented yet."); break;
+  }
+}
+
 //------------------------------------------------------------------------------
 // cv::varlbp
 //------------------------------------------------------------------------------
@@ -122,6 +212,82 @@ void libfacerec::varlbp(InputArray src, OutputArray dst, int radius, int neighbo
 // cv::elbp
 //------------------------------------------------------------------------------
 namespace libfacerec {
+  // one sample point of the circle, its four corners as offsets from the
+  // center and the bilinear weights, the same for every pixel
+  struct ElbpSample {
+    int fy, fx, cy, cx;
+    float w1, w2, w3, w4;
+  };
+
+  static ElbpSample elbp_sample(int radius, int n, int neighbors) {
+    ElbpSample p;
+    // sample points
+    float x = static_cast<float>(-radius) * sin(2.0f*(float)CV_PI*n / static_cast<float>(neighbors));
+    float y = static_cast<float>(radius)* cos(2.0f*(float)CV_PI*n / static_cast<float>(neighbors));
+    // relative indices
+    p.fx = static_cast<int>(floor(x));
+    p.fy = static_cast<int>(floor(y));
+    p.cx = static_cast<int>(ceil(x));
+    p.cy = static_cast<int>(ceil(y));
+    // fractional part
+    float ty = y - p.fy;
+    float tx = x - p.fx;
+    // set interpolation weights
+    p.w1 = (1 - tx) * (1 - ty);
+    p.w2 = tx  * (1 - ty);
+    p.w3 = (1 - tx) *      ty;
+    p.w4 = tx  *      ty;
+    return p;
+  }
+
+  // add bit n of the neighbor p to the codes of one dst row
+  template <typename _Tp> static
+    void elbp_row_(const Mat& src, int i, int radius, const ElbpSample& p, int n, int* out) {
+      const _Tp* c = src.ptr<_Tp>(i) + radius;
+      const _Tp* r1 = src.ptr<_Tp>(i + p.fy) + radius;
+      const _Tp* r2 = src.ptr<_Tp>(i + p.cy) + radius;
+      int count = src.cols - 2 * radius;
+      for (int j = 0; j < count; j++) {
+        // calculate interpolated value
+        float t = static_cast<float>(p.w1*r1[j + p.fx] + p.w2*r1[j + p.cx] + p.w3*r2[j + p.fx] + p.w4*r2[j + p.cx]);
+        // floating point precision, so check some machine-dependent epsilon
+        out[j] += ((t > c[j]) || (std::abs(t - c[j]) < std::numeric_limits<float>::epsilon())) << n;
+      }
+    }
+
+  template <>
+    void elbp_row_<unsigned char>(const Mat& src, int i, int radius, const ElbpSample& p, int n, int* out) {
+      const unsigned char* c = src.ptr<unsigned char>(i) + radius;
+      const unsigned char* r1 = src.ptr<unsigned char>(i + p.fy) + radius;
+      const unsigned char* r2 = src.ptr<unsigned char>(i + p.cy) + radius;
+      int count = src.cols - 2 * radius;
+      int j = 0;
+#if CV_SIMD
+      const int lanes = v_float32::nlanes;
+      const v_float32 w1 = vx_setall_f32(p.w1), w2 = vx_setall_f32(p.w2);
+      const v_float32 w3 = vx_setall_f32(p.w3), w4 = vx_setall_f32(p.w4);
+      const v_float32 eps = vx_setall_f32(std::numeric_limits<float>::epsilon());
+      const v_int32 bit = vx_setall_s32(1 << n);
+      for (; j <= count - lanes; j += lanes) {
+        v_float32 a = v_cvt_f32(v_reinterpret_as_s32(vx_load_expand_q(r1 + j + p.fx)));
+        v_float32 b = v_cvt_f32(v_reinterpret_as_s32(vx_load_expand_q(r1 + j + p.cx)));
+        v_float32 d = v_cvt_f32(v_reinterpret_as_s32(vx_load_expand_q(r2 + j + p.fx)));
+        v_float32 e = v_cvt_f32(v_reinterpret_as_s32(vx_load_expand_q(r2 + j + p.cx)));
+        v_float32 center = v_cvt_f32(v_reinterpret_as_s32(vx_load_expand_q(c + j)));
+        // the same order of operations as the scalar loop
+        v_float32 t = w1 * a + w2 * b + w3 * d + w4 * e;
+        v_float32 mask = (t > center) | (v_abs(t - center) < eps);
+        v_int32 code = vx_load(out + j) + (v_reinterpret_as_s32(mask) & bit);
+        v_store(out + j, code);
+      }
+      vx_cleanup();
+#endif
+      for (; j < count; j++) {
+        float t = static_cast<float>(p.w1*r1[j + p.fx] + p.w2*r1[j + p.cx] + p.w3*r2[j + p.fx] + p.w4*r2[j + p.cx]);
+        out[j] += ((t > c[j]) || (std::abs(t - c[j]) < std::numeric_limits<float>::epsilon())) << n;
+      }
+    }
+
   template <typename _Tp> static
     inline void elbp_(InputArray _src, OutputArray _dst, int radius, int neighbors) {
       //get matrices
@@ -132,31 +298,11 @@ namespace libfacerec {
       // zero
       dst.setTo(0);
       for (int n = 0; n<neighbors; n++) {
-        // sample points
-        float x = static_cast<float>(-radius) * sin(2.0f*(float)CV_PI*n / static_cast<float>(neighbors));
-        float y = static_cast<float>(radius)* cos(2.0f*(float)CV_PI*n / static_cast<float>(neighbors));
-        // relative indices
-        int fx = static_cast<int>(floor(x));
-        int fy = static_cast<int>(floor(y));
-        int cx = static_cast<int>(ceil(x));
-        int cy = static_cast<int>(ceil(y));
-        // fractional part
-        float ty = y - fy;
-        float tx = x - fx;
-        // set interpolation weights
-        float w1 = (1 - tx) * (1 - ty);
-        float w2 = tx  * (1 - ty);
-        float w3 = (1 - tx) *      ty;
-        float w4 = tx  *      ty;
+        // the weights are computed once per neighbor, not per pixel
+        ElbpSample p = elbp_sample(radius, n, neighbors);
         // iterate through your data
-        for (int i = radius; i < src.rows - radius; i++) {
-          for (int j = radius; j < src.cols - radius; j++) {
-            // calculate interpolated value
-            float t = static_cast<float>(w1*src.at<_Tp>(i + fy, j + fx) + w2*src.at<_Tp>(i + fy, j + cx) + w3*src.at<_Tp>(i + cy, j + fx) + w4*src.at<_Tp>(i + cy, j + cx));
-            // floating point precision, so check some machine-dependent epsilon
-            dst.at<int>(i - radius, j - radius) += ((t > src.at<_Tp>(i, j)) || (std::abs(t - src.at<_Tp>(i, j)) < std::numeric_limits<float>::epsilon())) << n;
-          }
-        }
+        for (int i = radius; i < src.rows - radius; i++)
+          elbp_row_<_Tp>(src, i, radius, p, n, dst.ptr<int>(i - radius));
       }
     }
 }
@@ -63,6 +63,8 @@ Modifer:liuruoze
 
 #include "opencv2/imgproc/imgproc_c.h"
 #include <limits>
+#include <exception>
+#include <functional>
 #include "mser2.hpp"
 
 namespace cv
@@ -109,6 +111,7 @@ namespace cv
         minMargin = _min_margin;
         edgeBlurSize = _edge_blur_size;
         pass2Only = false;
+        parallelPasses = true;
       }
 
 
@@ -123,6 +126,7 @@ namespace cv
       double maxVariation;
       double minDiversity;
       bool pass2Only;
+      bool parallelPasses;
 
       int maxEvolution;
       double areaThreshold;
@@ -146,6 +150,9 @@ namespace cv
     void setPass2Only(bool f) { params.pass2Only = f; }
     bool getPass2Only() const { return params.pass2Only; }
 
+    void setParallelPasses(bool f) { params.parallelPasses = f; }
+    bool getParallelPasses() const { return params.parallelPasses; }
+
     enum { DIR_SHIFT = 29, NEXT_MASK = ((1 << DIR_SHIFT) - 1) };
 
     struct Pixel
@@ -573,18 +580,58 @@ namespace cv
 
 
  
-    void preprocess1(const Mat& img, int* level_size)
+    // pixel, boundary heap and history storage of one polarity pass
+    struct PassBuffers
+    {
+      vector<Pixel> pixbuf;
+      vector<Pixel*> heapbuf;
+      vector<CompHistory> histbuf;
+    };
+
+    // kept per thread between calls, a new MSER2 per frame still finds
+    // its buffers sized for the resolution, and the two polarities have
+    // their own buffers so they can run at the same time
+    struct Workspace
+    {
+      PassBuffers passes[2];
+      Mat tempsrc;
+      Mat roisrc;
+    };
+
+    static Workspace& localWorkspace()
+    {
+      static thread_local Workspace workspace;
+      return workspace;
+    }
+
+    // gray level histogram of the image without its border
+    static void levelSizes(const Mat& img, int* level_size)
     {
       memset(level_size, 0, 256 * sizeof(level_size[0]));
 
+      int i, j, cols = img.cols, rows = img.rows;
+      for (i = 1; i < rows - 1; i++)
+      {
+        const uchar* imgptr = img.ptr(i);
+        for (j = 1; j < cols - 1; j++)
+          level_size[imgptr[j]]++;
+      }
+    }
+
+    // size the buffers for img, resize() keeps the memory when the
+    // resolution does not change, and mark every pixel unvisited but
+    // the border
+    static void preparePass(const Mat& img, PassBuffers& buf)
+    {
       int i, j, cols = img.cols, rows = img.rows;
       int step = cols;
-      pixbuf.resize(step*rows);
-      heapbuf.resize(cols*rows + 256);
-      histbuf.resize(cols*rows);
+      buf.pixbuf.resize(step*rows);
+      buf.heapbuf.resize(cols*rows + 256);
+      buf.histbuf.resize(cols*rows);
       Pixel borderpix;
       borderpix.setDir(5);
 
+      Pixel* pixbuf = &buf.pixbuf[0];
       for (j = 0; j < step; j++)
       {
         pixbuf[j] = pixbuf[j + (rows - 1)*step] = borderpix;
@@ -592,46 +639,60 @@ namespace cv
 
       for (i = 1; i < rows - 1; i++)
       {
-        const uchar* imgptr = img.ptr(i);
         Pixel* pptr = &pixbuf[i*step];
         pptr[0] = pptr[cols - 1] = borderpix;
         for (j = 1; j < cols - 1; j++)
-        {
-          int val = imgptr[j];
-          level_size[val]++;
           pptr[j].val = 0;
-        }
       }
     }
 
-    void preprocess2(const Mat& img, int* level_size)
+    // run both passes, on the opencv pool when allowed, so no thread is
+    // started per call and cv::setNumThreads bounds the threads
+    void runPasses(const std::function<void()>& first, const std::function<void()>& second, size_t npix)
     {
-      int i;
-
-      for (i = 0; i < 128; i++)
-        std::swap(level_size[i], level_size[255 - i]);
+      if (!first)
+      {
+        second();
+        return;
+      }
+      // below this handing a pass to the pool costs more than the pass
+      const size_t kParallelMinPixels = 64 * 64;
+      if (!params.parallelPasses || npix < kParallelMinPixels || getNumThreads() <= 1)
+      {
+        first();
+        second();
+        return;
+      }
 
-      if (!params.pass2Only)
+      std::exception_ptr errors[2];
+      parallel_for_(Range(0, 2), [&](const Range& range)
       {
-        int j, cols = img.cols, rows = img.rows;
-        int step = cols;
-        for (i = 1; i < rows - 1; i++)
+        for (int i = range.start; i < range.end; i++)
         {
-          Pixel* pptr = &pixbuf[i*step + 1];
-          for (j = 1; j < cols - 1; j++)
-          {
-            pptr[j].val = 0;
-          }
+          try { i == 0 ? first() : second(); }
+          catch (...) { errors[i] = std::current_exception(); }
         }
-      }
+      }, 2);
+      for (auto& error : errors)
+        if (error)
+          std::rethrow_exception(error);
+    }
+
+    // the source as one continuous 8 bit image, copied only when needed
+    static Mat continuousSource(const Mat& src, Mat& temp)
+    {
+      if (src.isContinuous())
+        return src;
+      src.copyTo(temp);
+      return temp;
     }
 
     void pass(const Mat& img, vector<vector<Point> >& msers, vector<Rect>& bboxvec,
-      Size size, const int* level_size, int mask)
+      Size size, const int* level_size, int mask, PassBuffers& buf) const
     {
-      CompHistory* histptr = &histbuf[0];
+      CompHistory* histptr = &buf.histbuf[0];
       int step = size.width;
-      Pixel *ptr0 = &pixbuf[0], *ptr = &ptr0[step + 1];
+      Pixel *ptr0 = &buf.pixbuf[0], *ptr = &ptr0[step + 1];
       const uchar* imgptr0 = img.ptr();
       Pixel** heap[256];
       ConnectedComp comp[257];
@@ -644,7 +705,7 @@ namespace cv
       wp.step = step;
       wp.similyThresh = 0.7f;
 
-      heap[0] = &heapbuf[0];
+      heap[0] = &buf.heapbuf[0];
       heap[0][0] = 0;
 
       for (int i = 1; i < 256; i++)
@@ -768,16 +829,15 @@ namespace cv
       }
     }
 
-    Mat tempsrc;
-    vector<Pixel> pixbuf;
-    vector<Pixel*> heapbuf;
-    vector<CompHistory> histbuf;
-    
     Params params;
 
     void detectRegions(InputArray _src, vector<vector<Point>>& msers_blue, vector<Rect>& bboxes_blue,
       vector<vector<Point>>& msers_yellow, vector<Rect>& bboxes_yellow);
 
+    void detectRegions(InputArray _src, const vector<Rect>& rois,
+      vector<vector<Point>>& msers_blue, vector<Rect>& bboxes_blue,
+      vector<vector<Point>>& msers_yellow, vector<Rect>& bboxes_yellow);
+
     void detectRegions(InputArray _src, vector<vector<Point>>& msers, vector<Rect>& bboxes, int type);
   };
 
@@ -790,21 +850,30 @@ namespace cv
 
     Size size = src.size();
     if (src.type() == CV_8U) {
-      int level_size[256];
-      if (!src.isContinuous()) {
-        src.copyTo(tempsrc);
-        src = tempsrc;
-      }
+      Workspace& ws = localWorkspace();
+      src = continuousSource(src, ws.tempsrc);
+
+      int level_size[256], level_size_inv[256];
+      levelSizes(src, level_size);
+      for (int i = 0; i < 256; i++)
+        level_size_inv[i] = level_size[255 - i];
 
       // darker to brighter (MSER+)
       // dont need when plate is blue
-      preprocess1(src, level_size);
+      std::function<void()> darkPass;
       if (!params.pass2Only)
-        pass(src, msers_yellow, bboxes_yellow, size, level_size, 0);
+        darkPass = [&]() {
+          preparePass(src, ws.passes[0]);
+          pass(src, msers_yellow, bboxes_yellow, size, level_size, 0, ws.passes[0]);
+        };
 
       // brighter to darker (MSER-)
-      preprocess2(src, level_size);
-      pass(src, msers_blue, bboxes_blue, size, level_size, 255);
+      auto brightPass = [&]() {
+        preparePass(src, ws.passes[1]);
+        pass(src, msers_blue, bboxes_blue, size, level_size_inv, 255, ws.passes[1]);
+      };
+
+      runPasses(darkPass, brightPass, npix);
     }
   }
 
@@ -816,21 +885,73 @@ namespace cv
 
     Size size = src.size();
     if (src.type() == CV_8U) {
-      int level_size[256];
-      if (!src.isContinuous()) {
-        src.copyTo(tempsrc);
-        src = tempsrc;
-      }
+      Workspace& ws = localWorkspace();
+      src = continuousSource(src, ws.tempsrc);
+
+      int level_size[256], level_size_inv[256];
+      levelSizes(src, level_size);
+      for (int i = 0; i < 256; i++)
+        level_size_inv[i] = level_size[255 - i];
 
       // darker to brighter (MSER+)
       // dont need when plate is blue
-      preprocess1(src, level_size);
-      if (type) 
-        pass(src, msers, bboxes, size, level_size, 0);
+      std::function<void()> darkPass;
+      if (type)
+        darkPass = [&]() {
+          preparePass(src, ws.passes[0]);
+          pass(src, msers, bboxes, size, level_size, 0, ws.passes[0]);
+        };
+
+      // brighter to darker (MSER-), kept aside so the output order stays
+      // dark regions first
+      vector<vector<Point> > brightMsers;
+      vector<Rect> brightBoxes;
+      auto brightPass = [&]() {
+        preparePass(src, ws.passes[1]);
+        pass(src, brightMsers, brightBoxes, size, level_size_inv, 255, ws.passes[1]);
+      };
+
+      runPasses(darkPass, brightPass, npix);
+
+      msers.insert(msers.end(), std::make_move_iterator(brightMsers.begin()),
+        std::make_move_iterator(brightMsers.end()));
+      bboxes.insert(bboxes.end(), brightBoxes.begin(), brightBoxes.end());
+    }
+  }
 
-      // brighter to darker (MSER-)
-      preprocess2(src, level_size);
-      pass(src, msers, bboxes, size, level_size, 255);
+  void MSER_Impl2::detectRegions(InputArray _src, const vector<Rect>& rois,
+    vector<vector<Point>>& msers_blue, vector<Rect>& bboxes_blue,
+    vector<vector<Point>>& msers_yellow, vector<Rect>& bboxes_yellow)
+  {
+    Mat src = _src.getMat();
+    Rect whole(0, 0, src.cols, src.rows);
+
+    for (size_t i = 0; i < rois.size(); i++)
+    {
+      Rect roi = rois[i] & whole;
+      // the pass needs at least one pixel inside the border
+      if (roi.width < 3 || roi.height < 3)
+        continue;
+
+      // a continuous copy of the roi, the passes index pixels by offset
+      Mat& roisrc = localWorkspace().roisrc;
+      src(roi).copyTo(roisrc);
+
+      size_t blue0 = msers_blue.size(), yellow0 = msers_yellow.size();
+      detectRegions(roisrc, msers_blue, bboxes_blue, msers_yellow, bboxes_yellow);
+
+      // back to the coordinates of src
+      Point offset = roi.tl();
+      for (size_t j = blue0; j < msers_blue.size(); j++)
+      {
+        for (auto& pt : msers_blue[j]) pt += offset;
+        bboxes_blue[j] += offset;
+      }
+      for (size_t j = yellow0; j < msers_yellow.size(); j++)
+      {
+        for (auto& pt : msers_yellow[j]) pt += offset;
+        bboxes_yellow[j] += offset;
+      }
     }
   }
 
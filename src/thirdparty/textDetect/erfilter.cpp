@@ -132,6 +132,10 @@ namespace cv
       int num_rejected_regions;
       int num_accepted_regions;
 
+      // classifier calls of the current run and their limit, 0 for none
+      int num_evaluations;
+      int max_evaluations;
+
     public:
 
       // set/get methods to set the algorithm properties,
@@ -143,6 +147,8 @@ namespace cv
       void setMinProbabilityDiff(float minProbabilityDiff);
       void setNonMaxSuppression(bool nonMaxSuppression);
       int  getNumRejected();
+      void setMaxEvaluations(int maxEvaluations);
+      int  getNumEvaluations();
 
     private:
       // pointer to the input/output regions vector
@@ -162,6 +168,10 @@ namespace cv
       ERStat* er_save(ERStat *er, ERStat *parent, ERStat *prev);
       // recursively walk the tree and filter (remove) regions using the callback classifier
       ERStat* er_tree_filter(InputArray image, ERStat *stat, ERStat *parent, ERStat *prev);
+      // compute the 2nd stage descriptors of a region
+      void er_nm2_descriptors(const Mat& src, ERStat *stat);
+      // whether the budget allows one more classifier call
+      bool er_can_evaluate() const;
       // recursively walk the tree selecting only regions with local maxima probability
       ERStat* er_tree_nonmax_suppression(ERStat *er, ERStat *parent, ERStat *prev);
     };
@@ -214,6 +224,8 @@ namespace cv
       minProbabilityDiff = 1.;
       num_accepted_regions = 0;
       num_rejected_regions = 0;
+      num_evaluations = 0;
+      max_evaluations = 0;
     }
 
     // the key method. Takes image on input, vector of ERStat is output for the first stage,
@@ -225,6 +237,7 @@ namespace cv
       CV_Assert(image.getMat().type() == CV_8UC1);
 
       regions = &_regions;
+      num_evaluations = 0;
       region_mask = Mat::zeros(image.getMat().rows + 2, image.getMat().cols + 2, CV_8UC1);
 
       // if regions vector is empty we must extract the entire component tree
@@ -672,16 +685,26 @@ namespace cv
       // recover the original grey-level
       child->level = child->level*thresholdDelta;
 
-      // before saving calculate P(child|character) and filter if possible
+      // the size checks are free, only a region that passes them is
+      // worth a classifier call
+      bool fits = (child->area >= (minArea*region_mask.rows*region_mask.cols)) &&
+        (child->area <= (maxArea*region_mask.rows*region_mask.cols)) &&
+        (child->rect.width > 2) && (child->rect.height > 2);
+
+      // before saving calculate P(child|character) and filter if possible,
+      // a region left over when the budget is spent counts as no character
       if (classifier != NULL)
       {
-        child->probability = classifier->eval(*child);
+        if (fits && er_can_evaluate())
+        {
+          child->probability = classifier->eval(*child);
+          num_evaluations++;
+        }
+        else
+          child->probability = 0.;
       }
 
-      if ((((classifier != NULL) ? (child->probability >= minProbability) : true) || (nonMaxSuppression)) &&
-        ((child->area >= (minArea*region_mask.rows*region_mask.cols)) &&
-        (child->area <= (maxArea*region_mask.rows*region_mask.cols)) &&
-        (child->rect.width > 2) && (child->rect.height > 2)))
+      if ((((classifier != NULL) ? (child->probability >= minProbability) : true) || (nonMaxSuppression)) && fits)
       {
 
         num_accepted_regions++;
@@ -795,6 +818,69 @@ namespace cv
       // assert correct image type
       CV_Assert(src.type() == CV_8UC1);
 
+      // the descriptors take a flood fill and a contour search, skip them
+      // for a region that is rejected anyway
+      bool fits = (stat->area >= minArea*region_mask.rows*region_mask.cols) &&
+        (stat->area <= maxArea*region_mask.rows*region_mask.cols);
+      bool evaluate = (classifier != NULL) && (stat->parent != NULL) && fits && er_can_evaluate();
+      if (evaluate || (stat->parent == NULL) || ((classifier == NULL) && fits))
+        er_nm2_descriptors(src, stat);
+
+      // calculate P(child|character) and filter if possible
+      if (evaluate)
+      {
+        stat->probability = classifier->eval(*stat);
+        num_evaluations++;
+      }
+      else if ((classifier != NULL) && (stat->parent != NULL))
+        stat->probability = 0.;
+
+      if ((((classifier != NULL) ? (stat->probability >= minProbability) : true) && fits) ||
+        (stat->parent == NULL))
+      {
+        num_accepted_regions++;
+        regions->push_back(*stat);
+
+        regions->back().parent = parent;
+        regions->back().next = NULL;
+        regions->back().child = NULL;
+
+        if (prev != NULL)
+          prev->next = &(regions->back());
+        else if (parent != NULL)
+          parent->child = &(regions->back());
+
+        ERStat *old_prev = NULL;
+        ERStat *this_er = &regions->back();
+
+        for (ERStat * child = stat->child; child; child = child->next)
+        {
+          old_prev = er_tree_filter(image, child, this_er, old_prev);
+        }
+
+        return this_er;
+
+      }
+      else {
+
+        num_rejected_regions++;
+
+        ERStat *old_prev = prev;
+
+        for (ERStat * child = stat->child; child; child = child->next)
+        {
+          old_prev = er_tree_filter(image, child, parent, old_prev);
+        }
+
+        return old_prev;
+      }
+
+    }
+
+    // compute the 2nd stage descriptors: hole area ratio, convex hull ratio
+    // and number of inflexion points
+    void ERFilterNM::er_nm2_descriptors(const Mat& src, ERStat *stat)
+    {
       //Fill the region and calculate 2nd stage features
       Mat region = region_mask(Rect(Point(stat->rect.x, stat->rect.y), Point(stat->rect.br().x + 2, stat->rect.br().y + 2)));
       region = Scalar(0);
@@ -867,57 +953,11 @@ namespace cv
       stat->hole_area_ratio = (float)holes_area / stat->area;
       stat->convex_hull_ratio = (float)hull_area / (float)contourArea(contours[0]);
       stat->num_inflexion_points = (float)num_inflexion_points;
+    }
 
-
-      // calculate P(child|character) and filter if possible
-      if ((classifier != NULL) && (stat->parent != NULL))
-      {
-        stat->probability = classifier->eval(*stat);
-      }
-
-      if ((((classifier != NULL) ? (stat->probability >= minProbability) : true) &&
-        ((stat->area >= minArea*region_mask.rows*region_mask.cols) &&
-        (stat->area <= maxArea*region_mask.rows*region_mask.cols))) ||
-        (stat->parent == NULL))
-      {
-
-        num_accepted_regions++;
-        regions->push_back(*stat);
-
-        regions->back().parent = parent;
-        regions->back().next = NULL;
-        regions->back().child = NULL;
-
-        if (prev != NULL)
-          prev->next = &(regions->back());
-        else if (parent != NULL)
-          parent->child = &(regions->back());
-
-        ERStat *old_prev = NULL;
-        ERStat *this_er = &regions->back();
-
-        for (ERStat * child = stat->child; child; child = child->next)
-        {
-          old_prev = er_tree_filter(image, child, this_er, old_prev);
-        }
-
-        return this_er;
-
-      }
-      else {
-
-        num_rejected_regions++;
-
-        ERStat *old_prev = prev;
-
-        for (ERStat * child = stat->child; child; child = child->next)
-        {
-          old_prev = er_tree_filter(image, child, parent, old_prev);
-        }
-
-        return old_prev;
-      }
-
+    bool ERFilterNM::er_can_evaluate() const
+    {
+      return (max_evaluations <= 0) || (num_evaluations < max_evaluations);
     }
 
     // recursively walk the tree selecting only regions with local maxima probability
@@ -1018,6 +1058,17 @@ namespace cv
       return num_rejected_regions;
     }
 
+    void ERFilterNM::setMaxEvaluations(int _maxEvaluations)
+    {
+      CV_Assert(_maxEvaluations >= 0);
+      max_evaluations = _maxEvaluations;
+    }
+
+    int ERFilterNM::getNumEvaluations()
+    {
+      return num_evaluations;
+    }
+
 
 
 
@@ -524,6 +524,41 @@ public:
    */
   char *GetUTF8Text();
 
+  /**
+   * Recognizes a single text line with the LSTM model alone, for small
+   * images that are one line already, like a cropped licence plate.
+   * The image is 8 bit grey, one byte per pixel, and is scaled to the
+   * height of the network. Thresholding, layout analysis and the PAGE_RES
+   * are skipped, and the image and results of SetImage/Recognize are left
+   * as they are. The black and white lists and tessedit_do_invert apply.
+   * If lstm_line_pattern is set, the beam search only follows paths that
+   * match it, and the text is empty if none does.
+   * text receives the UTF8 string. If not nullptr, confidences receives the
+   * confidence 0-100 of every character of text, and x_starts/x_ends its
+   * horizontal extent in pixels of the given image.
+   * Returns false without an LSTM model, if the image is too small or if
+   * lstm_line_pattern is malformed.
+   */
+  bool RecognizeLine(const unsigned char *imagedata, int width, int height,
+                     int bytes_per_line, std::string *text,
+                     std::vector<float> *confidences = nullptr,
+                     std::vector<int> *x_starts = nullptr,
+                     std::vector<int> *x_ends = nullptr);
+
+  /**
+   * As RecognizeLine for count lines at once, such as every plate found in
+   * a frame. The lines go through the network as a single batch, which is
+   * much faster than one call per line. Line i is imagedata[i] of
+   * widths[i] x heights[i] with bytes_per_lines[i], and its text goes to
+   * (*texts)[i], empty if the line is too small. If not nullptr,
+   * confidences receives the character confidences of every line.
+   * Returns false without an LSTM model or if no line could be read.
+   */
+  bool RecognizeLines(int count, const unsigned char *const *imagedata,
+                      const int *widths, const int *heights,
+                      const int *bytes_per_lines, std::vector<std::string> *texts,
+                      std::vector<std::vector<float>> *confidences = nullptr);
+
   /**
    * Make a HTML-formatted string with hOCR markup from the internal
    * data structures.
@@ -667,8 +702,8 @@ public:
 
   /**
    * Clear any library-level memory caches.
-   * There are a variety of expensive-to-load constant data structures (mostly
-   * language dictionaries) that are cached globally -- surviving the Init()
+   * There are a variety of expensive-to-load constant data structures (language
+   * dictionaries and lstm networks) that are cached globally -- surviving the Init()
    * and End() of individual TessBaseAPI's.  This function allows the clearing
    * of these caches.
    **/
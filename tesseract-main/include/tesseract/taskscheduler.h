@@ -0,0 +1,89 @@
+// SPDX-License-Identifier: Apache-2.0
+///////////////////////////////////////////////////////////////////////
+// File:        taskscheduler.h
+// Description: Runs the parallel parts of the LSTM recognizer.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+///////////////////////////////////////////////////////////////////////
+
+#ifndef TESSERACT_TASKSCHEDULER_H_
+#define TESSERACT_TASKSCHEDULER_H_
+
+#include "export.h"
+
+#include <functional> // for std::function
+#include <memory>     // for std::unique_ptr
+
+namespace tesseract {
+
+/**
+ * Runs the parts of the LSTM recognizer that can run at once: the gates of
+ * an LSTM timestep, the stacks of a Parallel layer, the timesteps of a
+ * FullyConnected layer, and the lines of TessBaseAPI::RecognizeLines.
+ *
+ * All recognizers of the process share one scheduler, so the application
+ * controls the total number of threads. In a build with OpenMP the default
+ * is a shared pool with one thread per core. Without OpenMP these parts
+ * always ran serial, and most calls are too small to pay for waking pool
+ * threads, so the default is Serial(); Set a pool from NewThreadPool to
+ * change that. An application that already runs a recognizer per worker
+ * thread can make each line serial, with Set(Serial()) or a SerialScope,
+ * and parallelize across lines itself, or set lstm_parallel_lines and a
+ * pool to have RecognizeLines do it.
+ */
+class TESS_API TaskScheduler {
+public:
+  virtual ~TaskScheduler();
+
+  /**
+   * Calls task(i) for every i in [0, count), and returns once all have
+   * returned. The calls may run at once, on any thread including the
+   * calling one, and in any order. task may call ParallelFor itself, and
+   * must not throw.
+   */
+  virtual void ParallelFor(int count, const std::function<void(int)> &task) = 0;
+
+  /**
+   * Returns the scheduler to use on the calling thread: the serial one
+   * inside a SerialScope, else the one given to Set, else the default:
+   * a pool started on first use with OpenMP, Serial() without.
+   */
+  static TaskScheduler *Get();
+  /**
+   * Sets the scheduler of all recognizers, or the default if nullptr.
+   * The scheduler is borrowed and must outlive its use. Don't call while
+   * any recognizer is running.
+   */
+  static void Set(TaskScheduler *scheduler);
+  /** Returns a scheduler that runs the tasks in turn on the calling thread. */
+  static TaskScheduler *Serial();
+  /**
+   * Returns a new work-stealing pool with num_threads threads, counting
+   * the thread that calls ParallelFor, or one per core if num_threads <= 0.
+   */
+  static std::unique_ptr<TaskScheduler> NewThreadPool(int num_threads);
+
+  /**
+   * While alive, makes Get() return Serial() on the thread that made it,
+   * such as a thread that recognizes a whole line by itself.
+   */
+  class TESS_API SerialScope {
+  public:
+    SerialScope();
+    ~SerialScope();
+    SerialScope(const SerialScope &) = delete;
+    SerialScope &operator=(const SerialScope &) = delete;
+  };
+};
+
+} // namespace tesseract.
+
+#endif // TESSERACT_TASKSCHEDULER_H_
@@ -36,6 +36,7 @@
 #include "helpers.h" // for IntCastRounded, chomp_string, copy_string
 #include "host.h"    // for MAX_PATH
 #include "imageio.h" // for IFF_TIFF_G4, IFF_TIFF, IFF_TIFF_G3, ...
+#include "lstmrecognizer.h" // for LSTMRecognizer
 #ifndef DISABLED_LEGACY_ENGINE
 #  include "intfx.h" // for INT_FX_RESULT_STRUCT
 #endif
@@ -333,6 +334,8 @@ int TessBaseAPI::Init(const char *data, int data_size, const char *language, Ocr
       reader_ = reader;
     }
     TessdataManager mgr(reader_);
+    // The traineddata is only read while loading, so it can be mapped.
+    mgr.set_map_file(true);
     if (data_size != 0) {
       mgr.LoadMemBuffer(language, data, data_size);
     }
@@ -1332,6 +1335,99 @@ char *TessBaseAPI::GetUTF8Text() {
   return copy_string(text);
 }
 
+// Appends the text of the unichar_ids of an LSTM line to text, and if not
+// nullptr the confidence and x-range of each character.
+static void LineResultToText(const UNICHARSET &unicharset, const std::vector<int> &unichar_ids,
+                             const std::vector<float> &certs, const std::vector<int> &xcoords,
+                             std::string *text, std::vector<float> *confidences,
+                             std::vector<int> *x_starts, std::vector<int> *x_ends) {
+  for (size_t i = 0; i < unichar_ids.size(); ++i) {
+    text->append(unicharset.id_to_unichar_ext(unichar_ids[i]));
+    // The same mapping from certainty as LTRResultIterator::Confidence.
+    if (confidences != nullptr) {
+      confidences->push_back(ClipToRange(100 + 5 * certs[i], 0.0f, 100.0f));
+    }
+    if (x_starts != nullptr) {
+      x_starts->push_back(xcoords[i]);
+    }
+    if (x_ends != nullptr) {
+      x_ends->push_back(xcoords[i + 1]);
+    }
+  }
+}
+
+/** Recognize a single grey line with the LSTM model, bypassing the page. */
+bool TessBaseAPI::RecognizeLine(const unsigned char *imagedata, int width, int height,
+                                int bytes_per_line, std::string *text,
+                                std::vector<float> *confidences, std::vector<int> *x_starts,
+                                std::vector<int> *x_ends) {
+  if (tesseract_ == nullptr || tesseract_->lstm_recognizer() == nullptr) {
+    return false;
+  }
+  LSTMRecognizer *recognizer = tesseract_->lstm_recognizer();
+  tesseract_->SetBlackAndWhitelist();
+  if (!recognizer->SetLabelPattern(tesseract_->lstm_line_pattern)) {
+    return false;
+  }
+  float threshold = tesseract_->tessedit_do_invert ? double(tesseract_->invert_threshold) : 0.0f;
+  std::vector<int> unichar_ids;
+  std::vector<float> certs;
+  std::vector<int> xcoords;
+  if (!recognizer->RecognizeGreyLine(imagedata, width, height, bytes_per_line, threshold,
+                                     &unichar_ids, &certs, &xcoords)) {
+    return false;
+  }
+
+  text->clear();
+  if (confidences != nullptr) {
+    confidences->clear();
+  }
+  if (x_starts != nullptr) {
+    x_starts->clear();
+  }
+  if (x_ends != nullptr) {
+    x_ends->clear();
+  }
+  LineResultToText(recognizer->GetUnicharset(), unichar_ids, certs, xcoords, text, confidences,
+                   x_starts, x_ends);
+  return true;
+}
+
+/** Recognize a batch of grey lines with the LSTM model in one forward pass. */
+bool TessBaseAPI::RecognizeLines(int count, const unsigned char *const *imagedata,
+                                 const int *widths, const int *heights,
+                                 const int *bytes_per_lines, std::vector<std::string> *texts,
+                                 std::vector<std::vector<float>> *confidences) {
+  if (tesseract_ == nullptr || tesseract_->lstm_recognizer() == nullptr || count <= 0) {
+    return false;
+  }
+  LSTMRecognizer *recognizer = tesseract_->lstm_recognizer();
+  tesseract_->SetBlackAndWhitelist();
+  if (!recognizer->SetLabelPattern(tesseract_->lstm_line_pattern)) {
+    return false;
+  }
+  float threshold = tesseract_->tessedit_do_invert ? double(tesseract_->invert_threshold) : 0.0f;
+  std::vector<GreyImage> lines;
+  for (int i = 0; i < count; ++i) {
+    lines.push_back(GreyImage{imagedata[i], widths[i], heights[i], bytes_per_lines[i]});
+  }
+  std::vector<std::vector<int>> unichar_ids, xcoords;
+  std::vector<std::vector<float>> certs;
+  recognizer->set_parallel_lines(tesseract_->lstm_parallel_lines);
+  bool result = recognizer->RecognizeGreyLines(lines, threshold, &unichar_ids, &certs, &xcoords);
+
+  texts->assign(count, std::string());
+  if (confidences != nullptr) {
+    confidences->assign(count, std::vector<float>());
+  }
+  for (int i = 0; i < count; ++i) {
+    LineResultToText(recognizer->GetUnicharset(), unichar_ids[i], certs[i], xcoords[i],
+                     &(*texts)[i], confidences != nullptr ? &(*confidences)[i] : nullptr,
+                     nullptr, nullptr);
+  }
+  return result;
+}
+
 static void AddBoxToTSV(const PageIterator *it, PageIteratorLevel level, std::string &text) {
   int left, top, right, bottom;
   it->BoundingBox(level, &left, &top, &right, &bottom);
@@ -1887,12 +1983,13 @@ void TessBaseAPI::End() {
 }
 
 // Clear any library-level memory caches.
-// There are a variety of expensive-to-load constant data structures (mostly
-// language dictionaries) that are cached globally -- surviving the Init()
+// There are a variety of expensive-to-load constant data structures (language
+// dictionaries and lstm networks) that are cached globally -- surviving the Init()
 // and End() of individual TessBaseAPI's.  This function allows the clearing
 // of these caches.
 void TessBaseAPI::ClearPersistentCache() {
   Dict::GlobalDawgCache()->DeleteUnusedDawgs();
+  LSTMRecognizer::DeleteUnusedSharedModels();
 }
 
 /**
@@ -2108,6 +2205,7 @@ int TessBaseAPI::FindLines() {
     } else {
       osd_tesseract_ = new Tesseract;
       TessdataManager mgr(reader_);
+      mgr.set_map_file(true);
       if (datapath_.empty()) {
         tprintf(
             "Warning: Auto orientation and script detection requested,"
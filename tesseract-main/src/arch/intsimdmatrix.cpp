@@ -19,6 +19,8 @@
 #include "matrix.h"     // for GENERIC_2D_ARRAY
 #include "simddetect.h" // for SIMDDetect
 
+#include <cstring> // for memcpy
+
 namespace tesseract {
 
 const IntSimdMatrix *IntSimdMatrix::intSimdMatrix = nullptr;
@@ -32,7 +34,8 @@ void IntSimdMatrix::Init(const GENERIC_2D_ARRAY<int8_t> &w, std::vector<int8_t>
   int rounded_num_in = Roundup(num_in, num_inputs_per_group_);
   rounded_num_out = RoundOutputs(num_out);
   // Add the bias and compute the required size.
-  shaped_w.resize((rounded_num_in + 1) * rounded_num_out, 0);
+  int bias_size = unsigned_inputs_ ? sizeof(int32_t) : 1;
+  shaped_w.resize((rounded_num_in + bias_size) * rounded_num_out, 0);
   int shaped_index = 0;
   int output = 0;
   // Each number of registers needs a different format! Iterates over the
@@ -60,11 +63,23 @@ void IntSimdMatrix::Init(const GENERIC_2D_ARRAY<int8_t> &w, std::vector<int8_t>
       }
       // Append the bias weights for the register set.
       for (int j = 0; j < num_outputs_per_register_set; ++j) {
-        int8_t weight = 0;
-        if (output + j < num_out) {
-          weight = w(output + j, num_in);
+        if (unsigned_inputs_) {
+          int32_t offset = 0;
+          if (output + j < num_out) {
+            offset = w(output + j, num_in) * INT8_MAX;
+            for (int i = 0; i < num_in; ++i) {
+              offset -= 128 * w(output + j, i);
+            }
+          }
+          memcpy(&shaped_w[shaped_index], &offset, sizeof(offset));
+          shaped_index += sizeof(offset);
+        } else {
+          int8_t weight = 0;
+          if (output + j < num_out) {
+            weight = w(output + j, num_in);
+          }
+          shaped_w[shaped_index++] = weight;
         }
-        shaped_w[shaped_index++] = weight;
       }
       output += num_outputs_per_register_set;
     }
@@ -116,4 +131,36 @@ void IntSimdMatrix::MatrixDotVector(const GENERIC_2D_ARRAY<int8_t> &w,
   }
 }
 
+void IntSimdMatrix::MatrixDotVectors(const GENERIC_2D_ARRAY<int8_t> &w,
+                                     const std::vector<TFloat> &scales, int num_vectors,
+                                     const int8_t *const *u, TFloat *const *v) {
+  int num_out = w.dim1();
+  int num_in = w.dim2() - 1;
+  for (int i = 0; i < num_out; ++i) {
+    const int8_t *wi = w[i];
+    // Two inputs at a time share each load of the weights.
+    int k;
+    for (k = 0; k + 1 < num_vectors; k += 2) {
+      const int8_t *u0 = u[k];
+      const int8_t *u1 = u[k + 1];
+      int total0 = 0;
+      int total1 = 0;
+      for (int j = 0; j < num_in; ++j) {
+        total0 += wi[j] * u0[j];
+        total1 += wi[j] * u1[j];
+      }
+      v[k][i] = (total0 + wi[num_in] * INT8_MAX) * scales[i];
+      v[k + 1][i] = (total1 + wi[num_in] * INT8_MAX) * scales[i];
+    }
+    if (k < num_vectors) {
+      const int8_t *u0 = u[k];
+      int total = 0;
+      for (int j = 0; j < num_in; ++j) {
+        total += wi[j] * u0[j];
+      }
+      v[k][i] = (total + wi[num_in] * INT8_MAX) * scales[i];
+    }
+  }
+}
+
 } // namespace tesseract
@@ -82,6 +82,10 @@ struct TESS_API IntSimdMatrix {
   // Computes the base C++ implementation.
   static void MatrixDotVector(const GENERIC_2D_ARRAY<int8_t> &w, const std::vector<TFloat> &scales,
                               const int8_t *u, TFloat *v);
+  // As MatrixDotVector, for num_vectors inputs: v[k] = Wu[k]. Each row of W
+  // is used for all the inputs before moving on to the next.
+  static void MatrixDotVectors(const GENERIC_2D_ARRAY<int8_t> &w, const std::vector<TFloat> &scales,
+                               int num_vectors, const int8_t *const *u, TFloat *const *v);
 
   // Rounds the input up to a multiple of the given factor.
   static int Roundup(int input, int factor) {
@@ -111,6 +115,19 @@ struct TESS_API IntSimdMatrix {
   int num_inputs_per_group_;
   // Number of groups of inputs to be broadcast.
   // num_input_groups_ = num_inputs_per_register_ / num_inputs_per_group_
+  // If true, the function adds 128 to the inputs to make them unsigned, as
+  // needed by vpdpbusd, and Init() stores in place of the int8_t biases of
+  // each register set an int32_t per output of bias * INT8_MAX - 128 * the
+  // sum of its weights, which corrects for it.
+  bool unsigned_inputs_;
+
+  // As matrixDotVectorFunction, for num_vectors inputs: v[k] = Wu[k]. Each
+  // block of shaped weights is loaded once for several inputs. Null when
+  // the implementation has none, then matrixDotVectorFunction is called
+  // for each input.
+  using MatrixDotVectorsFunction = void (*)(int, int, const int8_t *, const TFloat *, int,
+                                            const int8_t *const *, TFloat *const *);
+  MatrixDotVectorsFunction matrixDotVectorsFunction;
 
   static const IntSimdMatrix *intSimdMatrix;
   // Only available with NEON.
@@ -120,6 +137,8 @@ struct TESS_API IntSimdMatrix {
   // Only available with AVX2 / AVX / FMA / SSE.
   static const IntSimdMatrix intSimdMatrixAVX2;
   static const IntSimdMatrix intSimdMatrixSSE;
+  // Only available with AVX512 VNNI.
+  static const IntSimdMatrix intSimdMatrixAVX512VNNI;
 };
 
 } // namespace tesseract
@@ -575,6 +575,154 @@ static void matrixDotVector(int dim1, int dim2, const int8_t *wi, const double *
 }
 #endif
 
+// As MultiplyGroup, for two inputs: the block of weights at wi is loaded
+// once, and the sign of the weights is moved to each input.
+static inline void MultiplyGroupPair(const __m256i &rep_input0, const __m256i &rep_input1,
+                                     const __m256i &ones, const int8_t *wi, __m256i &result0,
+                                     __m256i &result1) {
+  __m256i weights = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(wi));
+  __m256i reps0 = _mm256_sign_epi8(rep_input0, weights);
+  __m256i reps1 = _mm256_sign_epi8(rep_input1, weights);
+  weights = _mm256_sign_epi8(weights, weights);
+  reps0 = _mm256_madd_epi16(_mm256_maddubs_epi16(weights, reps0), ones);
+  reps1 = _mm256_madd_epi16(_mm256_maddubs_epi16(weights, reps1), ones);
+  result0 = _mm256_add_epi32(result0, reps0);
+  result1 = _mm256_add_epi32(result1, reps1);
+}
+
+// Computes part of matrix.vector v = Wu for two inputs u0 and u1 at once:
+// 8 * kNumRegisters results of the group of group_size outputs at wi,
+// starting at register first. Each block of weights is loaded once and
+// multiplied by both inputs, and the results are the same as those of
+// the single input functions above. wi, scales, v0 and v1 point at the
+// start of the group, and the weights are arranged as there.
+template <int kNumRegisters>
+static void PartialMatrixDotVectorsPair(const int8_t *wi, int group_size, int first,
+                                        const TFloat *scales, const int8_t *u0,
+                                        const int8_t *u1, int num_in, TFloat *v0, TFloat *v1) {
+  // The biases of the group follow all its weights.
+  const int8_t *bias = wi + num_in * group_size + first * kNumOutputsPerRegister;
+  // The registers of one input group are together, the next input group
+  // is a whole group of blocks further on.
+  const int w_stride = group_size * kNumInputsPerGroup;
+  wi += first * kNumInputsPerRegister;
+  scales += first * kNumOutputsPerRegister;
+  v0 += first * kNumOutputsPerRegister;
+  v1 += first * kNumOutputsPerRegister;
+
+  __m256i ones = _mm256_set_epi16(1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1);
+  __m256i shift_id = _mm256_set_epi32(0, 7, 6, 5, 4, 3, 2, 1);
+  // The results of u0, then of u1, named so they stay in registers.
+  __m256i result00 = _mm256_setzero_si256();
+  __m256i result01 = _mm256_setzero_si256();
+  __m256i result02 = _mm256_setzero_si256();
+  __m256i result03 = _mm256_setzero_si256();
+  __m256i result10 = _mm256_setzero_si256();
+  __m256i result11 = _mm256_setzero_si256();
+  __m256i result12 = _mm256_setzero_si256();
+  __m256i result13 = _mm256_setzero_si256();
+  for (int j = 0; j < num_in;) {
+    __m256i inputs0 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(u0 + j));
+    __m256i inputs1 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(u1 + j));
+    for (int ig = 0; ig < kNumInputGroups && j < num_in;
+         ++ig, j += kNumInputsPerGroup, wi += w_stride) {
+      __m256i rep_input0 = _mm256_broadcastd_epi32(_mm256_castsi256_si128(inputs0));
+      __m256i rep_input1 = _mm256_broadcastd_epi32(_mm256_castsi256_si128(inputs1));
+      inputs0 = _mm256_permutevar8x32_epi32(inputs0, shift_id);
+      inputs1 = _mm256_permutevar8x32_epi32(inputs1, shift_id);
+      MultiplyGroupPair(rep_input0, rep_input1, ones, wi, result00, result10);
+      if constexpr (kNumRegisters > 1) {
+        MultiplyGroupPair(rep_input0, rep_input1, ones, wi + kNumInputsPerRegister, result01,
+                          result11);
+      }
+      if constexpr (kNumRegisters > 2) {
+        MultiplyGroupPair(rep_input0, rep_input1, ones, wi + 2 * kNumInputsPerRegister,
+                          result02, result12);
+        MultiplyGroupPair(rep_input0, rep_input1, ones, wi + 3 * kNumInputsPerRegister,
+                          result03, result13);
+      }
+    }
+  }
+  if constexpr (kNumRegisters == 1) {
+    ExtractResults8(result00, bias, scales, v0);
+    ExtractResults8(result10, bias, scales, v1);
+  } else {
+    // ExtractResults16 advances its pointers, both inputs start alike.
+    const int8_t *bias1 = bias;
+    const TFloat *scales1 = scales;
+    ExtractResults16(result00, result01, bias, scales, v0);
+    ExtractResults16(result10, result11, bias1, scales1, v1);
+    if constexpr (kNumRegisters > 2) {
+      ExtractResults16(result02, result03, bias, scales, v0);
+      ExtractResults16(result12, result13, bias1, scales1, v1);
+    }
+  }
+}
+
+// As matrixDotVector, for num_vectors inputs. The inputs go in pairs, so
+// each weight block is loaded half as often, and a last odd input goes
+// through matrixDotVector. Two inputs of the full group of 8 registers
+// would need more than the 16 ymm registers, so it is done in halves of 4.
+static void matrixDotVectors(int dim1, int dim2, const int8_t *wi, const TFloat *scales,
+                             int num_vectors, const int8_t *const *u, TFloat *const *v) {
+  const int num_out = dim1;
+  const int num_in = dim2 - 1;
+  const int rounded_num_in = IntSimdMatrix::Roundup(num_in, kNumInputsPerGroup);
+  const int rounded_num_out = IntSimdMatrix::Roundup(num_out, kNumOutputsPerRegister);
+  const int kHalfRegisters = kMaxOutputRegisters / 2;
+
+  int k = 0;
+  for (; k + 1 < num_vectors; k += 2) {
+    const int8_t *w = wi;
+    const TFloat *s = scales;
+    TFloat *v0 = v[k];
+    TFloat *v1 = v[k + 1];
+    int group_size = kNumOutputsPerRegister * kMaxOutputRegisters;
+    int output = 0;
+    for (; output + group_size <= rounded_num_out; output += group_size) {
+      PartialMatrixDotVectorsPair<kHalfRegisters>(w, group_size, 0, s, u[k], u[k + 1],
+                                                  rounded_num_in, v0, v1);
+      PartialMatrixDotVectorsPair<kHalfRegisters>(w, group_size, kHalfRegisters, s, u[k],
+                                                  u[k + 1], rounded_num_in, v0, v1);
+      w += (rounded_num_in + 1) * group_size;
+      s += group_size;
+      v0 += group_size;
+      v1 += group_size;
+    }
+    group_size /= 2;
+
+    if (output + group_size <= rounded_num_out) {
+      PartialMatrixDotVectorsPair<kHalfRegisters>(w, group_size, 0, s, u[k], u[k + 1],
+                                                  rounded_num_in, v0, v1);
+      w += (rounded_num_in + 1) * group_size;
+      s += group_size;
+      v0 += group_size;
+      v1 += group_size;
+      output += group_size;
+    }
+    group_size /= 2;
+
+    if (output + group_size <= rounded_num_out) {
+      PartialMatrixDotVectorsPair<kMaxOutputRegisters / 4>(w, group_size, 0, s, u[k], u[k + 1],
+                                                           rounded_num_in, v0, v1);
+      w += (rounded_num_in + 1) * group_size;
+      s += group_size;
+      v0 += group_size;
+      v1 += group_size;
+      output += group_size;
+    }
+    group_size /= 2;
+
+    if (output + group_size <= rounded_num_out) {
+      PartialMatrixDotVectorsPair<kMaxOutputRegisters / 8>(w, group_size, 0, s, u[k], u[k + 1],
+                                                           rounded_num_in, v0, v1);
+    }
+  }
+  if (k < num_vectors) {
+    matrixDotVector(dim1, dim2, wi, scales, u[k], v[k]);
+  }
+}
+
 const IntSimdMatrix IntSimdMatrix::intSimdMatrixAVX2 = {
     // Function.
     matrixDotVector,
@@ -585,7 +733,11 @@ const IntSimdMatrix IntSimdMatrix::intSimdMatrixAVX2 = {
     // Number of 8 bit inputs in the inputs register.
     kNumInputsPerRegister,
     // Number of inputs in each weight group.
-    kNumInputsPerGroup
+    kNumInputsPerGroup,
+    // The inputs are signed.
+    false,
+    // Function for several inputs.
+    matrixDotVectors
 };
 
 } // namespace tesseract.
@@ -0,0 +1,208 @@
+///////////////////////////////////////////////////////////////////////
+// File:        intsimdmatrixavx512vnni.cpp
+// Description: matrix-vector product for 8-bit data on avx512 vnni.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+///////////////////////////////////////////////////////////////////////
+
+#include "intsimdmatrix.h"
+
+#if !defined(__AVX512VNNI__) || !defined(__AVX512F__)
+#  if defined(__i686__) || defined(__x86_64__)
+#    error Implementation only for AVX512 VNNI capable architectures
+#  endif
+#else
+#  include <immintrin.h>
+#  include <cstdint>
+#  include <cstring>
+
+namespace tesseract {
+
+// Number of outputs held in each register. 16 x 32 bit ints.
+constexpr int kNumOutputsPerRegister = 16;
+// Maximum number of registers that we will use.
+constexpr int kMaxOutputRegisters = 8;
+// Number of inputs in the inputs register.
+constexpr int kNumInputsPerRegister = 64;
+// Number of inputs in each weight group.
+constexpr int kNumInputsPerGroup = 4;
+
+// The weights are shaped by IntSimdMatrix::Init as for AVX2, with 16
+// outputs per register: each 64 byte load holds 4 consecutive weights for
+// each of 16 outputs, which is exactly the operand of vpdpbusd. vpdpbusd
+// multiplies unsigned by signed bytes, so 128 is added to the inputs, and
+// the int32_t offsets that Init stores in place of the biases take it off
+// again, with the bias added, for each output.
+
+// Adds the offsets at wi to the num_registers results, converts them to
+// TFloat, scales them and writes them to v. wi, scales and v are advanced.
+template <int kNumRegisters>
+static inline void ExtractResults(const __m512i *results, const int8_t *&wi, const TFloat *&scales,
+                                  TFloat *&v) {
+  for (int r = 0; r < kNumRegisters; ++r) {
+    __m512i offsets = _mm512_loadu_si512(wi);
+    __m512i result = _mm512_add_epi32(results[r], offsets);
+#  if defined(FAST_FLOAT)
+    __m512 res = _mm512_cvtepi32_ps(result);
+    res = _mm512_mul_ps(res, _mm512_loadu_ps(scales));
+    _mm512_storeu_ps(v, res);
+#  else
+    __m512d res_low = _mm512_cvtepi32_pd(_mm512_castsi512_si256(result));
+    __m512d res_high = _mm512_cvtepi32_pd(_mm512_extracti64x4_epi64(result, 1));
+    res_low = _mm512_mul_pd(res_low, _mm512_loadu_pd(scales));
+    res_high = _mm512_mul_pd(res_high, _mm512_loadu_pd(scales + 8));
+    _mm512_storeu_pd(v, res_low);
+    _mm512_storeu_pd(v + 8, res_high);
+#  endif
+    wi += kNumOutputsPerRegister * sizeof(int32_t);
+    scales += kNumOutputsPerRegister;
+    v += kNumOutputsPerRegister;
+  }
+}
+
+// Computes part of matrix.vector v[k] = Wu[k] for kNumVectors inputs.
+// Computes N=16*kNumRegisters results for each of them, starting at output.
+// The weights *must* be arranged so that consecutive reads from wi
+// provides (num_in/kNumInputsPerGroup groups of (N output dim groups of
+// (kNumInputsPerGroup inputs))). After that there must be N consecutive
+// int32_t offsets, before continuing with any more weights.
+// num_in is a multiple of kNumInputsPerGroup, and u must be readable up to
+// num_in. The values beyond the true number of inputs meet zero weights.
+// Each block of weights is loaded once for all the inputs.
+template <int kNumRegisters, int kNumVectors>
+static void PartialMatrixDotVectors(const int8_t *wi, const TFloat *scales,
+                                    const int8_t *const *u, int num_in, TFloat *const *v,
+                                    int output) {
+  // Flips the sign bit of each byte, which adds 128 to a signed byte as
+  // seen as an unsigned one.
+  const int32_t kSignFlip = static_cast<int32_t>(0x80808080u);
+  __m512i results[kNumVectors][kNumRegisters];
+  for (auto &vector_results : results) {
+    for (auto &result : vector_results) {
+      result = _mm512_setzero_si512();
+    }
+  }
+  for (int j = 0; j < num_in; j += kNumInputsPerGroup) {
+    // The 4 inputs, made unsigned, in each of the 16 lanes.
+    __m512i rep_inputs[kNumVectors];
+    for (int k = 0; k < kNumVectors; ++k) {
+      int32_t group;
+      memcpy(&group, u[k] + j, sizeof(group));
+      rep_inputs[k] = _mm512_set1_epi32(group ^ kSignFlip);
+    }
+    for (int r = 0; r < kNumRegisters; ++r) {
+      __m512i weights = _mm512_loadu_si512(wi);
+      wi += kNumInputsPerRegister;
+      // Multiply 4 unsigned inputs by 4 signed weights and add all 4 to
+      // the 32 bit result, for each of the 16 outputs.
+      for (int k = 0; k < kNumVectors; ++k) {
+        results[k][r] = _mm512_dpbusd_epi32(results[k][r], rep_inputs[k], weights);
+      }
+    }
+  }
+  for (int k = 0; k < kNumVectors; ++k) {
+    // ExtractResults advances its pointers, every input starts alike.
+    const int8_t *offsets = wi;
+    const TFloat *vector_scales = scales;
+    TFloat *vector_v = v[k] + output;
+    ExtractResults<kNumRegisters>(results[k], offsets, vector_scales, vector_v);
+  }
+}
+
+// Computes v[k] = Wu[k] for kNumVectors inputs, see matrixDotVector.
+template <int kNumVectors>
+static void MatrixDotVectorsN(int dim1, int dim2, const int8_t *wi, const TFloat *scales,
+                              const int8_t *const *u, TFloat *const *v) {
+  const int num_out = dim1;
+  const int num_in = dim2 - 1;
+  // Each call to a partial function produces group_size outputs, except the
+  // last one, which can produce less.
+  const int rounded_num_in = IntSimdMatrix::Roundup(num_in, kNumInputsPerGroup);
+  const int rounded_num_out = IntSimdMatrix::Roundup(num_out, kNumOutputsPerRegister);
+  int group_size = kNumOutputsPerRegister * kMaxOutputRegisters;
+  int output = 0;
+
+  int w_step = (rounded_num_in + sizeof(int32_t)) * group_size;
+
+  // Run with this group size, until it would produce too much output, then
+  // switch to a smaller size.
+  for (; output + group_size <= rounded_num_out; output += group_size) {
+    PartialMatrixDotVectors<kMaxOutputRegisters, kNumVectors>(wi, scales, u, rounded_num_in, v,
+                                                              output);
+    wi += w_step;
+    scales += group_size;
+  }
+  group_size /= 2;
+  w_step /= 2;
+
+  if (output + group_size <= rounded_num_out) {
+    PartialMatrixDotVectors<kMaxOutputRegisters / 2, kNumVectors>(wi, scales, u, rounded_num_in,
+                                                                  v, output);
+    wi += w_step;
+    scales += group_size;
+    output += group_size;
+  }
+  group_size /= 2;
+  w_step /= 2;
+
+  if (output + group_size <= rounded_num_out) {
+    PartialMatrixDotVectors<kMaxOutputRegisters / 4, kNumVectors>(wi, scales, u, rounded_num_in,
+                                                                  v, output);
+    wi += w_step;
+    scales += group_size;
+    output += group_size;
+  }
+  group_size /= 2;
+
+  if (output + group_size <= rounded_num_out) {
+    PartialMatrixDotVectors<kMaxOutputRegisters / 8, kNumVectors>(wi, scales, u, rounded_num_in,
+                                                                  v, output);
+  }
+}
+
+static void matrixDotVector(int dim1, int dim2, const int8_t *wi, const TFloat *scales,
+                            const int8_t *u, TFloat *v) {
+  MatrixDotVectorsN<1>(dim1, dim2, wi, scales, &u, &v);
+}
+
+// Two inputs at a time: 2x8 results and the weights fit in the 32 zmm
+// registers.
+static void matrixDotVectors(int dim1, int dim2, const int8_t *wi, const TFloat *scales,
+                             int num_vectors, const int8_t *const *u, TFloat *const *v) {
+  int k = 0;
+  for (; k + 1 < num_vectors; k += 2) {
+    MatrixDotVectorsN<2>(dim1, dim2, wi, scales, u + k, v + k);
+  }
+  if (k < num_vectors) {
+    MatrixDotVectorsN<1>(dim1, dim2, wi, scales, u + k, v + k);
+  }
+}
+
+const IntSimdMatrix IntSimdMatrix::intSimdMatrixAVX512VNNI = {
+    // Function.
+    matrixDotVector,
+    // Number of 32 bit outputs held in each register.
+    kNumOutputsPerRegister,
+    // Maximum number of registers that we will use to hold outputs.
+    kMaxOutputRegisters,
+    // Number of 8 bit inputs in the inputs register.
+    kNumInputsPerRegister,
+    // Number of inputs in each weight group.
+    kNumInputsPerGroup,
+    // The inputs are made unsigned for vpdpbusd.
+    true,
+    // Function for several inputs.
+    matrixDotVectors
+};
+
+} // namespace tesseract.
+
+#endif
@@ -253,6 +253,11 @@ SIMDDetect::SIMDDetect() {
   // Select code for calculation of dot product based on autodetection.
   if (false) {
     // This is a dummy to support conditional compilation.
+#if defined(HAVE_AVX512VNNI)
+  } else if (avx512F_available_ && avx512VNNI_available_) {
+    // AVX512 VNNI detected.
+    SetDotProduct(DotProductAVX512F, &IntSimdMatrix::intSimdMatrixAVX512VNNI);
+#endif
 #if defined(HAVE_AVX512F)
   } else if (avx512F_available_) {
     // AVX512F detected.
@@ -306,6 +311,12 @@ void SIMDDetect::Update() {
     // Native optimized code selected by config variable.
     SetDotProduct(DotProductNative, IntSimdMatrix::intSimdMatrix);
     dotproduct_method = "native";
+#if defined(HAVE_AVX512VNNI)
+  } else if (dotproduct == "avx512vnni") {
+    // AVX512 VNNI selected by config variable.
+    SetDotProduct(DotProductAVX512F, &IntSimdMatrix::intSimdMatrixAVX512VNNI);
+    dotproduct_method = "avx512vnni";
+#endif
 #if defined(HAVE_AVX2)
   } else if (dotproduct == "avx2") {
     // AVX2 selected by config variable.
@@ -350,6 +361,9 @@ void SIMDDetect::Update() {
             dotproduct.c_str());
     tprintf(
         "Supported values for dotproduct: auto generic native"
+#if defined(HAVE_AVX512VNNI)
+        " avx512vnni"
+#endif
 #if defined(HAVE_AVX2)
         " avx2"
 #endif
@@ -170,7 +170,12 @@ bool Tesseract::init_tesseract_lang_data(const std::string &arg0,
 #endif // ndef DISABLED_LEGACY_ENGINE
     if (mgr->IsComponentAvailable(TESSDATA_LSTM)) {
       lstm_recognizer_ = new LSTMRecognizer(language_data_path_prefix.c_str());
-      ASSERT_HOST(lstm_recognizer_->Load(this->params(), lstm_use_matrix ? language : "", mgr));
+      std::string lstm_lang = lstm_use_matrix ? language : "";
+      if (lstm_share_model) {
+        ASSERT_HOST(lstm_recognizer_->LoadShared(this->params(), lstm_lang, mgr));
+      } else {
+        ASSERT_HOST(lstm_recognizer_->Load(this->params(), lstm_lang, mgr));
+      }
     } else {
       tprintf("Error: LSTM requested, but not present!! Loading tesseract.\n");
       tessedit_ocr_engine_mode.set_value(OEM_TESSERACT_ONLY);
@@ -228,6 +228,10 @@ Tesseract::Tesseract()
                   "(more accurate)",
                   this->params())
     , BOOL_MEMBER(lstm_use_matrix, 1, "Use ratings matrix/beam search with lstm", this->params())
+    , BOOL_MEMBER(lstm_share_model, true,
+                  "Share the lstm network between all instances that load it from "
+                  "the same traineddata file",
+                  this->params())
     , STRING_MEMBER(outlines_odd, "%| ", "Non standard number of outlines", this->params())
     , STRING_MEMBER(outlines_2, "ij!?%\":;", "Non standard number of outlines", this->params())
     , BOOL_MEMBER(tessedit_good_quality_unrej, true, "Reduce rejection on good docs",
@@ -445,6 +449,16 @@ Tesseract::Tesseract()
                     "information is lost due to the cut off at 0. The standard value is "
                     "5",
                     this->params())
+    , STRING_MEMBER(lstm_line_pattern, "",
+                    "Pattern that the results of RecognizeLine and RecognizeLines "
+                    "must match, such as [京沪粤][A-Z][A-HJ-NP-Z0-9]{5,6} for a "
+                    "licence plate. Classes [], ranges a-z, '.', repeats ? {n} {m,n} "
+                    "and alternatives | are supported. Empty for no constraint.",
+                    this->params())
+    , BOOL_MEMBER(lstm_parallel_lines, false,
+                  "Run each line of RecognizeLines through the network on a task "
+                  "of its own, serial inside, instead of all lines as one batch",
+                  this->params())
     , BOOL_MEMBER(pageseg_apply_music_mask, false,
                   "Detect music staff and remove intersecting components", this->params())
     ,
@@ -316,6 +316,11 @@ public:
 
   void SetBlackAndWhitelist();
 
+  // The LSTM recognizer of this language, nullptr without one.
+  LSTMRecognizer *lstm_recognizer() const {
+    return lstm_recognizer_;
+  }
+
   // Perform steps to prepare underlying binary image/other data structures for
   // page segmentation. Uses the strategy specified in the global variable
   // pageseg_devanagari_split_strategy for perform splitting while preparing for
@@ -831,6 +836,7 @@ public:
   INT_VAR_H(paragraph_debug_level);
   BOOL_VAR_H(paragraph_text_based);
   BOOL_VAR_H(lstm_use_matrix);
+  BOOL_VAR_H(lstm_share_model);
   STRING_VAR_H(outlines_odd);
   STRING_VAR_H(outlines_2);
   BOOL_VAR_H(tessedit_good_quality_unrej);
@@ -967,6 +973,8 @@ public:
   INT_VAR_H(lstm_choice_mode);
   INT_VAR_H(lstm_choice_iterations);
   double_VAR_H(lstm_rating_coefficient);
+  STRING_VAR_H(lstm_line_pattern);
+  BOOL_VAR_H(lstm_parallel_lines);
   BOOL_VAR_H(pageseg_apply_music_mask);
 
   //// ambigsrecog.cpp /////////////////////////////////////////////////////////
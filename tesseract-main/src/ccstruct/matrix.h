@@ -137,6 +137,15 @@ public:
     }
   }
 
+  // Frees the array, leaving it with no elements.
+  void DeAlloc() {
+    delete[] array_;
+    array_ = nullptr;
+    dim1_ = 0;
+    dim2_ = 0;
+    size_allocated_ = 0;
+  }
+
   // Sets all the elements of the array to the empty value.
   void Clear() {
     int total_size = num_elements();
@@ -25,6 +25,18 @@
 #include <climits> // for INT_MAX
 #include <cstdio>
 
+#if defined(_WIN32)
+#  ifndef NOMINMAX
+#    define NOMINMAX
+#  endif
+#  include <windows.h>
+#elif defined(__unix__) || defined(__APPLE__)
+#  include <fcntl.h>    // for open
+#  include <sys/mman.h> // for mmap, munmap
+#  include <sys/stat.h> // for fstat
+#  include <unistd.h>   // for close
+#endif
+
 namespace tesseract {
 
 // The default FileReader loads the whole file into the vector of char,
@@ -60,6 +72,62 @@ bool SaveDataToFile(const std::vector<char> &data, const char *filename) {
   return result;
 }
 
+MappedFile::~MappedFile() {
+#if defined(_WIN32)
+  if (data_ != nullptr) {
+    UnmapViewOfFile(data_);
+  }
+  if (mapping_ != nullptr) {
+    CloseHandle(mapping_);
+  }
+#elif defined(__unix__) || defined(__APPLE__)
+  if (data_ != nullptr) {
+    munmap(const_cast<char *>(data_), size_);
+  }
+#endif
+}
+
+// Returns the mapping of filename, or nullptr if it can't be opened or
+// mapping isn't supported.
+std::shared_ptr<MappedFile> MappedFile::Map(const char *filename) {
+  std::shared_ptr<MappedFile> file(new MappedFile);
+#if defined(_WIN32)
+  HANDLE handle = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (handle == INVALID_HANDLE_VALUE) {
+    return nullptr;
+  }
+  LARGE_INTEGER size;
+  if (GetFileSizeEx(handle, &size) && size.QuadPart > 0) {
+    file->mapping_ = CreateFileMappingA(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (file->mapping_ != nullptr) {
+      file->data_ = static_cast<const char *>(MapViewOfFile(file->mapping_, FILE_MAP_READ, 0, 0, 0));
+      file->size_ = size.QuadPart;
+    }
+  }
+  CloseHandle(handle);
+#elif defined(__unix__) || defined(__APPLE__)
+  int fd = open(filename, O_RDONLY);
+  if (fd < 0) {
+    return nullptr;
+  }
+  struct stat st;
+  if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+    void *data = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (data != MAP_FAILED) {
+      file->data_ = static_cast<const char *>(data);
+      file->size_ = st.st_size;
+    }
+  }
+  // The mapping stays valid without the descriptor.
+  close(fd);
+#endif
+  if (file->data_ == nullptr) {
+    return nullptr;
+  }
+  return file;
+}
+
 TFile::TFile() {
 }
 
@@ -74,7 +142,7 @@ bool TFile::DeSerializeSize(int32_t *pSize) {
   if (FReadEndian(&size, sizeof(size), 1) != 1) {
     return false;
   }
-  if (size > data_->size() / 4) {
+  if (size > read_size() / 4) {
     // Reverse endianness.
     swap_ = !swap_;
     ReverseN(&size, 4);
@@ -138,6 +206,7 @@ bool TFile::Skip(size_t count) {
 }
 
 bool TFile::Open(const char *filename, FileReader reader) {
+  in_place_ = nullptr;
   if (!data_is_owned_) {
     data_ = new std::vector<char>;
     data_is_owned_ = true;
@@ -154,6 +223,7 @@ bool TFile::Open(const char *filename, FileReader reader) {
 
 bool TFile::Open(const char *data, size_t size) {
   offset_ = 0;
+  in_place_ = nullptr;
   if (!data_is_owned_) {
     data_ = new std::vector<char>;
     data_is_owned_ = true;
@@ -167,6 +237,7 @@ bool TFile::Open(const char *data, size_t size) {
 
 bool TFile::Open(FILE *fp, int64_t end_offset) {
   offset_ = 0;
+  in_place_ = nullptr;
   auto current_pos = std::ftell(fp);
   if (current_pos < 0) {
     // ftell failed.
@@ -192,12 +263,22 @@ bool TFile::Open(FILE *fp, int64_t end_offset) {
   return fread(&(*data_)[0], 1, size, fp) == size;
 }
 
+void TFile::OpenInPlace(const char *data, size_t size) {
+  offset_ = 0;
+  in_place_ = data;
+  in_place_size_ = size;
+  is_writing_ = false;
+  swap_ = false;
+}
+
 char *TFile::FGets(char *buffer, int buffer_size) {
   ASSERT_HOST(!is_writing_);
+  const char *data = read_data();
+  size_t data_size = read_size();
   int size = 0;
-  while (size + 1 < buffer_size && offset_ < data_->size()) {
-    buffer[size++] = (*data_)[offset_++];
-    if ((*data_)[offset_ - 1] == '\n') {
+  while (size + 1 < buffer_size && offset_ < data_size) {
+    buffer[size++] = data[offset_++];
+    if (data[offset_ - 1] == '\n') {
       break;
     }
   }
@@ -221,18 +302,19 @@ size_t TFile::FReadEndian(void *buffer, size_t size, size_t count) {
 size_t TFile::FRead(void *buffer, size_t size, size_t count) {
   ASSERT_HOST(!is_writing_);
   ASSERT_HOST(size > 0);
+  size_t data_size = read_size();
   size_t required_size;
   if (SIZE_MAX / size <= count) {
     // Avoid integer overflow.
-    required_size = data_->size() - offset_;
+    required_size = data_size - offset_;
   } else {
     required_size = size * count;
-    if (data_->size() - offset_ < required_size) {
-      required_size = data_->size() - offset_;
+    if (data_size - offset_ < required_size) {
+      required_size = data_size - offset_;
     }
   }
   if (required_size > 0 && buffer != nullptr) {
-    memcpy(buffer, &(*data_)[offset_], required_size);
+    memcpy(buffer, read_data() + offset_, required_size);
   }
   offset_ += required_size;
   return required_size / size;
@@ -245,6 +327,7 @@ void TFile::Rewind() {
 
 void TFile::OpenWrite(std::vector<char> *data) {
   offset_ = 0;
+  in_place_ = nullptr;
   if (data != nullptr) {
     if (data_is_owned_) {
       delete data_;
@@ -24,6 +24,7 @@
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <memory> // std::shared_ptr
 #include <type_traits>
 #include <vector> // std::vector
 
@@ -44,6 +45,35 @@ bool LoadDataFromFile(const char *filename, std::vector<char> *data);
 TESS_API
 bool SaveDataToFile(const std::vector<char> &data, const char *filename);
 
+// A whole file mapped read-only into memory, so that it can be read in place,
+// and its pages are shared with every other process that maps the same file.
+// The file must not be changed while it is mapped.
+class TESS_API MappedFile {
+public:
+  ~MappedFile();
+
+  // Returns the mapping of filename, or nullptr if it can't be opened or
+  // mapping isn't supported.
+  static std::shared_ptr<MappedFile> Map(const char *filename);
+
+  const char *data() const {
+    return data_;
+  }
+  size_t size() const {
+    return size_;
+  }
+
+private:
+  MappedFile() = default;
+
+  const char *data_ = nullptr;
+  size_t size_ = 0;
+#ifdef _WIN32
+  // Handle of the file mapping object.
+  void *mapping_ = nullptr;
+#endif
+};
+
 // Deserialize data from file.
 template <typename T>
 bool DeSerialize(FILE *fp, T *data, size_t n = 1) {
@@ -71,6 +101,9 @@ public:
   bool Open(const char *data, size_t size);
   // From an open file and an end offset.
   bool Open(FILE *fp, int64_t end_offset);
+  // From an existing memory buffer, such as a MappedFile, which is read in
+  // place instead of copied, so it must outlive the reading.
+  void OpenInPlace(const char *data, size_t size);
   // Sets the value of the swap flag, so that FReadEndian does the right thing.
   void set_swap(bool value) {
     swap_ = value;
@@ -217,8 +250,19 @@ public:
   size_t FWrite(const void *buffer, size_t size, size_t count);
 
 private:
+  // The bytes being read, in place or from data_.
+  const char *read_data() const {
+    return in_place_ != nullptr ? in_place_ : data_->data();
+  }
+  size_t read_size() const {
+    return in_place_ != nullptr ? in_place_size_ : data_->size();
+  }
+
   // The buffered data from the file.
   std::vector<char> *data_ = nullptr;
+  // Borrowed buffer read in place of data_ after OpenInPlace, else nullptr.
+  const char *in_place_ = nullptr;
+  size_t in_place_size_ = 0;
   // The number of bytes used so far.
   unsigned offset_ = 0;
   // True if the data_ pointer is owned by *this.
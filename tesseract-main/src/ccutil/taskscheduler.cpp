@@ -0,0 +1,242 @@
+///////////////////////////////////////////////////////////////////////
+// File:        taskscheduler.cpp
+// Description: Runs the parallel parts of the LSTM recognizer.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+///////////////////////////////////////////////////////////////////////
+
+#include <tesseract/taskscheduler.h>
+
+#include <algorithm>          // for std::find
+#include <atomic>             // for std::atomic
+#include <condition_variable> // for std::condition_variable
+#include <deque>              // for std::deque
+#include <mutex>              // for std::mutex
+#include <thread>             // for std::thread
+#include <vector>             // for std::vector
+
+namespace tesseract {
+
+// Runs every task in turn on the calling thread.
+class SerialTaskScheduler : public TaskScheduler {
+public:
+  void ParallelFor(int count, const std::function<void(int)> &task) override {
+    for (int i = 0; i < count; ++i) {
+      task(i);
+    }
+  }
+};
+
+// A pool of threads, each with its own queue of ParallelFor calls. A call
+// made on a pool thread goes on the queue of that thread, and others on a
+// queue of their own. An idle thread takes the newest call of its own queue,
+// or else steals the oldest call of another queue, and runs tasks of it
+// until none are left. The thread that called ParallelFor runs tasks of its
+// call too, so a nested call can't wait for a thread that is busy waiting.
+class ThreadPoolTaskScheduler : public TaskScheduler {
+public:
+  // num_threads counts the calling thread, so one fewer is started.
+  explicit ThreadPoolTaskScheduler(int num_threads) {
+    int num_workers = std::max(num_threads - 1, 0);
+    // The last queue is for the threads that are not in the pool.
+    queues_.resize(num_workers + 1);
+    for (int w = 0; w < num_workers; ++w) {
+      workers_.emplace_back(&ThreadPoolTaskScheduler::Work, this, w);
+    }
+  }
+  ~ThreadPoolTaskScheduler() override {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    work_cv_.notify_all();
+    for (auto &worker : workers_) {
+      worker.join();
+    }
+  }
+
+  void ParallelFor(int count, const std::function<void(int)> &task) override {
+    if (count <= 1 || workers_.empty()) {
+      for (int i = 0; i < count; ++i) {
+        task(i);
+      }
+      return;
+    }
+    Call call(&task, count);
+    call.queue = worker_pool_ == this ? worker_index_ : workers_.size();
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      queues_[call.queue].push_back(&call);
+      ++call.helpers;
+    }
+    work_cv_.notify_all();
+    int done = RunTasks(&call);
+    std::unique_lock<std::mutex> lock(mutex_);
+    Release(&call, done);
+    // Threads that took the call may still be running its last tasks.
+    done_cv_.wait(lock, [&call] { return call.finished == call.count && call.helpers == 0; });
+  }
+
+private:
+  // A call of ParallelFor, which lives on the stack of its caller. The
+  // counts other than next are guarded by mutex_.
+  struct Call {
+    Call(const std::function<void(int)> *t, int c) : task(t), count(c) {}
+    const std::function<void(int)> *task;
+    int count;
+    // The next task to claim.
+    std::atomic<int> next{0};
+    // Tasks that have returned.
+    int finished = 0;
+    // Threads that took the call from its queue and are not done with it.
+    int helpers = 0;
+    // The queue of the call in queues_.
+    unsigned queue = 0;
+  };
+
+  // Runs tasks of call until none are left to claim. Returns the number run.
+  static int RunTasks(Call *call) {
+    int done = 0;
+    for (int i = call->next++; i < call->count; i = call->next++) {
+      (*call->task)(i);
+      ++done;
+    }
+    return done;
+  }
+
+  // Returns a call with tasks left, preferring the newest of queue w, and
+  // counts the thread as a helper of it, or nullptr if there is none. Calls
+  // with no tasks left to claim are taken off their queues. Needs mutex_.
+  Call *FindCall(unsigned w) {
+    for (unsigned q = 0; q < queues_.size(); ++q) {
+      // Own queue first, then the others.
+      unsigned index = (w + q) % queues_.size();
+      auto &queue = queues_[index];
+      while (!queue.empty()) {
+        Call *call = index == w ? queue.back() : queue.front();
+        if (call->next < call->count) {
+          ++call->helpers;
+          return call;
+        }
+        if (index == w) {
+          queue.pop_back();
+        } else {
+          queue.pop_front();
+        }
+      }
+    }
+    return nullptr;
+  }
+
+  // Records done finished tasks of call, and that a helper is done with it.
+  // Needs mutex_.
+  void Release(Call *call, int done) {
+    auto &queue = queues_[call->queue];
+    auto it = std::find(queue.begin(), queue.end(), call);
+    if (it != queue.end()) {
+      queue.erase(it);
+    }
+    call->finished += done;
+    --call->helpers;
+    if (call->finished == call->count && call->helpers == 0) {
+      done_cv_.notify_all();
+    }
+  }
+
+  // The loop of pool thread w.
+  void Work(unsigned w) {
+    worker_pool_ = this;
+    worker_index_ = w;
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+      Call *call = FindCall(w);
+      if (call == nullptr) {
+        if (stop_) {
+          return;
+        }
+        work_cv_.wait(lock);
+        continue;
+      }
+      lock.unlock();
+      int done = RunTasks(call);
+      lock.lock();
+      Release(call, done);
+    }
+  }
+
+  // The pool and queue of the calling thread, if it is a pool thread.
+  static thread_local const ThreadPoolTaskScheduler *worker_pool_;
+  static thread_local unsigned worker_index_;
+
+  std::vector<std::thread> workers_;
+  std::vector<std::deque<Call *>> queues_;
+  std::mutex mutex_;
+  // Signalled when there is a new call, or on stop_.
+  std::condition_variable work_cv_;
+  // Signalled when a call has finished.
+  std::condition_variable done_cv_;
+  bool stop_ = false;
+};
+
+thread_local const ThreadPoolTaskScheduler *ThreadPoolTaskScheduler::worker_pool_ = nullptr;
+thread_local unsigned ThreadPoolTaskScheduler::worker_index_ = 0;
+
+// The scheduler given to TaskScheduler::Set, or nullptr for the default.
+static std::atomic<TaskScheduler *> current_scheduler(nullptr);
+// The number of SerialScopes alive on this thread.
+static thread_local int serial_scopes = 0;
+
+TaskScheduler::~TaskScheduler() = default;
+
+TaskScheduler *TaskScheduler::Get() {
+  if (serial_scopes > 0) {
+    return Serial();
+  }
+  TaskScheduler *scheduler = current_scheduler.load(std::memory_order_acquire);
+  if (scheduler != nullptr) {
+    return scheduler;
+  }
+#ifdef _OPENMP
+  // Never deleted, so recognizers that run during exit still have it.
+  static TaskScheduler *default_pool = NewThreadPool(0).release();
+  return default_pool;
+#else
+  // These parts were serial without OpenMP, and most of their calls are
+  // too small to pay for waking the threads of a pool.
+  return Serial();
+#endif
+}
+
+void TaskScheduler::Set(TaskScheduler *scheduler) {
+  current_scheduler.store(scheduler, std::memory_order_release);
+}
+
+TaskScheduler *TaskScheduler::Serial() {
+  static SerialTaskScheduler serial;
+  return &serial;
+}
+
+std::unique_ptr<TaskScheduler> TaskScheduler::NewThreadPool(int num_threads) {
+  if (num_threads <= 0) {
+    num_threads = std::thread::hardware_concurrency();
+  }
+  return std::unique_ptr<TaskScheduler>(new ThreadPoolTaskScheduler(num_threads));
+}
+
+TaskScheduler::SerialScope::SerialScope() {
+  ++serial_scopes;
+}
+
+TaskScheduler::SerialScope::~SerialScope() {
+  --serial_scopes;
+}
+
+} // namespace tesseract.
@@ -39,12 +39,13 @@
 
 namespace tesseract {
 
-TessdataManager::TessdataManager() : reader_(nullptr), is_loaded_(false), swap_(false) {
+TessdataManager::TessdataManager()
+    : reader_(nullptr), is_loaded_(false), swap_(false), map_file_(false) {
   SetVersionString(TESSERACT_VERSION_STR);
 }
 
 TessdataManager::TessdataManager(FileReader reader)
-    : reader_(reader), is_loaded_(false), swap_(false) {
+    : reader_(reader), is_loaded_(false), swap_(false), map_file_(false) {
   SetVersionString(TESSERACT_VERSION_STR);
 }
 
@@ -72,6 +73,7 @@ bool TessdataManager::LoadArchiveFile(const char *filename) {
             int64_t size = archive_entry_size(ae);
             if (size > 0) {
               entries_[type].resize(size);
+              mapped_sizes_[type] = 0;
               if (archive_read_data(a, &entries_[type][0], size) == size) {
                 is_loaded_ = true;
               }
@@ -95,6 +97,9 @@ bool TessdataManager::Init(const char *data_file_name) {
       return true;
     }
 #endif
+    if (map_file_ && LoadMappedFile(data_file_name)) {
+      return true;
+    }
     if (!LoadDataFromFile(data_file_name, &data)) {
       return false;
     }
@@ -111,8 +116,56 @@ bool TessdataManager::LoadMemBuffer(const char *name, const char *data, int size
   // TODO: This method supports only the proprietary file format.
   Clear();
   data_file_name_ = name;
+  const char *views[TESSDATA_NUM_ENTRIES];
+  int64_t sizes[TESSDATA_NUM_ENTRIES];
+  if (!ReadOffsetTable(data, size, views, sizes)) {
+    return false;
+  }
+  for (unsigned i = 0; i < TESSDATA_NUM_ENTRIES; ++i) {
+    entries_[i].assign(views[i], views[i] + sizes[i]);
+  }
+  if (entries_[TESSDATA_VERSION].empty()) {
+    SetVersionString("Pre-4.0.0");
+  }
+  is_loaded_ = true;
+  return true;
+}
+
+// Maps the file for Init. Returns false, with nothing loaded, if it can't be
+// mapped.
+bool TessdataManager::LoadMappedFile(const char *filename) {
+  std::shared_ptr<MappedFile> file = MappedFile::Map(filename);
+  if (file == nullptr) {
+    return false;
+  }
+  Clear();
+  data_file_name_ = filename;
+  int64_t sizes[TESSDATA_NUM_ENTRIES];
+  if (!ReadOffsetTable(file->data(), file->size(), mapped_entries_, sizes)) {
+    return false;
+  }
+  mapped_file_ = file;
+  for (unsigned i = 0; i < TESSDATA_NUM_ENTRIES; ++i) {
+    mapped_sizes_[i] = sizes[i];
+  }
+  if (!IsComponentAvailable(TESSDATA_VERSION)) {
+    SetVersionString("Pre-4.0.0");
+  }
+  is_loaded_ = true;
+  return true;
+}
+
+// Reads the offset table of the traineddata in data[size] and points views[]
+// and sizes[] to the components in it.
+bool TessdataManager::ReadOffsetTable(const char *data, int64_t size,
+                                      const char *views[TESSDATA_NUM_ENTRIES],
+                                      int64_t sizes[TESSDATA_NUM_ENTRIES]) {
+  for (unsigned i = 0; i < TESSDATA_NUM_ENTRIES; ++i) {
+    views[i] = nullptr;
+    sizes[i] = 0;
+  }
   TFile fp;
-  fp.Open(data, size);
+  fp.OpenInPlace(data, size);
   uint32_t num_entries;
   if (!fp.DeSerialize(&num_entries)) {
     return false;
@@ -140,16 +193,13 @@ bool TessdataManager::LoadMemBuffer(const char *name, const char *data, int size
       if (j < num_entries) {
         entry_size = offset_table[j] - offset_table[i];
       }
-      entries_[i].resize(entry_size);
-      if (!fp.DeSerialize(&entries_[i][0], entry_size)) {
+      if (offset_table[i] > size || entry_size < 0 || entry_size > size - offset_table[i]) {
         return false;
       }
+      views[i] = data + offset_table[i];
+      sizes[i] = entry_size;
     }
   }
-  if (entries_[TESSDATA_VERSION].empty()) {
-    SetVersionString("Pre-4.0.0");
-  }
-  is_loaded_ = true;
   return true;
 }
 
@@ -158,6 +208,7 @@ void TessdataManager::OverwriteEntry(TessdataType type, const char *data, int si
   is_loaded_ = true;
   entries_[type].resize(size);
   memcpy(&entries_[type][0], data, size);
+  mapped_sizes_[type] = 0;
 }
 
 // Saves to the given filename.
@@ -181,11 +232,11 @@ void TessdataManager::Serialize(std::vector<char> *data) const {
   int64_t offset_table[TESSDATA_NUM_ENTRIES];
   int64_t offset = sizeof(int32_t) + sizeof(offset_table);
   for (unsigned i = 0; i < TESSDATA_NUM_ENTRIES; ++i) {
-    if (entries_[i].empty()) {
+    if (EntrySize(i) == 0) {
       offset_table[i] = -1;
     } else {
       offset_table[i] = offset;
-      offset += entries_[i].size();
+      offset += EntrySize(i);
     }
   }
   data->resize(offset, 0);
@@ -194,9 +245,9 @@ void TessdataManager::Serialize(std::vector<char> *data) const {
   fp.OpenWrite(data);
   fp.Serialize(&num_entries);
   fp.Serialize(&offset_table[0], countof(offset_table));
-  for (const auto &entry : entries_) {
-    if (!entry.empty()) {
-      fp.Serialize(&entry[0], entry.size());
+  for (unsigned i = 0; i < TESSDATA_NUM_ENTRIES; ++i) {
+    if (EntrySize(i) != 0) {
+      fp.Serialize(EntryData(i), EntrySize(i));
     }
   }
 }
@@ -206,6 +257,10 @@ void TessdataManager::Clear() {
   for (auto &entry : entries_) {
     entry.clear();
   }
+  for (auto &size : mapped_sizes_) {
+    size = 0;
+  }
+  mapped_file_.reset();
   is_loaded_ = false;
 }
 
@@ -214,10 +269,10 @@ void TessdataManager::Directory() const {
   printf("Version:%s\n", VersionString().c_str());
   auto offset = TESSDATA_NUM_ENTRIES * sizeof(int64_t);
   for (unsigned i = 0; i < TESSDATA_NUM_ENTRIES; ++i) {
-    if (!entries_[i].empty()) {
-      printf("%u:%s:size=%zu, offset=%zu\n", i, kTessdataFileSuffixes[i], entries_[i].size(),
+    if (EntrySize(i) != 0) {
+      printf("%u:%s:size=%zu, offset=%zu\n", i, kTessdataFileSuffixes[i], EntrySize(i),
               offset);
-      offset += entries_[i].size();
+      offset += EntrySize(i);
     }
   }
 }
@@ -236,23 +291,28 @@ bool TessdataManager::GetComponent(TessdataType type, TFile *fp) {
 // loaded.
 bool TessdataManager::GetComponent(TessdataType type, TFile *fp) const {
   ASSERT_HOST(is_loaded_);
-  if (entries_[type].empty()) {
+  if (EntrySize(type) == 0) {
     return false;
   }
-  fp->Open(&entries_[type][0], entries_[type].size());
+  if (mapped_sizes_[type] != 0) {
+    fp->OpenInPlace(mapped_entries_[type], mapped_sizes_[type]);
+  } else {
+    fp->Open(&entries_[type][0], entries_[type].size());
+  }
   fp->set_swap(swap_);
   return true;
 }
 
 // Returns the current version string.
 std::string TessdataManager::VersionString() const {
-  return std::string(&entries_[TESSDATA_VERSION][0], entries_[TESSDATA_VERSION].size());
+  return std::string(EntryData(TESSDATA_VERSION), EntrySize(TESSDATA_VERSION));
 }
 
 // Sets the version string to the given v_str.
 void TessdataManager::SetVersionString(const std::string &v_str) {
   entries_[TESSDATA_VERSION].resize(v_str.size());
   memcpy(&entries_[TESSDATA_VERSION][0], v_str.data(), v_str.size());
+  mapped_sizes_[TESSDATA_VERSION] = 0;
 }
 
 bool TessdataManager::CombineDataFiles(const char *language_data_path_prefix,
@@ -270,6 +330,7 @@ bool TessdataManager::CombineDataFiles(const char *language_data_path_prefix,
         tprintf("Load of file %s failed!\n", filename.c_str());
         return false;
       }
+      mapped_sizes_[type] = 0;
     }
   }
   is_loaded_ = true;
@@ -296,6 +357,7 @@ bool TessdataManager::OverwriteComponents(const char *new_traineddata_filename,
         tprintf("Failed to read component file:%s\n", component_filenames[i]);
         return false;
       }
+      mapped_sizes_[type] = 0;
     }
   }
 
@@ -306,9 +368,13 @@ bool TessdataManager::OverwriteComponents(const char *new_traineddata_filename,
 bool TessdataManager::ExtractToFile(const char *filename) {
   TessdataType type = TESSDATA_NUM_ENTRIES;
   ASSERT_HOST(tesseract::TessdataManager::TessdataTypeFromFileName(filename, &type));
-  if (entries_[type].empty()) {
+  if (EntrySize(type) == 0) {
     return false;
   }
+  if (mapped_sizes_[type] != 0) {
+    std::vector<char> entry(mapped_entries_[type], mapped_entries_[type] + mapped_sizes_[type]);
+    return SaveDataToFile(entry, filename);
+  }
   return SaveDataToFile(entries_[type], filename);
 }
 
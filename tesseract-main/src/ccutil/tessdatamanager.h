@@ -20,9 +20,10 @@
 #define TESSERACT_CCUTIL_TESSDATAMANAGER_H_
 
 #include <tesseract/baseapi.h> // FileReader
+#include <memory>              // std::shared_ptr
 #include <string>              // std::string
 #include <vector>              // std::vector
-#include "serialis.h"          // FileWriter
+#include "serialis.h"          // FileWriter, MappedFile
 
 static const char kTrainedDataSuffix[] = "traineddata";
 
@@ -137,6 +138,16 @@ public:
   bool is_loaded() const {
     return is_loaded_;
   }
+  // If true, Init maps the data file into memory rather than reading it, and
+  // GetComponent reads the components in place, which saves the copies of the
+  // file while loading. The mapping lives only as long as the manager, and
+  // the components are still copied into what is loaded from them, so no
+  // memory stays shared after loading. The file must not change until Clear
+  // or destruction. Has no effect with a reader, or where mapping isn't
+  // supported.
+  void set_map_file(bool value) {
+    map_file_ = value;
+  }
 
   // Lazily loads from the given filename. Won't actually read the file
   // until it needs it.
@@ -164,7 +175,7 @@ public:
 
   // Returns true if the component requested is present.
   bool IsComponentAvailable(TessdataType type) const {
-    return !entries_[type].empty();
+    return EntrySize(type) != 0;
   }
   // Opens the given TFile pointer to the given component type.
   // Returns false in case of failure.
@@ -180,12 +191,12 @@ public:
 
   // Returns true if the base Tesseract components are present.
   bool IsBaseAvailable() const {
-    return !entries_[TESSDATA_UNICHARSET].empty() && !entries_[TESSDATA_INTTEMP].empty();
+    return EntrySize(TESSDATA_UNICHARSET) != 0 && EntrySize(TESSDATA_INTTEMP) != 0;
   }
 
   // Returns true if the LSTM components are present.
   bool IsLSTMAvailable() const {
-    return !entries_[TESSDATA_LSTM].empty();
+    return EntrySize(TESSDATA_LSTM) != 0;
   }
 
   // Return the name of the underlying data file.
@@ -223,6 +234,22 @@ public:
 private:
   // Use libarchive.
   bool LoadArchiveFile(const char *filename);
+  // Maps the file for Init, if map_file_. Returns false, with nothing
+  // loaded, if it can't be mapped.
+  bool LoadMappedFile(const char *filename);
+  // Reads the offset table of the traineddata in data[size] and points
+  // views[] and sizes[] to the components in it.
+  bool ReadOffsetTable(const char *data, int64_t size,
+                       const char *views[TESSDATA_NUM_ENTRIES],
+                       int64_t sizes[TESSDATA_NUM_ENTRIES]);
+
+  // Returns the contents of element type, wherever they are held.
+  const char *EntryData(unsigned type) const {
+    return mapped_sizes_[type] != 0 ? mapped_entries_[type] : entries_[type].data();
+  }
+  size_t EntrySize(unsigned type) const {
+    return mapped_sizes_[type] != 0 ? mapped_sizes_[type] : entries_[type].size();
+  }
 
   /**
    * Fills type with TessdataType of the tessdata component represented by the
@@ -246,8 +273,15 @@ private:
   bool is_loaded_;
   // True if the bytes need swapping.
   bool swap_;
-  // Contents of each element of the traineddata file.
+  // True if Init should map the file.
+  bool map_file_;
+  // Contents of each element of the traineddata file, unless mapped.
   std::vector<char> entries_[TESSDATA_NUM_ENTRIES];
+  // The mapped file, and the elements that are read in place from it, which
+  // have a non-zero size here.
+  std::shared_ptr<MappedFile> mapped_file_;
+  const char *mapped_entries_[TESSDATA_NUM_ENTRIES] = {};
+  size_t mapped_sizes_[TESSDATA_NUM_ENTRIES] = {};
 };
 
 } // namespace tesseract
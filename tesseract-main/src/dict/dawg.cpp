@@ -26,7 +26,9 @@
 #include "helpers.h"
 #include "tprintf.h"
 
+#include <algorithm> // for std::stable_sort
 #include <memory>
+#include <numeric>   // for std::iota
 
 /*----------------------------------------------------------------------
               F u n c t i o n s   f o r   D a w g
@@ -197,6 +199,11 @@ SquishedDawg::~SquishedDawg() {
 
 EDGE_REF SquishedDawg::edge_char_of(NODE_REF node, UNICHAR_ID unichar_id,
                                     bool word_end) const {
+  if (node >= 0 && node < static_cast<NODE_REF>(node_slots_.size()) &&
+      node_slots_[node] >= 0) {
+    return indexed_edge_char_of(node_indices_[node_slots_[node]], node,
+                                unichar_id, word_end);
+  }
   EDGE_REF edge = node;
   if (node == 0) { // binary search
     EDGE_REF start = 0;
@@ -227,6 +234,106 @@ EDGE_REF SquishedDawg::edge_char_of(NODE_REF node, UNICHAR_ID unichar_id,
   return (NO_EDGE); // not found
 }
 
+EDGE_REF SquishedDawg::indexed_edge_char_of(const NodeIndex &index,
+                                            NODE_REF node,
+                                            UNICHAR_ID unichar_id,
+                                            bool word_end) const {
+  const UNICHAR_ID *letters = &index_letters_[index.start];
+  int32_t pos;
+  if (index.dense >= 0) {
+    if (unichar_id < 0 || unichar_id >= unicharset_size_) {
+      return NO_EDGE;
+    }
+    pos = dense_entries_[index.dense + unichar_id];
+    if (pos < 0) {
+      return NO_EDGE;
+    }
+  } else {
+    // Narrows the search down to a block that holds the first letter not
+    // less than unichar_id, or ends just before it, then counts the letters
+    // of the block that are less. The count has no branches, so the
+    // compiler can do it with vector compares.
+    pos = 0;
+    int32_t count = index.size;
+    while (count > kLetterBlock) {
+      int32_t half = count / 2;
+      if (letters[pos + half] < unichar_id) {
+        pos += half;
+      }
+      count -= half;
+    }
+    int32_t less = 0;
+    for (int32_t i = 0; i < count; ++i) {
+      less += letters[pos + i] < unichar_id;
+    }
+    pos += less;
+  }
+  // The letters are in node order where they are equal, so the first edge
+  // that matches is the one the linear search finds.
+  const int32_t *offsets = &index_offsets_[index.start];
+  for (; pos < index.size && letters[pos] == unichar_id; ++pos) {
+    EDGE_REF edge = node + offsets[pos];
+    if (!word_end || end_of_word_from_edge_rec(edges_[edge])) {
+      return edge;
+    }
+  }
+  return NO_EDGE;
+}
+
+void SquishedDawg::init_edge_lookup() {
+  num_forward_edges_in_node0 = num_forward_edges(0);
+  node_slots_.clear();
+  node_indices_.clear();
+  index_letters_.clear();
+  index_offsets_.clear();
+  dense_entries_.clear();
+  std::vector<int32_t> order;
+  for (EDGE_REF node = 0; node < num_edges_;) {
+    if (!forward_edge(node)) {
+      ++node;
+      continue;
+    }
+    int32_t num_edges = num_forward_edges(node);
+    if (num_edges >= kMinIndexedEdges) {
+      NodeIndex index;
+      index.start = index_letters_.size();
+      index.size = num_edges;
+      index.dense = -1;
+      order.resize(num_edges);
+      std::iota(order.begin(), order.end(), 0);
+      std::stable_sort(order.begin(), order.end(),
+                       [this, node](int32_t a, int32_t b) {
+                         return unichar_id_from_edge_rec(edges_[node + a]) <
+                                unichar_id_from_edge_rec(edges_[node + b]);
+                       });
+      for (int32_t offset : order) {
+        index_letters_.push_back(unichar_id_from_edge_rec(edges_[node + offset]));
+        index_offsets_.push_back(offset);
+      }
+      // The dense table costs at most 4 entries per edge.
+      if (num_edges * 4 >= unicharset_size_) {
+        index.dense = dense_entries_.size();
+        dense_entries_.resize(dense_entries_.size() + unicharset_size_, -1);
+        for (int32_t pos = num_edges - 1; pos >= 0; --pos) {
+          UNICHAR_ID letter = index_letters_[index.start + pos];
+          if (letter >= 0 && letter < unicharset_size_) {
+            dense_entries_[index.dense + letter] = pos;
+          }
+        }
+      }
+      node_slots_.resize(node + 1, -1);
+      node_slots_[node] = node_indices_.size();
+      node_indices_.push_back(index);
+    }
+    node += num_edges;
+  }
+  if (debug_level_ > 0) {
+    tprintf("Indexed %zu of the dawg nodes, with %zu dense tables\n",
+            node_indices_.size(),
+            dense_entries_.size() / std::max(unicharset_size_, 1));
+  }
+}
+
 int32_t SquishedDawg::num_forward_edges(NODE_REF node) const {
   EDGE_REF edge = node;
   int32_t num = 0;
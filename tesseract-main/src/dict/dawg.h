@@ -28,6 +28,7 @@
 #include <cinttypes>  // for PRId64
 #include <functional> // for std::function
 #include <memory>
+#include <vector> // for std::vector
 #include "elst.h"
 #include "params.h"
 #include "ratngs.h"
@@ -416,7 +417,7 @@ public:
     TFile file;
     ASSERT_HOST(file.Open(filename, nullptr));
     ASSERT_HOST(read_squished_dawg(&file));
-    num_forward_edges_in_node0 = num_forward_edges(0);
+    init_edge_lookup();
   }
   SquishedDawg(EDGE_ARRAY edges, int num_edges, DawgType type,
                const std::string &lang, PermuterType perm, int unicharset_size,
@@ -425,7 +426,7 @@ public:
         edges_(edges),
         num_edges_(num_edges) {
     init(unicharset_size);
-    num_forward_edges_in_node0 = num_forward_edges(0);
+    init_edge_lookup();
     if (debug_level > 3) {
       print_all("SquishedDawg:");
     }
@@ -437,7 +438,7 @@ public:
     if (!read_squished_dawg(fp)) {
       return false;
     }
-    num_forward_edges_in_node0 = num_forward_edges(0);
+    init_edge_lookup();
     return true;
   }
 
@@ -563,10 +564,41 @@ private:
   /// Constructs a mapping from the memory node indices to disk node indices.
   std::unique_ptr<EDGE_REF[]> build_node_map(int32_t *num_nodes) const;
 
+  // The lookup index of a node with many edges. Apart from those of node 0,
+  // the edges of a node are not sorted, so the index holds the letters of
+  // the node in sorted order, with the offset of each edge from the node.
+  // A node that has a large part of the unicharset also gets a dense table
+  // from unichar_id to its first entry in the sorted letters.
+  struct NodeIndex {
+    int32_t start; // Index of the first letter in index_letters_.
+    int32_t size;  // Number of edges of the node.
+    int32_t dense; // Index of the table in dense_entries_, or -1.
+  };
+  // Nodes with fewer edges are scanned, as they fit in a cache line or two.
+  static const int kMinIndexedEdges = 16;
+  // The binary search over the sorted letters stops at this many and
+  // compares them all at once.
+  static const int kLetterBlock = 16;
+
+  /// Sets num_forward_edges_in_node0 and builds the index of the nodes with
+  /// many edges, once the edges are loaded.
+  void init_edge_lookup();
+  /// Returns the edge out of the indexed node, as edge_char_of does.
+  EDGE_REF indexed_edge_char_of(const NodeIndex &index, NODE_REF node,
+                                UNICHAR_ID unichar_id, bool word_end) const;
+
   // Member variables.
   EDGE_ARRAY edges_ = nullptr;
   int32_t num_edges_ = 0;
   int num_forward_edges_in_node0 = 0;
+  // The edge lookup index, which is not part of the file format.
+  // The slot in node_indices_ of each node, or -1. It ends at the last
+  // indexed node.
+  std::vector<int32_t> node_slots_;
+  std::vector<NodeIndex> node_indices_;
+  std::vector<UNICHAR_ID> index_letters_;
+  std::vector<int32_t> index_offsets_;
+  std::vector<int32_t> dense_entries_;
 };
 
 } // namespace tesseract
@@ -21,21 +21,17 @@
 
 #include "fullyconnected.h"
 
-#ifdef _OPENMP
-#  include <omp.h>
-#endif
+#include <tesseract/taskscheduler.h>
+
+#include <algorithm> // for std::min
 #include <cstdio>
 #include <cstdlib>
 
 #include "functions.h"
 #include "networkscratch.h"
 
-// Number of threads to use for parallel calculation of Forward and Backward.
-#ifdef _OPENMP
+// Number of tasks, each a run of timesteps, for Forward and Backward.
 const int kNumThreads = 4;
-#else
-const int kNumThreads = 1;
-#endif
 
 namespace tesseract {
 
@@ -146,28 +142,23 @@ void FullyConnected::Forward(bool debug, const NetworkIO &input,
     temp_lines[i].Init(ro, scratch);
     curr_input[i].Init(ni_, scratch);
   }
-#ifdef _OPENMP
-#  pragma omp parallel for num_threads(kNumThreads)
-  for (int t = 0; t < width; ++t) {
-    // Thread-local pointer to temporary storage.
-    int thread_id = omp_get_thread_num();
-#else
-  for (int t = 0; t < width; ++t) {
-    // Thread-local pointer to temporary storage.
-    int thread_id = 0;
-#endif
-    TFloat *temp_line = temp_lines[thread_id];
-    if (input.int_mode()) {
-      ForwardTimeStep(input.i(t), t, temp_line);
-    } else {
-      input.ReadTimeStep(t, curr_input[thread_id]);
-      ForwardTimeStep(curr_input[thread_id], t, temp_line);
+  int num_tasks = std::min(kNumThreads, width);
+  TaskScheduler::Get()->ParallelFor(num_tasks, [&](int task) {
+    // Task-local pointer to temporary storage.
+    TFloat *temp_line = temp_lines[task];
+    for (int t = task * width / num_tasks; t < (task + 1) * width / num_tasks; ++t) {
+      if (input.int_mode()) {
+        ForwardTimeStep(input.i(t), t, temp_line);
+      } else {
+        input.ReadTimeStep(t, curr_input[task]);
+        ForwardTimeStep(curr_input[task], t, temp_line);
+      }
+      output->WriteTimeStep(t, temp_line);
+      if (IsTraining() && type_ != NT_SOFTMAX) {
+        acts_.CopyTimeStepFrom(t, *output, t);
+      }
     }
-    output->WriteTimeStep(t, temp_line);
-    if (IsTraining() && type_ != NT_SOFTMAX) {
-      acts_.CopyTimeStepFrom(t, *output, t);
-    }
-  }
+  });
   // Zero all the elements that are in the padding around images that allows
   // multiple different-sized images to exist in a single array.
   // acts_ is only used if this is not a softmax op.
@@ -188,9 +179,9 @@ void FullyConnected::Forward(bool debug, const NetworkIO &input,
 
 // Components of Forward so FullyConnected can be reused inside LSTM.
 void FullyConnected::SetupForward(const NetworkIO &input, const TransposedArray *input_transpose) {
-  // Softmax output is always float, so save the input type.
-  int_mode_ = input.int_mode();
   if (IsTraining()) {
+    // Softmax output is always float, so save the input type.
+    int_mode_ = input.int_mode();
     acts_.Resize(input, no_);
     // Source_ is a transposed copy of input. It isn't needed if provided.
     external_source_ = input_transpose;
@@ -257,24 +248,20 @@ bool FullyConnected::Backward(bool debug, const NetworkIO &fwd_deltas, NetworkSc
   int width = fwd_deltas.Width();
   NetworkScratch::GradientStore errors_t;
   errors_t.Init(no_, width, scratch);
-#ifdef _OPENMP
-#  pragma omp parallel for num_threads(kNumThreads)
-  for (int t = 0; t < width; ++t) {
-    int thread_id = omp_get_thread_num();
-#else
-  for (int t = 0; t < width; ++t) {
-    int thread_id = 0;
-#endif
+  int num_tasks = std::min(kNumThreads, width);
+  TaskScheduler::Get()->ParallelFor(num_tasks, [&](int task) {
     TFloat *backprop = nullptr;
     if (needs_to_backprop_) {
-      backprop = temp_backprops[thread_id];
+      backprop = temp_backprops[task];
     }
-    TFloat *curr_errors = errors[thread_id];
-    BackwardTimeStep(fwd_deltas, t, curr_errors, errors_t.get(), backprop);
-    if (backprop != nullptr) {
-      back_deltas->WriteTimeStep(t, backprop);
+    TFloat *curr_errors = errors[task];
+    for (int t = task * width / num_tasks; t < (task + 1) * width / num_tasks; ++t) {
+      BackwardTimeStep(fwd_deltas, t, curr_errors, errors_t.get(), backprop);
+      if (backprop != nullptr) {
+        back_deltas->WriteTimeStep(t, backprop);
+      }
     }
-  }
+  });
   FinishBackward(*errors_t.get());
   if (needs_to_backprop_) {
     back_deltas->ZeroInvalidElements();
@@ -23,7 +23,9 @@
 
 // Setting this to 1 or more causes massive dumps of debug data: weights,
 // updates, internal calculations etc, and reduces the number of test iterations
-// to a small number, so outputs can be diffed.
+// to a small number, so outputs can be diffed. The network layers run on the
+// TaskScheduler, so use TaskScheduler::Set(TaskScheduler::Serial()) as well to
+// get the outputs in sync.
 #define DEBUG_DETAIL 0
 #if DEBUG_DETAIL > 0
 #  undef _OPENMP // Disable open mp to get the outputs in sync.
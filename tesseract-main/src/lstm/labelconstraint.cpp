@@ -0,0 +1,262 @@
+///////////////////////////////////////////////////////////////////////
+// File:        labelconstraint.cpp
+// Description: Automata that restrict the unichar sequences of a line that
+//              the beam search may produce.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+///////////////////////////////////////////////////////////////////////
+
+#include "labelconstraint.h"
+
+#include "tprintf.h"    // for tprintf
+#include "unicharset.h" // for UNICHARSET, UNICHAR_SPACE
+
+#include <map> // for std::map
+
+namespace tesseract {
+
+bool PatternConstraint::CharClass::Contains(char32 ch) const {
+  if (any) {
+    return true;
+  }
+  bool found = false;
+  for (const auto &range : ranges) {
+    if (ch >= range.first && ch <= range.second) {
+      found = true;
+      break;
+    }
+  }
+  return found != negated;
+}
+
+// Compiles pattern against the unicharset of the recognizer. Returns false,
+// with a message, if the pattern is malformed.
+bool PatternConstraint::Compile(const char *pattern, const UNICHARSET &unicharset) {
+  next_.clear();
+  final_.clear();
+  pattern_.clear();
+  if (!Parse(pattern)) {
+    return false;
+  }
+  // The set of positions that can take each unichar. Unichars with the same
+  // set go through the same transitions.
+  num_unichars_ = unicharset.size();
+  std::map<uint64_t, std::vector<int>> unichars_by_positions;
+  for (int id = 0; id < num_unichars_; ++id) {
+    if (id == UNICHAR_SPACE) {
+      continue;
+    }
+    std::vector<char32> unicodes = UNICHAR::UTF8ToUTF32(unicharset.id_to_unichar(id));
+    uint64_t positions = 0;
+    for (unsigned p = 0; p < position_classes_.size(); ++p) {
+      int c = position_classes_[p];
+      if (c < 0) {
+        continue;
+      }
+      const CharClass &char_class = classes_[c];
+      if (char_class.any || (unicodes.size() == 1 && char_class.Contains(unicodes[0]))) {
+        positions |= uint64_t{1} << p;
+      }
+    }
+    if (positions != 0) {
+      unichars_by_positions[positions].push_back(id);
+    }
+  }
+  uint64_t end_positions = 0;
+  for (unsigned p = 0; p < position_classes_.size(); ++p) {
+    if (position_classes_[p] < 0) {
+      end_positions |= uint64_t{1} << p;
+    }
+  }
+  // Subset construction of the states, each a set of positions.
+  uint64_t start = 0;
+  for (int s : starts_) {
+    start |= Closure(s);
+  }
+  std::vector<uint64_t> states(1, start);
+  std::map<uint64_t, int> state_ids;
+  state_ids[start] = 0;
+  for (unsigned s = 0; s < states.size(); ++s) {
+    uint64_t state = states[s];
+    final_.push_back((state & end_positions) != 0);
+    next_.resize(states.size() * num_unichars_, -1);
+    for (const auto &entry : unichars_by_positions) {
+      uint64_t taken = state & entry.first;
+      if (taken == 0) {
+        continue;
+      }
+      uint64_t target = 0;
+      for (unsigned p = 0; p < position_classes_.size(); ++p) {
+        if (taken & (uint64_t{1} << p)) {
+          target |= Closure(p + 1);
+        }
+      }
+      auto it = state_ids.find(target);
+      int target_id;
+      if (it == state_ids.end()) {
+        target_id = states.size();
+        state_ids[target] = target_id;
+        states.push_back(target);
+      } else {
+        target_id = it->second;
+      }
+      for (int id : entry.second) {
+        next_[s * num_unichars_ + id] = target_id;
+      }
+    }
+  }
+  next_.resize(states.size() * num_unichars_, -1);
+  pattern_ = pattern;
+  return true;
+}
+
+// Returns the state after unichar_id in state, or -1 if unichar_id can't
+// follow there.
+int PatternConstraint::Next(int state, int unichar_id) const {
+  if (unichar_id == UNICHAR_SPACE) {
+    return state;
+  }
+  if (unichar_id < 0 || unichar_id >= num_unichars_) {
+    return -1;
+  }
+  return next_[state * num_unichars_ + unichar_id];
+}
+
+// Parses pattern into classes_ and the positions, which are the pattern with
+// the repeats expanded, followed by an end position for each alternative.
+bool PatternConstraint::Parse(const char *pattern) {
+  classes_.clear();
+  position_classes_.clear();
+  optional_.clear();
+  starts_.assign(1, 0);
+  std::vector<char32> chars = UNICHAR::UTF8ToUTF32(pattern);
+  if (chars.empty()) {
+    tprintf("Empty or invalid UTF-8 label pattern: %s\n", pattern);
+    return false;
+  }
+  size_t i = 0;
+  // Reads a literal, which may be escaped, at i.
+  auto read_literal = [&chars, &i](char32 *ch) {
+    if (chars[i] == '\\') {
+      if (++i == chars.size()) {
+        return false;
+      }
+    }
+    *ch = chars[i++];
+    return true;
+  };
+  // Reads a decimal number at i.
+  auto read_number = [&chars, &i](int *number) {
+    if (i == chars.size() || chars[i] < '0' || chars[i] > '9') {
+      return false;
+    }
+    *number = 0;
+    while (i < chars.size() && chars[i] >= '0' && chars[i] <= '9' && *number <= kMaxPositions) {
+      *number = *number * 10 + chars[i++] - '0';
+    }
+    return true;
+  };
+  while (i < chars.size()) {
+    if (chars[i] == '|') {
+      position_classes_.push_back(-1);
+      optional_.push_back(false);
+      starts_.push_back(position_classes_.size());
+      ++i;
+      continue;
+    }
+    CharClass char_class;
+    if (chars[i] == '.') {
+      char_class.any = true;
+      ++i;
+    } else if (chars[i] == '[') {
+      ++i;
+      if (i < chars.size() && chars[i] == '^') {
+        char_class.negated = true;
+        ++i;
+      }
+      while (i < chars.size() && chars[i] != ']') {
+        char32 first, last;
+        if (!read_literal(&first)) {
+          break;
+        }
+        last = first;
+        if (i + 1 < chars.size() && chars[i] == '-' && chars[i + 1] != ']') {
+          ++i;
+          if (!read_literal(&last) || last < first) {
+            tprintf("Bad range in label pattern: %s\n", pattern);
+            return false;
+          }
+        }
+        char_class.ranges.emplace_back(first, last);
+      }
+      if (i == chars.size()) {
+        tprintf("Unterminated class in label pattern: %s\n", pattern);
+        return false;
+      }
+      ++i;
+    } else if (chars[i] == '?' || chars[i] == '{' || chars[i] == ']' || chars[i] == '}') {
+      tprintf("Unexpected '%c' in label pattern: %s\n", static_cast<char>(chars[i]), pattern);
+      return false;
+    } else {
+      char32 ch;
+      if (!read_literal(&ch)) {
+        tprintf("Trailing \\ in label pattern: %s\n", pattern);
+        return false;
+      }
+      char_class.ranges.emplace_back(ch, ch);
+    }
+    int min_count = 1;
+    int max_count = 1;
+    if (i < chars.size() && chars[i] == '?') {
+      min_count = 0;
+      ++i;
+    } else if (i < chars.size() && chars[i] == '{') {
+      ++i;
+      bool ok = read_number(&min_count);
+      max_count = min_count;
+      if (ok && i < chars.size() && chars[i] == ',') {
+        ++i;
+        ok = read_number(&max_count);
+      }
+      if (!ok || i == chars.size() || chars[i] != '}' || max_count < min_count || max_count == 0) {
+        tprintf("Bad repeat in label pattern: %s\n", pattern);
+        return false;
+      }
+      ++i;
+    }
+    int class_index = classes_.size();
+    classes_.push_back(char_class);
+    for (int r = 0; r < max_count && position_classes_.size() <= kMaxPositions; ++r) {
+      position_classes_.push_back(class_index);
+      optional_.push_back(r >= min_count);
+    }
+  }
+  position_classes_.push_back(-1);
+  optional_.push_back(false);
+  if (position_classes_.size() > kMaxPositions) {
+    tprintf("Label pattern too long, max %d characters over all alternatives: %s\n",
+            kMaxPositions - static_cast<int>(starts_.size()), pattern);
+    return false;
+  }
+  return true;
+}
+
+// Returns the set of positions reachable at pos, which is pos and any after
+// it that can be reached by skipping optional positions.
+uint64_t PatternConstraint::Closure(int pos) const {
+  uint64_t positions = uint64_t{1} << pos;
+  while (position_classes_[pos] >= 0 && optional_[pos]) {
+    positions |= uint64_t{1} << ++pos;
+  }
+  return positions;
+}
+
+} // namespace tesseract.
@@ -0,0 +1,124 @@
+///////////////////////////////////////////////////////////////////////
+// File:        labelconstraint.h
+// Description: Automata that restrict the unichar sequences of a line that
+//              the beam search may produce.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+///////////////////////////////////////////////////////////////////////
+
+#ifndef TESSERACT_LSTM_LABELCONSTRAINT_H_
+#define TESSERACT_LSTM_LABELCONSTRAINT_H_
+
+#include <tesseract/export.h>
+#include <tesseract/unichar.h> // for char32
+
+#include <cstdint> // for uint64_t
+#include <string>  // for std::string
+#include <utility> // for std::pair
+#include <vector>  // for std::vector
+
+namespace tesseract {
+
+class UNICHARSET;
+
+// A deterministic automaton over unichar_ids, consulted by RecodeBeamSearch
+// as it extends each path by a unichar, so that a line can only decode to a
+// sequence the automaton accepts. Paths that leave it are dropped at once,
+// and the outputs that no live path can take are left out of the top-n.
+// The start state is 0. Implementations must be immutable once built, as
+// the same constraint may serve several searches at once.
+class TESS_API LabelConstraint {
+public:
+  virtual ~LabelConstraint() = default;
+
+  // Returns the number of states.
+  virtual int NumStates() const = 0;
+  // Returns the state after unichar_id in state, or -1 if unichar_id can't
+  // follow there.
+  virtual int Next(int state, int unichar_id) const = 0;
+  // Returns true if a line may end in state.
+  virtual bool IsFinal(int state) const = 0;
+};
+
+// A LabelConstraint compiled from a pattern such as the one of a Chinese
+// licence plate:
+//   [京津沪渝冀豫云辽黑湘皖鲁新苏浙赣鄂桂甘晋蒙陕吉闽贵粤青藏川宁琼使领][A-Z][A-HJ-NP-Z0-9]{5,6}
+// The pattern is a sequence of characters, each optionally repeated, and
+// the whole line must match it.
+// A character is a UTF-8 literal, '.' for any unichar, or a class [...] of
+// literals and ranges a-z, negated by a leading ^. \ escapes the character
+// after it.
+// A repeat is ?, {n} or {m,n}.
+// Alternatives for different plate types are separated by |.
+// Spaces in the line are ignored, so a separator between the region and the
+// serial does no harm. Unichars of more than one code point only match '.'.
+class TESS_API PatternConstraint : public LabelConstraint {
+public:
+  // Compiles pattern against the unicharset of the recognizer. Returns
+  // false, with a message, if the pattern is malformed.
+  bool Compile(const char *pattern, const UNICHARSET &unicharset);
+
+  // The pattern last compiled successfully.
+  const std::string &pattern() const {
+    return pattern_;
+  }
+
+  int NumStates() const override {
+    return static_cast<int>(final_.size());
+  }
+  int Next(int state, int unichar_id) const override;
+  bool IsFinal(int state) const override {
+    return final_[state];
+  }
+
+private:
+  // A set of code points, as it appears in the pattern.
+  struct CharClass {
+    bool any = false;
+    bool negated = false;
+    std::vector<std::pair<char32, char32>> ranges;
+
+    bool Contains(char32 ch) const;
+  };
+
+  // Maximum number of positions over all alternatives, as a set of them is
+  // held in a uint64_t while compiling.
+  static const int kMaxPositions = 64;
+
+  // Parses pattern into classes_ and the positions, which are the pattern
+  // with the repeats expanded, followed by an end position for each
+  // alternative.
+  bool Parse(const char *pattern);
+  // Returns the set of positions reachable at pos, which is pos and any
+  // after it that can be reached by skipping optional positions.
+  uint64_t Closure(int pos) const;
+
+  std::vector<CharClass> classes_;
+  // The index to classes_ of each position, or -1 at the end of an
+  // alternative.
+  std::vector<int> position_classes_;
+  // True if the position may be skipped.
+  std::vector<bool> optional_;
+  // The first position of each alternative.
+  std::vector<int> starts_;
+
+  std::string pattern_;
+  // The size of the unicharset compiled for.
+  int num_unichars_ = 0;
+  // next_[state * num_unichars_ + unichar_id] is the next state or -1.
+  std::vector<int> next_;
+  // True for the accepting states.
+  std::vector<bool> final_;
+};
+
+} // namespace tesseract.
+
+#endif // TESSERACT_LSTM_LABELCONSTRAINT_H_
@@ -21,9 +21,8 @@
 
 #include "lstm.h"
 
-#ifdef _OPENMP
-#  include <omp.h>
-#endif
+#include <tesseract/taskscheduler.h>
+
 #include <cstdio>
 #include <cstdlib>
 #include <sstream> // for std::ostringstream
@@ -37,33 +36,6 @@
 #include "networkscratch.h"
 #include "tprintf.h"
 
-// Macros for openmp code if it is available, otherwise empty macros.
-#ifdef _OPENMP
-#  define PARALLEL_IF_OPENMP(__num_threads)                                  \
-    PRAGMA(omp parallel if (__num_threads > 1) num_threads(__num_threads)) { \
-      PRAGMA(omp sections nowait) {                                          \
-        PRAGMA(omp section) {
-#  define SECTION_IF_OPENMP \
-    }                       \
-    PRAGMA(omp section) {
-#  define END_PARALLEL_IF_OPENMP \
-    }                            \
-    } /* end of sections */      \
-    } /* end of parallel section */
-
-// Define the portable PRAGMA macro.
-#  ifdef _MSC_VER // Different _Pragma
-#    define PRAGMA(x) __pragma(x)
-#  else
-#    define PRAGMA(x) _Pragma(#    x)
-#  endif // _MSC_VER
-
-#else // _OPENMP
-#  define PARALLEL_IF_OPENMP(__num_threads)
-#  define SECTION_IF_OPENMP
-#  define END_PARALLEL_IF_OPENMP
-#endif // _OPENMP
-
 namespace tesseract {
 
 // Max absolute value of state_. It is reasonably high to enable the state
@@ -104,6 +76,8 @@ LSTM::LSTM(const std::string &name, int ni, int ns, int no, bool two_dimensional
     , ns_(ns)
     , nf_(0)
     , is_2d_(two_dimensional)
+    , stacked_valid_(false)
+    , gates_released_(false)
     , softmax_(nullptr)
     , input_width_(0) {
   if (two_dimensional) {
@@ -156,6 +130,7 @@ void LSTM::SetEnableTraining(TrainingState state) {
     }
   } else {
     if (state == TS_ENABLED && training_ != TS_ENABLED) {
+      UnstackGateWeights();
       for (int w = 0; w < WT_COUNT; ++w) {
         if (w == GFS && !Is2D()) {
           continue;
@@ -168,12 +143,20 @@ void LSTM::SetEnableTraining(TrainingState state) {
   if (softmax_ != nullptr) {
     softmax_->SetEnableTraining(state);
   }
+  // Stack the gates now, rather than in the first Forward, which may share
+  // the network with other threads.
+  if (!IsTraining() && !stacked_valid_) {
+    StackGateWeights();
+  } else {
+    ReleaseGateWeights();
+  }
 }
 
 // Sets up the network for training. Initializes weights using weights of
 // scale `range` picked according to the random number generator `randomizer`.
 int LSTM::InitWeights(float range, TRand *randomizer) {
   Network::SetRandomizer(randomizer);
+  UnstackGateWeights();
   num_weights_ = 0;
   for (int w = 0; w < WT_COUNT; ++w) {
     if (w == GFS && !Is2D()) {
@@ -200,6 +183,7 @@ int LSTM::RemapOutputs(int old_no, const std::vector<int> &code_map) {
 
 // Converts a float network to an int network.
 void LSTM::ConvertToInt() {
+  UnstackGateWeights();
   for (int w = 0; w < WT_COUNT; ++w) {
     if (w == GFS && !Is2D()) {
       continue;
@@ -209,10 +193,12 @@ void LSTM::ConvertToInt() {
   if (softmax_ != nullptr) {
     softmax_->ConvertToInt();
   }
+  StackGateWeights();
 }
 
 // Sets up the network for training using the given weight_range.
 void LSTM::DebugWeights() {
+  UnstackGateWeights();
   for (int w = 0; w < WT_COUNT; ++w) {
     if (w == GFS && !Is2D()) {
       continue;
@@ -238,7 +224,14 @@ bool LSTM::Serialize(TFile *fp) const {
     if (w == GFS && !Is2D()) {
       continue;
     }
-    if (!gate_weights_[w].Serialize(IsTraining(), fp)) {
+    if (gates_released_) {
+      // Write the same matrix as before the stacking.
+      WeightMatrix gate(gate_weights_[w]);
+      gate.InitUnstacked(input_weights_, recurrent_weights_, w * ns_, ns_);
+      if (!gate.Serialize(IsTraining(), fp)) {
+        return false;
+      }
+    } else if (!gate_weights_[w].Serialize(IsTraining(), fp)) {
       return false;
     }
   }
@@ -262,6 +255,8 @@ bool LSTM::DeSerialize(TFile *fp) {
     nf_ = 0;
   }
   is_2d_ = false;
+  stacked_valid_ = false;
+  gates_released_ = false;
   for (int w = 0; w < WT_COUNT; ++w) {
     if (w == GFS && !Is2D()) {
       continue;
@@ -283,6 +278,9 @@ bool LSTM::DeSerialize(TFile *fp) {
   } else {
     softmax_ = nullptr;
   }
+  if (!IsTraining() && !Is2D()) {
+    StackGateWeights();
+  }
   return true;
 }
 
@@ -290,8 +288,6 @@ bool LSTM::DeSerialize(TFile *fp) {
 // See NetworkCpp for a detailed discussion of the arguments.
 void LSTM::Forward(bool debug, const NetworkIO &input, const TransposedArray *input_transpose,
                    NetworkScratch *scratch, NetworkIO *output) {
-  input_map_ = input.stride_map();
-  input_width_ = input.Width();
   if (softmax_ != nullptr) {
     output->ResizeFloat(input, no_);
   } else if (type_ == NT_LSTM_SUMMARY) {
@@ -299,6 +295,23 @@ void LSTM::Forward(bool debug, const NetworkIO &input, const TransposedArray *in
   } else {
     output->Resize(input, no_);
   }
+  if (!IsTraining() && !Is2D()) {
+    ForwardInference(input, scratch, output);
+#ifndef GRAPHICS_DISABLED
+    if (debug) {
+      DisplayForward(*output);
+    }
+#endif
+    return;
+  }
+  // The loop below runs through the members, so a 2-D network shared for
+  // inference runs it for one caller at a time.
+  std::unique_lock<std::mutex> lock(forward_mutex_, std::defer_lock);
+  if (!IsTraining()) {
+    lock.lock();
+  }
+  input_map_ = input.stride_map();
+  input_width_ = input.Width();
   ResizeForward(input);
   // Temporary storage of forward computation for each gate.
   NetworkScratch::FloatVec temp_lines[WT_COUNT];
@@ -371,56 +384,43 @@ void LSTM::Forward(bool debug, const NetworkIO &input, const TransposedArray *in
     if (!source_.int_mode()) {
       source_.ReadTimeStep(t, curr_input);
     }
-    // Matrix multiply the inputs with the source.
-    PARALLEL_IF_OPENMP(GFS)
-    // It looks inefficient to create the threads on each t iteration, but the
-    // alternative of putting the parallel outside the t loop, a single around
-    // the t-loop and then tasks in place of the sections is a *lot* slower.
-    // Cell inputs.
-    if (source_.int_mode()) {
-      gate_weights_[CI].MatrixDotVector(source_.i(t), temp_lines[CI]);
-    } else {
-      gate_weights_[CI].MatrixDotVector(curr_input, temp_lines[CI]);
-    }
-    FuncInplace<GFunc>(ns_, temp_lines[CI]);
-
-    SECTION_IF_OPENMP
-    // Input Gates.
-    if (source_.int_mode()) {
-      gate_weights_[GI].MatrixDotVector(source_.i(t), temp_lines[GI]);
-    } else {
-      gate_weights_[GI].MatrixDotVector(curr_input, temp_lines[GI]);
-    }
-    FuncInplace<FFunc>(ns_, temp_lines[GI]);
-
-    SECTION_IF_OPENMP
-    // 1-D forget gates.
-    if (source_.int_mode()) {
-      gate_weights_[GF1].MatrixDotVector(source_.i(t), temp_lines[GF1]);
-    } else {
-      gate_weights_[GF1].MatrixDotVector(curr_input, temp_lines[GF1]);
-    }
-    FuncInplace<FFunc>(ns_, temp_lines[GF1]);
-
-    // 2-D forget gates.
-    if (Is2D()) {
+    // Matrix multiply the inputs with the source, a gate per task.
+    auto multiply_gate = [&](int gate) {
       if (source_.int_mode()) {
-        gate_weights_[GFS].MatrixDotVector(source_.i(t), temp_lines[GFS]);
+        gate_weights_[gate].MatrixDotVector(source_.i(t), temp_lines[gate]);
       } else {
-        gate_weights_[GFS].MatrixDotVector(curr_input, temp_lines[GFS]);
+        gate_weights_[gate].MatrixDotVector(curr_input, temp_lines[gate]);
       }
-      FuncInplace<FFunc>(ns_, temp_lines[GFS]);
-    }
-
-    SECTION_IF_OPENMP
-    // Output gates.
-    if (source_.int_mode()) {
-      gate_weights_[GO].MatrixDotVector(source_.i(t), temp_lines[GO]);
-    } else {
-      gate_weights_[GO].MatrixDotVector(curr_input, temp_lines[GO]);
-    }
-    FuncInplace<FFunc>(ns_, temp_lines[GO]);
-    END_PARALLEL_IF_OPENMP
+    };
+    TaskScheduler::Get()->ParallelFor(4, [&](int task) {
+      switch (task) {
+        case 0:
+          // Cell inputs.
+          multiply_gate(CI);
+          FuncInplace<GFunc>(ns_, temp_lines[CI]);
+          break;
+        case 1:
+          // Input Gates.
+          multiply_gate(GI);
+          FuncInplace<FFunc>(ns_, temp_lines[GI]);
+          break;
+        case 2:
+          // 1-D forget gates.
+          multiply_gate(GF1);
+          FuncInplace<FFunc>(ns_, temp_lines[GF1]);
+          // 2-D forget gates.
+          if (Is2D()) {
+            multiply_gate(GFS);
+            FuncInplace<FFunc>(ns_, temp_lines[GFS]);
+          }
+          break;
+        default:
+          // Output gates.
+          multiply_gate(GO);
+          FuncInplace<FFunc>(ns_, temp_lines[GO]);
+          break;
+      }
+    });
 
     // Apply forget gate to state.
     MultiplyVectorsInPlace(ns_, temp_lines[GF1], curr_state);
@@ -502,6 +502,227 @@ void LSTM::Forward(bool debug, const NetworkIO &input, const TransposedArray *in
 #endif
 }
 
+// Rebuilds input_weights_ and recurrent_weights_ from gate_weights_.
+void LSTM::StackGateWeights() {
+  if (gates_released_) {
+    // The stacked matrices are the only copy and cannot be stale.
+    return;
+  }
+  stacked_valid_ = false;
+  if (Is2D()) {
+    return;
+  }
+  // CI, GI, GF1 and GO are the first 4 WeightTypes, GFS is only 2-D.
+  input_weights_.InitStacked(gate_weights_, GFS, 0, ni_, true);
+  recurrent_weights_.InitStacked(gate_weights_, GFS, ni_, nf_ + ns_, false);
+  stacked_valid_ = true;
+  ReleaseGateWeights();
+}
+
+// Frees gate_weights_ once training is disabled for good. Without this a
+// loaded model holds every 1-D LSTM weight twice, in int mode with the
+// SIMD shaped copy of each as well.
+void LSTM::ReleaseGateWeights() {
+  if (training_ != TS_DISABLED || !stacked_valid_ || gates_released_) {
+    return;
+  }
+  for (int w = 0; w < GFS; ++w) {
+    gate_weights_[w].ReleaseWeights();
+  }
+  gates_released_ = true;
+}
+
+// Rebuilds gate_weights_ from the stacked matrices if they were freed.
+// The rows of gate w are [w * ns_, (w + 1) * ns_) of both halves.
+void LSTM::UnstackGateWeights() {
+  if (!gates_released_) {
+    return;
+  }
+  for (int w = 0; w < GFS; ++w) {
+    gate_weights_[w].InitUnstacked(input_weights_, recurrent_weights_, w * ns_, ns_);
+  }
+  gates_released_ = false;
+}
+
+// Forward for a 1-D LSTM at inference.
+// Produces the same output as the timestep loop in Forward, up to rounding.
+void LSTM::ForwardInference(const NetworkIO &input, NetworkScratch *scratch, NetworkIO *output) {
+  if (!stacked_valid_) {
+    StackGateWeights();
+  }
+  // Every row of every image in the batch is an independent sequence.
+  const StrideMap &input_map = input.stride_map();
+  std::vector<int> row_t, row_width, row_dest;
+  int max_width = 0;
+  for (int b = 0; b < input_map.Size(FD_BATCH); ++b) {
+    StrideMap::Index first(input_map, b, 0, 0);
+    int height = first.MaxIndexOfDim(FD_HEIGHT) + 1;
+    for (int y = 0; y < height; ++y) {
+      StrideMap::Index row_index(input_map, b, y, 0);
+      row_t.push_back(row_index.t());
+      row_width.push_back(row_index.MaxIndexOfDim(FD_WIDTH) + 1);
+      max_width = std::max(max_width, row_width.back());
+      if (type_ == NT_LSTM_SUMMARY) {
+        StrideMap::Index dest_index(output->stride_map(), b, y, 0);
+        row_dest.push_back(dest_index.t());
+      }
+    }
+  }
+  int num_rows = row_t.size();
+  bool int_mode = input_weights_.is_int_mode();
+  int num_gates = GFS * ns_;
+  int rounded_gates = num_gates;
+  if (int_mode && IntSimdMatrix::intSimdMatrix) {
+    rounded_gates = IntSimdMatrix::intSimdMatrix->RoundOutputs(num_gates);
+  }
+
+  // The input half of the gates for every valid timestep, as one matrix
+  // product over blocks of timesteps.
+  std::vector<int> valid_t;
+  for (int r = 0; r < num_rows; ++r) {
+    for (int x = 0; x < row_width[r]; ++x) {
+      valid_t.push_back(row_t[r] + x);
+    }
+  }
+  NetworkScratch::GradientStore gate_store;
+  gate_store.Init(input.Width(), rounded_gates, scratch);
+  TransposedArray &gate_inputs = *gate_store.get();
+  const int kBlockSize = 32;
+  int num_blocks = (valid_t.size() + kBlockSize - 1) / kBlockSize;
+  TaskScheduler::Get()->ParallelFor(num_blocks, [&](int block) {
+    int start = block * kBlockSize;
+    int size = std::min<int>(kBlockSize, valid_t.size() - start);
+    TFloat *projections[kBlockSize];
+    for (int k = 0; k < size; ++k) {
+      projections[k] = gate_inputs[valid_t[start + k]];
+    }
+    if (int_mode) {
+      const int8_t *inputs[kBlockSize];
+      for (int k = 0; k < size; ++k) {
+        inputs[k] = input.i(valid_t[start + k]);
+      }
+      input_weights_.MatrixDotVectors(size, inputs, projections);
+    } else {
+      // The float NetworkIO holds float, the weights may be double.
+      std::vector<TFloat> block_inputs(size * ni_);
+      const TFloat *inputs[kBlockSize];
+      for (int k = 0; k < size; ++k) {
+        input.ReadTimeStep(valid_t[start + k], &block_inputs[k * ni_]);
+        inputs[k] = &block_inputs[k * ni_];
+      }
+      input_weights_.MatrixDotVectors(size, inputs, projections);
+    }
+  });
+
+  // Per row recurrent half of the gates, state and output.
+  int num_recurrent = nf_ + ns_;
+  std::vector<NetworkScratch::FloatVec> recurrent_gates(num_rows);
+  std::vector<NetworkScratch::FloatVec> curr_states(num_rows), curr_outputs(num_rows);
+  std::vector<NetworkScratch::FloatVec> float_recurrents, softmax_outputs;
+  for (int r = 0; r < num_rows; ++r) {
+    recurrent_gates[r].Init(num_gates, rounded_gates, scratch);
+    curr_states[r].Init(ns_, scratch);
+    ZeroVector<TFloat>(ns_, curr_states[r]);
+    curr_outputs[r].Init(ns_, scratch);
+    ZeroVector<TFloat>(ns_, curr_outputs[r]);
+  }
+  NetworkScratch::IO int_recurrents;
+  if (int_mode) {
+    int_recurrents.Resize2d(true, num_rows, recurrent_weights_.RoundInputs(num_recurrent),
+                            scratch);
+  } else {
+    float_recurrents.resize(num_rows);
+    for (auto &float_recurrent : float_recurrents) {
+      float_recurrent.Init(num_recurrent, scratch);
+    }
+  }
+  NetworkScratch::IO int_output;
+  if (softmax_ != nullptr) {
+    softmax_outputs.resize(num_rows);
+    for (auto &softmax_output : softmax_outputs) {
+      softmax_output.Init(no_, scratch);
+      ZeroVector<TFloat>(no_, softmax_output);
+    }
+    if (input.int_mode()) {
+      int_output.Resize2d(true, 1, gate_weights_[CI].RoundInputs(ns_), scratch);
+    }
+    softmax_->SetupForward(input, nullptr);
+  }
+  // Pointers to the recurrent inputs and gates of the rows running at this x.
+  std::vector<int> active(num_rows);
+  std::vector<const TFloat *> float_inputs(num_rows);
+  std::vector<const int8_t *> int_inputs(num_rows);
+  std::vector<TFloat *> gate_outputs(num_rows);
+  for (int x = 0; x < max_width; ++x) {
+    int num_active = 0;
+    for (int r = 0; r < num_rows; ++r) {
+      if (x >= row_width[r]) {
+        continue;
+      }
+      // The recurrent input is [softmax feedback, previous output].
+      if (int_mode) {
+        if (softmax_ != nullptr) {
+          int_recurrents->WriteTimeStepPart(r, 0, nf_, softmax_outputs[r]);
+        }
+        int_recurrents->WriteTimeStepPart(r, nf_, ns_, curr_outputs[r]);
+        int_inputs[num_active] = int_recurrents->i(r);
+      } else {
+        TFloat *recurrent = float_recurrents[r];
+        if (softmax_ != nullptr) {
+          CopyVector(nf_, softmax_outputs[r], recurrent);
+        }
+        CopyVector(ns_, curr_outputs[r], recurrent + nf_);
+        float_inputs[num_active] = recurrent;
+      }
+      gate_outputs[num_active] = recurrent_gates[r];
+      active[num_active++] = r;
+    }
+    // A single product over the stacked gates of all the active rows.
+    if (int_mode) {
+      recurrent_weights_.MatrixDotVectors(num_active, &int_inputs[0], &gate_outputs[0]);
+    } else {
+      recurrent_weights_.MatrixDotVectors(num_active, &float_inputs[0], &gate_outputs[0]);
+    }
+    for (int a = 0; a < num_active; ++a) {
+      int r = active[a];
+      int t = row_t[r] + x;
+      TFloat *curr_state = curr_states[r];
+      TFloat *curr_output = curr_outputs[r];
+      // Fused activations, gating, state update, clip and output.
+      const TFloat *projected = gate_inputs[t];
+      const TFloat *recurrent = gate_outputs[a];
+      for (int i = 0; i < ns_; ++i) {
+        TFloat ci = GFunc()(projected[CI * ns_ + i] + recurrent[CI * ns_ + i]);
+        TFloat gi = FFunc()(projected[GI * ns_ + i] + recurrent[GI * ns_ + i]);
+        TFloat gf = FFunc()(projected[GF1 * ns_ + i] + recurrent[GF1 * ns_ + i]);
+        TFloat go = FFunc()(projected[GO * ns_ + i] + recurrent[GO * ns_ + i]);
+        TFloat state = ClipToRange<TFloat>(curr_state[i] * gf + ci * gi, -kStateClip, kStateClip);
+        curr_state[i] = state;
+        curr_output[i] = HFunc()(state) * go;
+      }
+      if (softmax_ != nullptr) {
+        TFloat *softmax_output = softmax_outputs[r];
+        if (input.int_mode()) {
+          int_output->WriteTimeStepPart(0, 0, ns_, curr_output);
+          softmax_->ForwardTimeStep(int_output->i(0), t, softmax_output);
+        } else {
+          softmax_->ForwardTimeStep(curr_output, t, softmax_output);
+        }
+        output->WriteTimeStep(t, softmax_output);
+        if (type_ == NT_LSTM_SOFTMAX_ENCODED) {
+          CodeInBinary(no_, nf_, softmax_output);
+        }
+      } else if (type_ == NT_LSTM_SUMMARY) {
+        if (x + 1 == row_width[r]) {
+          output->WriteTimeStep(row_dest[r], curr_output);
+        }
+      } else {
+        output->WriteTimeStep(t, curr_output);
+      }
+    }
+  }
+}
+
 // Runs backward propagation of errors on the deltas line.
 // See NetworkCpp for a detailed discussion of the arguments.
 bool LSTM::Backward(bool debug, const NetworkIO &fwd_deltas, NetworkScratch *scratch,
@@ -650,54 +871,61 @@ bool LSTM::Backward(bool debug, const NetworkIO &fwd_deltas, NetworkScratch *scr
       tprintf("\n");
     }
 #endif
-    // Matrix multiply to get the source errors.
-    PARALLEL_IF_OPENMP(GFS)
-
-    // Cell inputs.
-    node_values_[CI].FuncMultiply3<GPrime>(t, node_values_[GI], t, curr_stateerr, gate_errors[CI]);
-    ClipVector(ns_, -kErrClip, kErrClip, gate_errors[CI].get());
-    gate_weights_[CI].VectorDotMatrix(gate_errors[CI], sourceerr_temps[CI]);
-    gate_errors_t[CI].get()->WriteStrided(t, gate_errors[CI]);
-
-    SECTION_IF_OPENMP
-    // Input Gates.
-    node_values_[GI].FuncMultiply3<FPrime>(t, node_values_[CI], t, curr_stateerr, gate_errors[GI]);
-    ClipVector(ns_, -kErrClip, kErrClip, gate_errors[GI].get());
-    gate_weights_[GI].VectorDotMatrix(gate_errors[GI], sourceerr_temps[GI]);
-    gate_errors_t[GI].get()->WriteStrided(t, gate_errors[GI]);
-
-    SECTION_IF_OPENMP
-    // 1-D forget Gates.
-    if (t > 0) {
-      node_values_[GF1].FuncMultiply3<FPrime>(t, state_, t - 1, curr_stateerr, gate_errors[GF1]);
-      ClipVector(ns_, -kErrClip, kErrClip, gate_errors[GF1].get());
-      gate_weights_[GF1].VectorDotMatrix(gate_errors[GF1], sourceerr_temps[GF1]);
-    } else {
-      memset(gate_errors[GF1], 0, ns_ * sizeof(gate_errors[GF1][0]));
-      memset(sourceerr_temps[GF1], 0, na_ * sizeof(*sourceerr_temps[GF1]));
-    }
-    gate_errors_t[GF1].get()->WriteStrided(t, gate_errors[GF1]);
-
-    // 2-D forget Gates.
-    if (up_pos >= 0) {
-      node_values_[GFS].FuncMultiply3<FPrime>(t, state_, up_pos, curr_stateerr, gate_errors[GFS]);
-      ClipVector(ns_, -kErrClip, kErrClip, gate_errors[GFS].get());
-      gate_weights_[GFS].VectorDotMatrix(gate_errors[GFS], sourceerr_temps[GFS]);
-    } else {
-      memset(gate_errors[GFS], 0, ns_ * sizeof(gate_errors[GFS][0]));
-      memset(sourceerr_temps[GFS], 0, na_ * sizeof(*sourceerr_temps[GFS]));
-    }
-    if (Is2D()) {
-      gate_errors_t[GFS].get()->WriteStrided(t, gate_errors[GFS]);
-    }
+    // Matrix multiply to get the source errors, a gate per task.
+    TaskScheduler::Get()->ParallelFor(4, [&](int task) {
+      switch (task) {
+        case 0:
+          // Cell inputs.
+          node_values_[CI].FuncMultiply3<GPrime>(t, node_values_[GI], t, curr_stateerr,
+                                                  gate_errors[CI]);
+          ClipVector(ns_, -kErrClip, kErrClip, gate_errors[CI].get());
+          gate_weights_[CI].VectorDotMatrix(gate_errors[CI], sourceerr_temps[CI]);
+          gate_errors_t[CI].get()->WriteStrided(t, gate_errors[CI]);
+          break;
+        case 1:
+          // Input Gates.
+          node_values_[GI].FuncMultiply3<FPrime>(t, node_values_[CI], t, curr_stateerr,
+                                                  gate_errors[GI]);
+          ClipVector(ns_, -kErrClip, kErrClip, gate_errors[GI].get());
+          gate_weights_[GI].VectorDotMatrix(gate_errors[GI], sourceerr_temps[GI]);
+          gate_errors_t[GI].get()->WriteStrided(t, gate_errors[GI]);
+          break;
+        case 2:
+          // 1-D forget Gates.
+          if (t > 0) {
+            node_values_[GF1].FuncMultiply3<FPrime>(t, state_, t - 1, curr_stateerr,
+                                                     gate_errors[GF1]);
+            ClipVector(ns_, -kErrClip, kErrClip, gate_errors[GF1].get());
+            gate_weights_[GF1].VectorDotMatrix(gate_errors[GF1], sourceerr_temps[GF1]);
+          } else {
+            memset(gate_errors[GF1], 0, ns_ * sizeof(gate_errors[GF1][0]));
+            memset(sourceerr_temps[GF1], 0, na_ * sizeof(*sourceerr_temps[GF1]));
+          }
+          gate_errors_t[GF1].get()->WriteStrided(t, gate_errors[GF1]);
 
-    SECTION_IF_OPENMP
-    // Output gates.
-    state_.Func2Multiply3<HFunc, FPrime>(node_values_[GO], t, outputerr, gate_errors[GO]);
-    ClipVector(ns_, -kErrClip, kErrClip, gate_errors[GO].get());
-    gate_weights_[GO].VectorDotMatrix(gate_errors[GO], sourceerr_temps[GO]);
-    gate_errors_t[GO].get()->WriteStrided(t, gate_errors[GO]);
-    END_PARALLEL_IF_OPENMP
+          // 2-D forget Gates.
+          if (up_pos >= 0) {
+            node_values_[GFS].FuncMultiply3<FPrime>(t, state_, up_pos, curr_stateerr,
+                                                     gate_errors[GFS]);
+            ClipVector(ns_, -kErrClip, kErrClip, gate_errors[GFS].get());
+            gate_weights_[GFS].VectorDotMatrix(gate_errors[GFS], sourceerr_temps[GFS]);
+          } else {
+            memset(gate_errors[GFS], 0, ns_ * sizeof(gate_errors[GFS][0]));
+            memset(sourceerr_temps[GFS], 0, na_ * sizeof(*sourceerr_temps[GFS]));
+          }
+          if (Is2D()) {
+            gate_errors_t[GFS].get()->WriteStrided(t, gate_errors[GFS]);
+          }
+          break;
+        default:
+          // Output gates.
+          state_.Func2Multiply3<HFunc, FPrime>(node_values_[GO], t, outputerr, gate_errors[GO]);
+          ClipVector(ns_, -kErrClip, kErrClip, gate_errors[GO].get());
+          gate_weights_[GO].VectorDotMatrix(gate_errors[GO], sourceerr_temps[GO]);
+          gate_errors_t[GO].get()->WriteStrided(t, gate_errors[GO]);
+          break;
+      }
+    });
 
     SumVectors(na_, sourceerr_temps[CI], sourceerr_temps[GI], sourceerr_temps[GF1],
                sourceerr_temps[GO], sourceerr_temps[GFS], curr_sourceerr);
@@ -720,15 +948,13 @@ bool LSTM::Backward(bool debug, const NetworkIO &fwd_deltas, NetworkScratch *scr
   source_.Transpose(source_t.get());
   state_t.Init(ns_, width, scratch);
   state_.Transpose(state_t.get());
-#ifdef _OPENMP
-#  pragma omp parallel for num_threads(GFS) if (!Is2D())
-#endif
-  for (int w = 0; w < WT_COUNT; ++w) {
+  TaskScheduler *scheduler = Is2D() ? TaskScheduler::Serial() : TaskScheduler::Get();
+  scheduler->ParallelFor(WT_COUNT, [&](int w) {
     if (w == GFS && !Is2D()) {
-      continue;
+      return;
     }
     gate_weights_[w].SumOuterTransposed(*gate_errors_t[w], *source_t, false);
-  }
+  });
   if (softmax_ != nullptr) {
     softmax_->FinishBackward(*softmax_errors_t);
   }
@@ -747,6 +973,7 @@ void LSTM::Update(float learning_rate, float momentum, float adam_beta, int num_
     }
     gate_weights_[w].Update(learning_rate, momentum, adam_beta, num_samples);
   }
+  stacked_valid_ = false;
   if (softmax_ != nullptr) {
     softmax_->Update(learning_rate, momentum, adam_beta, num_samples);
   }
@@ -761,6 +988,7 @@ void LSTM::Update(float learning_rate, float momentum, float adam_beta, int num_
 void LSTM::CountAlternators(const Network &other, TFloat *same, TFloat *changed) const {
   ASSERT_HOST(other.type() == type_);
   const LSTM *lstm = static_cast<const LSTM *>(&other);
+  ASSERT_HOST(!gates_released_ && !lstm->gates_released_);
   for (int w = 0; w < WT_COUNT; ++w) {
     if (w == GFS && !Is2D()) {
       continue;
@@ -776,6 +1004,7 @@ void LSTM::CountAlternators(const Network &other, TFloat *same, TFloat *changed)
 
 // Prints the weights for debug purposes.
 void LSTM::PrintW() {
+  UnstackGateWeights();
   tprintf("Weight state:%s\n", name_.c_str());
   for (int w = 0; w < WT_COUNT; ++w) {
     if (w == GFS && !Is2D()) {
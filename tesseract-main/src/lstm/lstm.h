@@ -21,6 +21,8 @@
 #include "fullyconnected.h"
 #include "network.h"
 
+#include <mutex> // for std::mutex
+
 namespace tesseract {
 
 // C++ Implementation of the LSTM class from lstm.py.
@@ -123,6 +125,19 @@ public:
 private:
   // Resizes forward data to cope with an input image of the given width.
   void ResizeForward(const NetworkIO &input);
+  // Forward for a 1-D LSTM at inference. The input half of all the gates is
+  // computed for every timestep up front, with input_weights_. All the rows
+  // of the batch then step along x together, each step being a single
+  // product with recurrent_weights_ over the rows that are still running,
+  // and one fused pass of the activations and state update.
+  void ForwardInference(const NetworkIO &input, NetworkScratch *scratch, NetworkIO *output);
+  // Rebuilds input_weights_ and recurrent_weights_ from gate_weights_.
+  void StackGateWeights();
+  // Frees gate_weights_ once training is disabled for good, as the stacked
+  // matrices hold the same weights.
+  void ReleaseGateWeights();
+  // Rebuilds gate_weights_ from the stacked matrices if they were freed.
+  void UnstackGateWeights();
 
 private:
   // Size of padded input to weight matrices = ni_ + no_ for 1-D operation
@@ -141,6 +156,16 @@ private:
 
   // Gate weight arrays of size [na + 1, no].
   WeightMatrix gate_weights_[WT_COUNT];
+  // The CI, GI, GF1 and GO gate weights for ForwardInference, in that order,
+  // split into the input columns with the bias, and the recurrent columns
+  // (softmax feedback and previous output). NOT SERIALIZED.
+  WeightMatrix input_weights_;
+  WeightMatrix recurrent_weights_;
+  // True if the two above are up to date with gate_weights_.
+  bool stacked_valid_;
+  // True if gate_weights_ hold no weights, only their mode, as a 1-D LSTM
+  // with training disabled keeps just the stacked copy.
+  bool gates_released_;
   // Used only if this is a softmax LSTM.
   FullyConnected *softmax_;
   // Input padded with previous output of size [width, na].
@@ -154,6 +179,8 @@ private:
   // Preserved input stride_map used for Backward when NT_LSTM_SQUASHED.
   StrideMap input_map_;
   int input_width_;
+  // Held by a Forward that runs through the members above, when not training.
+  std::mutex forward_mutex_;
 };
 
 } // namespace tesseract.
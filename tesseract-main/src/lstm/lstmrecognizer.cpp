@@ -30,13 +30,16 @@
 #include "input.h"
 #include "lstm.h"
 #include "normalis.h"
+#include "object_cache.h"
 #include "pageres.h"
 #include "ratngs.h"
 #include "recodebeam.h"
 #include "scrollview.h"
 #include "statistc.h"
 #include "tprintf.h"
+#include <tesseract/taskscheduler.h>
 
+#include <functional> // for std::bind
 #include <unordered_set>
 #include <vector>
 
@@ -47,6 +50,12 @@ const double kDictRatio = 2.25;
 // Default certainty offset to give the dictionary a chance.
 const double kCertOffset = -0.085;
 
+// The models of LoadShared, by traineddata file.
+static ObjectCache<LSTMRecognizer> &SharedModels() {
+  static ObjectCache<LSTMRecognizer> cache;
+  return cache;
+}
+
 LSTMRecognizer::LSTMRecognizer(const std::string &language_data_path_prefix)
     : LSTMRecognizer::LSTMRecognizer() {
   ccutil_.language_data_path_prefix = language_data_path_prefix;
@@ -54,6 +63,7 @@ LSTMRecognizer::LSTMRecognizer(const std::string &language_data_path_prefix)
 
 LSTMRecognizer::LSTMRecognizer()
     : network_(nullptr)
+    , shared_model_(nullptr)
     , training_flags_(0)
     , training_iteration_(0)
     , sample_iteration_(0)
@@ -63,12 +73,20 @@ LSTMRecognizer::LSTMRecognizer()
     , adam_beta_(0.0f)
     , dict_(nullptr)
     , search_(nullptr)
-    , debug_win_(nullptr) {}
+    , label_constraint_(nullptr)
+    , parallel_lines_(false)
+    , debug_win_(nullptr) {
+  // Noise padding draws from randomizer_ even if the network is shared.
+  scratch_space_.set_randomizer(&randomizer_);
+}
 
 LSTMRecognizer::~LSTMRecognizer() {
-  delete network_;
+  ReleaseNetwork();
   delete dict_;
   delete search_;
+  for (auto search : line_searches_) {
+    delete search;
+  }
 }
 
 // Loads a model from mgr, including the dictionary only if lang is not null.
@@ -89,6 +107,70 @@ bool LSTMRecognizer::Load(const ParamsVectors *params, const std::string &lang,
   return true;
 }
 
+// As Load, but the network is shared, read-only, by all the recognizers
+// loaded this way from the same traineddata file.
+bool LSTMRecognizer::LoadShared(const ParamsVectors *params, const std::string &lang,
+                                TessdataManager *mgr) {
+  std::string model_id = mgr->GetDataFileName();
+  model_id += kTessdataFileSuffixes[TESSDATA_LSTM];
+  LSTMRecognizer *model =
+      SharedModels().Get(model_id, std::bind(&LSTMRecognizer::LoadSharedModel, mgr));
+  if (model == nullptr) {
+    return false;
+  }
+  ReleaseNetwork();
+  shared_model_ = model;
+  network_ = model->network_;
+  ccutil_.unicharset.CopyFrom(model->GetUnicharset());
+  recoder_ = model->recoder_;
+  network_str_ = model->network_str_;
+  training_flags_ = model->training_flags_;
+  training_iteration_ = model->training_iteration_;
+  sample_iteration_ = model->sample_iteration_;
+  null_char_ = model->null_char_;
+  adam_beta_ = model->adam_beta_;
+  learning_rate_ = model->learning_rate_;
+  momentum_ = model->momentum_;
+  if (lang.empty()) {
+    return true;
+  }
+  // Allow it to run without a dictionary.
+  LoadDictionary(params, lang, mgr);
+  return true;
+}
+
+// Deletes the shared networks that no recognizer uses any more.
+void LSTMRecognizer::DeleteUnusedSharedModels() {
+  SharedModels().DeleteUnusedObjects();
+}
+
+// Deletes the network, or gives up the shared model it belongs to.
+void LSTMRecognizer::ReleaseNetwork() {
+  if (shared_model_ != nullptr) {
+    SharedModels().Free(shared_model_);
+    shared_model_ = nullptr;
+  } else {
+    delete network_;
+  }
+  network_ = nullptr;
+}
+
+// Deserializes the model of LoadShared from mgr. Training is disabled, so
+// that Forward leaves the network alone, and may run in several threads.
+LSTMRecognizer *LSTMRecognizer::LoadSharedModel(TessdataManager *mgr) {
+  TFile fp;
+  if (!mgr->GetComponent(TESSDATA_LSTM, &fp)) {
+    return nullptr;
+  }
+  auto *model = new LSTMRecognizer;
+  if (!model->DeSerialize(mgr, &fp)) {
+    delete model;
+    return nullptr;
+  }
+  model->network_->SetEnableTraining(TS_DISABLED);
+  return model;
+}
+
 // Writes to the given file. Returns false in case of error.
 bool LSTMRecognizer::Serialize(const TessdataManager *mgr, TFile *fp) const {
   bool include_charsets = mgr == nullptr || !mgr->IsComponentAvailable(TESSDATA_LSTM_RECODER) ||
@@ -131,7 +213,7 @@ bool LSTMRecognizer::Serialize(const TessdataManager *mgr, TFile *fp) const {
 
 // Reads from the given file. Returns false in case of error.
 bool LSTMRecognizer::DeSerialize(const TessdataManager *mgr, TFile *fp) {
-  delete network_;
+  ReleaseNetwork();
   network_ = Network::CreateFromFile(fp);
   if (network_ == nullptr) {
     return false;
@@ -389,6 +471,250 @@ bool LSTMRecognizer::RecognizeLine(const ImageData &image_data,
   return true;
 }
 
+// Bilinear scaling of an 8 bit grey buffer to dst_width x dst_height.
+static void ScaleGreyImage(const uint8_t *data, int width, int height, int bytes_per_line,
+                           int dst_width, int dst_height, std::vector<uint8_t> *dst) {
+  dst->resize(dst_width * dst_height);
+  float x_ratio = static_cast<float>(width) / dst_width;
+  float y_ratio = static_cast<float>(height) / dst_height;
+  for (int y = 0; y < dst_height; ++y) {
+    float src_y = std::max(0.0f, (y + 0.5f) * y_ratio - 0.5f);
+    int y0 = std::min(static_cast<int>(src_y), height - 1);
+    int y1 = std::min(y0 + 1, height - 1);
+    float fy = src_y - y0;
+    const uint8_t *row0 = data + bytes_per_line * y0;
+    const uint8_t *row1 = data + bytes_per_line * y1;
+    for (int x = 0; x < dst_width; ++x) {
+      float src_x = std::max(0.0f, (x + 0.5f) * x_ratio - 0.5f);
+      int x0 = std::min(static_cast<int>(src_x), width - 1);
+      int x1 = std::min(x0 + 1, width - 1);
+      float fx = src_x - x0;
+      float top = row0[x0] + fx * (row0[x1] - row0[x0]);
+      float bottom = row1[x0] + fx * (row1[x1] - row1[x0]);
+      (*dst)[y * dst_width + x] = static_cast<uint8_t>(top + fy * (bottom - top) + 0.5f);
+    }
+  }
+}
+
+// Recognizes a single line held in a plain 8 bit grey buffer.
+bool LSTMRecognizer::RecognizeGreyLine(const uint8_t *data, int width, int height,
+                                       int bytes_per_line, float invert_threshold,
+                                       std::vector<int> *unichar_ids, std::vector<float> *certs,
+                                       std::vector<int> *xcoords) {
+  std::vector<GreyImage> lines(1, GreyImage{data, width, height, bytes_per_line});
+  std::vector<std::vector<int>> line_ids, line_xcoords;
+  std::vector<std::vector<float>> line_certs;
+  bool result = RecognizeGreyLines(lines, invert_threshold, &line_ids, &line_certs, &line_xcoords);
+  unichar_ids->swap(line_ids[0]);
+  certs->swap(line_certs[0]);
+  xcoords->swap(line_xcoords[0]);
+  return result;
+}
+
+// Recognizes a batch of lines held in plain 8 bit grey buffers.
+bool LSTMRecognizer::RecognizeGreyLines(const std::vector<GreyImage> &lines,
+                                        float invert_threshold,
+                                        std::vector<std::vector<int>> *unichar_ids,
+                                        std::vector<std::vector<float>> *certs,
+                                        std::vector<std::vector<int>> *xcoords) {
+  unichar_ids->clear();
+  certs->clear();
+  xcoords->clear();
+  unichar_ids->resize(lines.size());
+  certs->resize(lines.size());
+  xcoords->resize(lines.size());
+  // Note that NumInputs() is defined as input image height.
+  int target_height = NumInputs();
+  int min_width = network_->XScaleFactor();
+  // Scale every line to the network height, keeping the usable ones.
+  std::vector<std::vector<uint8_t>> scaled(lines.size());
+  std::vector<GreyImage> batch;
+  std::vector<int> batch_lines;
+  std::vector<float> image_scales;
+  for (unsigned l = 0; l < lines.size(); ++l) {
+    GreyImage line = lines[l];
+    if (line.data == nullptr || line.width <= 0 || line.height <= 0) {
+      continue;
+    }
+    float image_scale = 1.0f;
+    if (line.height != target_height) {
+      image_scale = static_cast<float>(target_height) / line.height;
+      int scaled_width = std::max(1, IntCastRounded(line.width * image_scale));
+      ScaleGreyImage(line.data, line.width, line.height, line.bytes_per_line, scaled_width,
+                     target_height, &scaled[l]);
+      line = GreyImage{&scaled[l][0], scaled_width, target_height, scaled_width};
+    }
+    if (line.width < min_width || line.height < min_width) {
+      tprintf("Image too small to scale!! (%dx%d vs min width of %d)\n", line.width, line.height,
+              min_width);
+      continue;
+    }
+    batch.push_back(line);
+    batch_lines.push_back(l);
+    image_scales.push_back(image_scale);
+  }
+  if (batch.empty()) {
+    return false;
+  }
+
+  std::vector<NetworkIO> line_outputs(batch.size());
+  if (parallel_lines_ && batch.size() > 1) {
+    // Each line goes through the network on a task of its own, serial
+    // inside, so the threads are shared by the lines instead of the layers.
+    TaskScheduler::Get()->ParallelFor(static_cast<int>(batch.size()), [&](int b) {
+      TaskScheduler::SerialScope serial;
+      ForwardGreyLine(batch[b], invert_threshold, &line_outputs[b]);
+    });
+  } else {
+    NetworkIO inputs, outputs;
+    inputs.set_int_mode(IsIntMode());
+    SetRandomSeed();
+    inputs.FromGreyImages(network_->InputShape(), batch, &randomizer_);
+    network_->Forward(false, inputs, nullptr, &scratch_space_, &outputs);
+    for (unsigned b = 0; b < batch.size(); ++b) {
+      line_outputs[b].CopyBatchFrom(outputs, b);
+    }
+    if (invert_threshold > 0.0f) {
+      // The lines that look bad go through again inverted, as a second batch.
+      std::vector<float> pos_means;
+      std::vector<std::vector<uint8_t>> inverted;
+      std::vector<GreyImage> inv_batch;
+      std::vector<int> inv_index;
+      for (unsigned b = 0; b < batch.size(); ++b) {
+        float pos_min, pos_mean, pos_sd;
+        OutputStats(line_outputs[b], &pos_min, &pos_mean, &pos_sd);
+        if (pos_mean < invert_threshold) {
+          const GreyImage &line = batch[b];
+          inverted.emplace_back(line.width * line.height);
+          std::vector<uint8_t> &pixels = inverted.back();
+          for (int y = 0; y < line.height; ++y) {
+            for (int x = 0; x < line.width; ++x) {
+              pixels[y * line.width + x] = 255 - line.data[y * line.bytes_per_line + x];
+            }
+          }
+          pos_means.push_back(pos_mean);
+          inv_index.push_back(b);
+        }
+      }
+      for (unsigned i = 0; i < inv_index.size(); ++i) {
+        const GreyImage &line = batch[inv_index[i]];
+        inv_batch.push_back(GreyImage{&inverted[i][0], line.width, line.height, line.width});
+      }
+      if (!inv_batch.empty()) {
+        NetworkIO inv_inputs, inv_outputs;
+        inv_inputs.set_int_mode(IsIntMode());
+        SetRandomSeed();
+        inv_inputs.FromGreyImages(network_->InputShape(), inv_batch, &randomizer_);
+        network_->Forward(false, inv_inputs, nullptr, &scratch_space_, &inv_outputs);
+        for (unsigned i = 0; i < inv_index.size(); ++i) {
+          NetworkIO inv_line;
+          inv_line.CopyBatchFrom(inv_outputs, i);
+          float inv_min, inv_mean, inv_sd;
+          OutputStats(inv_line, &inv_min, &inv_mean, &inv_sd);
+          if (inv_mean > pos_means[i]) {
+            line_outputs[inv_index[i]] = std::move(inv_line);
+          }
+        }
+      }
+    }
+  }
+
+  while (line_searches_.size() < batch.size()) {
+    line_searches_.push_back(new RecodeBeamSearch(recoder_, null_char_, SimpleTextOutput(), dict_));
+    line_searches_.back()->SetConstraint(label_constraint_, GetUnicharset());
+  }
+  // The lines are decoded at once, each by its own beam search.
+  TaskScheduler::Get()->ParallelFor(static_cast<int>(batch.size()), [&](int b) {
+    int l = batch_lines[b];
+    RecodeBeamSearch *search = line_searches_[b];
+    // A plate or code is not a word, so the dictionary gets no bonus. The
+    // charset still applies the black and white lists.
+    search->Decode(line_outputs[b], 1.0, 0.0, RecodeBeamSearch::kMinCertainty, &GetUnicharset());
+    std::vector<float> ratings;
+    search->ExtractBestPathAsUnicharIds(false, &GetUnicharset(), &(*unichar_ids)[l],
+                                       &(*certs)[l], &ratings, &(*xcoords)[l]);
+    // Output timesteps to pixels of the caller's image.
+    for (auto &x : (*xcoords)[l]) {
+      x = IntCastRounded(x * min_width / image_scales[b]);
+    }
+  });
+  return true;
+}
+
+// Runs a single line of RecognizeGreyLines through the network, with a
+// scratch space and randomizer of its own, so that lines can run at once.
+// As in RecognizeGreyLines, the line is tried inverted too if its outputs
+// look bad, and output receives the better outputs.
+void LSTMRecognizer::ForwardGreyLine(const GreyImage &line, float invert_threshold,
+                                     NetworkIO *output) {
+  TRand randomizer;
+  randomizer.set_seed(sample_iteration_ * 0x10000001LL);
+  randomizer.IntRand();
+  NetworkScratch scratch;
+  scratch.set_randomizer(&randomizer);
+  NetworkIO inputs;
+  inputs.set_int_mode(IsIntMode());
+  inputs.FromGreyImages(network_->InputShape(), {line}, &randomizer);
+  network_->Forward(false, inputs, nullptr, &scratch, output);
+  if (invert_threshold <= 0.0f) {
+    return;
+  }
+  float pos_min, pos_mean, pos_sd;
+  OutputStats(*output, &pos_min, &pos_mean, &pos_sd);
+  if (pos_mean >= invert_threshold) {
+    return;
+  }
+  std::vector<uint8_t> pixels(line.width * line.height);
+  for (int y = 0; y < line.height; ++y) {
+    for (int x = 0; x < line.width; ++x) {
+      pixels[y * line.width + x] = 255 - line.data[y * line.bytes_per_line + x];
+    }
+  }
+  NetworkIO inv_inputs, inv_output;
+  inv_inputs.set_int_mode(IsIntMode());
+  randomizer.set_seed(sample_iteration_ * 0x10000001LL);
+  randomizer.IntRand();
+  inv_inputs.FromGreyImages(network_->InputShape(),
+                            {GreyImage{&pixels[0], line.width, line.height, line.width}},
+                            &randomizer);
+  network_->Forward(false, inv_inputs, nullptr, &scratch, &inv_output);
+  float inv_min, inv_mean, inv_sd;
+  OutputStats(inv_output, &inv_min, &inv_mean, &inv_sd);
+  if (inv_mean > pos_mean) {
+    *output = std::move(inv_output);
+  }
+}
+
+// Restricts the results of RecognizeGreyLines to the unichar sequences that
+// constraint accepts, or removes the restriction if nullptr.
+void LSTMRecognizer::SetLabelConstraint(const LabelConstraint *constraint) {
+  label_constraint_ = constraint;
+  for (auto search : line_searches_) {
+    search->SetConstraint(label_constraint_, GetUnicharset());
+  }
+}
+
+// As SetLabelConstraint with a PatternConstraint compiled from pattern, or no
+// constraint if pattern is empty.
+bool LSTMRecognizer::SetLabelPattern(const std::string &pattern) {
+  if (pattern == label_pattern_str_) {
+    return label_pattern_str_.empty() || label_constraint_ != nullptr;
+  }
+  label_pattern_str_ = pattern;
+  SetLabelConstraint(nullptr);
+  label_pattern_.reset();
+  if (pattern.empty()) {
+    return true;
+  }
+  auto constraint = std::make_unique<PatternConstraint>();
+  if (!constraint->Compile(pattern.c_str(), GetUnicharset())) {
+    return false;
+  }
+  label_pattern_ = std::move(constraint);
+  SetLabelConstraint(label_pattern_.get());
+  return true;
+}
+
 // Converts an array of labels to utf-8, whether or not the labels are
 // augmented with character boundaries.
 std::string LSTMRecognizer::DecodeLabels(const std::vector<int> &labels) {
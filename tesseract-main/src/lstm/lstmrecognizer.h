@@ -20,6 +20,7 @@
 
 #include "ccutil.h"
 #include "helpers.h"
+#include "labelconstraint.h"
 #include "matrix.h"
 #include "network.h"
 #include "networkscratch.h"
@@ -28,6 +29,8 @@
 #include "series.h"
 #include "unicharcompress.h"
 
+#include <memory> // for std::unique_ptr
+
 class BLOB_CHOICE_IT;
 struct Pix;
 class ROW_RES;
@@ -221,6 +224,14 @@ public:
 
   // Loads a model from mgr, including the dictionary only if lang is not null.
   bool Load(const ParamsVectors *params, const std::string &lang, TessdataManager *mgr);
+  // As Load, but the network is shared, read-only, by all the recognizers
+  // loaded this way from the same traineddata file, and deserialized only by
+  // the first. Each keeps its own copy of the unicharset, which the white and
+  // black lists change, and its own scratch space, so they can run in
+  // different threads. The network must not be trained or converted after.
+  bool LoadShared(const ParamsVectors *params, const std::string &lang, TessdataManager *mgr);
+  // Deletes the shared networks that no recognizer uses any more.
+  static void DeleteUnusedSharedModels();
 
   // Writes to the given file. Returns false in case of error.
   // If mgr contains a unicharset and recoder, then they are not encoded to fp.
@@ -267,6 +278,41 @@ public:
   bool RecognizeLine(const ImageData &image_data, float invert_threshold, bool debug, bool re_invert,
                      bool upside_down, float *scale_factor, NetworkIO *inputs, NetworkIO *outputs);
 
+  // Recognizes a single line held in a plain 8 bit grey buffer, such as a
+  // cropped licence plate, without ImageData, Pix, page layout or WERD_RES.
+  // The image is scaled to the network input height if needed. If
+  // invert_threshold > 0, tries the inverted image as well, as RecognizeLine.
+  // Returns the unichar_ids of the best path without a dictionary, their
+  // certainties, and in xcoords the start x of each in image pixels followed
+  // by the end x of the last one.
+  bool RecognizeGreyLine(const uint8_t *data, int width, int height, int bytes_per_line,
+                         float invert_threshold, std::vector<int> *unichar_ids,
+                         std::vector<float> *certs, std::vector<int> *xcoords);
+  // As RecognizeGreyLine for a batch of lines, such as all the plates of a
+  // frame, that run through the network as a single padded batch. Each line
+  // is decoded by its own beam search. A line that is too small gets empty
+  // results. Returns false if no line could be recognized.
+  bool RecognizeGreyLines(const std::vector<GreyImage> &lines, float invert_threshold,
+                          std::vector<std::vector<int>> *unichar_ids,
+                          std::vector<std::vector<float>> *certs,
+                          std::vector<std::vector<int>> *xcoords);
+
+  // Restricts the results of RecognizeGreyLines to the unichar sequences that
+  // constraint accepts, such as the licence plates of a region, or removes
+  // the restriction if nullptr. Borrows the pointer, which must survive until
+  // replaced.
+  void SetLabelConstraint(const LabelConstraint *constraint);
+  // As SetLabelConstraint with a PatternConstraint compiled from pattern, or
+  // no constraint if pattern is empty. Does nothing if pattern is the one set
+  // last. Returns false, leaving no constraint, if the pattern is malformed.
+  bool SetLabelPattern(const std::string &pattern);
+  // If true, RecognizeGreyLines runs each line through the network by itself
+  // on a task of the TaskScheduler, with the network serial inside, instead
+  // of running the lines as one batch with the network parallel inside.
+  void set_parallel_lines(bool value) {
+    parallel_lines_ = value;
+  }
+
   // Converts an array of labels to utf-8, whether or not the labels are
   // augmented with character boundaries.
   std::string DecodeLabels(const std::vector<int> &labels);
@@ -291,6 +337,11 @@ protected:
     randomizer_.IntRand();
   }
 
+  // Runs one line of RecognizeGreyLines through the network into output,
+  // with a scratch space and randomizer of its own so that lines can run at
+  // once, and keeps the inverted result if it is better.
+  void ForwardGreyLine(const GreyImage &line, float invert_threshold, NetworkIO *output);
+
   // Displays the labels and cuts at the corresponding xcoords.
   // Size of labels should match xcoords.
   void DisplayLSTMOutput(const std::vector<int> &labels, const std::vector<int> &xcoords,
@@ -324,9 +375,16 @@ protected:
   // a default of ".." for part of a multi-label unichar-id.
   const char *DecodeSingleLabel(int label);
 
+  // Deletes the network, or gives up the shared model it belongs to.
+  void ReleaseNetwork();
+  // Deserializes the model of LoadShared from mgr, with training disabled.
+  static LSTMRecognizer *LoadSharedModel(TessdataManager *mgr);
+
 protected:
-  // The network hierarchy.
+  // The network hierarchy. Borrowed from shared_model_ if not null.
   Network *network_;
+  // The model, held in a global cache, that owns network_ after LoadShared.
+  LSTMRecognizer *shared_model_;
   // The unicharset. Only the unicharset element is serialized.
   // Has to be a CCUtil, so Dict can point to it.
   CCUtil ccutil_;
@@ -360,6 +418,15 @@ protected:
   Dict *dict_;
   // Beam search held between uses to optimize memory allocation/use.
   RecodeBeamSearch *search_;
+  // One beam search per line of RecognizeGreyLines, held as search_.
+  std::vector<RecodeBeamSearch *> line_searches_;
+  // Borrowed constraint on the results of RecognizeGreyLines, or nullptr.
+  const LabelConstraint *label_constraint_;
+  // The constraint compiled by SetLabelPattern, and its pattern.
+  std::unique_ptr<PatternConstraint> label_pattern_;
+  std::string label_pattern_str_;
+  // Whether RecognizeGreyLines runs the lines apart, as set_parallel_lines.
+  bool parallel_lines_;
 
   // == Debugging parameters.==
   // Recognition debug display window.
@@ -37,8 +37,16 @@ bool Maxpool::DeSerialize(TFile *fp) {
 void Maxpool::Forward(bool debug, const NetworkIO &input, const TransposedArray *input_transpose,
                       NetworkScratch *scratch, NetworkIO *output) {
   output->ResizeScaled(input, x_scale_, y_scale_, no_);
-  maxes_.ResizeNoInit(output->Width(), ni_);
-  back_map_ = input.stride_map();
+  // The positions of the maxes are kept for Backward only when training, so
+  // that inference doesn't write to the network.
+  bool training = IsTraining();
+  std::vector<int> max_buffer;
+  if (training) {
+    maxes_.ResizeNoInit(output->Width(), ni_);
+    back_map_ = input.stride_map();
+  } else {
+    max_buffer.resize(ni_);
+  }
 
   StrideMap::Index dest_index(output->stride_map());
   do {
@@ -48,7 +56,7 @@ void Maxpool::Forward(bool debug, const NetworkIO &input, const TransposedArray
                                dest_index.index(FD_WIDTH) * x_scale_);
     // Find the max input out of x_scale_ groups of y_scale_ inputs.
     // Do it independently for each input dimension.
-    int *max_line = maxes_[out_t];
+    int *max_line = training ? maxes_[out_t] : &max_buffer[0];
     int in_t = src_index.t();
     output->CopyTimeStepFrom(out_t, input, in_t);
     for (int i = 0; i < ni_; ++i) {
@@ -124,17 +124,15 @@ void NetworkIO::ZeroInvalidElements() {
 // of text, so a horizontal line through the middle of the image passes through
 // at least some of it, so local minima and maxima are a good proxy for black
 // and white pixel samples.
-static void ComputeBlackWhite(Image pix, float *black, float *white) {
-  int width = pixGetWidth(pix);
-  int height = pixGetHeight(pix);
+// pixel(x) returns the grey value at x of the middle row.
+template <typename PixelFunc>
+static void ComputeRowBlackWhite(int width, PixelFunc pixel, float *black, float *white) {
   STATS mins(0, 255), maxes(0, 255);
   if (width >= 3) {
-    int y = height / 2;
-    l_uint32 *line = pixGetData(pix) + pixGetWpl(pix) * y;
-    int prev = GET_DATA_BYTE(line, 0);
-    int curr = GET_DATA_BYTE(line, 1);
+    int prev = pixel(0);
+    int curr = pixel(1);
     for (int x = 1; x + 1 < width; ++x) {
-      int next = GET_DATA_BYTE(line, x + 1);
+      int next = pixel(x + 1);
       if ((curr < prev && curr <= next) || (curr <= prev && curr < next)) {
         // Local minimum.
         mins.add(curr, 1);
@@ -157,6 +155,14 @@ static void ComputeBlackWhite(Image pix, float *black, float *white) {
   *white = maxes.ile(0.75);
 }
 
+static void ComputeBlackWhite(Image pix, float *black, float *white) {
+  int width = pixGetWidth(pix);
+  int height = pixGetHeight(pix);
+  l_uint32 *line = pixGetData(pix) + pixGetWpl(pix) * (height / 2);
+  ComputeRowBlackWhite(
+      width, [line](int x) { return static_cast<int>(GET_DATA_BYTE(line, x)); }, black, white);
+}
+
 // Sets up the array from the given image, using the currently set int_mode_.
 // If the image width doesn't match the shape, the image is truncated or padded
 // with noise to match.
@@ -213,6 +219,90 @@ void NetworkIO::FromPixes(const StaticShape &shape, const std::vector<Image> &pi
 // of input channels, the height is the height of the image, and the width
 // is the width of the image, or truncated/padded with noise if the width
 // is a fixed size.
+// Sets up the array from an 8 bit grey image in a plain buffer, using the
+// currently set int_mode_. The image height must already match the shape.
+void NetworkIO::FromGreyImage(const StaticShape &shape, const uint8_t *data, int width,
+                              int height, int bytes_per_line, TRand *randomizer) {
+  std::vector<GreyImage> images(1, GreyImage{data, width, height, bytes_per_line});
+  FromGreyImages(shape, images, randomizer);
+}
+
+// As FromGreyImage, for a batch of images of any widths.
+void NetworkIO::FromGreyImages(const StaticShape &shape, const std::vector<GreyImage> &images,
+                               TRand *randomizer) {
+  int target_height = shape.height();
+  std::vector<std::pair<int, int>> h_w_pairs;
+  for (auto &image : images) {
+    ASSERT_HOST(target_height == 0 || target_height == image.height ||
+                (target_height == 1 && image.height == shape.depth()));
+    h_w_pairs.emplace_back(target_height == 1 ? 1 : image.height,
+                           shape.width() != 0 ? shape.width() : image.width);
+  }
+  stride_map_.SetStride(h_w_pairs);
+  ResizeToMap(int_mode(), stride_map_, target_height == 1 ? images[0].height : shape.depth());
+
+  int num_features = NumFeatures();
+  int target_width = stride_map_.Size(FD_WIDTH);
+  for (unsigned b = 0; b < images.size(); ++b) {
+    const GreyImage &image = images[b];
+    float black = 0.0f, white = 255.0f;
+    const uint8_t *middle = image.data + image.bytes_per_line * (image.height / 2);
+    ComputeRowBlackWhite(
+        image.width, [middle](int x) { return static_cast<int>(middle[x]); }, &black, &white);
+    float contrast = (white - black) / 2.0f;
+    if (contrast <= 0.0f) {
+      contrast = 1.0f;
+    }
+    int copy_width = std::min(image.width, target_width);
+    StrideMap::Index index(stride_map_, b, 0, 0);
+    int t = index.t();
+    if (target_height == 1) {
+      // Vertical pixel strips, as Copy1DGreyImage.
+      int x;
+      for (x = 0; x < copy_width; ++x, ++t) {
+        for (int y = 0; y < image.height; ++y) {
+          SetPixel(t, y, image.data[image.bytes_per_line * y + x], black, contrast);
+        }
+      }
+      for (; x < target_width; ++x) {
+        Randomize(t++, 0, num_features, randomizer);
+      }
+    } else {
+      // As Copy2DImage with a single channel.
+      for (int y = 0; y < stride_map_.Size(FD_HEIGHT); ++y) {
+        int x = 0;
+        if (y < image.height) {
+          const uint8_t *line = image.data + image.bytes_per_line * y;
+          for (x = 0; x < copy_width; ++x, ++t) {
+            SetPixel(t, 0, line[x], black, contrast);
+          }
+        }
+        for (; x < target_width; ++x) {
+          Randomize(t++, 0, num_features, randomizer);
+        }
+      }
+    }
+  }
+}
+
+// Sets up *this as a copy of the given batch index of src.
+void NetworkIO::CopyBatchFrom(const NetworkIO &src, int batch) {
+  StrideMap::Index first(src.stride_map_, batch, 0, 0);
+  int height = first.MaxIndexOfDim(FD_HEIGHT) + 1;
+  int width = first.MaxIndexOfDim(FD_WIDTH) + 1;
+  std::vector<std::pair<int, int>> h_w_pairs(1, std::make_pair(height, width));
+  StrideMap stride_map;
+  stride_map.SetStride(h_w_pairs);
+  ResizeToMap(src.int_mode(), stride_map, src.NumFeatures());
+  int t = 0;
+  for (int y = 0; y < height; ++y) {
+    StrideMap::Index src_index(src.stride_map_, batch, y, 0);
+    for (int x = 0; x < width; ++x) {
+      CopyTimeStepFrom(t++, src, src_index.t() + x);
+    }
+  }
+}
+
 void NetworkIO::Copy2DImage(int batch, Image pix, float black, float contrast, TRand *randomizer) {
   int width = pixGetWidth(pix);
   int height = pixGetHeight(pix);
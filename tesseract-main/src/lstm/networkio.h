@@ -32,6 +32,14 @@ struct Pix;
 
 namespace tesseract {
 
+// An 8 bit grey image in a plain buffer, one byte per pixel. Not owned.
+struct GreyImage {
+  const uint8_t *data;
+  int width;
+  int height;
+  int bytes_per_line;
+};
+
 // Class to contain all the input/output of a network, allowing for fixed or
 // variable-strided 2d to 1d mapping, and float or int8_t values. Provides
 // enough calculating functions to hide the detail of the implementation.
@@ -72,6 +80,19 @@ public:
   // truncated or padded with noise to match.
   void FromPixes(const StaticShape &shape, const std::vector<Image> &pixes,
                  TRand *randomizer);
+  // Sets up the array from an 8 bit grey image held in a plain buffer, as
+  // FromPix but without a Pix. The height must already be the height of the
+  // shape, or its depth if the shape's height is 1.
+  void FromGreyImage(const StaticShape &shape, const uint8_t *data, int width, int height,
+                     int bytes_per_line, TRand *randomizer);
+  // As FromGreyImage, for a batch of images of any widths. The narrower
+  // images are padded to the widest, and the padding is not a valid
+  // position of the stride map.
+  void FromGreyImages(const StaticShape &shape, const std::vector<GreyImage> &images,
+                      TRand *randomizer);
+  // Sets up *this as a copy of the given batch index of src, so one image
+  // of a batch can be used on its own, eg by a decoder.
+  void CopyBatchFrom(const NetworkIO &src, int batch);
   // Copies the given pix to *this at the given batch index, stretching and
   // clipping the pixel values so that [black, black + 2*contrast] maps to the
   // dynamic range of *this, ie [-1,1] for a float and (-127,127) for int.
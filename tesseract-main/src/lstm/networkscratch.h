@@ -25,6 +25,8 @@
 
 namespace tesseract {
 
+class TRand;
+
 // Generic scratch space for network layers. Provides NetworkIO that can store
 // a complete set (over time) of intermediates, and vector<float>
 // scratch space that auto-frees after use. The aim here is to provide a set
@@ -32,7 +34,7 @@ namespace tesseract {
 // and don't have to be reallocated on each call.
 class NetworkScratch {
 public:
-  NetworkScratch() : int_mode_(false) {}
+  NetworkScratch() : int_mode_(false), randomizer_(nullptr) {}
   ~NetworkScratch() = default;
 
   // Sets the network representation. If the representation is integer, then
@@ -44,6 +46,16 @@ public:
     int_mode_ = int_mode;
   }
 
+  // Sets the random number generator of the layers that pad with noise. A
+  // network shared between recognizers draws from the one of the caller
+  // rather than its own, so that it is never written by two at once.
+  void set_randomizer(TRand *randomizer) {
+    randomizer_ = randomizer;
+  }
+  TRand *randomizer() const {
+    return randomizer_;
+  }
+
   // Class that acts like a NetworkIO (by having an implicit cast operator),
   // yet actually holds a pointer to NetworkIOs in the source NetworkScratch,
   // and knows how to unstack the borrowed pointers on destruction.
@@ -266,6 +278,8 @@ public:
 private:
   // If true, the network weights are int8_t, if false, float.
   bool int_mode_;
+  // Borrowed random number generator, or nullptr for that of the network.
+  TRand *randomizer_;
   // Stacks of NetworkIO and vector<float>. Once allocated, they are not
   // deleted until the NetworkScratch is deleted.
   Stack<NetworkIO> int_stack_;
@@ -21,11 +21,8 @@
 
 #include "parallel.h"
 
-#ifdef _OPENMP
-#  include <omp.h>
-#endif
+#include <tesseract/taskscheduler.h>
 
-#include "functions.h" // For conditional undef of _OPENMP.
 #include "networkscratch.h"
 
 namespace tesseract {
@@ -65,12 +62,9 @@ void Parallel::Forward(bool debug, const NetworkIO &input, const TransposedArray
     for (int i = 0; i < stack_size; ++i) {
       results[i].Resize(input, stack_[i]->NumOutputs(), scratch);
     }
-#ifdef _OPENMP
-#  pragma omp parallel for num_threads(stack_size)
-#endif
-    for (int i = 0; i < stack_size; ++i) {
+    TaskScheduler::Get()->ParallelFor(stack_size, [&](int i) {
       stack_[i]->Forward(debug, input, nullptr, scratch, results[i]);
-    }
+    });
     // Now pack all the results (serially) into the output.
     int out_offset = 0;
     output->Resize(*results[0], NumOutputs());
@@ -134,12 +128,9 @@ bool Parallel::Backward(bool debug, const NetworkIO &fwd_deltas, NetworkScratch
       in_deltas[i]->CopyUnpacking(fwd_deltas, feature_offset, num_features);
       feature_offset += num_features;
     }
-#ifdef _OPENMP
-#  pragma omp parallel for num_threads(stack_size)
-#endif
-    for (unsigned i = 0; i < stack_size; ++i) {
+    TaskScheduler::Get()->ParallelFor(static_cast<int>(stack_size), [&](int i) {
       stack_[i]->Backward(debug, *in_deltas[i], scratch, i == 0 ? back_deltas : out_deltas[i]);
-    }
+    });
     if (needs_to_backprop_) {
       for (unsigned i = 1; i < stack_size; ++i) {
         back_deltas->AddAllToFloat(*out_deltas[i]);
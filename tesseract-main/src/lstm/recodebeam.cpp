@@ -23,7 +23,7 @@
 #include "pageres.h"
 #include "unicharcompress.h"
 
-#include <algorithm> // for std::reverse
+#include <algorithm> // for std::min, std::reverse
 
 namespace tesseract {
 
@@ -64,7 +64,8 @@ RecodeBeamSearch::RecodeBeamSearch(const UnicharCompress &recoder,
       dict_(dict),
       space_delimited_(true),
       is_simple_text_(simple_text),
-      null_char_(null_char) {
+      null_char_(null_char),
+      constraint_(nullptr) {
   if (dict_ != nullptr && !dict_->IsSpaceDelimitedLang()) {
     space_delimited_ = false;
   }
@@ -79,6 +80,76 @@ RecodeBeamSearch::~RecodeBeamSearch() {
   }
 }
 
+// Restricts the following decodes to the unichar sequences that constraint
+// accepts, or removes the restriction if nullptr.
+void RecodeBeamSearch::SetConstraint(const LabelConstraint *constraint,
+                                     const UNICHARSET &unicharset) {
+  constraint_ = constraint;
+  state_codes_.clear();
+  code_mask_.clear();
+  if (constraint_ == nullptr) {
+    return;
+  }
+  int num_states = constraint_->NumStates();
+  state_codes_.resize(num_states);
+  for (auto &codes : state_codes_) {
+    codes.resize(recoder_.code_range(), false);
+    codes[null_char_] = true;
+  }
+  for (unsigned unichar_id = 0; unichar_id < unicharset.size(); ++unichar_id) {
+    RecodedCharID code;
+    int length = recoder_.EncodeUnichar(unichar_id, &code);
+    for (int state = 0; state < num_states; ++state) {
+      if (constraint_->Next(state, unichar_id) < 0) {
+        continue;
+      }
+      for (int i = 0; i < length; ++i) {
+        state_codes_[state][code(i)] = true;
+      }
+    }
+  }
+}
+
+// Sets code_mask_ to the codes that the constraint allows after any of the
+// nodes in prev, the previous step, or nullptr at the first step.
+void RecodeBeamSearch::ComputeCodeMask(const RecodeBeam *prev) {
+  if (constraint_ == nullptr) {
+    return;
+  }
+  std::vector<bool> active(state_codes_.size(), false);
+  if (prev == nullptr) {
+    active[0] = true;
+  } else {
+    for (const auto &beam : prev->beams_) {
+      for (int i = 0; i < beam.size(); ++i) {
+        active[beam.get(i).data().constraint_state] = true;
+      }
+    }
+  }
+  code_mask_.assign(recoder_.code_range(), false);
+  for (unsigned state = 0; state < active.size(); ++state) {
+    if (!active[state]) {
+      continue;
+    }
+    const std::vector<bool> &codes = state_codes_[state];
+    for (unsigned code = 0; code < codes.size(); ++code) {
+      if (codes[code]) {
+        code_mask_[code] = true;
+      }
+    }
+  }
+}
+
+// Returns the constraint state after a node for unichar_id after prev.
+int RecodeBeamSearch::NextConstraintState(int unichar_id, bool dup,
+                                          const RecodeNode *prev) const {
+  int state = prev == nullptr ? 0 : prev->constraint_state;
+  if (constraint_ != nullptr && !dup && unichar_id != INVALID_UNICHAR_ID) {
+    state = constraint_->Next(state, unichar_id);
+  }
+  return state;
+}
+
 // Decodes the set of network outputs, storing the lattice internally.
 void RecodeBeamSearch::Decode(const NetworkIO &output, double dict_ratio,
                               double cert_offset, double worst_dict_cert,
@@ -89,6 +160,7 @@ void RecodeBeamSearch::Decode(const NetworkIO &output, double dict_ratio,
     timesteps.clear();
   }
   for (int t = 0; t < width; ++t) {
+    ComputeCodeMask(t == 0 ? nullptr : beam_[t - 1]);
     ComputeTopN(output.f(t), output.NumFeatures(), kBeamWidths[0]);
     DecodeStep(output.f(t), t, dict_ratio, cert_offset, worst_dict_cert,
                charset);
@@ -104,6 +176,7 @@ void RecodeBeamSearch::Decode(const GENERIC_2D_ARRAY<float> &output,
   beam_size_ = 0;
   int width = output.dim1();
   for (int t = 0; t < width; ++t) {
+    ComputeCodeMask(t == 0 ? nullptr : beam_[t - 1]);
     ComputeTopN(output[t], output.dim2(), kBeamWidths[0]);
     DecodeStep(output[t], t, dict_ratio, cert_offset, worst_dict_cert, charset);
   }
@@ -126,6 +199,7 @@ void RecodeBeamSearch::DecodeSecondaryBeams(
            t >= character_boundaries_[bucketNumber + 1]) {
       ++bucketNumber;
     }
+    ComputeCodeMask(t == 0 ? nullptr : secondary_beam_[t - 1]);
     ComputeSecTopN(&(excludedUnichars)[bucketNumber], output.f(t),
                    output.NumFeatures(), kBeamWidths[0]);
     DecodeSecondaryStep(output.f(t), t, dict_ratio, cert_offset,
@@ -667,62 +741,94 @@ WERD_RES *RecodeBeamSearch::InitializeWord(bool leading_space,
   return word_res;
 }
 
+// The outputs are scanned in blocks of this many, so a block with no output
+// that can enter the top-n is passed over with a single compare.
+static const int kTopNBlock = 16;
+
+// Returns true if any of the kTopNBlock outputs is greater than threshold.
+// The compares have no branches, so the compiler can do them as vector
+// compares.
+static inline bool AnyAbove(const float *outputs, float threshold) {
+  int above = 0;
+  for (int i = 0; i < kTopNBlock; ++i) {
+    above |= outputs[i] > threshold;
+  }
+  return above != 0;
+}
+
 // Fills top_n_flags_ with bools that are true iff the corresponding output
 // is one of the top_n.
 void RecodeBeamSearch::ComputeTopN(const float *outputs, int num_outputs,
                                    int top_n) {
-  top_n_flags_.clear();
-  top_n_flags_.resize(num_outputs, TN_ALSO_RAN);
-  top_code_ = -1;
-  second_code_ = -1;
-  top_heap_.clear();
-  for (int i = 0; i < num_outputs; ++i) {
-    if (top_heap_.size() < top_n || outputs[i] > top_heap_.PeekTop().key()) {
-      TopPair entry(outputs[i], i);
-      top_heap_.Push(&entry);
-      if (top_heap_.size() > top_n) {
-        top_heap_.Pop(&entry);
-      }
+  SelectTopN(outputs, num_outputs, top_n, nullptr);
+}
+
+// As ComputeTopN, but leaves out the codes in exList.
+void RecodeBeamSearch::ComputeSecTopN(std::unordered_set<int> *exList,
+                                      const float *outputs, int num_outputs,
+                                      int top_n) {
+  if (excluded_codes_.size() < static_cast<size_t>(num_outputs)) {
+    excluded_codes_.resize(num_outputs, false);
+  }
+  for (int code : *exList) {
+    if (code >= 0 && code < num_outputs) {
+      excluded_codes_[code] = true;
     }
   }
-  while (!top_heap_.empty()) {
-    TopPair entry;
-    top_heap_.Pop(&entry);
-    if (top_heap_.size() > 1) {
-      top_n_flags_[entry.data()] = TN_TOPN;
-    } else {
-      top_n_flags_[entry.data()] = TN_TOP2;
-      if (top_heap_.empty()) {
-        top_code_ = entry.data();
-      } else {
-        second_code_ = entry.data();
-      }
+  SelectTopN(outputs, num_outputs, top_n, &excluded_codes_);
+  for (int code : *exList) {
+    if (code >= 0 && code < num_outputs) {
+      excluded_codes_[code] = false;
     }
   }
-  top_n_flags_[null_char_] = TN_TOP2;
 }
 
-void RecodeBeamSearch::ComputeSecTopN(std::unordered_set<int> *exList,
-                                      const float *outputs, int num_outputs,
-                                      int top_n) {
-  top_n_flags_.clear();
-  top_n_flags_.resize(num_outputs, TN_ALSO_RAN);
+// Does the work of ComputeTopN and ComputeSecTopN. Once the heap holds top_n
+// outputs, an output can only enter it by beating the smallest of them, so
+// the blocks of outputs that can't are skipped. The heap sees the same
+// outputs in the same order as it would without the skipping, so the result
+// is the same, ties included.
+void RecodeBeamSearch::SelectTopN(const float *outputs, int num_outputs,
+                                  int top_n,
+                                  const std::vector<bool> *excluded) {
+  // Only the flags set by the last call need resetting.
+  if (top_n_flags_.size() != static_cast<size_t>(num_outputs)) {
+    top_n_flags_.assign(num_outputs, TN_ALSO_RAN);
+  } else {
+    for (int code : top_n_codes_) {
+      top_n_flags_[code] = TN_ALSO_RAN;
+    }
+  }
+  top_n_codes_.clear();
   top_code_ = -1;
   second_code_ = -1;
   top_heap_.clear();
-  for (int i = 0; i < num_outputs; ++i) {
-    if ((top_heap_.size() < top_n || outputs[i] > top_heap_.PeekTop().key()) &&
-        !exList->count(i)) {
-      TopPair entry(outputs[i], i);
-      top_heap_.Push(&entry);
-      if (top_heap_.size() > top_n) {
-        top_heap_.Pop(&entry);
+  for (int i = 0; i < num_outputs;) {
+    if (top_heap_.size() == top_n && i + kTopNBlock <= num_outputs &&
+        !AnyAbove(outputs + i, top_heap_.PeekTop().key())) {
+      i += kTopNBlock;
+      continue;
+    }
+    int block_end = std::min(i + kTopNBlock, num_outputs);
+    for (; i < block_end; ++i) {
+      if (!code_mask_.empty() && !code_mask_[i]) {
+        continue; // No live path can take it.
+      }
+      if ((top_heap_.size() < top_n ||
+           outputs[i] > top_heap_.PeekTop().key()) &&
+          (excluded == nullptr || !(*excluded)[i])) {
+        TopPair entry(outputs[i], i);
+        top_heap_.Push(&entry);
+        if (top_heap_.size() > top_n) {
+          top_heap_.Pop(&entry);
+        }
       }
     }
   }
   while (!top_heap_.empty()) {
     TopPair entry;
     top_heap_.Pop(&entry);
+    top_n_codes_.push_back(entry.data());
     if (top_heap_.size() > 1) {
       top_n_flags_[entry.data()] = TN_TOPN;
     } else {
@@ -735,6 +841,7 @@ void RecodeBeamSearch::ComputeSecTopN(std::unordered_set<int> *exList,
     }
   }
   top_n_flags_[null_char_] = TN_TOP2;
+  top_n_codes_.push_back(null_char_);
 }
 
 // Adds the computation for the current time-step to the beam. Call at each
@@ -962,6 +1069,11 @@ void RecodeBeamSearch::ContinueContext(
           !charset->get_enabled(unichar_id)) {
         continue; // disabled by whitelist/blacklist
       }
+      if (unichar_id != INVALID_UNICHAR_ID && constraint_ != nullptr &&
+          constraint_->Next(prev == nullptr ? 0 : prev->constraint_state,
+                            unichar_id) < 0) {
+        continue; // not allowed by the constraint
+      }
       ContinueUnichar(code, unichar_id, cert, worst_dict_cert, dict_ratio,
                       use_dawgs, NC_ANYTHING, prev, step);
       if (top_n_flag == TN_TOP2 && code != null_char_) {
@@ -1155,6 +1267,7 @@ void RecodeBeamSearch::PushInitialDawgIfBetter(int code, int unichar_id,
     RecodeNode node(code, unichar_id, permuter, true, start, end, false, cert,
                     score, prev, initial_dawgs,
                     ComputeCodeHash(code, false, prev));
+    node.constraint_state = NextConstraintState(unichar_id, false, prev);
     *best_initial_dawg = node;
   }
 }
@@ -1201,6 +1314,7 @@ void RecodeBeamSearch::PushHeapIfBetter(int max_size, int code, int unichar_id,
     uint64_t hash = ComputeCodeHash(code, dup, prev);
     RecodeNode node(code, unichar_id, permuter, dawg_start, word_start, end,
                     dup, cert, score, prev, d, hash);
+    node.constraint_state = NextConstraintState(unichar_id, dup, prev);
     if (UpdateHeapIfMatched(&node, heap)) {
       return;
     }
@@ -1293,6 +1407,10 @@ void RecodeBeamSearch::ExtractBestPaths(
       int heap_size = last_beam->beams_[beam_index].size();
       for (int h = 0; h < heap_size; ++h) {
         const RecodeNode *node = &last_beam->beams_[beam_index].get(h).data();
+        if (constraint_ != nullptr &&
+            !constraint_->IsFinal(node->constraint_state)) {
+          continue; // The constraint doesn't accept the path.
+        }
         if (is_dawg) {
           // dawg_node may be a null_char, or duplicate, so scan back to the
           // last valid unichar_id.
@@ -25,6 +25,7 @@
 #include "genericheap.h"
 #include "genericvector.h"
 #include "kdpair.h"
+#include "labelconstraint.h"
 #include "networkio.h"
 #include "ratngs.h"
 #include "unicharcompress.h"
@@ -102,7 +103,8 @@ struct RecodeNode {
       , score(0.0f)
       , prev(nullptr)
       , dawgs(nullptr)
-      , code_hash(0) {}
+      , code_hash(0)
+      , constraint_state(0) {}
   RecodeNode(int c, int uni_id, PermuterType perm, bool dawg_start, bool word_start, bool end,
              bool dup, float cert, float s, const RecodeNode *p, DawgPositionVector *d,
              uint64_t hash)
@@ -117,7 +119,8 @@ struct RecodeNode {
       , score(s)
       , prev(p)
       , dawgs(d)
-      , code_hash(hash) {}
+      , code_hash(hash)
+      , constraint_state(0) {}
   // NOTE: If we could use C++11, then this would be a move constructor.
   // Instead we have copy constructor that does a move!! This is because we
   // don't want to copy the whole DawgPositionVector each time, and true
@@ -172,6 +175,9 @@ struct RecodeNode {
   // A hash of all codes in the prefix and this->code as well. Used for
   // duplicate path removal.
   uint64_t code_hash;
+  // The state of the LabelConstraint of the search after the last unichar
+  // in the path. 0 without a constraint.
+  int constraint_state;
 };
 
 using RecodePair = KDPairInc<double, RecodeNode>;
@@ -184,6 +190,11 @@ public:
   RecodeBeamSearch(const UnicharCompress &recoder, int null_char, bool simple_text, Dict *dict);
   ~RecodeBeamSearch();
 
+  // Restricts the following decodes to the unichar sequences that constraint
+  // accepts, or removes the restriction if nullptr. unicharset is that of the
+  // recoder. Borrows the pointer, which must survive until replaced.
+  void SetConstraint(const LabelConstraint *constraint, const UNICHARSET &unicharset);
+
   // Decodes the set of network outputs, storing the lattice internally.
   // If charset is not null, it enables detailed debugging of the beam search.
   void Decode(const NetworkIO &output, double dict_ratio, double cert_offset,
@@ -262,6 +273,9 @@ public:
   }
 
 private:
+  // Checks SelectTopN against a plain scan of the outputs.
+  friend class RecodeBeamTest;
+
   // Struct for the Re-encode beam search. This struct holds the data for
   // a single time-step position of the output. Use a vector<RecodeBeam>
   // to hold all the timesteps and prevent reallocation of the individual heaps.
@@ -312,12 +326,23 @@ private:
                            float space_certainty, const UNICHARSET *unicharset,
                            const std::vector<int> &xcoords, float scale_factor);
 
+  // Sets code_mask_ to the codes that the constraint allows after any of the
+  // nodes in prev, the previous step, or nullptr at the first step.
+  void ComputeCodeMask(const RecodeBeam *prev);
+  // Returns the constraint state after a node for unichar_id after prev.
+  int NextConstraintState(int unichar_id, bool dup, const RecodeNode *prev) const;
+
   // Fills top_n_flags_ with bools that are true iff the corresponding output
   // is one of the top_n.
   void ComputeTopN(const float *outputs, int num_outputs, int top_n);
 
+  // As ComputeTopN, but leaves out the codes in exList.
   void ComputeSecTopN(std::unordered_set<int> *exList, const float *outputs, int num_outputs,
                       int top_n);
+  // Does the work of ComputeTopN and ComputeSecTopN, leaving out the codes
+  // that are true in excluded, if not nullptr.
+  void SelectTopN(const float *outputs, int num_outputs, int top_n,
+                  const std::vector<bool> *excluded);
 
   // Adds the computation for the current time-step to the beam. Call at each
   // time-step in sequence from left to right. outputs is the activation vector
@@ -410,8 +435,13 @@ private:
   // A record of the highest and second scoring codes.
   int top_code_;
   int second_code_;
+  // The codes whose top_n_flags_ are set, so they can be reset at the next
+  // timestep without clearing all of them.
+  std::vector<int> top_n_codes_;
   // Heap used to compute the top_n_flags_.
   GenericHeap<TopPair> top_heap_;
+  // The codes ComputeSecTopN leaves out, as flags. All false between calls.
+  std::vector<bool> excluded_codes_;
   // Borrowed pointer to the dictionary to use in the search.
   Dict *dict_;
   // True if the language is space-delimited, which is true for most languages
@@ -422,6 +452,14 @@ private:
   bool is_simple_text_;
   // The encoded (class label) of the null/reject character.
   int null_char_;
+  // Borrowed pointer to the constraint on the decoded unichars, or nullptr.
+  const LabelConstraint *constraint_;
+  // For each state of constraint_, true for each code that is part of a
+  // unichar that the constraint allows in that state.
+  std::vector<std::vector<bool>> state_codes_;
+  // The union of state_codes_ over the states of the previous step. Codes
+  // that are false are left out of the top-n. Empty without a constraint.
+  std::vector<bool> code_mask_;
 };
 
 } // namespace tesseract.
@@ -17,6 +17,9 @@
 
 #include "weightmatrix.h"
 
+#include <tesseract/taskscheduler.h>
+
+#include <algorithm> // for std::copy
 #include <cassert> // for assert
 #include "intsimdmatrix.h"
 #include "simddetect.h" // for DotProduct
@@ -110,6 +113,20 @@ static inline void MatrixDotVectorInternal(const GENERIC_2D_ARRAY<TFloat> &w, bo
   }
 }
 
+// As MatrixDotVectorInternal with add_bias_fwd, for num_vectors inputs.
+// Each row of w is multiplied by all the inputs while it is in L1.
+static inline void MatrixDotVectorsInternal(const GENERIC_2D_ARRAY<TFloat> &w, int num_vectors,
+                                            const TFloat *const *u, TFloat *const *v) {
+  int num_results = w.dim1();
+  int extent = w.dim2() - 1;
+  for (int i = 0; i < num_results; ++i) {
+    const TFloat *wi = w[i];
+    for (int k = 0; k < num_vectors; ++k) {
+      v[k][i] = DotProduct(wi, u[k], extent) + wi[extent];
+    }
+  }
+}
+
 // Copies the whole input transposed, converted to TFloat, into *this.
 void TransposedArray::Transpose(const GENERIC_2D_ARRAY<TFloat> &input) {
   int width = input.dim1();
@@ -212,6 +229,92 @@ void WeightMatrix::ConvertToInt() {
   }
 }
 
+// Sets *this to the columns [start, start + count) of the given matrices,
+// stacked one above the other.
+void WeightMatrix::InitStacked(const WeightMatrix *parts, int num_parts, int start, int count,
+                               bool with_bias) {
+  int_mode_ = parts[0].int_mode_;
+  use_adam_ = false;
+  int num_out = 0;
+  for (int p = 0; p < num_parts; ++p) {
+    ASSERT_HOST(parts[p].int_mode_ == int_mode_);
+    num_out += parts[p].NumOutputs();
+  }
+  int row = 0;
+  if (int_mode_) {
+    wi_.ResizeNoInit(num_out, count + 1);
+    scales_.clear();
+    for (int p = 0; p < num_parts; ++p) {
+      const WeightMatrix &part = parts[p];
+      int bias = part.wi_.dim2() - 1;
+      for (int i = 0; i < part.wi_.dim1(); ++i, ++row) {
+        std::copy(part.wi_[i] + start, part.wi_[i] + start + count, wi_[row]);
+        wi_[row][count] = with_bias ? part.wi_[i][bias] : 0;
+        scales_.push_back(part.scales_[i]);
+      }
+    }
+    if (IntSimdMatrix::intSimdMatrix) {
+      int32_t rounded_num_out;
+      IntSimdMatrix::intSimdMatrix->Init(wi_, shaped_w_, rounded_num_out);
+      scales_.resize(rounded_num_out);
+    }
+  } else {
+    wf_.ResizeNoInit(num_out, count + 1);
+    for (int p = 0; p < num_parts; ++p) {
+      const WeightMatrix &part = parts[p];
+      int bias = part.wf_.dim2() - 1;
+      for (int i = 0; i < part.wf_.dim1(); ++i, ++row) {
+        std::copy(part.wf_[i] + start, part.wf_[i] + start + count, wf_[row]);
+        wf_[row][count] = with_bias ? part.wf_[i][bias] : 0.0;
+      }
+    }
+  }
+}
+
+// The inverse of InitStacked, see weightmatrix.h.
+void WeightMatrix::InitUnstacked(const WeightMatrix &inputs, const WeightMatrix &recurrents,
+                                 int first_row, int num_rows) {
+  ASSERT_HOST(inputs.int_mode_ == int_mode_ && recurrents.int_mode_ == int_mode_);
+  if (int_mode_) {
+    int split = inputs.wi_.dim2() - 1;
+    int count = recurrents.wi_.dim2() - 1;
+    wi_.ResizeNoInit(num_rows, split + count + 1);
+    scales_.clear();
+    for (int i = 0; i < num_rows; ++i) {
+      const int8_t *input_row = inputs.wi_[first_row + i];
+      const int8_t *recurrent_row = recurrents.wi_[first_row + i];
+      std::copy(input_row, input_row + split, wi_[i]);
+      std::copy(recurrent_row, recurrent_row + count, wi_[i] + split);
+      wi_[i][split + count] = input_row[split];
+      scales_.push_back(inputs.scales_[first_row + i]);
+    }
+    if (IntSimdMatrix::intSimdMatrix) {
+      int32_t rounded_num_out;
+      IntSimdMatrix::intSimdMatrix->Init(wi_, shaped_w_, rounded_num_out);
+      scales_.resize(rounded_num_out);
+    }
+  } else {
+    int split = inputs.wf_.dim2() - 1;
+    int count = recurrents.wf_.dim2() - 1;
+    wf_.ResizeNoInit(num_rows, split + count + 1);
+    for (int i = 0; i < num_rows; ++i) {
+      const TFloat *input_row = inputs.wf_[first_row + i];
+      const TFloat *recurrent_row = recurrents.wf_[first_row + i];
+      std::copy(input_row, input_row + split, wf_[i]);
+      std::copy(recurrent_row, recurrent_row + count, wf_[i] + split);
+      wf_[i][split + count] = input_row[split];
+    }
+  }
+}
+
+// Frees the weights, but not the mode or training data.
+void WeightMatrix::ReleaseWeights() {
+  wf_.DeAlloc();
+  wi_.DeAlloc();
+  std::vector<TFloat>().swap(scales_);
+  std::vector<int8_t>().swap(shaped_w_);
+}
+
 // Allocates any needed memory for running Backward, and zeroes the deltas,
 // thus eliminating any existing momentum.
 void WeightMatrix::InitBackward() {
@@ -400,6 +503,29 @@ void WeightMatrix::MatrixDotVector(const int8_t *u, TFloat *v) const {
   }
 }
 
+void WeightMatrix::MatrixDotVectors(int num_vectors, const TFloat *const *u,
+                                    TFloat *const *v) const {
+  assert(!int_mode_);
+  MatrixDotVectorsInternal(wf_, num_vectors, u, v);
+}
+
+void WeightMatrix::MatrixDotVectors(int num_vectors, const int8_t *const *u,
+                                    TFloat *const *v) const {
+  assert(int_mode_);
+  const IntSimdMatrix *simd = IntSimdMatrix::intSimdMatrix;
+  if (simd && simd->matrixDotVectorsFunction) {
+    simd->matrixDotVectorsFunction(wi_.dim1(), wi_.dim2(), &shaped_w_[0], &scales_[0],
+                                   num_vectors, u, v);
+  } else if (simd) {
+    for (int k = 0; k < num_vectors; ++k) {
+      simd->matrixDotVectorFunction(wi_.dim1(), wi_.dim2(), &shaped_w_[0], &scales_[0], u[k],
+                                    v[k]);
+    }
+  } else {
+    IntSimdMatrix::MatrixDotVectors(wi_, scales_, num_vectors, u, v);
+  }
+}
+
 // MatrixDotVector for peep weights, MultiplyAccumulate adds the
 // component-wise products of *this[0] and v to inout.
 void WeightMatrix::MultiplyAccumulate(const TFloat *v, TFloat *inout) {
@@ -436,10 +562,8 @@ void WeightMatrix::SumOuterTransposed(const TransposedArray &u, const Transposed
   int num_samples = u.dim2();
   // v is missing the last element in dim1.
   assert(v.dim1() == num_inputs);
-#ifdef _OPENMP
-#  pragma omp parallel for num_threads(4) if (in_parallel)
-#endif
-  for (int i = 0; i < num_outputs; ++i) {
+  TaskScheduler *scheduler = in_parallel ? TaskScheduler::Get() : TaskScheduler::Serial();
+  scheduler->ParallelFor(num_outputs, [&](int i) {
     TFloat *dwi = dw_[i];
     const TFloat *ui = u[i];
     for (int j = 0; j < num_inputs; ++j) {
@@ -451,7 +575,7 @@ void WeightMatrix::SumOuterTransposed(const TransposedArray &u, const Transposed
       total += ui[k];
     }
     dwi[num_inputs] = total;
-  }
+  });
 }
 
 // Updates the weights using the given learning rate and momentum.
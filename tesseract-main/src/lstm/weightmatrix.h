@@ -91,6 +91,22 @@ public:
   // Store a multiplicative scale factor (as a float) that will reproduce
   // the original value, subject to rounding errors.
   void ConvertToInt();
+  // Sets *this, for forward use only, to the columns [start, start + count)
+  // of the num_parts matrices in parts, stacked one above the other. The
+  // bias of each row is kept if with_bias, otherwise it is zero. In int mode
+  // each row keeps its scale, so the product with the stacked matrix is the
+  // partial sum over those columns of the product with the parts.
+  void InitStacked(const WeightMatrix *parts, int num_parts, int start, int count,
+                   bool with_bias);
+  // The inverse of InitStacked for a matrix split at column split: sets
+  // *this to the rows [first_row, first_row + num_rows) of inputs, without
+  // its bias column, followed by the same rows of recurrents and then the
+  // bias of inputs. The mode and training data of *this are kept.
+  void InitUnstacked(const WeightMatrix &inputs, const WeightMatrix &recurrents, int first_row,
+                     int num_rows);
+  // Frees the weights, but not the mode or training data, when a stacked
+  // copy holds them. InitUnstacked puts them back.
+  void ReleaseWeights();
   // Returns the size rounded up to an internal factor used by the SIMD
   // implementation for its input.
   int RoundInputs(int size) const {
@@ -135,6 +151,11 @@ public:
   // Asserts that the call matches what we have.
   void MatrixDotVector(const TFloat *u, TFloat *v) const;
   void MatrixDotVector(const int8_t *u, TFloat *v) const;
+  // As MatrixDotVector, but for num_vectors inputs at once: v[k] = Wu[k].
+  // Each part of the weights is used for all the inputs while it is in the
+  // cache, so this is a matrix-matrix product over a batch of lines.
+  void MatrixDotVectors(int num_vectors, const TFloat *const *u, TFloat *const *v) const;
+  void MatrixDotVectors(int num_vectors, const int8_t *const *u, TFloat *const *v) const;
   // MatrixDotVector for peep weights, MultiplyAccumulate adds the
   // component-wise products of *this[0] and v to inout.
   void MultiplyAccumulate(const TFloat *v, TFloat *inout);
@@ -74,6 +74,8 @@ void build(Solution &s)
             libtesseract["src/arch/dotproductsse.cpp"].args.push_back("-msse4.1");
             libtesseract["src/arch/intsimdmatrixsse.cpp"].args.push_back("-msse4.1");
             libtesseract["src/arch/intsimdmatrixavx2.cpp"].args.push_back("-mavx2");
+            libtesseract["src/arch/intsimdmatrixavx512vnni.cpp"].args.push_back("-mavx512f");
+            libtesseract["src/arch/intsimdmatrixavx512vnni.cpp"].args.push_back("-mavx512vnni");
         }
         if (!win_or_mingw)
         {
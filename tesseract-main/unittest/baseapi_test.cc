@@ -60,6 +60,25 @@ protected:
   static std::string TessdataPath() {
     return TESSDATA_DIR;
   }
+  // Reads the test image name into a plain 8 bit grey buffer with no
+  // padding at the end of the rows, as RecognizeLine takes it.
+  static void ReadGreyBuffer(const std::string &name, std::vector<unsigned char> *buffer,
+                             int *width, int *height) {
+    Image src_pix = pixRead(TestDataNameToPath(name).c_str());
+    CHECK(src_pix);
+    Image grey_pix = pixConvertTo8(src_pix, false);
+    *width = pixGetWidth(grey_pix);
+    *height = pixGetHeight(grey_pix);
+    buffer->resize(*width * *height);
+    for (int y = 0; y < *height; ++y) {
+      l_uint32 *line = pixGetData(grey_pix) + pixGetWpl(grey_pix) * y;
+      for (int x = 0; x < *width; ++x) {
+        (*buffer)[y * *width + x] = GET_DATA_BYTE(line, x);
+      }
+    }
+    grey_pix.destroy();
+    src_pix.destroy();
+  }
 };
 
 // Test static TessBaseAPI (like it is used by tesserocr).
@@ -223,6 +242,78 @@ TEST_F(TesseractTest, BasicLSTMTest) {
   src_pix.destroy();
 }
 
+// Tests that RecognizeLine reads a single line image from a plain grey buffer
+// as the full page pipeline does, with a confidence and a position for every
+// character.
+TEST_F(TesseractTest, RecognizeLineLSTMTest) {
+  tesseract::TessBaseAPI api;
+  if (api.Init(TessdataPath().c_str(), langs[0], tesseract::OEM_LSTM_ONLY) == -1) {
+    // eng.traineddata not found.
+    GTEST_SKIP();
+  }
+  std::vector<unsigned char> buffer;
+  int width, height;
+  ReadGreyBuffer(image_files[0], &buffer, &width, &height);
+
+  std::string text;
+  std::vector<float> confidences;
+  std::vector<int> x_starts, x_ends;
+  ASSERT_TRUE(api.RecognizeLine(&buffer[0], width, height, width, &text, &confidences,
+                                &x_starts, &x_ends));
+  trim(text);
+  EXPECT_STREQ(gt_text[0], text.c_str());
+  ASSERT_EQ(confidences.size(), x_starts.size());
+  ASSERT_EQ(x_starts.size(), x_ends.size());
+  for (size_t i = 0; i < x_starts.size(); ++i) {
+    EXPECT_GE(confidences[i], 0.0f);
+    EXPECT_LE(confidences[i], 100.0f);
+    EXPECT_LE(x_starts[i], x_ends[i]);
+    EXPECT_LE(x_ends[i], width + 8);
+    if (i > 0) {
+      EXPECT_LE(x_starts[i - 1], x_starts[i]);
+    }
+  }
+}
+
+// Test that a padded batch of lines of different widths reads each line as
+// RecognizeLine does on its own.
+TEST_F(TesseractTest, RecognizeLinesLSTMBatchTest) {
+  tesseract::TessBaseAPI api;
+  if (api.Init(TessdataPath().c_str(), langs[0], tesseract::OEM_LSTM_ONLY) == -1) {
+    // eng.traineddata not found.
+    GTEST_SKIP();
+  }
+  std::vector<unsigned char> buffer;
+  int width, height;
+  ReadGreyBuffer(image_files[0], &buffer, &width, &height);
+
+  // The whole line, its left half and the whole line again.
+  const int kNumLines = 3;
+  const unsigned char *images[kNumLines] = {&buffer[0], &buffer[0], &buffer[0]};
+  const int widths[kNumLines] = {width, width / 2, width};
+  const int heights[kNumLines] = {height, height, height};
+  const int bytes_per_lines[kNumLines] = {width, width, width};
+  std::vector<std::string> texts;
+  std::vector<std::vector<float>> confidences;
+  ASSERT_TRUE(api.RecognizeLines(kNumLines, images, widths, heights, bytes_per_lines, &texts,
+                                 &confidences));
+  ASSERT_EQ(static_cast<size_t>(kNumLines), texts.size());
+  ASSERT_EQ(static_cast<size_t>(kNumLines), confidences.size());
+  for (int i = 0; i < kNumLines; ++i) {
+    std::string text;
+    std::vector<float> line_confidences;
+    ASSERT_TRUE(api.RecognizeLine(images[i], widths[i], heights[i], bytes_per_lines[i], &text,
+                                  &line_confidences));
+    EXPECT_EQ(text, texts[i]);
+    ASSERT_EQ(line_confidences.size(), confidences[i].size());
+    for (size_t c = 0; c < line_confidences.size(); ++c) {
+      EXPECT_NEAR(line_confidences[c], confidences[i][c], 1e-3);
+    }
+  }
+  trim(texts[0]);
+  EXPECT_STREQ(gt_text[0], texts[0].c_str());
+}
+
 // Test that LSTM's character bounding boxes are properly converted to
 // Tesseract structures. Note that we can't guarantee that LSTM's
 // character boxes fall completely within Tesseract's word box because
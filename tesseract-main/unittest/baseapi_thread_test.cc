@@ -23,6 +23,7 @@
 #include <functional>
 #include <memory>
 #include <string>
+#include <thread>
 #ifdef INCLUDE_TENSORFLOW
 #  include <tensorflow/core/lib/core/threadpool.h>
 #endif
@@ -218,6 +219,28 @@ TEST_F(BaseapiThreadTest, TestRecognition) {
 #endif
 }
 
+// Test concurrent recognition by instances of one language, which share a
+// single lstm network.
+TEST_F(BaseapiThreadTest, TestSharedModel) {
+  const int n = 4;
+  std::vector<TessBaseAPI> tess(n);
+  std::vector<Image> pix(n);
+  for (int i = 0; i < n; ++i) {
+    InitTessInstance(&tess[i], langs_[0]);
+    pix[i] = pixCopy(nullptr, pix_[0]);
+  }
+  std::vector<std::string> ocr_text(n);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < n; ++i) {
+    threads.emplace_back(GetCleanedText, &tess[i], pix[i], std::ref(ocr_text[i]));
+  }
+  for (int i = 0; i < n; ++i) {
+    threads[i].join();
+    EXPECT_STREQ(gt_text_[0].c_str(), ocr_text[i].c_str());
+    pix[i].destroy();
+  }
+}
+
 TEST_F(BaseapiThreadTest, TestAll) {
 #ifdef INCLUDE_TENSORFLOW
   const int n = num_langs_ * FLAGS_reps;
@@ -18,6 +18,7 @@
 #include <sys/stat.h>
 #include <cstdlib> // for system
 #include <fstream> // for ifstream
+#include <memory>  // for std::unique_ptr
 #include <set>
 #include <string>
 #include <vector>
@@ -107,4 +108,37 @@ TEST_F(DawgTest, TestMatching) {
   EXPECT_TRUE(trie.prefix_in_dawg(space_apos, true));
 }
 
+TEST_F(DawgTest, TestIndexedNodes) {
+  // Words that give the squished dawg a node with edges for most of the
+  // unicharset, and a node with fewer, unsorted, edges, so that both kinds
+  // of indexed lookup are checked against the words.
+  UNICHARSET unicharset;
+  unicharset.load_from_file(file::JoinPath(TESTING_DIR, "eng.unicharset").c_str());
+  tesseract::Trie trie(tesseract::DAWG_TYPE_WORD, "indexed_dawg", NGRAM_PERM, unicharset.size(), 0);
+  const std::string letters = "zyxwvutsrqponmlkjihgfedcbaZYXWVUTSRQPONMLKJIHGFEDCBA9876543210";
+  std::vector<std::string> words, non_words;
+  for (char c : letters) {
+    words.push_back(std::string("a") + c);
+  }
+  for (size_t i = 0; i < 20; ++i) {
+    words.push_back(std::string("b") + letters[i] + "s");
+    non_words.push_back(std::string("b") + letters[i] + "t");
+    non_words.push_back(std::string("b") + letters[i]);
+  }
+  non_words.push_back("a");
+  non_words.push_back("ab!");
+  for (const auto &word : words) {
+    WERD_CHOICE choice(word.c_str(), unicharset);
+    EXPECT_TRUE(trie.add_word_to_dawg(choice));
+  }
+  std::unique_ptr<SquishedDawg> dawg(trie.trie_to_dawg());
+  for (const auto &word : words) {
+    EXPECT_TRUE(dawg->word_in_dawg(WERD_CHOICE(word.c_str(), unicharset))) << word;
+  }
+  for (const auto &word : non_words) {
+    EXPECT_FALSE(dawg->word_in_dawg(WERD_CHOICE(word.c_str(), unicharset))) << word;
+  }
+  EXPECT_TRUE(dawg->prefix_in_dawg(WERD_CHOICE("b0", unicharset), false));
+}
+
 } // namespace tesseract
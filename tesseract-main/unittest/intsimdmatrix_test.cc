@@ -17,6 +17,7 @@
 #include "intsimdmatrix.h"
 #include <gtest/gtest.h>
 #include <gtest/internal/gtest-port.h>
+#include <chrono>
 #include <memory>
 #include <vector>
 #include "include_gunit.h"
@@ -97,6 +98,69 @@ protected:
 #endif
   }
 
+  // Tests the function for several inputs over a range of sizes and numbers
+  // of inputs, odd ones included, against the generic version.
+  void ExpectEqualBatchResults(const IntSimdMatrix &matrix) {
+    ASSERT_NE(matrix.matrixDotVectorsFunction, nullptr);
+    const int kNumInputs[] = {1, 5, 31, 64, 97, 129};
+    for (int num_out = 1; num_out < 200; ++num_out) {
+      for (int num_in : kNumInputs) {
+        for (int num_vectors = 1; num_vectors <= 5; ++num_vectors) {
+          GENERIC_2D_ARRAY<int8_t> w = InitRandom(num_out, num_in + 1);
+          std::vector<TFloat> scales = RandomScales(num_out);
+          std::vector<std::vector<int8_t>> inputs;
+          std::vector<std::vector<TFloat>> base_results;
+          for (int k = 0; k < num_vectors; ++k) {
+            inputs.push_back(RandomVector(num_in, matrix));
+            base_results.emplace_back(num_out);
+            IntSimdMatrix::MatrixDotVector(w, scales, inputs[k].data(), base_results[k].data());
+          }
+          std::vector<int8_t> shaped_wi;
+          int32_t rounded_num_out;
+          matrix.Init(w, shaped_wi, rounded_num_out);
+          scales.resize(rounded_num_out);
+          std::vector<std::vector<TFloat>> test_results(num_vectors,
+                                                        std::vector<TFloat>(rounded_num_out));
+          std::vector<const int8_t *> u;
+          std::vector<TFloat *> v;
+          for (int k = 0; k < num_vectors; ++k) {
+            u.push_back(inputs[k].data());
+            v.push_back(test_results[k].data());
+          }
+          matrix.matrixDotVectorsFunction(w.dim1(), w.dim2(), &shaped_wi[0], &scales[0],
+                                          num_vectors, u.data(), v.data());
+          for (int k = 0; k < num_vectors; ++k) {
+            for (int i = 0; i < num_out; ++i) {
+              EXPECT_FLOAT_EQ(base_results[k][i], test_results[k][i])
+                  << "num_out=" << num_out << " num_in=" << num_in << " k=" << k << " i=" << i;
+            }
+          }
+        }
+      }
+    }
+  }
+
+  // Returns the mean time in ns of a product of a num_out x num_in matrix
+  // and a vector.
+  double TimeProduct(const IntSimdMatrix &matrix, int num_out, int num_in) {
+    const int kIterations = 2000;
+    GENERIC_2D_ARRAY<int8_t> w = InitRandom(num_out, num_in + 1);
+    std::vector<int8_t> u = RandomVector(num_in, matrix);
+    std::vector<TFloat> scales = RandomScales(num_out);
+    std::vector<int8_t> shaped_wi;
+    int32_t rounded_num_out;
+    matrix.Init(w, shaped_wi, rounded_num_out);
+    scales.resize(rounded_num_out);
+    std::vector<TFloat> result(rounded_num_out);
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kIterations; ++i) {
+      matrix.matrixDotVectorFunction(w.dim1(), w.dim2(), &shaped_wi[0], &scales[0], &u[0],
+                                     &result[0]);
+    }
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / kIterations;
+  }
+
   TRand random_;
 };
 
@@ -128,10 +192,52 @@ TEST_F(IntSimdMatrixTest, AVX2) {
     GTEST_SKIP();
   }
   ExpectEqualResults(IntSimdMatrix::intSimdMatrixAVX2);
+  ExpectEqualBatchResults(IntSimdMatrix::intSimdMatrixAVX2);
 #else
   GTEST_LOG_(INFO) << "AVX2 unsupported! Not tested!";
   GTEST_SKIP();
 #endif
 }
 
+// Tests that the AVX512 VNNI implementation gets the same result as the vanilla.
+TEST_F(IntSimdMatrixTest, AVX512VNNI) {
+#if defined(HAVE_AVX512VNNI)
+  if (!SIMDDetect::IsAVX512FAvailable() || !SIMDDetect::IsAVX512VNNIAvailable()) {
+    GTEST_LOG_(INFO) << "No AVX512 VNNI found! Not tested!";
+    GTEST_SKIP();
+  }
+  ExpectEqualResults(IntSimdMatrix::intSimdMatrixAVX512VNNI);
+  ExpectEqualBatchResults(IntSimdMatrix::intSimdMatrixAVX512VNNI);
+#else
+  GTEST_LOG_(INFO) << "AVX512 VNNI unsupported! Not tested!";
+  GTEST_SKIP();
+#endif
+}
+
+// Logs the time of the available kernels for the gate sizes of a typical
+// LSTM layer: 4 x 96 outputs of 96 + 96 inputs, as stacked in the LSTM.
+TEST_F(IntSimdMatrixTest, Speed) {
+  const int kNumOut = 384;
+  const int kNumIn = 192;
+#if defined(HAVE_SSE4_1)
+  if (SIMDDetect::IsSSEAvailable()) {
+    GTEST_LOG_(INFO) << "SSE: " << TimeProduct(IntSimdMatrix::intSimdMatrixSSE, kNumOut, kNumIn)
+                     << " ns";
+  }
+#endif
+#if defined(HAVE_AVX2)
+  if (SIMDDetect::IsAVX2Available()) {
+    GTEST_LOG_(INFO) << "AVX2: " << TimeProduct(IntSimdMatrix::intSimdMatrixAVX2, kNumOut, kNumIn)
+                     << " ns";
+  }
+#endif
+#if defined(HAVE_AVX512VNNI)
+  if (SIMDDetect::IsAVX512FAvailable() && SIMDDetect::IsAVX512VNNIAvailable()) {
+    GTEST_LOG_(INFO) << "AVX512 VNNI: "
+                     << TimeProduct(IntSimdMatrix::intSimdMatrixAVX512VNNI, kNumOut, kNumIn)
+                     << " ns";
+  }
+#endif
+}
+
 } // namespace tesseract
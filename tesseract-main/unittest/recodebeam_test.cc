@@ -21,6 +21,10 @@
 #include "unicharset_training_utils.h"
 
 #include "helpers.h"
+#include "labelconstraint.h"
+
+#include <algorithm>  // for std::max_element, std::sort
+#include <functional> // for std::greater
 
 namespace tesseract {
 
@@ -50,6 +54,12 @@ const float kZHTopScores[] = {0.98, 0.98, 0.98, 0.98, 0.98, 0.98, 0.98};
 const char *kZH2nds[] = {"学", "储", "投", "生", "学", "生", "实", nullptr};
 const float kZH2ndScores[] = {0.01, 0.01, 0.01, 0.01, 0.01, 0.01, 0.01};
 
+// A plate read with two characters that only the pattern can fix.
+const char *kPlateTops[] = {"A", "8", "1", "2", "3", "4", "O", nullptr};
+const float kPlateTopScores[] = {0.60, 0.60, 0.60, 0.60, 0.60, 0.60, 0.60};
+const char *kPlate2nds[] = {"4", "B", "l", "Z", "8", "A", "0", nullptr};
+const float kPlate2ndScores[] = {0.35, 0.35, 0.35, 0.35, 0.35, 0.35, 0.35};
+
 const char *kViTops[] = {"v", "ậ", "y", " ", "t", "ộ", "i", nullptr};
 const float kViTopScores[] = {0.98, 0.98, 0.98, 0.98, 0.98, 0.98, 0.97};
 const char *kVi2nds[] = {"V", "a", "v", "", "l", "o", "", nullptr};
@@ -101,6 +111,78 @@ protected:
     lstm_dict_.FinishLoad();
   }
 
+  // Runs the top-n selection of beam_search on outputs, leaving out the codes
+  // in excluded if not nullptr, and expects the same flags, top and second
+  // codes as a scan of every output with the same heap. The codes flagged
+  // must also hold the top_n largest values. null_char must have the
+  // smallest output, and more than top_n other codes must be left in.
+  void ExpectTopNMatchesScan(RecodeBeamSearch &beam_search, const std::vector<float> &outputs,
+                             int null_char, int top_n, std::unordered_set<int> *excluded) {
+    int num_outputs = outputs.size();
+    if (excluded == nullptr) {
+      beam_search.ComputeTopN(outputs.data(), num_outputs, top_n);
+    } else {
+      beam_search.ComputeSecTopN(excluded, outputs.data(), num_outputs, top_n);
+    }
+
+    // The scan without any skipping.
+    GenericHeap<KDPairInc<float, int>> heap;
+    for (int i = 0; i < num_outputs; ++i) {
+      if ((heap.size() < top_n || outputs[i] > heap.PeekTop().key()) &&
+          (excluded == nullptr || excluded->count(i) == 0)) {
+        KDPairInc<float, int> entry(outputs[i], i);
+        heap.Push(&entry);
+        if (heap.size() > top_n) {
+          heap.Pop(&entry);
+        }
+      }
+    }
+    std::vector<TopNState> flags(num_outputs, TN_ALSO_RAN);
+    int top_code = -1;
+    int second_code = -1;
+    while (!heap.empty()) {
+      KDPairInc<float, int> entry;
+      heap.Pop(&entry);
+      if (heap.size() > 1) {
+        flags[entry.data()] = TN_TOPN;
+      } else {
+        flags[entry.data()] = TN_TOP2;
+        if (heap.empty()) {
+          top_code = entry.data();
+        } else {
+          second_code = entry.data();
+        }
+      }
+    }
+    flags[null_char] = TN_TOP2;
+    EXPECT_EQ(top_code, beam_search.top_code_);
+    EXPECT_EQ(second_code, beam_search.second_code_);
+    ASSERT_EQ(flags.size(), beam_search.top_n_flags_.size());
+    for (int i = 0; i < num_outputs; ++i) {
+      EXPECT_EQ(flags[i], beam_search.top_n_flags_[i]) << "code " << i;
+    }
+
+    // Whichever of tied codes is kept, the values are the top_n largest.
+    std::vector<float> expected, selected;
+    for (int i = 0; i < num_outputs; ++i) {
+      if (i == null_char || (excluded != nullptr && excluded->count(i) != 0)) {
+        continue;
+      }
+      expected.push_back(outputs[i]);
+      if (beam_search.top_n_flags_[i] != TN_ALSO_RAN) {
+        selected.push_back(outputs[i]);
+      }
+    }
+    std::sort(expected.begin(), expected.end(), std::greater<float>());
+    expected.resize(top_n);
+    std::sort(selected.begin(), selected.end(), std::greater<float>());
+    EXPECT_EQ(expected, selected);
+    EXPECT_EQ(expected[0], outputs[beam_search.top_code_]);
+    if (top_n > 1) {
+      EXPECT_EQ(expected[1], outputs[beam_search.second_code_]);
+    }
+  }
+
   // Expects the appropriate results from the compressed_  ccutil_.unicharset.
   void ExpectCorrect(const GENERIC_2D_ARRAY<float> &output,
                      const std::vector<int> &transcription) {
@@ -196,6 +278,35 @@ protected:
       EXPECT_EQ(truth_utf8, w_trunc);
     }
   }
+  // Returns the best path of output as utf8, decoded with the constraint.
+  std::string DecodeConstrained(const GENERIC_2D_ARRAY<float> &output,
+                                const LabelConstraint *constraint) {
+    RecodeBeamSearch beam_search(recoder_, encoded_null_char_, false, nullptr);
+    beam_search.SetConstraint(constraint, ccutil_.unicharset);
+    beam_search.Decode(output, 1.0, 0.0, RecodeBeamSearch::kMinCertainty, nullptr);
+    std::vector<int> unichar_ids, xcoords;
+    std::vector<float> certainties, ratings;
+    beam_search.ExtractBestPathAsUnicharIds(false, &ccutil_.unicharset, &unichar_ids, &certainties,
+                                            &ratings, &xcoords);
+    std::string decoded;
+    for (int unichar_id : unichar_ids) {
+      decoded += ccutil_.unicharset.id_to_unichar(unichar_id);
+    }
+    return decoded;
+  }
+  // Returns true if constraint accepts the whole of utf8_str.
+  bool Accepts(const LabelConstraint &constraint, const char *utf8_str) {
+    std::vector<int> unichar_ids;
+    EXPECT_TRUE(ccutil_.unicharset.encode_string(utf8_str, true, &unichar_ids, nullptr, nullptr));
+    int state = 0;
+    for (int unichar_id : unichar_ids) {
+      state = constraint.Next(state, unichar_id);
+      if (state < 0) {
+        return false;
+      }
+    }
+    return constraint.IsFinal(state);
+  }
   // Generates easy encoding of the given unichar_ids, and pads with at least
   // padding of random data.
   GENERIC_2D_ARRAY<float> GenerateRandomPaddedOutputs(const std::vector<int> &unichar_ids,
@@ -419,6 +530,41 @@ TEST_F(RecodeBeamTest, DoesEnglish) {
   ExpectCorrect(outputs, transcription);
 }
 
+// Tests the automaton compiled from a pattern.
+TEST_F(RecodeBeamTest, PatternConstraint) {
+  LoadUnicharset("eng.unicharset");
+  PatternConstraint constraint;
+  EXPECT_FALSE(constraint.Compile("[A-Z", ccutil_.unicharset));
+  EXPECT_FALSE(constraint.Compile("A{3,1}", ccutil_.unicharset));
+  EXPECT_FALSE(constraint.Compile("?A", ccutil_.unicharset));
+  ASSERT_TRUE(constraint.Compile("[A-HJ-Z]{2}[0-9]{3,4}|X.?", ccutil_.unicharset));
+  EXPECT_TRUE(Accepts(constraint, "AB123"));
+  EXPECT_TRUE(Accepts(constraint, "AB1234"));
+  EXPECT_TRUE(Accepts(constraint, "AB 1234"));
+  EXPECT_FALSE(Accepts(constraint, "AB12"));
+  EXPECT_FALSE(Accepts(constraint, "AB12345"));
+  EXPECT_FALSE(Accepts(constraint, "AI123"));
+  EXPECT_FALSE(Accepts(constraint, "A1123"));
+  EXPECT_TRUE(Accepts(constraint, "X"));
+  EXPECT_TRUE(Accepts(constraint, "X7"));
+  EXPECT_TRUE(Accepts(constraint, "XY123"));
+  EXPECT_FALSE(Accepts(constraint, "XYZ"));
+}
+
+// Tests that the beam search only produces what the constraint accepts.
+TEST_F(RecodeBeamTest, DoesConstrainedPlate) {
+  LoadUnicharset("eng.unicharset");
+  GENERIC_2D_ARRAY<float> outputs =
+      GenerateSyntheticOutputs(kPlateTops, kPlateTopScores, kPlate2nds, kPlate2ndScores, nullptr);
+  EXPECT_EQ("A81234O", DecodeConstrained(outputs, nullptr));
+  PatternConstraint constraint;
+  ASSERT_TRUE(constraint.Compile("[A-Z]{2}[0-9]{5}", ccutil_.unicharset));
+  EXPECT_EQ("AB12340", DecodeConstrained(outputs, &constraint));
+  // There are only 7 characters, so nothing matches and nothing is output.
+  ASSERT_TRUE(constraint.Compile("[A-Z]{8}", ccutil_.unicharset));
+  EXPECT_EQ("", DecodeConstrained(outputs, &constraint));
+}
+
 TEST_F(RecodeBeamTest, DISABLED_EngDictionary) {
   LOG(INFO) << "Testing eng dictionary"
             << "\n";
@@ -466,6 +612,43 @@ TEST_F(RecodeBeamTest, DISABLED_ChiDictionary) {
   }
 }
 
+// Tests that the top-n selection, which skips the blocks of outputs that
+// can't enter the top-n, selects as a scan of every output does. The sizes
+// are not multiples of the block size, the rows are random, and some have
+// many ties. The same search is reused, so stale flags would show.
+TEST_F(RecodeBeamTest, SelectTopNMatchesScan) {
+  const int kSizes[] = {5, 16, 23, 47, 64, 100, 111, 257};
+  const int kTopNs[] = {1, 2, 3, 8};
+  TRand random;
+  RecodeBeamSearch beam_search(recoder_, 0, false, nullptr);
+  for (int num_outputs : kSizes) {
+    for (int top_n : kTopNs) {
+      if (top_n + 4 >= num_outputs) {
+        continue;
+      }
+      for (int row = 0; row < 20; ++row) {
+        // Every other row has values from only 4 levels, so ties are common.
+        bool ties = row % 2 == 1;
+        std::vector<float> outputs(num_outputs);
+        for (auto &output : outputs) {
+          output = ties ? random.IntRand() % 4 / 4.0f : static_cast<float>(random.UnsignedRand(1.0));
+        }
+        // The null char has the smallest output.
+        outputs[0] = -1.0f;
+        ExpectTopNMatchesScan(beam_search, outputs, 0, top_n, nullptr);
+        // Leave out 3 codes, the top one among them when there is one.
+        std::unordered_set<int> excluded;
+        int best = std::max_element(outputs.begin(), outputs.end()) - outputs.begin();
+        excluded.insert(best);
+        while (excluded.size() < 3) {
+          excluded.insert(1 + random.IntRand() % (num_outputs - 1));
+        }
+        ExpectTopNMatchesScan(beam_search, outputs, 0, top_n, &excluded);
+      }
+    }
+  }
+}
+
 // Tests that a recoder built with decomposed unicode allows true ctc
 // arbitrary duplicates and inserted nulls inside the multicode sequence.
 TEST_F(RecodeBeamTest, DISABLED_MultiCodeSequences) {
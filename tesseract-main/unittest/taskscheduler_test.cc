@@ -0,0 +1,117 @@
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <tesseract/taskscheduler.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "include_gunit.h"
+
+namespace tesseract {
+
+// Tests that the schedulers run every task exactly once, including calls
+// nested in tasks and calls made from several threads at once.
+
+class TaskSchedulerTest : public ::testing::Test {
+protected:
+  // Runs count tasks on scheduler and checks that each ran once.
+  static void ExpectAllRunOnce(TaskScheduler *scheduler, int count) {
+    std::vector<std::atomic<int>> runs(count);
+    scheduler->ParallelFor(count, [&runs](int i) { ++runs[i]; });
+    for (int i = 0; i < count; ++i) {
+      EXPECT_EQ(1, runs[i].load()) << "task " << i;
+    }
+  }
+};
+
+TEST_F(TaskSchedulerTest, Serial) {
+  ExpectAllRunOnce(TaskScheduler::Serial(), 0);
+  ExpectAllRunOnce(TaskScheduler::Serial(), 100);
+  // The serial scheduler keeps the order of the tasks.
+  std::vector<int> order;
+  TaskScheduler::Serial()->ParallelFor(10, [&order](int i) { order.push_back(i); });
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_EQ(i, order[i]);
+  }
+}
+
+TEST_F(TaskSchedulerTest, ThreadPool) {
+  auto pool = TaskScheduler::NewThreadPool(4);
+  ExpectAllRunOnce(pool.get(), 0);
+  ExpectAllRunOnce(pool.get(), 1);
+  ExpectAllRunOnce(pool.get(), 1000);
+  // A pool with no thread but the caller still runs everything.
+  auto single = TaskScheduler::NewThreadPool(1);
+  ExpectAllRunOnce(single.get(), 100);
+}
+
+TEST_F(TaskSchedulerTest, Nested) {
+  auto pool = TaskScheduler::NewThreadPool(3);
+  const int kOuter = 20;
+  const int kInner = 50;
+  std::vector<std::atomic<int>> runs(kOuter * kInner);
+  // More nested calls than threads, so waiting tasks must help.
+  pool->ParallelFor(kOuter, [&](int o) {
+    pool->ParallelFor(kInner, [&](int i) { ++runs[o * kInner + i]; });
+  });
+  for (auto &run : runs) {
+    EXPECT_EQ(1, run.load());
+  }
+}
+
+TEST_F(TaskSchedulerTest, ManyCallers) {
+  auto pool = TaskScheduler::NewThreadPool(4);
+  std::vector<std::thread> callers;
+  for (int c = 0; c < 4; ++c) {
+    callers.emplace_back([&pool] {
+      for (int r = 0; r < 20; ++r) {
+        ExpectAllRunOnce(pool.get(), 64);
+      }
+    });
+  }
+  for (auto &caller : callers) {
+    caller.join();
+  }
+}
+
+TEST_F(TaskSchedulerTest, SetAndSerialScope) {
+  auto pool = TaskScheduler::NewThreadPool(2);
+  TaskScheduler::Set(pool.get());
+  EXPECT_EQ(pool.get(), TaskScheduler::Get());
+  {
+    TaskScheduler::SerialScope serial;
+    EXPECT_EQ(TaskScheduler::Serial(), TaskScheduler::Get());
+    {
+      TaskScheduler::SerialScope inner;
+      EXPECT_EQ(TaskScheduler::Serial(), TaskScheduler::Get());
+    }
+    EXPECT_EQ(TaskScheduler::Serial(), TaskScheduler::Get());
+    // The scope is of this thread only.
+    TaskScheduler *other = nullptr;
+    std::thread thread([&other] { other = TaskScheduler::Get(); });
+    thread.join();
+    EXPECT_EQ(pool.get(), other);
+  }
+  EXPECT_EQ(pool.get(), TaskScheduler::Get());
+  TaskScheduler::Set(nullptr);
+  TaskScheduler *default_scheduler = TaskScheduler::Get();
+  EXPECT_NE(pool.get(), default_scheduler);
+#ifdef _OPENMP
+  EXPECT_NE(TaskScheduler::Serial(), default_scheduler);
+#else
+  // Without OpenMP the default is serial.
+  EXPECT_EQ(TaskScheduler::Serial(), default_scheduler);
+#endif
+  ExpectAllRunOnce(default_scheduler, 100);
+}
+
+} // namespace tesseract
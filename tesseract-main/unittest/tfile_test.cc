@@ -10,6 +10,7 @@
 // limitations under the License.
 
 #include "serialis.h"
+#include "tessdatamanager.h"
 
 #include "include_gunit.h"
 
@@ -212,4 +213,53 @@ TEST_F(TfileTest, BigEndian) {
   m3.ExpectEq(m2);
 }
 
+TEST_F(TfileTest, InPlace) {
+  // This test verifies that a TFile reads the same from a buffer it
+  // doesn't copy.
+  MathData m1;
+  m1.Setup();
+  std::vector<char> data;
+  TFile fpw;
+  fpw.OpenWrite(&data);
+  EXPECT_TRUE(m1.Serialize(&fpw));
+  TFile fpr;
+  fpr.OpenInPlace(&data[0], data.size());
+  MathData m2;
+  EXPECT_TRUE(m2.DeSerialize(&fpr));
+  m1.ExpectEq(m2);
+  // Reading past the end fails as it does on a copy.
+  MathData m3;
+  EXPECT_FALSE(m3.DeSerialize(&fpr));
+}
+
+TEST_F(TfileTest, MappedTraineddata) {
+  // This test verifies that the components of a mapped traineddata read the
+  // same as those of a copied one.
+  MathData m1;
+  m1.Setup();
+  std::vector<char> data;
+  TFile fpw;
+  fpw.OpenWrite(&data);
+  EXPECT_TRUE(m1.Serialize(&fpw));
+  TessdataManager writer;
+  writer.OverwriteEntry(TESSDATA_LSTM, &data[0], data.size());
+  writer.SetVersionString("mapped");
+  std::string filename = file::JoinPath(FLAGS_test_tmpdir, "mapped.traineddata");
+  EXPECT_TRUE(writer.SaveFile(filename.c_str(), nullptr));
+
+  for (bool map_file : {false, true}) {
+    TessdataManager mgr;
+    mgr.set_map_file(map_file);
+    EXPECT_TRUE(mgr.Init(filename.c_str()));
+    EXPECT_TRUE(mgr.IsLSTMAvailable());
+    EXPECT_FALSE(mgr.IsBaseAvailable());
+    EXPECT_EQ("mapped", mgr.VersionString());
+    TFile fpr;
+    EXPECT_TRUE(mgr.GetComponent(TESSDATA_LSTM, &fpr));
+    MathData m2;
+    EXPECT_TRUE(m2.DeSerialize(&fpr));
+    m1.ExpectEq(m2);
+  }
+}
+
 } // namespace tesseract
@@ -0,0 +1,190 @@
+///////////////////////////////////////////////////////////////////////
+// File:        weightmatrix_test.cc
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+///////////////////////////////////////////////////////////////////////
+
+#include "weightmatrix.h"
+#include <vector>
+#include "helpers.h"
+#include "include_gunit.h"
+
+namespace tesseract {
+
+class WeightMatrixTest : public ::testing::Test {
+protected:
+  static const int kNumParts = 4;
+  static const int kNumOutputs = 37;
+  static const int kNumInputs = 29;
+  static const int kNumRecurrent = 41;
+
+  void SetUp() override {
+    std::locale::global(std::locale(""));
+    for (auto &part : parts_) {
+      // The extra input is the bias.
+      part.InitWeightsFloat(kNumOutputs, kNumInputs + kNumRecurrent + 1, false, 0.5f, &random_);
+    }
+  }
+
+  // Makes a random float input vector of the given size.
+  std::vector<TFloat> RandomFloats(int size) {
+    std::vector<TFloat> v(size);
+    for (auto &value : v) {
+      value = random_.SignedRand(1.0);
+    }
+    return v;
+  }
+  // Makes a random int8_t input vector, rounded up for the SIMD functions.
+  std::vector<int8_t> RandomInts(int size, const WeightMatrix &matrix) {
+    std::vector<int8_t> v(matrix.RoundInputs(size), 0);
+    for (int i = 0; i < size; ++i) {
+      v[i] = static_cast<int8_t>(random_.SignedRand(INT8_MAX));
+    }
+    return v;
+  }
+  // Returns the size needed for the output of the given matrix.
+  static int OutputSize(const WeightMatrix &matrix) {
+    int size = matrix.NumOutputs();
+    if (matrix.is_int_mode() && IntSimdMatrix::intSimdMatrix) {
+      size = IntSimdMatrix::intSimdMatrix->RoundOutputs(size);
+    }
+    return size;
+  }
+
+  // Checks that the stacked input and recurrent matrices add up to the
+  // product with each of the parts.
+  template <typename T>
+  void ExpectStackedEqual(const std::vector<T> &input, const std::vector<T> &recurrent,
+                          const std::vector<T> &full, double tolerance) {
+    WeightMatrix input_weights, recurrent_weights;
+    input_weights.InitStacked(parts_, kNumParts, 0, kNumInputs, true);
+    recurrent_weights.InitStacked(parts_, kNumParts, kNumInputs, kNumRecurrent, false);
+    EXPECT_EQ(kNumParts * kNumOutputs, input_weights.NumOutputs());
+    EXPECT_EQ(kNumParts * kNumOutputs, recurrent_weights.NumOutputs());
+    std::vector<TFloat> input_result(OutputSize(input_weights));
+    std::vector<TFloat> recurrent_result(OutputSize(recurrent_weights));
+    input_weights.MatrixDotVector(&input[0], &input_result[0]);
+    recurrent_weights.MatrixDotVector(&recurrent[0], &recurrent_result[0]);
+    for (int p = 0; p < kNumParts; ++p) {
+      std::vector<TFloat> part_result(OutputSize(parts_[p]));
+      parts_[p].MatrixDotVector(&full[0], &part_result[0]);
+      for (int i = 0; i < kNumOutputs; ++i) {
+        int row = p * kNumOutputs + i;
+        EXPECT_NEAR(part_result[i], input_result[row] + recurrent_result[row], tolerance)
+            << "part=" << p << " i=" << i;
+      }
+    }
+  }
+
+  // Checks that InitUnstacked rebuilds each of the parts from the stacked
+  // matrices as it was, comparing the serialized bytes.
+  void ExpectUnstackedEqual() {
+    WeightMatrix input_weights, recurrent_weights;
+    input_weights.InitStacked(parts_, kNumParts, 0, kNumInputs, true);
+    recurrent_weights.InitStacked(parts_, kNumParts, kNumInputs, kNumRecurrent, false);
+    for (int p = 0; p < kNumParts; ++p) {
+      std::vector<char> expected, result;
+      TFile fp;
+      fp.OpenWrite(&expected);
+      ASSERT_TRUE(parts_[p].Serialize(false, &fp));
+      WeightMatrix part(parts_[p]);
+      part.ReleaseWeights();
+      EXPECT_EQ(0, part.NumOutputs());
+      part.InitUnstacked(input_weights, recurrent_weights, p * kNumOutputs, kNumOutputs);
+      fp.OpenWrite(&result);
+      ASSERT_TRUE(part.Serialize(false, &fp));
+      EXPECT_EQ(expected, result) << "part=" << p;
+    }
+  }
+
+  WeightMatrix parts_[kNumParts];
+  TRand random_;
+};
+
+// Tests that MatrixDotVectors gives the same results as MatrixDotVector.
+TEST_F(WeightMatrixTest, MatrixDotVectorsFloat) {
+  const int kNumVectors = 5;
+  std::vector<std::vector<TFloat>> inputs, results(kNumVectors);
+  const TFloat *u[kNumVectors];
+  TFloat *v[kNumVectors];
+  for (int k = 0; k < kNumVectors; ++k) {
+    inputs.push_back(RandomFloats(kNumInputs + kNumRecurrent));
+    results[k].resize(kNumOutputs);
+    u[k] = &inputs[k][0];
+    v[k] = &results[k][0];
+  }
+  parts_[0].MatrixDotVectors(kNumVectors, u, v);
+  for (int k = 0; k < kNumVectors; ++k) {
+    std::vector<TFloat> expected(kNumOutputs);
+    parts_[0].MatrixDotVector(u[k], &expected[0]);
+    for (int i = 0; i < kNumOutputs; ++i) {
+      EXPECT_DOUBLE_EQ(expected[i], results[k][i]) << "k=" << k << " i=" << i;
+    }
+  }
+}
+
+TEST_F(WeightMatrixTest, MatrixDotVectorsInt) {
+  parts_[0].ConvertToInt();
+  const int kNumVectors = 5;
+  std::vector<std::vector<int8_t>> inputs;
+  std::vector<std::vector<TFloat>> results(kNumVectors);
+  const int8_t *u[kNumVectors];
+  TFloat *v[kNumVectors];
+  for (int k = 0; k < kNumVectors; ++k) {
+    inputs.push_back(RandomInts(kNumInputs + kNumRecurrent, parts_[0]));
+    results[k].resize(OutputSize(parts_[0]));
+    u[k] = &inputs[k][0];
+    v[k] = &results[k][0];
+  }
+  parts_[0].MatrixDotVectors(kNumVectors, u, v);
+  for (int k = 0; k < kNumVectors; ++k) {
+    std::vector<TFloat> expected(OutputSize(parts_[0]));
+    parts_[0].MatrixDotVector(u[k], &expected[0]);
+    for (int i = 0; i < kNumOutputs; ++i) {
+      EXPECT_FLOAT_EQ(expected[i], results[k][i]) << "k=" << k << " i=" << i;
+    }
+  }
+}
+
+// Tests that the split into stacked input and recurrent columns, as used by
+// the LSTM at inference, gives the same gates as the whole matrices.
+TEST_F(WeightMatrixTest, StackedFloat) {
+  std::vector<TFloat> full = RandomFloats(kNumInputs + kNumRecurrent);
+  std::vector<TFloat> input(full.begin(), full.begin() + kNumInputs);
+  std::vector<TFloat> recurrent(full.begin() + kNumInputs, full.end());
+  ExpectStackedEqual(input, recurrent, full, 1e-5);
+}
+
+TEST_F(WeightMatrixTest, StackedInt) {
+  for (auto &part : parts_) {
+    part.ConvertToInt();
+  }
+  std::vector<int8_t> full = RandomInts(kNumInputs + kNumRecurrent, parts_[0]);
+  std::vector<int8_t> input(parts_[0].RoundInputs(kNumInputs), 0);
+  std::vector<int8_t> recurrent(parts_[0].RoundInputs(kNumRecurrent), 0);
+  std::copy(full.begin(), full.begin() + kNumInputs, input.begin());
+  std::copy(full.begin() + kNumInputs, full.begin() + kNumInputs + kNumRecurrent,
+            recurrent.begin());
+  ExpectStackedEqual(input, recurrent, full, 1e-4);
+}
+
+// Tests that the LSTM can free its gates after stacking and get them back.
+TEST_F(WeightMatrixTest, UnstackedFloat) {
+  ExpectUnstackedEqual();
+}
+
+TEST_F(WeightMatrixTest, UnstackedInt) {
+  for (auto &part : parts_) {
+    part.ConvertToInt();
+  }
+  ExpectUnstackedEqual();
+}
+
+} // namespace tesseract